@@ -4,6 +4,7 @@
 #include "xmlrpc_params.h"
 #include "cros_node.h"
 #include "cros_message.h"
+#include "cros_codec.h"
 
 typedef enum CrosTransportType
 {
@@ -249,7 +250,7 @@ struct SubConnectionData
 struct BusInfo
 {
   int connectionId;
-  int destinationId;
+  char *destinationId;                //! Caller id of the subscriber or URI of the publisher
   CrosTransportDirection direction;
   CrosTransportType transport;
   char *topic;
@@ -300,6 +301,13 @@ typedef CallbackResponse (*ServiceProviderApiCallback)(cRosMessage *request, cRo
 typedef CallbackResponse (*SubscriberApiCallback)(cRosMessage *message,  void *context);
 typedef CallbackResponse (*PublisherApiCallback)(cRosMessage *message, void *context);
 
+/*! \brief Callback that receives the response of a service call
+ *
+ *  \param callid The id returned by cRosApiCallService()
+ *  \param response The response message, NULL if the call failed
+ */
+typedef void (*ServiceCallerApiCallback)(int callid, cRosMessage *response, void *context);
+
 // Master api: register/unregister methods
 int cRosApiRegisterServiceProvider(CrosNode *node, const char *service_name, const char *service_type, ServiceProviderApiCallback callback, NodeStatusCallback status_callback, void *context);
 int cRosApisUnegisterServiceProvider(CrosNode *node, int svcidx);
@@ -308,6 +316,112 @@ int cRosApiUnregisterSubscriber(CrosNode *node, int subidx);
 int cRosApiRegisterPublisher(CrosNode *node, const char *topic_name, const char *topic_type, int loop_period, PublisherApiCallback callback, NodeStatusCallback status_callback, void *context);
 int cRosApiUnregisterPublisher(CrosNode *node, int pubidx);
 
+/*! \brief Deserialize the messages of a subscriber in a bump arena instead of the heap
+ *
+ *  The arena is reset before each incoming message, so the strings and arrays of the
+ *  message passed to the subscriber callback are valid only until the next message
+ *
+ *  \param block_size Size of the arena blocks, 0 to use CROS_ARENA_BLOCK_SIZE
+ *  \param enable 1 to enable the arena, 0 to get back to heap allocated messages
+ *  \return Returns 0 on success, -1 on failure
+ */
+int cRosApiSetSubscriberArena(CrosNode *node, int subidx, int enable, size_t block_size);
+
+typedef CallbackResponse (*RawSubscriberApiCallback)(DynBuffer *message, void *context);
+
+/*! \brief Register a subscriber that receives the messages as they are on the wire, without
+ *         deserializing them (e.g., to record or forward them). The message file of topic_type
+ *         is read only to get the md5sum and the definition of the type
+ *
+ *  \param callback The callback that receives the serialized message (size prefix excluded).
+ *                  The buffer is a view of the connection buffer, valid only during the callback
+ *  \return Returns the index of the subscriber on success, -1 on failure
+ */
+int cRosApiRegisterRawSubscriber(CrosNode *node, const char *topic_name, const char *topic_type,
+                                 RawSubscriberApiCallback callback, NodeStatusCallback status_callback, void *context);
+
+// Typed providers: messages and services defined by the code generated with cRosGentoolsGenerateC()
+
+typedef CallbackResponse (*TypedPublisherApiCallback)(void *message, void *context);
+typedef CallbackResponse (*TypedSubscriberApiCallback)(void *message, void *context);
+typedef CallbackResponse (*TypedServiceProviderApiCallback)(void *request, void *response, void *context);
+
+/*! \brief Register a publisher of a generated message type. The callback fills a struct
+ *         of the type described by codec, the .msg files are not needed at runtime
+ *
+ *  \return Returns the index of the publisher on success, -1 on failure
+ */
+int cRosApiRegisterTypedPublisher(CrosNode *node, const char *topic_name, const CrosMessageCodec *codec, int loop_period,
+                                  TypedPublisherApiCallback callback, NodeStatusCallback status_callback, void *context);
+
+/*! \brief Register a subscriber of a generated message type. The struct passed to the callback
+ *         is reused (its strings and arrays are reallocated) by the next messages
+ *
+ *  \return Returns the index of the subscriber on success, -1 on failure
+ */
+int cRosApiRegisterTypedSubscriber(CrosNode *node, const char *topic_name, const CrosMessageCodec *codec,
+                                   TypedSubscriberApiCallback callback, NodeStatusCallback status_callback, void *context);
+
+/*! \brief Register a provider of a generated service type
+ *
+ *  \return Returns the index of the service provider on success, -1 on failure
+ */
+int cRosApiRegisterTypedServiceProvider(CrosNode *node, const char *service_name, const CrosServiceCodec *codec,
+                                        TypedServiceProviderApiCallback callback, NodeStatusCallback status_callback,
+                                        void *context);
+
+/*! \brief Send the response of a deferred request of a typed service provider
+ *
+ *  \param codec The response codec of the service (i.e., CrosServiceCodec::response)
+ *  \param response The response struct, NULL to report to the caller that the service failed
+ *  \return Returns 0 on success, -1 if the request is no more waiting
+ */
+int cRosApiSendTypedServiceResponse(CrosNode *node, int callid, const CrosMessageCodec *codec, const void *response);
+
+// Service calls
+
+/*! \brief Register a client of a service provided by another node. The provider is looked up
+ *         through the node lookup cache
+ *
+ *  \param persistent If 1, the connection to the provider is kept open and the queued requests
+ *                    are pipelined on it
+ *  \param callback The callback that receives the responses, in the order of the calls
+ *  \return Returns the index of the service caller on success, -1 on failure
+ */
+int cRosApiRegisterServiceCaller(CrosNode *node, const char *service_name, const char *service_type, int persistent, ServiceCallerApiCallback callback, NodeStatusCallback status_callback, void *context);
+
+/*! \brief Unregister the service caller. The pending calls fail with a NULL response
+ */
+int cRosApiUnregisterServiceCaller(CrosNode *node, int svccalleridx);
+
+/*! \brief Get the request message to be filled before calling cRosApiCallService()
+ */
+cRosMessage * cRosApiGetServiceCallerRequest(CrosNode *node, int svccalleridx);
+
+/*! \brief Call the service asynchronously with the current request message. The response
+ *         is delivered to the caller callback by cRosNodeDoEventsLoop()
+ *
+ *  \return Returns the call id on success, -1 on failure
+ */
+int cRosApiCallService(CrosNode *node, int svccalleridx);
+
+// Service providers: deferred responses
+
+/*! \brief Get the id of the request being served. Valid only inside a service provider
+ *         callback: a callback that returns CN_SERVICE_RESPONSE_DEFERRED must save it
+ *         to answer later with cRosApiSendServiceResponse()
+ */
+int cRosApiGetServiceCallId(CrosNode *node);
+
+/*! \brief Send the response of a deferred service request
+ *
+ *  \param callid The id returned by cRosApiGetServiceCallId() inside the provider callback
+ *  \param response The response message (e.g., the one passed to the provider callback),
+ *                  NULL to report to the caller that the service failed
+ *  \return Returns 0 on success, -1 if the request is no more waiting (e.g., the caller disconnected)
+ */
+int cRosApiSendServiceResponse(CrosNode *node, int callid, cRosMessage *response);
+
 // Master api: name service and system state
 int cRosApiLookupNode(CrosNode *node, const char *node_name, LookupNodeCallback callback, void *context);
 int cRosApiGetPublishedTopics(CrosNode *node, const char *subgraph, GetPublishedTopicsCallback callback, void *context);
@@ -37,6 +37,54 @@ int cRosNodeRegisterServiceProvider(CrosNode *n, const char *service_name,
                                     ServiceProviderCallback callback, NodeStatusCallback status_callback,
                                     void *data_context);
 
+/*! \brief Send the response of a request deferred by a service provider callback
+ *         (i.e., the callback returned CN_SERVICE_RESPONSE_DEFERRED)
+ *
+ *  \param callid The request id, taken from CrosNode::service_call_id during the callback
+ *  \param response The (raw) response data, or the error message if ok is 0. Can be NULL
+ *  \param ok 1 if the service succeded, 0 otherwise
+ *  \return Returns 0 on success, -1 if no request is waiting with such id
+ */
+int cRosNodeSendServiceResponse(CrosNode *node, int callid, DynBuffer *response, int ok);
+
+/*! \brief Register a client of a service provided by another node
+ *
+ *  \param service_name The name of the called service
+ *  \param service_type The service data type (e.g., roscpp/GetLoggers, ...)
+ *  \param md5sum The md5sum of the service type
+ *  \param persistent If 1, the connection to the provider is kept open and the queued requests
+ *                    are pipelined on it
+ *  \param callback The callback that receives the (raw) responses
+ *  \return Returns the index of the service caller on success, -1 on failure
+ */
+int cRosNodeRegisterServiceCaller(CrosNode *node, const char *service_name,
+                                  const char *service_type, const char *md5sum, int persistent,
+                                  ServiceCallerCallback callback, NodeStatusCallback status_callback,
+                                  void *data_context);
+
+/*! \brief Unregister the service caller. The pending calls fail with a NULL response
+ *
+ *  \param svccalleridx Index of the service caller
+ */
+int cRosNodeUnregisterServiceCaller(CrosNode *node, int svccalleridx);
+
+/*! \brief Enqueue a call of the service: the response is delivered to the caller callback
+ *         by cRosNodeDoEventsLoop()
+ *
+ *  \param svccalleridx Index of the service caller
+ *  \param request The (raw) request data, it is copied
+ *  \return Returns the call id on success, -1 on failure
+ */
+int cRosNodeCallService(CrosNode *node, int svccalleridx, DynBuffer *request);
+
+/*! \brief Give the result of the lookupService done on behalf of a service caller
+ *
+ *  \param service_name The looked up service, used to discard the results of unregistered callers
+ *  \param uri The provider RPCROS uri (e.g. rosrpc://host:port), NULL if the lookup failed
+ */
+void cRosNodeServiceCallerLookupDone(CrosNode *node, int svccalleridx, const char *service_name,
+                                     const char *uri);
+
 /*! \brief Unregister the topic subscriber
  *
  *  \param subidx Index of the subscriber
@@ -57,6 +105,14 @@ int cRosNodeUnregisterService(CrosNode *node, int serviceidx);
 
 void restartAdversing(CrosNode* node);
 int enqueueRequestTopic(CrosNode *node, int subidx);
+/*! \brief Open the Unix domain socket that accepts the UNIXROS connections, if not yet opened
+ *  \return The path of the socket, NULL on failure (the subscriber should use TCPROS)
+ */
+const char *openUnixrosListnerSocket(CrosNode *node);
+/*! \brief Get the cache kind and key of an api call, as cRosLookupCacheCallKey(), but
+ *         getParam is cacheable only for the parameters covered by a subscription of the node
+ */
+CrosLookupCacheKind lookupCacheCallKey(CrosNode *node, RosApiCall *call, const char **key);
 int enqueueMasterApiCall(CrosNode *node, RosApiCall *call);
 int enqueueSlaveApiCall(CrosNode *node, RosApiCall *call, const char *host, int port);
 
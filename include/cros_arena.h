@@ -0,0 +1,66 @@
+#ifndef _CROS_ARENA_H_
+#define _CROS_ARENA_H_
+
+#include <stddef.h>
+
+/*! \defgroup cros_arena cROS bump arena
+ *
+ *  Bump allocator for the transient storage of a deserialized message:
+ *  allocations are never freed one by one, the whole arena is rewound
+ *  before the next message is deserialized
+ */
+
+/*! \addtogroup cros_arena
+ *  @{
+ */
+
+/*! Default size of an arena block (in bytes) */
+#define CROS_ARENA_BLOCK_SIZE 16384
+
+/*! Alignment of the arena allocations (in bytes) */
+#define CROS_ARENA_ALIGNMENT 8
+
+typedef struct CrosArenaBlock CrosArenaBlock;
+typedef struct CrosArena CrosArena;
+
+struct CrosArenaBlock
+{
+  CrosArenaBlock *next;               //! Next block of the arena
+  size_t size;                        //! Usable size of the block
+  size_t used;                        //! Bytes already handed out
+  unsigned char data[];
+};
+
+struct CrosArena
+{
+  CrosArenaBlock *first;              //! First block, NULL if nothing has been allocated yet
+  CrosArenaBlock *current;            //! Block serving the allocations
+  size_t block_size;                  //! Minimum size of a new block
+  size_t used;                        //! Bytes handed out since the last reset
+};
+
+/*! \brief Initialize an empty arena
+ *
+ *  \param block_size Minimum size of the blocks, 0 to use CROS_ARENA_BLOCK_SIZE
+ */
+void cRosArenaInit(CrosArena *arena, size_t block_size);
+
+/*! \brief Free all the blocks of the arena */
+void cRosArenaRelease(CrosArena *arena);
+
+/*! \brief Allocate size bytes (not zeroed) that remain valid until the next reset
+ *
+ *  \return A pointer aligned to CROS_ARENA_ALIGNMENT, NULL on failure
+ */
+void * cRosArenaAlloc(CrosArena *arena, size_t size);
+
+/*! \brief Invalidate all the allocations and rewind the arena
+ *
+ *  If the last cycle needed more than one block, the blocks are merged in a
+ *  single one large enough for the whole cycle
+ */
+void cRosArenaReset(CrosArena *arena);
+
+/*! @}*/
+
+#endif // _CROS_ARENA_H_
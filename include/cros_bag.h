@@ -0,0 +1,168 @@
+#ifndef _CROS_BAG_H_
+#define _CROS_BAG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cros_node.h"
+#include "dyn_buffer.h"
+
+/*! \defgroup cros_bag cROS rosbag recorder
+ *
+ *  Writer of rosbag v2 files (http://wiki.ros.org/Bags/Format/2.0), fed with the
+ *  serialized messages of raw subscribers (see cRosApiRegisterRawSubscriber()): the
+ *  messages are never decoded, their wire bytes are copied in the current chunk.
+ *
+ *  A chunk is built in memory and written, with its index records, by a single write
+ *  when it exceeds the chunk threshold. The connection records and the chunk infos are
+ *  written at the end of the file by cRosBagClose(), that also fills the bag header.
+ *
+ *  The player maps a bag file and loads only its index: every connection is published
+ *  by a publisher of the node, whose publication cycle is scheduled at the time of the
+ *  next message of the connection. The serialized messages are copied from the mapping
+ *  to the packet of the publisher, they are never decoded
+ */
+
+/*! \addtogroup cros_bag
+ *  @{
+ */
+
+/*! Default size of the chunks (uncompressed, as rosbag record) */
+#define CROS_BAG_CHUNK_THRESHOLD (768 * 1024)
+
+/*! Max num of connections (i.e., recorded topics) of a bag */
+#define CROS_BAG_MAX_CONNECTIONS 64
+
+/*! Size of the bag header record, padding included */
+#define CROS_BAG_HEADER_SIZE 4096
+
+typedef struct CrosBag CrosBag;
+typedef struct CrosBagConnection CrosBagConnection;
+
+struct CrosBagConnection
+{
+  CrosBag *bag;                       //! The bag of the connection, to be used as subscriber context
+  char *topic;
+  DynBuffer header;                   //! Connection header fields (topic, type, md5sum, message_definition)
+  DynBuffer index;                    //! Index entries (time, offset) of the messages in the current chunk
+  uint32_t chunk_count;               //! Messages of the connection in the current chunk
+  uint64_t message_count;             //! Messages recorded since the bag opening
+  int written;                        //! The connection record has been written in a chunk
+};
+
+struct CrosBag
+{
+  int fd;                             //! The bag file, -1 if closed
+  uint64_t file_pos;                  //! Size of the file written so far
+  size_t chunk_threshold;
+  DynBuffer chunk;                    //! Data of the current chunk
+  uint64_t chunk_start_time;          //! Time of the first message of the current chunk (sec << 32 | nsec)
+  uint64_t chunk_end_time;
+  DynBuffer chunk_infos;              //! Chunk info records of the chunks already written
+  uint32_t chunk_count;
+  CrosBagConnection connections[CROS_BAG_MAX_CONNECTIONS];
+  int n_connections;
+};
+
+/*! \brief Create a bag file, truncating an existing one
+ *
+ *  \param chunk_threshold Size of the chunks, 0 to use CROS_BAG_CHUNK_THRESHOLD
+ *  \return Returns 0 on success, -1 on failure
+ */
+int cRosBagOpen(CrosBag *bag, const char *path, size_t chunk_threshold);
+
+/*! \brief Add a connection to the bag
+ *
+ *  \return Returns the connection id on success, -1 on failure
+ */
+int cRosBagAddConnection(CrosBag *bag, const char *topic, const char *type, const char *md5sum,
+                         const char *message_definition);
+
+/*! \brief Append a serialized message of a connection to the current chunk
+ *
+ *  \param sec, nsec The record time of the message
+ *  \return Returns 0 on success, -1 on failure
+ */
+int cRosBagWrite(CrosBag *bag, int conn, uint32_t sec, uint32_t nsec, const unsigned char *data, size_t size);
+
+/*! \brief Record a topic: register a raw subscriber that appends the received messages
+ *         to the bag, with their reception time
+ *
+ *  \return Returns the index of the subscriber on success, -1 on failure
+ */
+int cRosBagRecordTopic(CrosNode *node, CrosBag *bag, const char *topic_name, const char *topic_type);
+
+/*! \brief Write the current chunk, the connection records and the chunk infos, then close
+ *         the file. The messages received by the recording subscribers afterwards are ignored
+ *
+ *  \return Returns 0 on success, -1 if some data couldn't be written
+ */
+int cRosBagClose(CrosBag *bag);
+
+typedef struct CrosBagIndexEntry CrosBagIndexEntry;
+typedef struct CrosBagPlayer CrosBagPlayer;
+typedef struct CrosBagPlayerConnection CrosBagPlayerConnection;
+
+struct CrosBagIndexEntry
+{
+  uint64_t time;                      //! Time of the message (sec << 32 | nsec)
+  uint64_t pos;                       //! Position of the message data record in the file
+};
+
+struct CrosBagPlayerConnection
+{
+  CrosBagPlayer *player;              //! The player of the connection, to be used as publisher context
+  uint32_t conn;                      //! The connection id in the bag
+  char *topic;
+  char *type;
+  char *md5sum;
+  char *message_definition;
+  CrosBagIndexEntry *entries;         //! The messages of the connection, sorted by time
+  size_t n_entries;
+  size_t next;                        //! The next message to be published
+  int pub_idx;                        //! The publisher of the connection, -1 if not started
+};
+
+struct CrosBagPlayer
+{
+  const unsigned char *map;           //! The mapped bag file, NULL if closed
+  size_t map_size;
+  CrosBagPlayerConnection connections[CROS_BAG_MAX_CONNECTIONS];
+  int n_connections;
+  CrosNode *node;
+  double rate;                        //! Playback speed factor, 0 to publish as fast as possible
+  uint64_t bag_start_time;            //! Time of the first message of the bag (sec << 32 | nsec)
+  uint64_t start_time_ms;             //! Wall time matching bag_start_time, 0 until the first publication
+  size_t published;                   //! Messages published so far
+};
+
+/*! \brief Map a bag file and load the index of its messages. The chunks are not read,
+ *         only their index records
+ *
+ *  \return Returns 0 on success, -1 on failure (e.g., the bag has compressed chunks)
+ */
+int cRosBagPlayerOpen(CrosBagPlayer *player, const char *path);
+
+/*! \brief Register a publisher for every connection of the bag and start the playback.
+ *         The playback clock starts with the first message sent to a subscriber
+ *
+ *  \param rate The speed factor (1.0 is the recording speed), 0 to publish the messages as
+ *              fast as the subscribers read them
+ *  \return Returns 0 on success, -1 on failure (e.g., too many connections for the node)
+ */
+int cRosBagPlayerStart(CrosNode *node, CrosBagPlayer *player, double rate);
+
+/*! \brief Check if all the messages of the bag have been published. As for any publisher of
+ *         the node, the messages of a topic are published only when it has subscribers:
+ *         the playback of a topic waits for its first subscriber
+ */
+int cRosBagPlayerIsDone(CrosBagPlayer *player);
+
+/*! \brief Unmap the bag file. The publishers of the player must have been unregistered
+ *         (or their node destroyed) first
+ */
+void cRosBagPlayerClose(CrosBagPlayer *player);
+
+/*! @}*/
+
+#endif // _CROS_BAG_H_
@@ -19,6 +19,12 @@
  */
 uint64_t cRosClockGetTimeMs();
 
+/*! \brief Return the current time, expressed as microseconds since the Epoch
+ * 
+ *  \return The current time
+ */
+uint64_t cRosClockGetTimeUs();
+
 /*! \brief Convert an interval expressed as milliseconds in a timeval structure, 
  *         that express the same interval as seconds and microseconds
  * 
@@ -0,0 +1,130 @@
+#ifndef _CROS_CODEC_H_
+#define _CROS_CODEC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dyn_buffer.h"
+
+/*! \defgroup cros_codec cROS typed message codecs
+ *
+ *  Support of the C structs and codecs emitted by cRosGentoolsGenerateC(): the generated
+ *  code serializes with straight-line writes into a single reserved buffer area, and
+ *  deserializes without going through the cRosMessage field tree
+ */
+
+/*! \addtogroup cros_codec
+ *  @{
+ */
+
+typedef struct CrosTime CrosTime;
+typedef struct CrosDuration CrosDuration;
+typedef struct CrosHeader CrosHeader;
+typedef struct CrosMessageCodec CrosMessageCodec;
+typedef struct CrosServiceCodec CrosServiceCodec;
+
+struct CrosTime
+{
+  uint32_t sec;
+  uint32_t nsec;
+};
+
+struct CrosDuration
+{
+  int32_t sec;
+  int32_t nsec;
+};
+
+struct CrosHeader
+{
+  uint32_t seq;
+  CrosTime stamp;
+  char *frame_id;                     //! Owned by the header, NULL is serialized as an empty string
+};
+
+/*! \brief Description of a generated message type, used to register typed publishers and subscribers */
+struct CrosMessageCodec
+{
+  const char *type;                   //! e.g., std_msgs/String
+  const char *md5sum;
+  const char *definition;             //! Full text of the message definition
+  size_t msg_size;                    //! sizeof() of the generated struct
+  void (*init)(void *msg);
+  void (*release)(void *msg);
+  int (*serialize)(const void *msg, DynBuffer *buffer);
+  int (*deserialize)(void *msg, DynBuffer *buffer);
+};
+
+/*! \brief Description of a generated service type */
+struct CrosServiceCodec
+{
+  const char *type;
+  const char *md5sum;
+  const CrosMessageCodec *request;
+  const CrosMessageCodec *response;
+};
+
+/*! \brief Get the serialized size of a string (length prefix included)
+ */
+size_t cRosCodecStringSize(const char *str);
+
+/*! \brief Copy n bytes to out
+ *
+ *  \return The first byte after the written ones
+ */
+unsigned char * cRosCodecWriteBuf(unsigned char *out, const void *src, size_t n);
+
+unsigned char * cRosCodecWriteUInt32(unsigned char *out, uint32_t val);
+
+unsigned char * cRosCodecWriteString(unsigned char *out, const char *str);
+
+/*! \brief Read n bytes, moving the position indicator of the buffer
+ *
+ *  \return Returns 0 on success, -1 if the buffer is too short
+ */
+int cRosCodecRead(DynBuffer *buffer, void *dst, size_t n);
+
+/*! \brief Read a string, reusing the storage of *str
+ *
+ *  \return Returns 0 on success, -1 on failure
+ */
+int cRosCodecReadString(DynBuffer *buffer, char **str);
+
+/*! \brief Read the size of a variable length array, checking that the buffer holds at least
+ *         min_element_size bytes per element
+ *
+ *  \return Returns 0 on success, -1 on failure
+ */
+int cRosCodecReadArraySize(DynBuffer *buffer, uint32_t *size, size_t min_element_size);
+
+/*! \brief Resize the storage of a variable length array
+ *
+ *  \return Returns 0 on success, -1 on failure (the array is left untouched)
+ */
+int cRosCodecResizeArray(void **array, uint32_t size, size_t element_size);
+
+/*! \brief Read a variable length array of fixed size elements
+ *
+ *  \return Returns 0 on success, -1 on failure
+ */
+int cRosCodecReadArray(DynBuffer *buffer, void **array, uint32_t *size, size_t element_size);
+
+/*! \brief Read a variable length array of strings, reusing the storage of the previous one
+ *
+ *  \return Returns 0 on success, -1 on failure
+ */
+int cRosCodecReadStringArray(DynBuffer *buffer, char ***array, uint32_t *size);
+
+void cRosCodecReleaseStringArray(char **array, uint32_t size);
+
+size_t cRosCodecHeaderSize(const CrosHeader *header);
+
+unsigned char * cRosCodecWriteHeader(unsigned char *out, const CrosHeader *header);
+
+int cRosCodecReadHeader(DynBuffer *buffer, CrosHeader *header);
+
+void cRosCodecReleaseHeader(CrosHeader *header);
+
+/*! @}*/
+
+#endif // _CROS_CODEC_H_
@@ -32,6 +32,20 @@ int cRosGentoolsSHA1(char* filename);
  */
 int cRosGentoolsFulltext(char* filename);
 
+/*! \brief Generate a C header with the typed struct, codec and registration helpers of a message
+ *         or service type. The headers of the message types it depends on are generated too
+ *
+ *  Each header is written as output_dir/package/Name.h, so the generated code includes them
+ *  with "package/Name.h". The md5sum and the full message definition are compiled in:
+ *  the .msg/.srv files are not needed at runtime
+ *
+ *  \param filename Full path of the message/service file
+ *  \param output_dir Directory where the headers are written (it must exist)
+ *
+ *  \return Returns 0 on success, -1 on failure
+ */
+int cRosGentoolsGenerateC(char* filename, const char *output_dir);
+
 /*! @}*/
 
 #endif
@@ -0,0 +1,73 @@
+#ifndef _CROS_INTRAPROCESS_H_
+#define _CROS_INTRAPROCESS_H_
+
+#include "cros_node.h"
+
+/*! \defgroup cros_intraprocess cROS intra-process transport
+ *
+ *  When a node subscribes to a topic published by a node of the same process, the
+ *  requestTopic exchange negotiates the INTRAPROCESS transport: the packet of each
+ *  publication cycle is appended to the subscriber queue and dispatched by the
+ *  subscriber node, without going through the loopback TCP connection.
+ *
+ *  The nodes are not thread safe, and a link writes the queues of both nodes: only the nodes
+ *  that enabled the transport with cRosNodeSetIntraprocessTransport() are linked, and they
+ *  must be run by the same thread. The other nodes of the process use the socket transports
+ */
+
+/*! \addtogroup cros_intraprocess
+ *  @{
+ */
+
+/*! \brief Make a node reachable by the other nodes of the process
+ *
+ *  \return Returns 0 on success, -1 if there are already CN_MAX_INTRAPROCESS_NODES nodes
+ */
+int cRosIntraprocessRegisterNode(CrosNode *n);
+
+/*! \brief Unlink all the publishers and subscribers of a node and forget it
+ */
+void cRosIntraprocessUnregisterNode(CrosNode *n);
+
+/*! \brief Find a node of this process
+ *
+ *  \param node_name The absolute node name
+ *
+ *  \return The node, or NULL if no node of this process has this name
+ */
+CrosNode * cRosIntraprocessFindNode(const char *node_name);
+
+/*! \brief Feed a subscriber of a node of this process directly from a publisher. The latched
+ *         packet of the publisher, if any, is delivered immediately
+ *
+ *  \return Returns 0 on success, -1 if the message types don't match or the publisher
+ *          has already CN_MAX_INTRAPROCESS_SUBSCRIBERS subscribers of this process
+ */
+int cRosIntraprocessLink(CrosNode *pub_node, int pub_idx, CrosNode *sub_node, int sub_idx);
+
+/*! \brief Detach all the intra-process subscribers of a publisher. They will connect again
+ *         at the next publisherUpdate
+ */
+void cRosIntraprocessUnlinkPublisher(CrosNode *n, int pub_idx);
+
+/*! \brief Detach a subscriber from its intra-process publisher, dropping its pending packets
+ */
+void cRosIntraprocessUnlinkSubscriber(CrosNode *n, int sub_idx);
+
+/*! \brief Append the current packet of a publisher to the queues of its intra-process subscribers
+ */
+void cRosIntraprocessPublish(CrosNode *n, int pub_idx);
+
+/*! \brief Call the subscriber callbacks on all the packets delivered to the node
+ *
+ *  \return The number of dispatched packets
+ */
+int cRosIntraprocessDispatch(CrosNode *n);
+
+/*! \brief Check if some packets are waiting to be dispatched to the subscribers of the node
+ */
+int cRosIntraprocessHasPending(CrosNode *n);
+
+/*! @}*/
+
+#endif // _CROS_INTRAPROCESS_H_
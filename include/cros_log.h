@@ -4,13 +4,58 @@
 #include <stdint.h>
 #include "cros_node.h"
 
-#define PRINT_LOG(node,log_level,...) \
-     cRosLogPrint(node,\
-                  log_level,\
-                  __FILE__,\
-                  __FUNCTION__,\
-                  __LINE__,\
-                  __VA_ARGS__)
+/*! Minimum level of the log statements compiled in, e.g. -DCROS_LOG_MIN_LEVEL=4 to keep only
+ *  the warnings and the errors (the values of CrosLogLevel). The statements below it are removed
+ *  by the compiler, their arguments are never evaluated */
+#ifndef CROS_LOG_MIN_LEVEL
+#define CROS_LOG_MIN_LEVEL 1
+#endif
+
+/*! State of a log statement: every PRINT_LOG() call site owns a static one. The enable flag is
+ *  cached for the last node logged, and refreshed when a logger level changes */
+typedef struct CrosLogSite
+{
+  const CrosNode *owner;        //! The node of the cached flag
+  uint32_t generation;          //! The value of cRosLogGeneration when the flag was cached
+  int enabled;
+  int done;                     //! The statement has been logged (_ONCE variants)
+  uint64_t last_time_ms;        //! Time of the last message logged (_THROTTLE variants)
+} CrosLogSite;
+
+/*! Incremented at every change of the level of a node, to invalidate the cached flags */
+extern uint32_t cRosLogGeneration;
+
+int cRosLogSiteUpdate(CrosLogSite *site, const CrosNode *node, CrosLogLevel level);
+int cRosLogSiteThrottle(CrosLogSite *site, double period);
+
+/* A disabled statement costs a comparison of the site generation. The node argument is
+ * evaluated more than once */
+#define CROS_LOG_SITE_ENABLED(site,node,log_level) \
+     ((log_level) >= CROS_LOG_MIN_LEVEL && \
+      ((site).generation == cRosLogGeneration && (site).owner == (node) ? \
+          (site).enabled : cRosLogSiteUpdate(&(site), node, log_level)))
+
+#define PRINT_LOG_IF(node,log_level,cond,...) \
+     do { \
+       static CrosLogSite cros_log_site_; \
+       if (CROS_LOG_SITE_ENABLED(cros_log_site_, node, log_level) && (cond)) \
+         cRosLogPrint(node,\
+                      log_level,\
+                      __FILE__,\
+                      __FUNCTION__,\
+                      __LINE__,\
+                      __VA_ARGS__); \
+     } while (0)
+
+#define PRINT_LOG(node,log_level,...) PRINT_LOG_IF(node, log_level, 1, __VA_ARGS__)
+
+//! Log at most once every period (in sec)
+#define PRINT_LOG_THROTTLE(node,log_level,period,...) \
+     PRINT_LOG_IF(node, log_level, cRosLogSiteThrottle(&cros_log_site_, period), __VA_ARGS__)
+
+//! Log only the first time the statement is enabled
+#define PRINT_LOG_ONCE(node,log_level,...) \
+     PRINT_LOG_IF(node, log_level, !cros_log_site_.done && (cros_log_site_.done = 1), __VA_ARGS__)
 
 #define ROS_INFO(node,...) PRINT_LOG(node, CROS_LOGLEVEL_INFO, __VA_ARGS__)
 #define ROS_DEBUG(node,...) PRINT_LOG(node, CROS_LOGLEVEL_DEBUG, __VA_ARGS__)
@@ -18,8 +63,17 @@
 #define ROS_ERROR(node,...) PRINT_LOG(node, CROS_LOGLEVEL_ERROR, __VA_ARGS__)
 #define ROS_FATAL(node,...) PRINT_LOG(node, CROS_LOGLEVEL_FATAL, __VA_ARGS__)
 
-CrosLog * cRosLogNew();
-void cRosLogFree(CrosLog *log);
+#define ROS_INFO_THROTTLE(node,period,...) PRINT_LOG_THROTTLE(node, CROS_LOGLEVEL_INFO, period, __VA_ARGS__)
+#define ROS_DEBUG_THROTTLE(node,period,...) PRINT_LOG_THROTTLE(node, CROS_LOGLEVEL_DEBUG, period, __VA_ARGS__)
+#define ROS_WARN_THROTTLE(node,period,...) PRINT_LOG_THROTTLE(node, CROS_LOGLEVEL_WARN, period, __VA_ARGS__)
+#define ROS_ERROR_THROTTLE(node,period,...) PRINT_LOG_THROTTLE(node, CROS_LOGLEVEL_ERROR, period, __VA_ARGS__)
+#define ROS_FATAL_THROTTLE(node,period,...) PRINT_LOG_THROTTLE(node, CROS_LOGLEVEL_FATAL, period, __VA_ARGS__)
+
+#define ROS_INFO_ONCE(node,...) PRINT_LOG_ONCE(node, CROS_LOGLEVEL_INFO, __VA_ARGS__)
+#define ROS_DEBUG_ONCE(node,...) PRINT_LOG_ONCE(node, CROS_LOGLEVEL_DEBUG, __VA_ARGS__)
+#define ROS_WARN_ONCE(node,...) PRINT_LOG_ONCE(node, CROS_LOGLEVEL_WARN, __VA_ARGS__)
+#define ROS_ERROR_ONCE(node,...) PRINT_LOG_ONCE(node, CROS_LOGLEVEL_ERROR, __VA_ARGS__)
+#define ROS_FATAL_ONCE(node,...) PRINT_LOG_ONCE(node, CROS_LOGLEVEL_FATAL, __VA_ARGS__)
 
 void cRosLogPrint(CrosNode* node,
                   CrosLogLevel level,         // debug level
@@ -28,13 +82,21 @@ void cRosLogPrint(CrosNode* node,
                   uint32_t line,
                   const char* msg, ...);
 
-CrosLogQueue* cRosLogQueueNew();
-void cRosLogQueueInit(CrosLogQueue *queue);
-int cRosLogQueueEnqueue(CrosLogQueue *queue, CrosLog* log);
-CrosLog * cRosLogQueuePeek(CrosLogQueue *queue);
-CrosLog * cRosLogQueueDequeue(CrosLogQueue *queue);
-void cRosLogQueueRelease(CrosLogQueue *queue);
-size_t cRosLogQueueCount(CrosLogQueue *queue);
-int cRosLogQueueIsEmpty(CrosLogQueue *queue);
+/*! \brief Set the minimum level of the messages logged by a node (e.g., by the
+ *         set_logger_level service)
+ */
+void cRosLogSetLevel(CrosNode *node, CrosLogLevel level);
+
+/*! \brief Get the number of log records dropped because /rosout didn't publish them in time */
+uint64_t cRosLogGetDropped(CrosNode *node);
+
+int cRosLogRingInit(CrosLogRing *ring, size_t capacity);
+void cRosLogRingRelease(CrosLogRing *ring);
+/*! \brief Get the slot of a new record, overwriting the oldest one if the ring is full */
+CrosLog * cRosLogRingPush(CrosLogRing *ring);
+CrosLog * cRosLogRingPeek(CrosLogRing *ring);
+void cRosLogRingPop(CrosLogRing *ring);
+size_t cRosLogRingCount(CrosLogRing *ring);
+int cRosLogRingIsEmpty(CrosLogRing *ring);
 
 #endif //_CROS_LOG_H_
@@ -0,0 +1,101 @@
+#ifndef _CROS_LOOKUP_CACHE_H_
+#define _CROS_LOOKUP_CACHE_H_
+
+#include <stdint.h>
+
+#include "xmlrpc_params.h"
+#include "cros_api_call.h"
+
+/*! \defgroup cros_lookup_cache cROS master lookup cache
+ *
+ *  Node-local cache of the roscore responses to lookupService, lookupNode,
+ *  getTopicTypes and getParam, so that repeated lookups don't need an
+ *  XMLRPC round trip to the master. The node caches only the parameters it is
+ *  subscribed to: the others can be changed by any node without notice
+ */
+
+/*! \addtogroup cros_lookup_cache
+ *  @{
+ */
+
+/*! Number of cache slots (must be a power of 2) */
+#define CROS_LOOKUP_CACHE_SIZE 64
+
+/*! Number of slots probed starting from the hashed one */
+#define CROS_LOOKUP_CACHE_PROBES 4
+
+/*! Default time to live of a cache entry (in msec) */
+#define CROS_LOOKUP_CACHE_TTL 5000
+
+typedef enum CrosLookupCacheKind
+{
+  CROS_LOOKUP_CACHE_NONE = 0,
+  CROS_LOOKUP_CACHE_SERVICE,          //! lookupService responses, keyed by service name
+  CROS_LOOKUP_CACHE_NODE,             //! lookupNode responses, keyed by node name
+  CROS_LOOKUP_CACHE_TOPIC_TYPES,      //! getTopicTypes response (empty key)
+  CROS_LOOKUP_CACHE_PARAM             //! getParam responses, keyed by parameter name
+} CrosLookupCacheKind;
+
+typedef struct CrosLookupCacheEntry CrosLookupCacheEntry;
+typedef struct CrosLookupCache CrosLookupCache;
+
+struct CrosLookupCacheEntry
+{
+  CrosLookupCacheKind kind;           //! Kind of the lookup, CROS_LOOKUP_CACHE_NONE if the slot is free
+  char *key;                          //! The looked up name
+  uint32_t hash;                      //! Hash of (kind, key)
+  XmlrpcParam response;               //! The cached [code, status, value] response
+  uint64_t expire_time;               //! Entry expiration time (in msec since the Epoch)
+};
+
+struct CrosLookupCache
+{
+  CrosLookupCacheEntry entries[CROS_LOOKUP_CACHE_SIZE];
+  uint64_t ttl;                       //! Time to live of new entries (in msec), 0 disables the cache
+  size_t hits;                        //! Number of lookups served by the cache
+  size_t misses;                      //! Number of lookups forwarded to roscore
+};
+
+/*! \brief Initialize an empty cache with the default TTL */
+void cRosLookupCacheInit(CrosLookupCache *cache);
+
+/*! \brief Release all the cached entries */
+void cRosLookupCacheRelease(CrosLookupCache *cache);
+
+/*! \brief Find a valid (not expired) entry
+ *
+ *  \return The cached response on success, NULL otherwise
+ */
+XmlrpcParam * cRosLookupCacheGet(CrosLookupCache *cache, CrosLookupCacheKind kind, const char *key);
+
+/*! \brief Store (a copy of) a roscore response, replacing any previous entry with the same key
+ *
+ *  \return 0 on success, -1 on failure
+ */
+int cRosLookupCacheStore(CrosLookupCache *cache, CrosLookupCacheKind kind, const char *key, XmlrpcParam *response);
+
+/*! \brief Drop the entry with the given kind and key, if present */
+void cRosLookupCacheInvalidate(CrosLookupCache *cache, CrosLookupCacheKind kind, const char *key);
+
+/*! \brief Drop all the parameter entries in the namespace of key (or containing key), e.g.,
+ *         "/a/b" and "/a" for "/a", but not "/ab" */
+void cRosLookupCacheInvalidateParam(CrosLookupCache *cache, const char *key);
+
+/*! \brief Drop all the entries of the given kind */
+void cRosLookupCacheInvalidateKind(CrosLookupCache *cache, CrosLookupCacheKind kind);
+
+/*! \brief Drop all the node and service entries whose URI points to host:port */
+void cRosLookupCacheInvalidateUri(CrosLookupCache *cache, const char *host, int port);
+
+/*! \brief Drop all the entries */
+void cRosLookupCacheClear(CrosLookupCache *cache);
+
+/*! \brief Get the cache kind and key of an api call
+ *
+ *  \return The kind of the lookup, CROS_LOOKUP_CACHE_NONE if the call is not cacheable
+ */
+CrosLookupCacheKind cRosLookupCacheCallKey(RosApiCall *call, const char **key);
+
+/*! @}*/
+
+#endif // _CROS_LOOKUP_CACHE_H_
@@ -2,6 +2,7 @@
 #define _CROS_MESSAGE_H_
 
 #include "cros_node.h"
+#include "cros_arena.h"
 
 /*! \defgroup cros_message cROS TCPROS 
  * 
@@ -79,10 +80,27 @@ struct cRosMessageField
     int array_capacity;
     CrosMessageType type;
     char *type_s;
+    int is_arena_data;                  //! The string/array storage belongs to an arena, it is not freed with the field
 };
 
 typedef struct t_msgDef cRosMessageDef;
 
+#define CROS_MESSAGE_FIELD_PATH_MAX_DEPTH 8
+
+typedef struct CrosMessageFieldPath CrosMessageFieldPath;
+
+/*! \brief A field path (e.g., "points[].positions") compiled to a chain of field indexes
+ *
+ *  The field order of a message only depends on its definition, so a path compiled once
+ *  is valid for every message of the same type
+ */
+struct CrosMessageFieldPath
+{
+  int depth;
+  int indexes[CROS_MESSAGE_FIELD_PATH_MAX_DEPTH];       //! Index of the field at each level
+  int is_element[CROS_MESSAGE_FIELD_PATH_MAX_DEPTH];    //! The level steps into an element of a message array
+};
+
 struct cRosMessage
 {
     cRosMessageField **fields;
@@ -113,6 +131,44 @@ void cRosMessageFieldFree(cRosMessageField *field);
 
 cRosMessageField* cRosMessageGetField(cRosMessage *message, char *field);
 
+/*! \brief Get the index of a field, to be resolved once and then used with cRosMessageGetFieldAt()
+ *         on every message of the same type
+ *
+ *  \return Returns the index of the field, or -1 if the message has no such field
+ */
+int cRosMessageGetFieldIndex(cRosMessage *message, const char *field_name);
+
+/*! \brief Get a field from its index, without any string comparison
+ *
+ *  \return Returns the field, or NULL if the index is out of range
+ */
+cRosMessageField* cRosMessageGetFieldAt(cRosMessage *message, int index);
+
+/*! \brief Compile a field path against a message of the wanted type
+ *
+ *  The steps of the path are separated by '.'. A step ending in "[]" is an array of messages
+ *  and the next step is a field of its elements, e.g. "points[].positions". The time and
+ *  duration fields can be walked into ("header.stamp.secs")
+ *
+ *  \param message A message of the type the path applies to
+ *  \param path The path to compile
+ *  \param compiled The compiled path
+ *
+ *  \return Returns 0 on success, -1 if the path doesn't match the type
+ */
+int cRosMessageFieldPathCompile(cRosMessage *message, const char *path, CrosMessageFieldPath *compiled);
+
+/*! \brief Get the field pointed by a compiled path
+ *
+ *  \param message The message
+ *  \param path The path compiled by cRosMessageFieldPathCompile()
+ *  \param elements The element index of each "[]" step of the path, in order (NULL if none)
+ *
+ *  \return Returns the field, or NULL if an element index is out of range
+ */
+cRosMessageField* cRosMessageFieldPathGet(cRosMessage *message, const CrosMessageFieldPath *path,
+                                          const int *elements);
+
 int cRosMessageSetFieldValueString(cRosMessageField* field, const char* value);
 
 int cRosMessageFieldArrayPushBackInt8(cRosMessageField *field, int8_t val);
@@ -175,6 +231,13 @@ void cRosMessageSerialize(cRosMessage *message, DynBuffer* buffer);
 
 void cRosMessageDeserialize(cRosMessage *message, DynBuffer *buffer);
 
+/*! \brief Deserialize a message taking the storage of its strings and variable size arrays from an arena
+ *
+ *  The deserialized data is valid until the arena is reset. Fields modified
+ *  with the setters or the push back functions are moved to the heap
+ */
+void cRosMessageDeserializeArena(cRosMessage *message, DynBuffer *buffer, CrosArena *arena);
+
 CrosMessageType getMessageType(const char* type);
 
 const char * getMessageTypeString(CrosMessageType type);
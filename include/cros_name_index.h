@@ -0,0 +1,82 @@
+#ifndef _CROS_NAME_INDEX_H_
+#define _CROS_NAME_INDEX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*! \defgroup cros_name_index cROS name index
+ *
+ *  Hash index of the names of the providers of a node (published and subscribed topics,
+ *  services, parameter subscriptions), so that the requests of the master and of the other
+ *  nodes find their provider without scanning the provider tables.
+ *
+ *  The index doesn't copy the names: an entry points to the name owned by its provider, and
+ *  has to be removed before the name is released. Several providers can share a name: the
+ *  lookups return the one with the lowest index, as the table scans they replace
+ */
+
+/*! \addtogroup cros_name_index
+ *  @{
+ */
+
+/*! Number of index slots (must be a power of 2, larger than the providers of a node) */
+#define CROS_NAME_INDEX_SIZE 128
+
+typedef enum CrosNameKind
+{
+  CROS_NAME_NONE = 0,
+  CROS_NAME_PUBLISHER,                //! Index in the node pubs
+  CROS_NAME_SUBSCRIBER,               //! Index in the node subs
+  CROS_NAME_SERVICE,                  //! Index in the node services
+  CROS_NAME_PARAMETER                 //! Index in the node paramsubs
+} CrosNameKind;
+
+typedef struct CrosNameIndexEntry CrosNameIndexEntry;
+typedef struct CrosNameIndex CrosNameIndex;
+
+struct CrosNameIndexEntry
+{
+  CrosNameKind kind;                  //! CROS_NAME_NONE if the slot is free
+  uint32_t hash;                      //! Hash of (kind, name)
+  const char *name;                   //! The name of the provider
+  int idx;                            //! The index of the provider
+};
+
+struct CrosNameIndex
+{
+  CrosNameIndexEntry entries[CROS_NAME_INDEX_SIZE];
+  int count;
+};
+
+/*! \brief Initialize an empty index */
+void cRosNameIndexInit(CrosNameIndex *index);
+
+/*! \brief Add a provider
+ *
+ *  \param name The provider name, that must live until the provider is removed
+ *  \return 0 on success, -1 if the index is full
+ */
+int cRosNameIndexAdd(CrosNameIndex *index, CrosNameKind kind, const char *name, int idx);
+
+/*! \brief Remove a provider, if present */
+void cRosNameIndexRemove(CrosNameIndex *index, CrosNameKind kind, const char *name, int idx);
+
+/*! \brief Find the provider of a name
+ *
+ *  \return The lowest index of the providers with that name, -1 if none
+ */
+int cRosNameIndexFind(const CrosNameIndex *index, CrosNameKind kind, const char *name);
+
+/*! \brief Find the provider of the first len chars of a name */
+int cRosNameIndexFindN(const CrosNameIndex *index, CrosNameKind kind, const char *name, size_t len);
+
+/*! \brief Find the provider of a name or of one of its namespaces (e.g., "/a/b", "/a/" or "/a"
+ *         for "/a/b"), as the parameter subscriptions that receive the updates of their subkeys
+ *
+ *  \return The lowest index of the matching providers, -1 if none
+ */
+int cRosNameIndexFindNamespace(const CrosNameIndex *index, CrosNameKind kind, const char *name);
+
+/*! @}*/
+
+#endif // _CROS_NAME_INDEX_H_
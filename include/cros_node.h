@@ -5,6 +5,9 @@
 #include "xmlrpc_process.h"
 #include "tcpros_process.h"
 #include "cros_api_call.h"
+#include "cros_lookup_cache.h"
+#include "cros_name_index.h"
+#include "cros_uring.h"
 
 /*! \defgroup cros_node cROS Node */
 
@@ -22,6 +25,9 @@
 /*! Max num service providers */
 #define CN_MAX_SERVICE_PROVIDERS 8
 
+/*! Max num service callers */
+#define CN_MAX_SERVICE_CALLERS 5
+
 /*! Max num parameter subscriptions */
 #define CN_MAX_PARAMETER_SUBSCRIPTIONS 20
 
@@ -31,8 +37,17 @@
 /*! Max num serving TCPROS connections */
 #define CN_MAX_TCPROS_SERVER_CONNECTIONS 5
 
+/*! Initial num serving RPCROS connections (more are allocated on demand) */
+#define CN_INIT_RPCROS_SERVER_CONNECTIONS CN_MAX_SERVICE_PROVIDERS
+
 /*! Max num serving RPCROS connections */
-#define CN_MAX_RPCROS_SERVER_CONNECTIONS CN_MAX_SERVICE_PROVIDERS
+#define CN_MAX_RPCROS_SERVER_CONNECTIONS 64
+
+/*! Max num of RPCROS connections waiting to be accepted */
+#define CN_RPCROS_LISTEN_BACKLOG CN_MAX_RPCROS_SERVER_CONNECTIONS
+
+/*! Max num RPCROS connections against service providers (one for each service caller) */
+#define CN_MAX_RPCROS_CLIENT_CONNECTIONS CN_MAX_SERVICE_CALLERS
 
 /*!
  * Max num XMLRPC connections against another subscribed nodes
@@ -49,13 +64,61 @@
 /*! Node automatic XMLRPC ping cycle period (in msec) */
 #define CN_PING_LOOP_PERIOD 1000
 
+/*! Maximum number of bytes read at once by a subscriber connection */
+#define CN_TCPROS_RECV_CHUNK_SIZE 65536
+
+/*! Default max num of bytes of the queued packets coalesced in a single write by a publisher connection */
+#define CN_TCPROS_WRITE_BATCH_SIZE 65536
+
+/*! Max num nodes of the same process that can exchange messages without sockets */
+#define CN_MAX_INTRAPROCESS_NODES 16
+
+/*! Max num subscribers of the same process fed directly by a publisher */
+#define CN_MAX_INTRAPROCESS_SUBSCRIBERS 8
+
+/*! Max num packets waiting to be dispatched to an intra-process subscriber (the newer ones are dropped) */
+#define CN_INTRAPROCESS_QUEUE_LENGTH 16
+
+/*! Subscriber queue length that conflates the messages: only the newest one reaches the callback */
+#define CN_SUBSCRIBER_QUEUE_LATEST_ONLY 1
+
+/*! Events of a file descriptor of the node (see cRosNodeGetEvents()) */
+#define CN_EVENT_READ 0x1
+#define CN_EVENT_WRITE 0x2
+
+/*! Max num subscribers of a publisher reached through UDPROS */
+#define CN_MAX_UDPROS_SUBSCRIBERS 8
+
+/*! Default max size of the UDPROS datagrams: the UDP payload of an Ethernet frame, so that IP
+ *  doesn't fragment them (a lost fragment would lose the whole datagram) */
+#define CN_UDPROS_DEFAULT_DATAGRAM_SIZE 1472
+
+/*! Max num log records waiting to be published on /rosout (the older ones are dropped) */
+#define CN_LOG_RING_CAPACITY 128
+
+/*! Max size of a log message (terminator included), the longer ones are truncated */
+#define CN_LOG_MAX_MSG_SIZE 512
+
 /*! Maximum I/O operations timeout (in msec) */
 #define CN_IO_TIMEOUT 2000
 
+/*! Max num requests of a persistent service caller waiting for their response */
+#define CN_SERVICE_PIPELINE_DEPTH 16
+
+/*! Period (in msec) to check the resolution of the host name of a service provider */
+#define CN_SERVICE_RESOLVE_PERIOD 10
+
 typedef struct PublisherNode PublisherNode;
 typedef struct SubscriberNode SubscriberNode;
 typedef struct ServiceProviderNode ServiceProviderNode;
+typedef struct ServiceCallerNode ServiceCallerNode;
+typedef struct ServiceCallNode ServiceCallNode;
+typedef struct ServiceHostResolver ServiceHostResolver;
 typedef struct ParameterSubscription ParameterSubscription;
+typedef struct IntraprocessLink IntraprocessLink;
+typedef struct CrosShmRing CrosShmRing;
+typedef struct UdprosDestination UdprosDestination;
+typedef struct UdprosReceiver UdprosReceiver;
 
 typedef enum CrosNodeStatus
 {
@@ -67,6 +130,7 @@ typedef enum CrosNodeStatus
   CROS_STATUS_PARAM_UNSUBSCRIBED,
   CROS_STATUS_PARAM_SUBSCRIBED,
   CROS_STATUS_PARAM_UPDATE,
+  CROS_STATUS_SERVICE_CALLER_UNREGISTERED,
 } CrosNodeStatus;
 
 typedef struct CrosNodeStatusUsr
@@ -88,6 +152,51 @@ typedef void (*NodeStatusCallback)(CrosNodeStatusUsr *status, void* context);
 typedef uint8_t CallbackResponse;
 typedef CallbackResponse (*PublisherCallback)(DynBuffer *buffer, void* context);
 
+/*! What a TCPROS connection of a publisher drops when its send queue is full */
+typedef enum CrosDropPolicy
+{
+  CROS_DROP_NEWEST = 0,                         //! The connection skips the packet just published (the default)
+  CROS_DROP_OLDEST                              //! The oldest queued packet makes room for the one just published
+} CrosDropPolicy;
+
+/*! A subscriber of a node of the same process, fed by a publisher without sockets */
+struct IntraprocessLink
+{
+  struct CrosNode *node;                        //! The node of the subscriber
+  int sub_idx;                                  //! The subscriber index in node->subs
+};
+
+/*! A subscriber fed by a publisher through UDPROS */
+struct UdprosDestination
+{
+  int fd;                                       //! UDP socket connected to the subscriber
+  int port;                                     //! Local port of the socket, answered to the subscriber
+  uint32_t connection_id;                       //! Sent in every datagram, chosen by the publisher
+  int max_datagram_size;                        //! Datagram header included
+  uint8_t message_id;                           //! Id of the next message (it wraps around)
+  char *caller_id;                              //! The subscriber node
+  size_t sent_messages;
+  size_t dropped_messages;                      //! Messages not sent, e.g. the socket buffer was full
+};
+
+/*! The UDPROS side of a subscriber: datagrams are reassembled into messages, and a message
+ *  is dropped as soon as one of its blocks is lost or out of order */
+struct UdprosReceiver
+{
+  int max_datagram_size;                        //! Offered in requestTopic, 0 if UDPROS is not wanted
+  int fd;                                       //! UDP socket bound to the node host, -1 if none
+  int refused;                                  //! The publisher didn't accept UDPROS: request TCPROS only
+  int connected;                                //! The socket is connected to the publisher and read by the loop
+  uint32_t connection_id;                       //! Assigned by the publisher, the other datagrams are discarded
+  DynBuffer message;                            //! Message ([size][data]) being reassembled
+  int message_id;                               //! Id of the message being reassembled, -1 if none
+  int n_blocks;                                 //! Total blocks of the message being reassembled
+  int next_block;
+  int last_message_id;                          //! Id of the last message started, -1 if none
+  size_t received_messages;
+  size_t dropped_messages;                      //! Messages lost (entirely or in part) on the way
+};
+
 /*! Structure that define a published topic */
 struct PublisherNode
 {
@@ -100,6 +209,22 @@ struct PublisherNode
   PublisherCallback callback;                   //! The callback called to generate the (raw) packet data of type topic_type
   NodeStatusCallback status_callback;
   int loop_period;                              //! Period (in msec) for publication cycle 
+  uint64_t wake_up_time_ms;                     //! The time for the next publication cycle (in msec, since the Epoch)
+  DynBuffer packet;                             //! Last published packet (size included): it is shared by
+                                                //! all the subscribers and latched for the new ones
+  DynBuffer header;                             //! TCPROS connection header (size included), built at the first connection
+  IntraprocessLink intra_subs[CN_MAX_INTRAPROCESS_SUBSCRIBERS]; //! Subscribers of the same process
+  int n_intra_subs;
+  CrosShmRing *shm;                             //! Shared memory ring of the subscribers of the same host, NULL if none
+  UdprosDestination udpros_subs[CN_MAX_UDPROS_SUBSCRIBERS]; //! Subscribers reached through UDPROS
+  int n_udpros_subs;
+  int send_queue_size;                          //! Max num of packets queued by a TCPROS connection still writing
+  CrosDropPolicy drop_policy;                   //! What a connection with a full send queue drops
+  uint64_t lag_limit_ms;                        //! A connection busy for longer is lagging, 0 to never check
+  int disconnect_lagging;                       //! If 1, the lagging connections are closed
+  size_t lagging_disconnects;                   //! Number of connections closed because lagging
+  size_t write_batch_size;                      //! Max num of bytes written at once by a connection
+  uint64_t write_window_us;                     //! Delay of the first write of an idle connection (in usec)
 };
 
 typedef CallbackResponse (*SubscriberCallback)(DynBuffer *buffer,  void* context);
@@ -115,9 +240,27 @@ struct SubscriberNode
   char *md5sum;                                 //! The md5sum of the message type
   char *topic_host;                             //! The hostname of the topic already contacted.
   int   topic_port;                             //! The host-port of the topic already contacted.
+  char *topic_uri;                              //! The XMLRPC URI of the publisher, as reported by the master
   int   client_xmlrpc_id;                       //! The xmlrpc client that manages the subscription
   int   client_tcpros_id;
   int   tcpros_port;
+  struct CrosNode *intra_pub_node;              //! The node of the same process publishing the topic, NULL if none
+  int   intra_pub_idx;                          //! The publisher index in intra_pub_node->pubs
+  DynBuffer header;                             //! TCPROS connection header (size included), built at the first connection
+  DynBuffer intra_packets;                      //! Packets ([size][data]) delivered by intra_pub_node, to be dispatched
+  int   n_intra_packets;
+  CrosShmRing *shm;                             //! Shared memory ring of the publisher, NULL if not used
+  int   shm_reader;                             //! The reader index of the subscriber in the ring
+  int   shm_notify_fd;                          //! FIFO written by the publisher for every packet, -1 if none
+  char *shm_fifo_path;
+  int   shm_refused;                            //! The ring couldn't be mapped: request TCPROS only
+  char *unixros_path;                           //! Unix domain socket of the publisher (UNIXROS), NULL if not used
+  int   unixros_refused;                        //! The socket couldn't be connected: request TCPROS only, until the publisher URI changes
+  UdprosReceiver udpros;
+  int   queue_size;                             //! Max num of messages waiting for the callback, 0 to call it on reception
+  DynBuffer queue;                              //! Messages ([size][data]) waiting for the callback, oldest first
+  int   n_queued;
+  uint64_t queue_drops;                         //! Messages dropped because the queue was full
   void *context;
   SubscriberCallback callback;
   NodeStatusCallback status_callback;
@@ -125,6 +268,11 @@ struct SubscriberNode
 
 typedef CallbackResponse (*ServiceProviderCallback)(DynBuffer *bufferRequest, DynBuffer *bufferResponse, void* context);
 
+/*! Value returned by a service provider callback that will answer the request later,
+ *  with cRosNodeSendServiceResponse(). The request id is in CrosNode::service_call_id
+ *  during the callback */
+#define CN_SERVICE_RESPONSE_DEFERRED ((CallbackResponse)0xFF)
+
 struct ServiceProviderNode
 {
   char *service_name;
@@ -132,48 +280,84 @@ struct ServiceProviderNode
   char *servicerequest_type;
   char *serviceresponse_type;
   char *md5sum;
+  DynBuffer header;                             //! RPCROS connection header (size included), built at the first connection
   void *context;
   ServiceProviderCallback callback;
   NodeStatusCallback status_callback;
 };
 
+/*! \brief Callback that receives the (raw) response of a service call
+ *
+ *  \param callid The id returned by cRosNodeCallService()
+ *  \param bufferResponse The response data, NULL if the call failed
+ */
+typedef void (*ServiceCallerCallback)(int callid, DynBuffer *bufferResponse, void* context);
+
+/*! A service call waiting to be sent or to be answered */
+struct ServiceCallNode
+{
+  int id;
+  DynBuffer request;                            //! The (raw) request data
+  ServiceCallNode *next;
+};
+
+/*! Structure that define a service client */
+struct ServiceCallerNode
+{
+  char *service_name;
+  char *service_type;
+  char *md5sum;
+  char *service_host;                           //! The provider host, NULL until the service is looked up
+  int service_port;                             //! The provider RPCROS port
+  int uri_from_cache;                           //! The provider address has been taken from the lookup cache
+  int lookup_pending;                           //! A lookupService is in progress on behalf of the caller
+  ServiceHostResolver *resolver;                //! Resolution of the provider host name in progress, NULL if none
+  int persistent;                               //! If 1, keep the connection open and pipeline the requests on it,
+                                                //! up to CN_SERVICE_PIPELINE_DEPTH waiting for their response
+  DynBuffer header;                             //! RPCROS connection header (size included), built at the first connection
+  ServiceCallNode *queue_head;                  //! Requests waiting to be sent
+  ServiceCallNode *queue_tail;
+  ServiceCallNode *sent_head;                   //! Requests sent, waiting for the response (in order)
+  ServiceCallNode *sent_tail;
+  void *context;
+  ServiceCallerCallback callback;
+  NodeStatusCallback status_callback;
+};
+
 struct ParameterSubscription
 {
   char *parameter_key;
   XmlrpcParam parameter_value;
   void *context;
   NodeStatusCallback status_callback;
+  unsigned char subscribed;           //! The master notifies the updates of the parameter
 };
 
 typedef struct CrosLog CrosLog;
-typedef struct CrosLogNode CrosLogNode;
-typedef struct CrosLogQueue CrosLogQueue;
+typedef struct CrosLogRing CrosLogRing;
 
+/*! A log record, formatted once by cRosLogPrint(). The rest of the rosgraph_msgs/Log
+ *  message (node name, published topics) is filled when the record is published */
 struct CrosLog
 {
   uint8_t level;    //! debug level
-  char* name;       //! name of the node
-  char* msg;        //! message
-  char* file;       //! file the message came from
-  char* function;   //! function the message came from
+  const char* file;       //! file the message came from (a string literal, e.g. __FILE__)
+  const char* function;   //! function the message came from (a string literal)
   uint32_t line;    //! line the message came from
-  char** pubs;    //! topic names that the node publishes
   uint32_t secs;
   uint32_t nsecs;
-  size_t n_pubs;
-};
-
-struct CrosLogNode
-{
-  CrosLog *call;
-  CrosLogNode* next;
+  char msg[CN_LOG_MAX_MSG_SIZE];    //! message, truncated if too long
 };
 
-struct CrosLogQueue
+/*! Preallocated queue of the log records waiting for /rosout: when it's full, the oldest
+ *  record is overwritten */
+struct CrosLogRing
 {
-  CrosLogNode* head;
-  CrosLogNode* tail;
+  CrosLog *records;
+  size_t capacity;
+  size_t head;                  //! Index of the oldest record
   size_t count;
+  uint64_t dropped;             //! Records overwritten before being published
 };
 
 typedef enum CrosLogLevel //!Logging levels
@@ -206,12 +390,15 @@ struct CrosNode
   char *message_root_path;      //! Directory with the message register
 
   CrosLogLevel log_level;
-  CrosLogQueue* log_queue;
+  CrosLogRing log_ring;         //! Log records waiting for /rosout
+  int log_pub_idx;              //! The /rosout publisher, -1 if none
   uint32_t log_last_id;
 
   unsigned int next_call_id;
   ApiCallQueue master_api_queue;
   ApiCallQueue slave_api_queue;
+  ApiCallQueue cached_api_queue;        //! User lookups to be answered from lookup_cache
+  CrosLookupCache lookup_cache;         //! Cache of the roscore lookup responses
 
   //! Manage connections for XMLRPC calls from this node to others
   XmlrpcProcess xmlrpc_client_proc[CN_MAX_XMLRPC_CLIENT_CONNECTIONS];
@@ -222,6 +409,8 @@ struct CrosNode
   //! Manage connections for TCPROS calls from this node to others
   TcprosProcess tcpros_client_proc[CN_MAX_TCPROS_CLIENT_CONNECTIONS];
   TcprosProcess tcpros_listner_proc;   //! Accept new TCPROS connections from roscore or other nodes
+  TcpIpSocket unixros_listner;         //! Accept the TCPROS connections of the nodes of the same host (UNIXROS)
+  char *unixros_path;                  //! Path of unixros_listner, NULL until the first UNIXROS subscriber
 
   /*! Manage connections for TCPROS between this and other nodes  */
   TcprosProcess tcpros_server_proc[CN_MAX_TCPROS_SERVER_CONNECTIONS];
@@ -229,18 +418,38 @@ struct CrosNode
   //! Manage connections for RPCROS calls from this node to others
   TcprosProcess rpcros_listner_proc;   //! Accept new TCPROS connections from roscore or other nodes
 
-  /*! Manage connections for RPCROS between this and other nodes  */
-  TcprosProcess rpcros_server_proc[CN_MAX_RPCROS_SERVER_CONNECTIONS];
+  /*! Manage connections for RPCROS between this and other nodes (grows on demand
+   *  up to CN_MAX_RPCROS_SERVER_CONNECTIONS) */
+  TcprosProcess *rpcros_server_proc;
+  int n_rpcros_server_proc;             //! Number of allocated rpcros_server_proc
+  int service_call_id;                  //! Id of the request being served by a provider callback, -1 otherwise
+  int next_connection_id;               //! Id of the next TCPROS/RPCROS connection (see getBusInfo)
+  size_t service_requests;              //! Service requests served since the node creation
+  size_t service_bytes_received;        //! Bytes of the service requests received
+  size_t service_bytes_sent;            //! Bytes of the service responses sent
+
+  /*! Manage connections for RPCROS calls from the service callers of this node to the providers */
+  TcprosProcess rpcros_client_proc[CN_MAX_RPCROS_CLIENT_CONNECTIONS];
 
   PublisherNode pubs[CN_MAX_PUBLISHED_TOPICS];            //! All the published topic, defined by PublisherNode structures
   SubscriberNode subs[CN_MAX_SUBSCRIBED_TOPICS];          //! All the subscribed topic, defined by PublisherNode structures
   ServiceProviderNode services[CN_MAX_SERVICE_PROVIDERS]; //! All the services to register
+  ServiceCallerNode service_callers[CN_MAX_SERVICE_CALLERS]; //! All the services called by the node
   ParameterSubscription paramsubs[CN_MAX_PARAMETER_SUBSCRIPTIONS];
 
   int n_pubs;                   //! Number of node's published topics
   int n_subs;                   //! Number of node's subscribed topics
   int n_services;               //! Number of registered services
+  int n_service_callers;        //! Number of service callers
   int n_paramsubs;
+  CrosNameIndex name_index;     //! Index of the names of pubs, subs, services and paramsubs
+
+  int intraprocess_transport;   //! Linked to the other nodes of the process that enabled it (see cros_intraprocess.h)
+  int shm_transport;            //! Offer the shared memory transport to the publishers of the same host
+  int unix_transport;           //! Offer the Unix domain socket transport to the publishers of the same host
+#ifdef CROS_USE_IO_URING
+  CrosUring uring;              //! Waits for the events of the sockets instead of select()
+#endif
 };
 
 /*! \brief Resolve the namespace of the resource name
@@ -303,7 +512,171 @@ void cRosNodeDoEventsLoop( CrosNode *n );
  */
 void cRosNodeStart( CrosNode *n, unsigned char *exit );
 
+typedef struct CrosNodeFd CrosNodeFd;
+
+struct CrosNodeFd
+{
+  int fd;
+  int events;                         //! CN_EVENT_READ and/or CN_EVENT_WRITE
+};
+
+/*! \brief Start a cycle of the cROS node main loop driven by an external event loop (e.g., epoll):
+ *         run the pending work of the node and get the file descriptors to wait for, with the
+ *         deadline of the cycle
+ *
+ *  \param n A pointer to a CrosNode object
+ *  \param fds Returns the file descriptors of the node and the events they wait for. The set
+ *             changes at every cycle: the host loop has to update its own
+ *  \param max_fds The size of fds (FD_SETSIZE is always enough)
+ *  \param deadline_ms Returns the time (in msec, since the Epoch, as cRosClockGetTimeMs()) when
+ *                     the cycle ends if no event occurs, UINT64_MAX if never
+ *
+ *  \return Returns the number of file descriptors, -1 if fds is too small
+ *
+ *  A cycle ends with cRosNodeProcessEvents(), e.g.:
+ *
+ *  while(1)
+ *  {
+ *    int n_fds = cRosNodeGetEvents( node, fds, FD_SETSIZE, &deadline_ms );
+ *    // Wait for the events of the fds until deadline_ms, along with the other ones of the application
+ *    // For every ready fd of the node:
+ *    cRosNodeProcessEvents( node, fd, events );
+ *    // Or, if none got ready before the deadline:
+ *    cRosNodeProcessEvents( node, -1, 0 );
+ *  }
+ */
+int cRosNodeGetEvents( CrosNode *n, CrosNodeFd *fds, int max_fds, uint64_t *deadline_ms );
+
+/*! \brief End a cycle of the cROS node main loop driven by an external event loop, processing the
+ *         events of a file descriptor returned by cRosNodeGetEvents(), or the cycle deadline
+ *
+ *  \param n A pointer to a CrosNode object
+ *  \param fd The ready file descriptor, -1 if the deadline expired
+ *  \param events The events of fd (CN_EVENT_READ and/or CN_EVENT_WRITE): errors and hang-ups have
+ *                to be reported as both events, as select() does
+ */
+void cRosNodeProcessEvents( CrosNode *n, int fd, int events );
+
 XmlrpcParam * cRosNodeGetParameterValue( CrosNode *n, const char *key);
+
+/*! \brief Set the time to live of the roscore lookups (lookupService, lookupNode,
+ *         getTopicTypes, getParam) cached by the node. Only the parameters covered by a
+ *         subscription of the node are cached, since their updates invalidate the entries
+ *
+ *  \param n A pointer to a CrosNode object
+ *  \param ttl_ms The time to live in msec. 0 disables the cache and drops all the cached lookups
+ */
+void cRosNodeSetLookupCacheTtl( CrosNode *n, uint64_t ttl_ms );
+
+/*! \brief Enable or disable the intra-process transport (see cros_intraprocess.h). It is disabled
+ *         by default: the publishers and subscribers of the nodes of the process that enabled it
+ *         exchange the packets through their queues, so these nodes must be run by the same thread
+ *
+ *  \param n A pointer to a CrosNode object
+ *  \param enable 1 to link the node to the other nodes of the process that enabled the transport
+ *  \return Returns 0 on success, -1 if there are already CN_MAX_INTRAPROCESS_NODES linked nodes
+ */
+int cRosNodeSetIntraprocessTransport( CrosNode *n, int enable );
+
+/*! \brief Enable or disable the shared memory transport for the new subscriptions (see cros_shm.h).
+ *         It is enabled by default
+ *
+ *  \param n A pointer to a CrosNode object
+ *  \param enable 0 to always use TCPROS with the publishers of other processes
+ */
+void cRosNodeSetShmTransport( CrosNode *n, int enable );
+
+/*! \brief Enable or disable the Unix domain socket transport (UNIXROS) for the new subscriptions.
+ *         It is enabled by default: a subscriber whose publisher is on the same host asks for
+ *         a TCPROS connection through a Unix domain stream socket instead of the loopback interface
+ *
+ *  \param n A pointer to a CrosNode object
+ *  \param enable 0 to always use TCP/IP with the publishers of other processes
+ */
+void cRosNodeSetUnixTransport( CrosNode *n, int enable );
+
+/*! \brief Offer UDPROS to the publishers of a subscribed topic (see cros_udpros.h), from the next
+ *         connection on. Suited to high-rate data where freshness matters more than completeness:
+ *         the lost messages are dropped instead of delaying the next ones
+ *
+ *  \param n A pointer to a CrosNode object
+ *  \param subidx The subscriber index
+ *  \param max_datagram_size The max size of the datagrams (e.g., CN_UDPROS_DEFAULT_DATAGRAM_SIZE),
+ *                           0 to use TCPROS only (the default)
+ *
+ *  \return Returns 0 on success, -1 on failure
+ */
+int cRosNodeSetSubscriberUdpros( CrosNode *n, int subidx, int max_datagram_size );
+
+/*! \brief Set the queue of a subscribed topic (see cros_subscriber_queue.h), as the queue_size of roscpp:
+ *         the received messages wait for the callback in the queue, that drops the oldest ones when full
+ *
+ *  \param n A pointer to a CrosNode object
+ *  \param subidx The subscriber index
+ *  \param queue_size The max num of queued messages, CN_SUBSCRIBER_QUEUE_LATEST_ONLY to pass only the
+ *                    newest message to the callback, 0 to call the callback on reception (the default)
+ *
+ *  \return Returns 0 on success, -1 on failure
+ */
+int cRosNodeSetSubscriberQueue( CrosNode *n, int subidx, int queue_size );
+
+/*! \brief Set the send queue of every TCPROS subscriber connection of a publisher. A connection still
+ *         writing when a packet is published queues it, so that a slow subscriber doesn't delay the
+ *         other ones and gets the packets in order. When the queue is full the policy decides which
+ *         packet the connection drops
+ *
+ *  \param n A pointer to a CrosNode object
+ *  \param pubidx The publisher index
+ *  \param queue_size The max num of queued packets per connection, 0 to skip the packets published
+ *                    while the connection is writing (the default)
+ *  \param policy CROS_DROP_NEWEST or CROS_DROP_OLDEST
+ *
+ *  \return Returns 0 on success, -1 on failure
+ */
+int cRosNodeSetPublisherQueue( CrosNode *n, int pubidx, int queue_size, CrosDropPolicy policy );
+
+/*! \brief Detect the chronically lagging subscribers of a publisher: the TCPROS connections that
+ *         have had packets to write for longer than lag_limit_ms without emptying their queue
+ *
+ *  \param n A pointer to a CrosNode object
+ *  \param pubidx The publisher index
+ *  \param lag_limit_ms The limit (in msec), 0 to disable the detection (the default)
+ *  \param disconnect If 1, a lagging connection is closed (the subscriber may connect again),
+ *                    otherwise it's only reported by cRosNodeGetPublisherStats()
+ *
+ *  \return Returns 0 on success, -1 on failure
+ */
+int cRosNodeSetPublisherLagLimit( CrosNode *n, int pubidx, uint64_t lag_limit_ms, int disconnect );
+
+/*! \brief Get the statistics of the TCPROS subscriber connections of a publisher
+ *
+ *  \param n A pointer to a CrosNode object
+ *  \param pubidx The publisher index
+ *  \param drops Returns the packets dropped by the current connections
+ *  \param lagging Returns the num of current connections that are lagging
+ *  \param lagging_disconnects Returns the num of connections closed because lagging
+ *
+ *  \return Returns 0 on success, -1 on failure
+ */
+int cRosNodeGetPublisherStats( CrosNode *n, int pubidx, size_t *drops, int *lagging, size_t *lagging_disconnects );
+
+/*! \brief Set how the TCPROS subscriber connections of a publisher coalesce their writes. A connection
+ *         writes its pending packet and the queued ones (see cRosNodeSetPublisherQueue()) with a single
+ *         writev(), up to batch_size bytes. An idle connection can also wait window_us before its first
+ *         write, so that the packets published meanwhile are queued and sent with it: this cuts the
+ *         syscalls of the high-rate topics of small messages, at the cost of their latency.
+ *         The event loop has a millisecond resolution, so the window is rounded up to the millisecond
+ *
+ *  \param n A pointer to a CrosNode object
+ *  \param pubidx The publisher index
+ *  \param batch_size The max num of bytes written at once (CN_TCPROS_WRITE_BATCH_SIZE by default),
+ *                    0 to write the packets one by one
+ *  \param window_us The aggregation window (in usec), 0 to write as soon as a packet is published
+ *                   (the default). It requires a send queue
+ *
+ *  \return Returns 0 on success, -1 on failure
+ */
+int cRosNodeSetPublisherWriteBatching( CrosNode *n, int pubidx, size_t batch_size, uint64_t window_us );
 /*! @}*/
 
 #endif
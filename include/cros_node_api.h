@@ -2,7 +2,10 @@
 #define _CROS_NODE_API_H_
 
 #define CROS_TRANSPORT_TCPROS_STRING "TCPROS"
-#define CROS_TRANSPORT_UPDROS_STRING "UDPROS"
+#define CROS_TRANSPORT_UDPROS_STRING "UDPROS"
+#define CROS_TRANSPORT_INTRAPROCESS_STRING "INTRAPROCESS"
+#define CROS_TRANSPORT_SHMROS_STRING "SHMROS"
+#define CROS_TRANSPORT_UNIXROS_STRING "UNIXROS"
 
 typedef enum
 {
@@ -95,6 +98,9 @@ struct CrosNodeStatusUsr;
 
 void initCrosNodeStatus(struct CrosNodeStatusUsr *status);
 
+/*! \brief Resolve a hostname to its numeric address, written into ip (at least 100 chars) */
+int lookup_host(const char *host, char *ip);
+
 /*! @}*/
 
 #endif
@@ -0,0 +1,116 @@
+#ifndef _CROS_SHM_H_
+#define _CROS_SHM_H_
+
+#include <stdint.h>
+
+#include "cros_node.h"
+
+/*! \defgroup cros_shm cROS shared memory transport
+ *
+ *  Transport between cROS nodes of the same host, negotiated in requestTopic (SHMROS)
+ *  ahead of TCPROS, that other ROS implementations ignore. Each publisher owns a POSIX
+ *  shared memory ring: the packet of a publication cycle is written once in the ring and
+ *  every subscriber dispatches it in place. The subscribers are woken up through a FIFO,
+ *  so that the notification can be waited by the select() of the event loop.
+ *
+ *  A publisher never overwrites a packet not yet read by a subscriber: when the ring
+ *  is full the new packets are dropped, as with a TCPROS connection still writing
+ */
+
+/*! \addtogroup cros_shm
+ *  @{
+ */
+
+/*! Size of the ring of a publisher (the larger packets can't be sent through it) */
+#define CROS_SHM_RING_SIZE (8 * 1024 * 1024)
+
+/*! Max num subscribers of a ring */
+#define CROS_SHM_MAX_READERS 8
+
+/*! Record that marks the end of the packets before the ring wraps around */
+#define CROS_SHM_WRAP_MARKER 0xFFFFFFFF
+
+#define CROS_SHM_MAGIC 0x43524f53
+
+typedef struct CrosShmReader CrosShmReader;
+typedef struct CrosShmHeader CrosShmHeader;
+
+struct CrosShmReader
+{
+  int32_t pid;                        //! The subscriber process
+  int32_t active;
+  uint64_t read_pos;                  //! Position of the next packet to read, written by the subscriber
+};
+
+/*! Beginning of the shared memory, followed by the packets. The positions grow from 0 and
+ *  wrap around the ring with a modulo */
+struct CrosShmHeader
+{
+  uint32_t magic;
+  uint32_t closed;                    //! Set when the publisher is gone
+  uint64_t capacity;                  //! Size of the packet area
+  uint64_t write_pos;                 //! End of the last packet, written by the publisher
+  uint64_t last_pos;                  //! Beginning of the last packet (latching)
+  CrosShmReader readers[CROS_SHM_MAX_READERS];
+};
+
+/*! A ring mapped by a publisher or a subscriber */
+struct CrosShmRing
+{
+  char name[64];                      //! Name of the shared memory object
+  CrosShmHeader *header;
+  unsigned char *data;                //! The packet area
+  size_t map_size;
+  int notify_fds[CROS_SHM_MAX_READERS]; //! Publisher side: the FIFOs of the subscribers, -1 if none
+};
+
+/*! \brief Add a subscriber to the ring of a publisher, creating the ring if needed.
+ *         The latched packet of the publisher, if any, is the first one read by the subscriber
+ *
+ *  \param n The publisher node
+ *  \param pub_idx The publisher index
+ *  \param pid The subscriber process
+ *  \param fifo_path The FIFO opened by the subscriber to be notified. Only a /tmp/cros_*.fifo FIFO
+ *                   of the same user is accepted (no symbolic link)
+ *
+ *  \return The reader index, -1 on failure (the subscriber should use TCPROS)
+ */
+int cRosShmAddReader(CrosNode *n, int pub_idx, int pid, const char *fifo_path);
+
+/*! \brief Check if a publisher has some subscribers through shared memory */
+int cRosShmHasReaders(CrosNode *n, int pub_idx);
+
+/*! \brief Write the current packet of a publisher in its ring and notify the subscribers
+ */
+void cRosShmPublish(CrosNode *n, int pub_idx);
+
+/*! \brief Remove the ring of a publisher. Its subscribers will connect again at the next publisherUpdate
+ */
+void cRosShmRelease(CrosNode *n, int pub_idx);
+
+/*! \brief Create the notification FIFO of a subscriber, to be sent with requestTopic
+ *
+ *  \return The path of the FIFO (owned by the subscriber), NULL on failure
+ */
+const char * cRosShmOpenNotifier(CrosNode *n, int sub_idx);
+
+/*! \brief Map the ring of a publisher, as answered to requestTopic
+ *
+ *  \return Returns 0 on success, -1 on failure (the FIFO is closed so that the publisher drops the reader)
+ */
+int cRosShmAttach(CrosNode *n, int sub_idx, const char *name, int reader_idx);
+
+/*! \brief Stop reading a ring and remove the notification FIFO of a subscriber
+ */
+void cRosShmDetach(CrosNode *n, int sub_idx);
+
+/*! \brief Call the subscriber callbacks on the packets of the rings not read yet.
+ *         A packet size that doesn't fit the ring makes the subscriber skip to the last written position
+ *
+ *  \return The number of dispatched packets
+ */
+int cRosShmDispatch(CrosNode *n);
+
+/*! @}*/
+
+#endif // _CROS_SHM_H_
@@ -0,0 +1,46 @@
+#ifndef _CROS_SUBSCRIBER_QUEUE_H_
+#define _CROS_SUBSCRIBER_QUEUE_H_
+
+#include "cros_node.h"
+
+/*! \defgroup cros_subscriber_queue cROS subscriber queue
+ *
+ *  By default the callback of a subscriber is called for every message, as soon as it is
+ *  received: a slow callback delays the reading of the connection, and the publisher ends up
+ *  waiting for it. A subscriber with a queue (see cRosNodeSetSubscriberQueue()) copies the
+ *  received messages in the queue instead, and its callback is called on one of them at every
+ *  cycle of the events loop. When the queue is full the oldest message is dropped, as with the
+ *  queue_size of roscpp: the connections are read at full speed and the callback gets the
+ *  newest messages. A queue of CN_SUBSCRIBER_QUEUE_LATEST_ONLY messages keeps only the last one
+ */
+
+/*! \addtogroup cros_subscriber_queue
+ *  @{
+ */
+
+/*! \brief Pass a received message to a subscriber: call its callback, or append the message
+ *         to its queue. Used by all the transports
+ *
+ *  \param msg The serialized message (size prefix excluded), copied if queued
+ */
+void cRosSubscriberQueueDeliver(CrosNode *n, int sub_idx, DynBuffer *msg);
+
+/*! \brief Call the callback of every subscriber of the node on its oldest queued message.
+ *         The remaining ones wait for the next cycle, after the connections have been read
+ *
+ *  \return The number of dispatched messages
+ */
+int cRosSubscriberQueueDispatch(CrosNode *n);
+
+/*! \brief Check if some messages are waiting in the subscriber queues of the node
+ */
+int cRosSubscriberQueueHasPending(CrosNode *n);
+
+/*! \brief Change the length of the queue of a subscriber, dropping the oldest messages
+ *         that exceed it. With 0, the queued messages are still dispatched
+ */
+void cRosSubscriberQueueResize(SubscriberNode *sub, int queue_size);
+
+/*! @}*/
+
+#endif // _CROS_SUBSCRIBER_QUEUE_H_
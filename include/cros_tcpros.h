@@ -47,19 +47,44 @@ void cRosMessagePrepareSubcriptionHeader( CrosNode *n, int client_idx );
  */
 void cRosMessagePreparePublicationHeader( CrosNode *n, int server_idx );
 
-/*! \brief Prepare a TCPROS message (with data) to be sent to a subscriber
+/*! \brief Prepare the TCPROS message (with data) of a publisher, to be sent to all its subscribers
  *
  *  \param n Ponter to the CrosNode object
- *  \param server_idx Index of the TcprosProcess ( tcpros_server_proc[server_idx] ) to be considered
+ *  \param pub_idx Index of the publisher ( pubs[pub_idx] ): the message is stored in its packet
+ */
+void cRosMessagePreparePublicationPacket( CrosNode *n, int pub_idx );
+
+/*! \brief Prepare the connection header sent by a subscriber in the UDPROS entry of requestTopic
+ *         (the fields only, without the header size prefix)
+ *
+ *  \param n Ponter to the CrosNode object
+ *  \param sub_idx Index of the subscriber ( subs[sub_idx] )
+ *  \param header Pointer to the DynBuffer where the fields are appended
+ */
+void cRosMessagePrepareUdprosSubscriptionHeader( CrosNode *n, int sub_idx, DynBuffer *header );
+
+/*! \brief Prepare the connection header sent back by a publisher in the UDPROS response of requestTopic
+ *
+ *  \param n Ponter to the CrosNode object
+ *  \param pub_idx Index of the publisher ( pubs[pub_idx] )
+ *  \param latching 1 if the latched message has been sent to the subscriber
+ *  \param header Pointer to the DynBuffer where the fields are appended
+ */
+void cRosMessagePrepareUdprosPublicationHeader( CrosNode *n, int pub_idx, int latching, DynBuffer *header );
+
+/*! \brief Check the type and md5sum fields of a UDPROS connection header (a "*" md5sum matches any)
+ *
+ *  \return Returns 0 if they match, -1 otherwise
  */
-void cRosMessagePreparePublicationPacket( CrosNode *n, int server_idx );
+int cRosMessageCheckUdprosHeader( const unsigned char *header, size_t size, const char *type, const char *md5sum );
 
 /*! \brief Read the TCPROS message (with data) received from the publisher
  *
  *  \param n Ponter to the CrosNode object
  *  \param client_idx Index of the TcprosProcess ( tcpros_client_proc[server_idx] ) to be considered for the parsing
+ *  \param packet Pointer to the DynBuffer with the message data (without the size prefix)
  */
-void cRosMessageParsePublicationPacket( CrosNode *n, int client_idx );
+void cRosMessageParsePublicationPacket( CrosNode *n, int client_idx, DynBuffer *packet );
 
 /*! \brief Parse a RCPROS header sent from a service caller
  *
@@ -83,8 +108,36 @@ void cRosMessagePrepareServiceProviderHeader( CrosNode *n, int server_idx);
  *
  *  \param n Ponter to the CrosNode object
  *  \param server_idx Index of the TcprosProcess ( rpcros_server_proc[server_idx] ) to be considered
+ *
+ *  \return Returns the value returned by the provider callback. If it is CN_SERVICE_RESPONSE_DEFERRED,
+ *          the packet is left empty
+ */
+CallbackResponse cRosMessagePrepareServiceResponsePacket( CrosNode *n, int server_idx);
+
+/*! \brief Append a RCPROS response (ok byte, size and data) to a packet
+ *
+ *  \param packet The packet to be sent to the service caller
+ *  \param ok 1 if the service succeded, 0 otherwise (then response is an error message)
+ *  \param response The (raw) response data, can be NULL
  */
-void cRosMessagePrepareServiceResponsePacket( CrosNode *n, int server_idx);
+void cRosMessagePrepareServiceResponse( DynBuffer *packet, int ok, DynBuffer *response );
+
+/*! \brief Prepare a TCPROS header to be sent to a service provider
+ *
+ *  \param n Ponter to the CrosNode object
+ *  \param client_idx Index of the TcprosProcess ( rpcros_client_proc[client_idx] ) to be considered
+ */
+void cRosMessagePrepareServiceCallHeader( CrosNode *n, int client_idx);
+
+/*! \brief Parse a TCPROS header sent back from a service provider
+ *
+ *  \param n Ponter to the CrosNode object
+ *  \param client_idx Index of the TcprosProcess ( rpcros_client_proc[client_idx] ) to be considered for the parsing
+ *
+ *  \return Returns TCPROS_PARSER_DONE if the header is successfully parsed,
+ *          or TCPROS_PARSER_ERROR on failure (e.g., the provider sent an error)
+ */
+TcprosParserState cRosMessageParseServiceProviderHeader( CrosNode *n, int client_idx);
 
 /*! \brief Parse a TCPROS header sent initially from a subscriber
  *
@@ -122,19 +175,20 @@ void cRosMessagePrepareSubcriptionHeader( CrosNode *n, int client_idx );
  */
 void cRosMessagePreparePublicationHeader( CrosNode *n, int server_idx );
 
-/*! \brief Prepare a TCPROS message (with data) to be sent to a subscriber
+/*! \brief Prepare the TCPROS message (with data) of a publisher, to be sent to all its subscribers
  *
  *  \param n Ponter to the CrosNode object
- *  \param server_idx Index of the TcprosProcess ( tcpros_server_proc[server_idx] ) to be considered
+ *  \param pub_idx Index of the publisher ( pubs[pub_idx] ): the message is stored in its packet
  */
-void cRosMessagePreparePublicationPacket( CrosNode *n, int server_idx );
+void cRosMessagePreparePublicationPacket( CrosNode *n, int pub_idx );
 
 /*! \brief Read the TCPROS message (with data) received from the publisher
  *
  *  \param n Ponter to the CrosNode object
  *  \param client_idx Index of the TcprosProcess ( tcpros_client_proc[server_idx] ) to be considered for the parsing
+ *  \param packet Pointer to the DynBuffer with the message data (without the size prefix)
  */
-void cRosMessageParsePublicationPacket( CrosNode *n, int client_idx );
+void cRosMessageParsePublicationPacket( CrosNode *n, int client_idx, DynBuffer *packet );
 
 /*! \brief Parse a RCPROS header sent from a service caller
  *
@@ -158,7 +212,18 @@ void cRosMessagePrepareServiceProviderHeader( CrosNode *n, int server_idx);
  *
  *  \param n Ponter to the CrosNode object
  *  \param server_idx Index of the TcprosProcess ( rpcros_server_proc[server_idx] ) to be considered
+ *
+ *  \return Returns the value returned by the provider callback. If it is CN_SERVICE_RESPONSE_DEFERRED,
+ *          the packet is left empty
+ */
+CallbackResponse cRosMessagePrepareServiceResponsePacket( CrosNode *n, int server_idx);
+
+/*! \brief Append a RCPROS response (ok byte, size and data) to a packet
+ *
+ *  \param packet The packet to be sent to the service caller
+ *  \param ok 1 if the service succeded, 0 otherwise (then response is an error message)
+ *  \param response The (raw) response data, can be NULL
  */
-void cRosMessagePrepareServiceResponsePacket( CrosNode *n, int server_idx);
+void cRosMessagePrepareServiceResponse( DynBuffer *packet, int ok, DynBuffer *response );
 
 #endif // _CROS_TCPROS_H_
\ No newline at end of file
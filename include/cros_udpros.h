@@ -0,0 +1,103 @@
+#ifndef _CROS_UDPROS_H_
+#define _CROS_UDPROS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cros_node.h"
+
+/*! \defgroup cros_udpros cROS UDPROS transport
+ *
+ *  UDPROS (http://wiki.ros.org/ROS/UDPROS), negotiated in requestTopic by the subscribers
+ *  that enable it with cRosNodeSetSubscriberUdpros(). The subscriber binds a UDP socket
+ *  and sends its connection header with the socket address; the publisher answers with the
+ *  connection id that tags every datagram sent to that subscriber.
+ *
+ *  Each message ([size][data]) is split into blocks that fit in a datagram after its
+ *  8 bytes header: the first one (DATA0) carries the number of blocks, the following ones
+ *  (DATAN) their index. A message with a lost or out of order block is dropped: nothing
+ *  is retransmitted, so a lost datagram never delays the next messages
+ */
+
+/*! \addtogroup cros_udpros
+ *  @{
+ */
+
+/*! Size of the header of every datagram */
+#define CROS_UDPROS_HEADER_SIZE 8
+
+typedef enum CrosUdprosOpcode
+{
+  CROS_UDPROS_DATA0 = 0,                //! First block of a message
+  CROS_UDPROS_DATAN = 1,                //! Next blocks of a message
+  CROS_UDPROS_PING = 2,
+  CROS_UDPROS_ERR = 3
+} CrosUdprosOpcode;
+
+/*! \brief Add a subscriber to a publisher, sending it the latched packet if any
+ *
+ *  \param n The publisher node
+ *  \param pub_idx The publisher index
+ *  \param caller_id The subscriber node
+ *  \param host The host of the subscriber socket
+ *  \param port The port of the subscriber socket
+ *  \param max_datagram_size The max size of the datagrams asked by the subscriber
+ *
+ *  \return The index of the subscriber in the publisher udpros_subs, -1 on failure
+ */
+int cRosUdprosAddSubscriber(CrosNode *n, int pub_idx, const char *caller_id, const char *host,
+                            int port, int max_datagram_size);
+
+/*! \brief Check if a publisher has some subscribers through UDPROS */
+int cRosUdprosHasSubscribers(CrosNode *n, int pub_idx);
+
+/*! \brief Send the current packet of a publisher to its UDPROS subscribers
+ */
+void cRosUdprosPublish(CrosNode *n, int pub_idx);
+
+/*! \brief Remove all the UDPROS subscribers of a publisher
+ */
+void cRosUdprosRelease(CrosNode *n, int pub_idx);
+
+/*! \brief Open the socket of a subscriber, to be sent with requestTopic. The socket is kept
+ *         (and its port doesn't change) until cRosUdprosCloseReceiver()
+ *
+ *  \return The port of the socket, -1 on failure
+ */
+int cRosUdprosOpenReceiver(CrosNode *n, int sub_idx);
+
+/*! \brief Start receiving the datagrams of a publisher, as answered to requestTopic. The socket
+ *         is connected to the publisher one: the datagrams received since the request (e.g., the
+ *         latched message) are read from now on
+ *
+ *  \param host The host of the publisher socket
+ *  \param port The port of the publisher socket
+ *  \param connection_id The id of the connection assigned by the publisher
+ *  \param max_datagram_size The max size of the datagrams sent by the publisher
+ *
+ *  \return Returns 0 on success, -1 on failure
+ */
+int cRosUdprosConnect(CrosNode *n, int sub_idx, const char *host, int port, uint32_t connection_id,
+                      int max_datagram_size);
+
+/*! \brief Close the socket of a subscriber
+ */
+void cRosUdprosCloseReceiver(CrosNode *n, int sub_idx);
+
+/*! \brief Read the pending datagrams of the subscribers, calling their callbacks on the
+ *         completed messages
+ *
+ *  \return The number of dispatched messages
+ */
+int cRosUdprosReceive(CrosNode *n);
+
+/*! \brief Get the message counters of a subscriber
+ *
+ *  \param received Output: the messages received through UDPROS
+ *  \param dropped Output: the messages lost (entirely or in part) on the way
+ */
+void cRosUdprosGetStats(CrosNode *n, int sub_idx, size_t *received, size_t *dropped);
+
+/*! @}*/
+
+#endif // _CROS_UDPROS_H_
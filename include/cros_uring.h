@@ -0,0 +1,176 @@
+#ifndef _CROS_URING_H_
+#define _CROS_URING_H_
+
+#ifdef CROS_USE_IO_URING
+
+#include <stdint.h>
+#include <sys/select.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+/*! \defgroup cros_uring cROS io_uring event backend
+ *
+ *  Built with CROS_USE_IO_URING (cmake -DCROS_USE_IO_URING=ON), the event loop waits for the
+ *  events of its sockets with an io_uring instead of select(). The poll request of a socket stays
+ *  queued across the cycles: a cycle submits only the polls of the sockets that became ready
+ *  (armed again, as select() reports a socket until it is served) or whose events changed, and
+ *  waits for the completions in the same io_uring_enter(), with the cycle timeout. So an idle
+ *  node costs a single system call per cycle, whatever the number of its sockets.
+ *  The completions fill the same fd sets as select(), so that the processes of the node are
+ *  unchanged: they still read and write their non-blocking sockets as soon as they are ready.
+ *  The exceptional conditions (i.e., TCP urgent data, never sent by ROS) aren't reported.
+ *
+ *  The data of the TCPROS connections is transferred by completions instead: a subscriber
+ *  socket keeps a receive queued in the io_uring, into a ring of buffers provided to the kernel
+ *  (cRosUringRecv()), and a publisher socket sends a copy of its packets owned by the io_uring
+ *  (cRosUringSend()). These requests are submitted with the polls of the cycle, and a socket is
+ *  reported ready when its receive has completed or its send buffer is free. The connection
+ *  setup (connect, accept and headers), XML-RPC and the services are still readiness-based.
+ *
+ *  A pending request keeps its socket alive after close(), and doesn't watch a new socket that
+ *  reuses the descriptor: the owners of the descriptors call cRosUringNotifyClose(), that counts
+ *  the closings of each descriptor, and the next cycle removes the requests of the closed ones.
+ *
+ *  If the kernel has no io_uring (Linux < 5.11, or disabled), the node falls back to select().
+ *  The completion receives need Linux 5.19 (provided buffer rings): before, the subscribers
+ *  read their sockets when they are ready
+ */
+
+/*! \addtogroup cros_uring
+ *  @{
+ */
+
+/*! Size of the submission queue: the requests in excess are submitted in several batches */
+#define CROS_URING_ENTRIES 256
+
+/*! Max number of sockets that receive or send with completions: the others use readiness */
+#define CROS_URING_MAX_IO 16
+
+/*! Number of buffers provided to the receives (a power of 2), and their size */
+#define CROS_URING_RECV_BUFFERS 16
+#define CROS_URING_RECV_BUFFER_SIZE 65536
+
+/*! Max size of the data copied by a cRosUringSend() */
+#define CROS_URING_SEND_SIZE 65536
+
+typedef enum CrosUringIoState
+{
+  CROS_URING_IO_FREE = 0,             //! The entry isn't used
+  CROS_URING_IO_IDLE,                 //! Send: no data to send, the socket is ready for writing
+  CROS_URING_IO_WANTED,               //! The request is queued at the next cycle
+  CROS_URING_IO_PENDING,              //! The request is submitted
+  CROS_URING_IO_DONE,                 //! Receive: the result is ready, the socket is ready for reading
+  CROS_URING_IO_CANCEL,               //! The socket is closed: the request is cancelled at the next cycle
+  CROS_URING_IO_CANCELLING            //! The cancellation is submitted, the entry is freed by the completion
+} CrosUringIoState;
+
+typedef struct CrosUringIo CrosUringIo;
+
+struct CrosUringIo
+{
+  int fd;                             //! The socket, -1 if the entry isn't bound to a socket
+  int is_send;                        //! 1 if the socket sends, 0 if it receives
+  CrosUringIoState state;
+  uint32_t close_count;               //! Count of the closings of the socket when the entry was bound
+  uint64_t data;                      //! Tag of the request submitted
+  int result;                         //! Receive: bytes received or -errno; send: -errno of a failed send
+  int buffer_id;                      //! Receive: the provided buffer with the received bytes, -1 if none
+  unsigned char *send_buf;            //! Send: copy of the bytes being sent
+  size_t send_size;
+  size_t send_offset;                 //! Send: bytes of send_buf already sent
+};
+
+typedef struct CrosUring CrosUring;
+
+struct CrosUring
+{
+  int fd;                             //! The io_uring, -1 if not available (select() is used)
+  void *ring_map;                     //! Mapping of the submission and completion rings
+  size_t ring_map_size;
+  struct io_uring_sqe *sqes;          //! Mapping of the submission queue entries
+  size_t sqes_size;
+  unsigned *sq_tail, *sq_mask, *sq_array;
+  unsigned sq_entries;
+  unsigned *cq_head, *cq_tail, *cq_mask;
+  struct io_uring_cqe *cqes;
+  uint32_t sequence;                  //! Tag of the last request queued, to ignore the completions of the replaced ones
+  uint64_t poll_data[FD_SETSIZE];     //! Tag of the pending poll of each socket
+  unsigned char poll_events[FD_SETSIZE]; //! Events (POLLIN, POLLOUT) of the pending poll of each socket, 0 if none
+  uint32_t poll_close_count[FD_SETSIZE]; //! Count of the closings of each socket when its poll was queued
+  int max_fd;                         //! Highest socket with a pending poll, -1 if none
+  int active;                         //! Set by cRosUringSelect(): the completion I/O needs its cycles
+  CrosUringIo io[CROS_URING_MAX_IO];  //! The sockets that receive or send with completions
+  signed char io_idx[FD_SETSIZE];     //! Entry of io of each socket, -1 if none
+  struct io_uring_buf_ring *recv_ring; //! Ring of the buffers provided to the receives, NULL until the first one
+  unsigned char *recv_buffers;
+  unsigned short recv_tail;           //! Buffers added to recv_ring
+  int recv_unavailable;               //! The kernel can't provide the buffers: the subscribers use readiness
+};
+
+/*! \brief Create the io_uring of a node
+ *
+ *  \return Returns 0 on success, -1 if io_uring is not available: cRosUringSelect() uses select()
+ */
+int cRosUringInit( CrosUring *ring );
+
+/*! \brief Release the io_uring of a node (if any) */
+void cRosUringRelease( CrosUring *ring );
+
+/*! \brief Wait for the events of a set of sockets, as select()
+ *
+ *  \param nfds The highest file descriptor of the sets, plus 1
+ *  \param r_fds, w_fds The sockets to be checked for reading and writing: they return the ones
+ *                      that are ready
+ *  \param err_fds The sockets to be checked for exceptional conditions: it returns empty
+ *  \param timeout_ms The max waiting time (in msec)
+ *
+ *  \return Returns the number of ready sockets (0 on timeout), -1 on failure (errno is set)
+ */
+int cRosUringSelect( CrosUring *ring, int nfds, fd_set *r_fds, fd_set *w_fds, fd_set *err_fds,
+                     uint64_t timeout_ms );
+
+/*! \brief Receive from a stream socket with a completion
+ *
+ *  The first call queues a receive, submitted by the next cRosUringSelect(), that reports the
+ *  socket ready for reading when it completes; then every call returns its result and queues the
+ *  next receive
+ *
+ *  \param fd The socket
+ *  \param data Returns the received bytes: they are valid until the next cRosUringSelect()
+ *
+ *  \return Returns the number of bytes received (0 if the peer closed the connection), or -1 with
+ *          errno set to EAGAIN if the receive hasn't completed yet, ENOTSUP if the socket can't
+ *          receive with completions (it must be read when ready), or the error of the receive
+ */
+ssize_t cRosUringRecv( CrosUring *ring, int fd, const unsigned char **data );
+
+/*! \brief Send to a stream socket with a completion, as writev()
+ *
+ *  The data (up to CROS_URING_SEND_SIZE bytes) is copied and sent by the next cRosUringSelect(),
+ *  that reports the socket ready for writing when the whole copy has been sent
+ *
+ *  \param fd The socket
+ *  \param iov, iovcnt The data to send
+ *
+ *  \return Returns the number of bytes taken, or -1 with errno set to EAGAIN if the previous data
+ *          is still being sent, ENOTSUP if the socket can't send with completions (it must be
+ *          written when ready), or the error of the previous send
+ */
+ssize_t cRosUringSend( CrosUring *ring, int fd, const struct iovec *iov, int iovcnt );
+
+/*! \brief Tell the io_uring of every node that a descriptor that may be polled is being closed
+ *
+ *  \param fd The descriptor
+ */
+void cRosUringNotifyClose( int fd );
+
+/*! @}*/
+
+#else
+
+#define cRosUringNotifyClose( fd )
+
+#endif // CROS_USE_IO_URING
+
+#endif // _CROS_URING_H_
@@ -154,6 +154,39 @@ int dynBufferPushBackFloat64( DynBuffer *d_buf, double val );
  */
 void dynBufferClear( DynBuffer *d_buf );
 
+/*! \brief Make room for at least n bytes at the end of the dynamic buffer, to be filled
+ *         in place (e.g., by a recv()) and then appended with dynBufferCommit()
+ *
+ *  \param d_buf Pointer to a DynBuffer object
+ *  \param n Number of bytes to be reserved
+ *
+ *  \return A pointer to the first free byte, or NULL on failure
+ */
+unsigned char *dynBufferReserve( DynBuffer *d_buf, size_t n );
+
+/*! \brief Append n bytes already written in the space returned by dynBufferReserve()
+ *
+ *  \param d_buf Pointer to a DynBuffer object
+ *  \param n Number of bytes to be appended
+ */
+void dynBufferCommit( DynBuffer *d_buf, size_t n );
+
+/*! \brief Discard the bytes before the position indicator, moving the remaining
+ *         ones to the beginning of the buffer (the internal memory IS NOT released)
+ *
+ *  \param d_buf Pointer to a DynBuffer object
+ */
+void dynBufferCompact( DynBuffer *d_buf );
+
+/*! \brief Initialize a read-only dynamic buffer over size bytes of external memory.
+ *         The view must not be modified or released, and it is valid as long as data is
+ *
+ *  \param d_buf Pointer to a DynBuffer object to be initialized
+ *  \param data Pointer to the viewed memory
+ *  \param size Number of the viewed bytes
+ */
+void dynBufferInitView( DynBuffer *d_buf, const unsigned char *data, size_t size );
+
 /*! \brief Get the current dynamic buffer size
  * 
  *  \param d_buf Pointer to a DynBuffer object
@@ -2,6 +2,7 @@
 #define _TCPIP_SOCKET_H_
 
 # include <arpa/inet.h>
+# include <sys/uio.h>
 
 #include "dyn_string.h"
 #include "dyn_buffer.h"
@@ -28,6 +29,7 @@ typedef struct TcpIpSocket TcpIpSocket;
 struct TcpIpSocket
 {
   int fd; 
+  int family;                   //! AF_INET (TCP/IP4) or AF_UNIX (local stream socket)
   unsigned short port;
   struct sockaddr_in adr;
   unsigned char open, connected, 
@@ -48,6 +50,15 @@ void tcpIpSocketInit( TcpIpSocket *s );
  */
 int tcpIpSocketOpen( TcpIpSocket *s );
 
+/*! \brief Open a Unix domain stream socket, that can be used in place of a TCP/IP4 socket
+ *         between processes of the same host
+ *
+ *  \param s Pointer to a TcpIpSocket object
+ *
+ *  \return Returns 1 on success, 0 on failure
+ */
+int tcpIpSocketOpenUnix( TcpIpSocket *s );
+
 /*! \brief Close a socket
  * 
  *  \param s Pointer to a TcpIpSocket object
@@ -93,6 +104,17 @@ int tcpIpSocketSetKeepAlive( TcpIpSocket *s, unsigned int idle, unsigned int int
  */
 TcpIpSocketState tcpIpSocketConnect( TcpIpSocket *s, const char *host, unsigned short port );
 
+/*! \brief Connect a Unix domain socket to a server
+ *
+ *  \param s Pointer to a TcpIpSocket object opened with tcpIpSocketOpenUnix()
+ *  \param path The path of the server socket
+
+ *  \return Returns TCPIPSOCKET_DONE on success,
+ *          TCPIPSOCKET_IN_PROGRESS if the connection is not yet completed,
+ *          or TCPIPSOCKET_FAILED on failure
+ */
+TcpIpSocketState tcpIpSocketConnectUnix( TcpIpSocket *s, const char *path );
+
 /*! \brief Bind and listen for TCP/IP4  socket connections
  * 
  *  \param s Pointer to a TcpIpSocket object
@@ -104,6 +126,17 @@ TcpIpSocketState tcpIpSocketConnect( TcpIpSocket *s, const char *host, unsigned
  */
 int tcpIpSocketBindListen( TcpIpSocket *s, const char *host, unsigned short port, int backlog );
 
+/*! \brief Bind and listen for Unix domain socket connections. A stale socket file
+ *         with the same path is removed
+ *
+ *  \param s Pointer to a TcpIpSocket object opened with tcpIpSocketOpenUnix()
+ *  \param path The path to be bound to the socket
+ *  \param backlog the maximum length of the listen queue
+ *
+ *  \return Returns 1 on success, 0 on failure
+ */
+int tcpIpSocketBindListenUnix( TcpIpSocket *s, const char *path, int backlog );
+
 /*! \brief Accept a new connection on a TCP/IP4  socket
  * 
  *  \param s Pointer to a TcpIpSocket object used to accept new connection 
@@ -137,6 +170,21 @@ int tcpIpSocketDisconnect( TcpIpSocket *s );
  */
 TcpIpSocketState tcpIpSocketWriteBuffer( TcpIpSocket *s, DynBuffer *d_buf );
 
+/*! \brief Send several memory areas on a connected socket, with a single writev()
+ *
+ *  \param s Pointer to a TcpIpSocket object
+ *  \param iov The areas to be written, in order
+ *  \param iovcnt The number of areas
+ *  \param n_written Returns the number of bytes written, that can be less than the areas size
+ *
+ *  \return Returns TCPIPSOCKET_DONE if some bytes have been written,
+ *          TCPIPSOCKET_IN_PROGRESS (only if the socket is non-blocking)
+ *          if the write operation would block,
+ *          TCPIPSOCKET_DISCONNECTED if the socket has been disconnectd,
+ *          or TCPIPSOCKET_FAILED on failure
+ */
+TcpIpSocketState tcpIpSocketWriteIov( TcpIpSocket *s, const struct iovec *iov, int iovcnt, size_t *n_written );
+
 /*! \brief Send a string on a connected socket
  * 
  *  \param s Pointer to a TcpIpSocket object
@@ -34,11 +34,7 @@ struct TcprosProcess
 {
   TcprosProcessState state;             //! The state
   TcpIpSocket socket;                   //! The socket used for the TCPROS communication
-  DynString topic;                      //! The name of the topic
-  DynString service;                    //! The name of the service
-  DynString type;                       //! The message/service type
-  DynString md5sum;                     //! The md5sum of the message type
-  DynString caller_id;                  //! The name of subscriber
+  DynString caller_id;                  //! The name of the remote node, from the connection header
   unsigned char latching;               //! If 1, the publisher is sending latched messages
   unsigned char tcp_nodelay;            //! If 1, the publisher should set TCP_NODELAY on the socket, if possible.
   unsigned char persistent;             //! If 1, the service connection should be kept open for multiple requests
@@ -50,6 +46,22 @@ struct TcprosProcess
   																			//! a service client
   size_t left_to_recv;                  //! Remaining to recevice
   int probe;														//! The current session is a probing one.
+  int call_id;                          //! Id of the service request waiting for a deferred response, -1 if none
+  int connection_id;                    //! Id of the connection reported by getBusInfo/getBusStats, -1 if none
+  uint64_t connect_time;                //! Connection establishment time (in msec, since the Epoch)
+  uint64_t last_activity_time;          //! Last time a message has been sent or received (in msec, since the Epoch)
+  size_t bytes_sent;                    //! Bytes of the messages sent on the connection
+  size_t bytes_received;                //! Bytes of the messages received on the connection
+  size_t msgs_sent;                     //! Number of messages sent on the connection
+  size_t msgs_received;                 //! Number of messages received on the connection
+  size_t drops;                         //! Number of messages not sent because the connection was still busy,
+                                        //! or dropped by the queue of the subscriber
+  DynBuffer send_queue;                 //! Packets ([size][data]) published while the connection was writing
+  int n_send_queued;
+  uint64_t busy_since;                  //! Time since the connection has packets to write (in msec), 0 if idle
+  int lagging;                          //! The connection has been busy longer than the lag limit of its publisher
+  uint64_t write_after_us;              //! The connection doesn't write before this time (in usec), to aggregate
+                                        //! the packets published meanwhile
 };
 
 
@@ -73,6 +85,13 @@ void tcprosProcessRelease( TcprosProcess *p );
  */
 void tcprosProcessClear( TcprosProcess *p , int fullreset );
 
+/*! \brief Reset the traffic counters of an TcprosProcess object whose connection has been just established
+ *
+ *  \param s Pointer to TcprosProcess object
+ *  \param connection_id The id of the new connection
+ */
+void tcprosProcessStartConnection( TcprosProcess *p, int connection_id );
+
 /*! \brief Change the internal state of an TcprosProcess object, and update its timer
  * 
  *  \param s Pointer to TcprosProcess object
@@ -19,7 +19,7 @@ typedef enum
   XMLRPC_PARAM_STRING,
   XMLRPC_PARAM_ARRAY,
   XMLRPC_PARAM_DATETIME, /* WARNING: Currently unsupported */
-  XMLRPC_PARAM_BINARY, /* WARNING: Currently unsupported */
+  XMLRPC_PARAM_BINARY, //! base64
   XMLRPC_PARAM_STRUCT
 }XmlrpcParamType;
  
@@ -41,8 +41,9 @@ struct XmlrpcParam
     char *as_string;
     XmlrpcParam *as_array;
     void* as_time; /* WARNING: Currently unsupported */
-    void* as_binary; /* WARNING: Currently unsupported */
+    unsigned char *as_binary;
   } data; //! Param data
+  int binary_size; //! Used only if type is XMLRPC_PARAM_BINARY: it stores the data size
   int array_n_elem; //! Used only if type is XMLRPC_PARAM_ARRAY: it stores the array size
   int array_max_elem; //! Used only if type is XMLRPC_PARAM_ARRAY: it stores the current max size
 };
@@ -88,6 +89,17 @@ double xmlrpcParamGetDouble( XmlrpcParam *param );
  */
 char *xmlrpcParamGetString( XmlrpcParam *param );
 
+/*! \brief Return an XMLRPC parameter as binary data.
+ *         No type control are performed. If the XMLRPC parameter
+ *         is not binary, return value is undefined
+ *
+ *  \param param Pointer to a XMLRPC parameter
+ *  \param size Output: the data size
+ *
+ *  \return Pointer to the data, passed as a pointer to the internal memory
+ */
+unsigned char *xmlrpcParamGetBinary( XmlrpcParam *param, int *size );
+
 /*! \brief Setup a XMLRPC unknown parameter (e.g., in case of errors)
  * 
  *  \param param Pointer to a XMLRPC parameter
@@ -131,6 +143,15 @@ void xmlrpcParamSetString( XmlrpcParam *param, const char *val );
  */
 void xmlrpcParamSetStringN( XmlrpcParam *param, const char *val, int n );
 
+/*! \brief Setup a XMLRPC binary parameter (serialized as base64) with the given data.
+ *         The data is copied inside a dynamically allocated memory
+ *
+ *  \param param Pointer to a XMLRPC parameter
+ *  \param val Pointer to the data
+ *  \param n The data size
+ */
+void xmlrpcParamSetBinary( XmlrpcParam *param, const void *val, int n );
+
 /*! \brief Setup an empty array XMLRPC parameter, starting to allocate internal memory  
  * 
  *  \param param Pointer to a XMLRPC parameter
@@ -205,6 +226,14 @@ XmlrpcParam * xmlrpcParamArrayPushBackString( XmlrpcParam *param, const char *va
  */
 XmlrpcParam * xmlrpcParamArrayPushBackStringN( XmlrpcParam *param, const char *val, int n );
 
+/*! \brief Append to an array XMLRPC parameter a binary parameter
+ *
+ *  \param param Pointer to an array XMLRPC parameter
+ *  \param val Pointer to the data
+ *  \param n The data size
+ */
+XmlrpcParam * xmlrpcParamArrayPushBackBinary( XmlrpcParam *param, const void *val, int n );
+
 /*! \brief Append to an array XMLRPC parameter an empty array parameter
  * 
  *  \param param Pointer to an array XMLRPC parameter
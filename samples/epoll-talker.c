@@ -0,0 +1,137 @@
+#include <cros.h>
+#include <cros_clock.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+// The talker sample, driven by the epoll loop of the application instead of cRosNodeStart():
+// the loop also reads the standard input, and exits when a line starting with 'q' is entered
+
+CrosNode *node;
+
+static CallbackResponse callback_pub(cRosMessage *message, void* data_context)
+{
+  static int count = 0;
+  char buf[1024];
+  cRosMessageField *data_field = cRosMessageGetField(message, "data");
+  if(data_field)
+  {
+    snprintf(buf, sizeof(buf), "hello world %d", count);
+    if(cRosMessageSetFieldValueString(data_field, buf) == 0)
+    {
+      ROS_INFO(node, "%s", buf);
+    }
+  }
+  ++count;
+  return 0;
+}
+
+static int toEpollEvents(int events)
+{
+  return ((events & CN_EVENT_READ) ? EPOLLIN : 0) | ((events & CN_EVENT_WRITE) ? EPOLLOUT : 0);
+}
+
+// The fds of the node change at every cycle: register the new ones, update or remove the others
+static void updateEpollSet(int epfd, CrosNodeFd *registered, int *n_registered, CrosNodeFd *fds, int n_fds)
+{
+  int i, j;
+  for(i = 0; i < *n_registered; i++)
+  {
+    for(j = 0; j < n_fds && fds[j].fd != registered[i].fd; j++);
+    if(j == n_fds)
+      epoll_ctl(epfd, EPOLL_CTL_DEL, registered[i].fd, NULL);
+  }
+
+  for(j = 0; j < n_fds; j++)
+  {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = toEpollEvents(fds[j].events);
+    ev.data.fd = fds[j].fd;
+    for(i = 0; i < *n_registered && registered[i].fd != fds[j].fd; i++);
+    if(i == *n_registered)
+    {
+      // A closed fd leaves the epoll set by itself, its number can be reused
+      if(epoll_ctl(epfd, EPOLL_CTL_ADD, fds[j].fd, &ev) == -1)
+        epoll_ctl(epfd, EPOLL_CTL_MOD, fds[j].fd, &ev);
+    }
+    else if(registered[i].events != fds[j].events)
+    {
+      if(epoll_ctl(epfd, EPOLL_CTL_MOD, fds[j].fd, &ev) == -1)
+        epoll_ctl(epfd, EPOLL_CTL_ADD, fds[j].fd, &ev);
+    }
+  }
+
+  memcpy(registered, fds, n_fds * sizeof(CrosNodeFd));
+  *n_registered = n_fds;
+}
+
+int main(int argc, char **argv)
+{
+  char path[1024];
+  getcwd(path, sizeof(path));
+  strncat(path, "/rosdb", sizeof(path) - strlen(path) - 1);
+  node = cRosNodeCreate("/epoll_talker", "127.0.0.1", "127.0.0.1", 11311, path, NULL);
+  if(cRosApiRegisterPublisher(node, "/chatter","std_msgs/String", 100,
+                                callback_pub, NULL, NULL) < 0)
+  {
+    printf("cRosApiRegisterPublisher failed; did you run this program one directory above 'rosdb'?\n");
+    return EXIT_FAILURE;
+  }
+
+  int epfd = epoll_create1(0);
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = STDIN_FILENO;
+  epoll_ctl(epfd, EPOLL_CTL_ADD, STDIN_FILENO, &ev);
+
+  static CrosNodeFd fds[FD_SETSIZE], registered[FD_SETSIZE];
+  int n_registered = 0;
+  unsigned char exit = 0;
+  while(!exit)
+  {
+    uint64_t deadline_ms;
+    int n_fds = cRosNodeGetEvents(node, fds, FD_SETSIZE, &deadline_ms);
+    if(n_fds < 0)
+      break;
+    updateEpollSet(epfd, registered, &n_registered, fds, n_fds);
+
+    uint64_t cur_time = cRosClockGetTimeMs();
+    int timeout = -1;
+    if(deadline_ms != UINT64_MAX)
+      timeout = (deadline_ms > cur_time) ? (int)(deadline_ms - cur_time) : 0;
+
+    struct epoll_event events[64];
+    int i, n_events = epoll_wait(epfd, events, 64, timeout), node_events = 0;
+    for(i = 0; i < n_events; i++)
+    {
+      if(events[i].data.fd == STDIN_FILENO)
+      {
+        char line[256];
+        if(fgets(line, sizeof(line), stdin) == NULL || line[0] == 'q')
+          exit = 1;
+        continue;
+      }
+
+      // Errors and hang-ups are reported as both events, as select() does
+      int cros_events = 0;
+      if(events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+        cros_events |= CN_EVENT_READ;
+      if(events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+        cros_events |= CN_EVENT_WRITE;
+      cRosNodeProcessEvents(node, events[i].data.fd, cros_events);
+      node_events++;
+    }
+
+    if(node_events == 0)
+      cRosNodeProcessEvents(node, -1, 0);
+  }
+
+  close(epfd);
+  cRosNodeDestroy( node );
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,26 @@
+#include <cros.h>
+#include <cros_gentools.h>
+
+#include <stdio.h>
+
+// Generates the typed C headers of the given .msg/.srv files (and of their dependencies)
+int main(int argc, char **argv)
+{
+  if(argc < 3)
+  {
+    printf("Usage: %s <output directory> <message/service file>...\n", argv[0]);
+    return 1;
+  }
+
+  int i;
+  for(i = 2; i < argc; i++)
+  {
+    if(cRosGentoolsGenerateC(argv[i], argv[1]) != 0)
+    {
+      printf("Can't generate the header of %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  return 0;
+}
@@ -10,7 +10,11 @@ CrosNode *node;
 // This callback will be invoked when we receive a message
 static CallbackResponse callback_sub(cRosMessage *message, void* data_context)
 {
-  cRosMessageField *data_field = cRosMessageGetField(message, "data");
+  // The field index is the same for every message of the topic, resolve it only once
+  static int data_idx = -1;
+  if(data_idx == -1)
+    data_idx = cRosMessageGetFieldIndex(message, "data");
+  cRosMessageField *data_field = cRosMessageGetFieldAt(message, data_idx);
   if(data_field)
   {
     ROS_INFO(node, "I heard: [%s]", data_field->data.as_string);
@@ -0,0 +1,65 @@
+#include <cros.h>
+#include <cros_bag.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+
+// Play a rosbag v2 file (with uncompressed chunks) without decoding its messages:
+//
+//   player in.bag [rate]
+//
+// The rate is the speed factor, 0 to publish the messages as fast as the subscribers read them
+
+static unsigned char exit_flag = 0;
+
+static void exitHandler(int sig)
+{
+  exit_flag = 1;
+}
+
+int main(int argc, char **argv)
+{
+  if(argc < 2)
+  {
+    printf("Usage: %s <bag file> [rate]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  double rate = argc > 2 ? atof(argv[2]) : 1.0;
+
+  CrosBagPlayer player;
+  if(cRosBagPlayerOpen(&player, argv[1]) != 0)
+  {
+    printf("Can't play %s\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  // The bag carries the message definitions of its topics: the .msg files are needed only by /rosout
+  char path[1024];
+  getcwd(path, sizeof(path));
+  strncat(path, "/rosdb", sizeof(path) - strlen(path) - 1);
+  CrosNode *node = cRosNodeCreate("/player", "127.0.0.1", "127.0.0.1", 11311, path, NULL);
+  if(cRosBagPlayerStart(node, &player, rate) != 0)
+  {
+    printf("Can't publish the topics of %s\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  signal(SIGINT, exitHandler);
+  signal(SIGTERM, exitHandler);
+  // The publication cycles are scheduled at the time of the messages
+  while(!exit_flag && !cRosBagPlayerIsDone(&player))
+    cRosNodeDoEventsLoop( node );
+
+  // Let the subscribers receive the last messages
+  int i;
+  for(i = 0; i < 10 && !exit_flag; i++)
+    cRosNodeDoEventsLoop( node );
+
+  printf("Published %lu messages\n", (unsigned long)player.published);
+  cRosNodeDestroy( node );
+  cRosBagPlayerClose(&player);
+  return EXIT_SUCCESS;
+}
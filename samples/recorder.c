@@ -0,0 +1,67 @@
+#include <cros.h>
+#include <cros_bag.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+
+// Record topics in a rosbag v2 file without decoding their messages, until Ctrl-C:
+//
+//   recorder out.bag /chatter:std_msgs/String /pose:geometry_msgs/Pose ...
+
+static unsigned char exit_flag = 0;
+
+static void exitHandler(int sig)
+{
+  exit_flag = 1;
+}
+
+int main(int argc, char **argv)
+{
+  if(argc < 3)
+  {
+    printf("Usage: %s <bag file> <topic>:<type> [<topic>:<type> ...]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  // We need to tell our node where to find the .msg files of the recorded types
+  char path[1024];
+  getcwd(path, sizeof(path));
+  strncat(path, "/rosdb", sizeof(path) - strlen(path) - 1);
+  CrosNode *node = cRosNodeCreate("/recorder", "127.0.0.1", "127.0.0.1", 11311, path, NULL);
+
+  CrosBag bag;
+  if(cRosBagOpen(&bag, argv[1], 0) != 0)
+  {
+    printf("Can't create %s\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  int i;
+  for(i = 2; i < argc; i++)
+  {
+    char *type = strchr(argv[i], ':');
+    if(type == NULL)
+    {
+      printf("Missing type of %s\n", argv[i]);
+      return EXIT_FAILURE;
+    }
+    *type++ = '\0';
+    // The messages are appended to the bag as they arrive on the wire
+    if(cRosBagRecordTopic(node, &bag, argv[i], type) < 0)
+    {
+      printf("Can't record %s; did you run this program one directory above 'rosdb'?\n", argv[i]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  signal(SIGINT, exitHandler);
+  signal(SIGTERM, exitHandler);
+  cRosNodeStart( node, &exit_flag );
+
+  cRosNodeDestroy( node );
+  // Write the index and the pending messages
+  int rc = cRosBagClose(&bag);
+  return rc == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,214 @@
+/* Compare the loopback TCP/IP connections used by TCPROS with the Unix domain sockets
+ * used by UNIXROS between two processes of the same host. No roscore is needed:
+ *
+ *   socket-benchmark [round trips] [streamed megabytes]
+ *
+ * For every message size it reports the mean round trip time of a ping-pong and the
+ * throughput of a one way stream of messages */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+
+#include "tcpip_socket.h"
+#include "dyn_buffer.h"
+
+#define BENCHMARK_UNIX_PATH_FORMAT "/tmp/cros_benchmark_%d.sock"
+
+enum
+{
+  BENCHMARK_PING_PONG = 0,
+  BENCHMARK_STREAM = 1
+};
+
+static double getTimeSec(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int readExact(TcpIpSocket *s, DynBuffer *buf, size_t size)
+{
+  dynBufferClear(buf);
+  while (dynBufferGetSize(buf) < size)
+  {
+    size_t n_reads;
+    if (tcpIpSocketReadBufferEx(s, buf, size - dynBufferGetSize(buf), &n_reads) != TCPIPSOCKET_DONE)
+      return -1;
+  }
+
+  return 0;
+}
+
+static int writeAll(TcpIpSocket *s, DynBuffer *buf)
+{
+  dynBufferRewindPoseIndicator(buf);
+  return tcpIpSocketWriteBuffer(s, buf) == TCPIPSOCKET_DONE ? 0 : -1;
+}
+
+// Child process: serve the tests of the connections accepted by the listener
+static void runServer(TcpIpSocket *listener, int n_tests)
+{
+  DynBuffer buf;
+  dynBufferInit(&buf);
+
+  int i;
+  for (i = 0; i < n_tests; i++)
+  {
+    TcpIpSocket conn;
+    tcpIpSocketInit(&conn);
+    if (tcpIpSocketAccept(listener, &conn) != TCPIPSOCKET_DONE)
+      exit(EXIT_FAILURE);
+
+    uint32_t test[3];                   // Mode, message size, message count
+    if (readExact(&conn, &buf, sizeof(test)) != 0)
+      exit(EXIT_FAILURE);
+    memcpy(test, dynBufferGetData(&buf), sizeof(test));
+
+    uint32_t j;
+    for (j = 0; j < test[2]; j++)
+    {
+      if (readExact(&conn, &buf, test[1]) != 0)
+        exit(EXIT_FAILURE);
+      if (test[0] == BENCHMARK_PING_PONG && writeAll(&conn, &buf) != 0)
+        exit(EXIT_FAILURE);
+    }
+
+    if (test[0] == BENCHMARK_STREAM)
+    {
+      // Acknowledge the end of the stream
+      dynBufferClear(&buf);
+      dynBufferPushBackUInt32(&buf, test[2]);
+      writeAll(&conn, &buf);
+    }
+
+    tcpIpSocketClose(&conn);
+  }
+
+  dynBufferRelease(&buf);
+  exit(EXIT_SUCCESS);
+}
+
+static int connectClient(TcpIpSocket *s, int unix_socket, const char *path, unsigned short port)
+{
+  tcpIpSocketInit(s);
+  if (unix_socket)
+    return tcpIpSocketOpenUnix(s) && tcpIpSocketConnectUnix(s, path) == TCPIPSOCKET_DONE ? 0 : -1;
+
+  return tcpIpSocketOpen(s) && tcpIpSocketConnect(s, "127.0.0.1", port) == TCPIPSOCKET_DONE ? 0 : -1;
+}
+
+// Returns the elapsed seconds, a negative value on failure
+static double runClient(int unix_socket, const char *path, unsigned short port,
+                        uint32_t mode, uint32_t size, uint32_t count)
+{
+  TcpIpSocket s;
+  if (connectClient(&s, unix_socket, path, port) != 0)
+    return -1;
+
+  DynBuffer msg, reply;
+  dynBufferInit(&msg);
+  dynBufferInit(&reply);
+
+  uint32_t test[3] = { mode, size, count };
+  dynBufferPushBackBuf(&msg, (unsigned char *)test, sizeof(test));
+  double elapsed = -1;
+  if (writeAll(&s, &msg) != 0)
+    goto clean;
+
+  dynBufferClear(&msg);
+  uint32_t i;
+  for (i = 0; i < size; i++)
+    dynBufferPushBackUInt8(&msg, (uint8_t)i);
+
+  double start = getTimeSec();
+  for (i = 0; i < count; i++)
+  {
+    if (writeAll(&s, &msg) != 0)
+      goto clean;
+    if (mode == BENCHMARK_PING_PONG && readExact(&s, &reply, size) != 0)
+      goto clean;
+  }
+
+  if (mode == BENCHMARK_STREAM && readExact(&s, &reply, sizeof(uint32_t)) != 0)
+    goto clean;
+
+  elapsed = getTimeSec() - start;
+
+clean:
+  dynBufferRelease(&msg);
+  dynBufferRelease(&reply);
+  tcpIpSocketClose(&s);
+  return elapsed;
+}
+
+int main(int argc, char **argv)
+{
+  static const uint32_t sizes[] = { 64, 1024, 16384, 262144 };
+  const int n_sizes = sizeof(sizes) / sizeof(sizes[0]);
+  uint32_t round_trips = argc > 1 ? (uint32_t)atoi(argv[1]) : 20000;
+  uint32_t stream_mb = argc > 2 ? (uint32_t)atoi(argv[2]) : 256;
+
+  char path[108];
+  snprintf(path, sizeof(path), BENCHMARK_UNIX_PATH_FORMAT, (int)getpid());
+
+  printf("%-8s %10s %14s %14s\n", "socket", "msg size", "rtt (usec)", "stream (MB/s)");
+
+  int unix_socket;
+  for (unix_socket = 0; unix_socket <= 1; unix_socket++)
+  {
+    TcpIpSocket listener;
+    tcpIpSocketInit(&listener);
+    int ok = unix_socket ?
+             tcpIpSocketOpenUnix(&listener) && tcpIpSocketBindListenUnix(&listener, path, 1) :
+             tcpIpSocketOpen(&listener) && tcpIpSocketSetReuse(&listener) &&
+             tcpIpSocketBindListen(&listener, "127.0.0.1", 0, 1);
+    if (!ok)
+    {
+      printf("Can't open the listener socket\n");
+      return EXIT_FAILURE;
+    }
+
+    unsigned short port = tcpIpSocketGetPort(&listener);
+    fflush(stdout);
+    pid_t server = fork();
+    if (server == 0)
+      runServer(&listener, 2 * n_sizes);
+
+    int i;
+    for (i = 0; i < n_sizes; i++)
+    {
+      // Fewer round trips for the large messages, to keep the same order of magnitude of duration
+      uint32_t n_round_trips = round_trips / (1 + sizes[i] / 4096);
+      if (n_round_trips == 0)
+        n_round_trips = 1;
+      uint32_t n_stream = (uint32_t)(((uint64_t)stream_mb * 1024 * 1024) / sizes[i]);
+
+      double rtt = runClient(unix_socket, path, port, BENCHMARK_PING_PONG, sizes[i], n_round_trips);
+      double stream = runClient(unix_socket, path, port, BENCHMARK_STREAM, sizes[i], n_stream);
+      if (rtt < 0 || stream < 0)
+      {
+        printf("Test failed\n");
+        kill(server, SIGKILL);
+        return EXIT_FAILURE;
+      }
+
+      printf("%-8s %10u %14.2f %14.1f\n", unix_socket ? "unix" : "tcp", sizes[i],
+             rtt * 1e6 / n_round_trips, (double)n_stream * sizes[i] / (1024 * 1024) / stream);
+    }
+
+    waitpid(server, NULL, 0);
+    tcpIpSocketClose(&listener);
+    if (unix_socket)
+      unlink(path);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -12,8 +12,12 @@ static CallbackResponse callback_pub(cRosMessage *message, void* data_context)
 {
   static int count = 0;
   char buf[1024];
-  // We need to index into the message structure and then assign to fields
-  cRosMessageField *data_field = cRosMessageGetField(message, "data");
+  // We need to index into the message structure and then assign to fields.
+  // The field index is the same for every message of the topic, resolve it only once
+  static int data_idx = -1;
+  if(data_idx == -1)
+    data_idx = cRosMessageGetFieldIndex(message, "data");
+  cRosMessageField *data_field = cRosMessageGetFieldAt(message, data_idx);
   if(data_field)
   {
     snprintf(buf, sizeof(buf), "hello world %d", count);
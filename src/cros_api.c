@@ -55,7 +55,8 @@ typedef enum ProviderType
 {
   CROS_SUBSCRIBER,
   CROS_PUBLISHER,
-  CROS_SERVICE_PROVIDER
+  CROS_SERVICE_PROVIDER,
+  CROS_SERVICE_CALLER
 } ProviderType;
 
 typedef struct ProviderContext
@@ -69,12 +70,44 @@ typedef struct ProviderContext
   void *api_callback;
   void *context;
   int unregistering;
+  CrosArena *arena;               //! Storage of the incoming messages of a subscriber, NULL to use the heap
+  const CrosMessageCodec *incoming_codec; //! Codec of typed_incoming, NULL for the cRosMessage based providers
+  const CrosMessageCodec *outgoing_codec; //! Codec of typed_outgoing, NULL for the cRosMessage based providers
+  void *typed_incoming;
+  void *typed_outgoing;
 } ProviderContext;
 
+static void * newTypedMessage(const CrosMessageCodec *codec)
+{
+  void *msg = malloc(codec->msg_size);
+  if (msg != NULL)
+    codec->init(msg);
+
+  return msg;
+}
+
+static void freeTypedMessage(const CrosMessageCodec *codec, void *msg)
+{
+  if (msg == NULL)
+    return;
+
+  codec->release(msg);
+  free(msg);
+}
+
 static void freeProviderContext(ProviderContext *context)
 {
   cRosMessageFree(context->incoming);
   cRosMessageFree(context->outgoing);
+  if (context->incoming_codec != NULL)
+    freeTypedMessage(context->incoming_codec, context->typed_incoming);
+  if (context->outgoing_codec != NULL)
+    freeTypedMessage(context->outgoing_codec, context->typed_outgoing);
+  if (context->arena != NULL)
+  {
+    cRosArenaRelease(context->arena);
+    free(context->arena);
+  }
   free(context->md5sum);
   free(context);
 }
@@ -136,6 +169,22 @@ static ProviderContext * newProviderContext(const char *provider_path, ProviderT
 
       break;
     }
+    case CROS_SERVICE_CALLER:
+    {
+      context->incoming = cRosMessageNew();
+      if (context->incoming == NULL)
+        goto clean;
+      context->outgoing = cRosMessageNew();
+      if (context->outgoing == NULL)
+        goto clean;
+
+      // The caller sends the request and receives the response
+      rc = cRosServiceBuildInner(context->outgoing, context->incoming, context->md5sum, provider_path);
+      if (rc != 0)
+        goto clean;
+
+      break;
+    }
     default:
       assert(0);
   }
@@ -147,6 +196,45 @@ clean:
   return NULL;
 }
 
+// Context of the providers of generated message types: no message file is parsed at runtime
+static ProviderContext * newTypedProviderContext(ProviderType type, const char *md5sum,
+                                                 const CrosMessageCodec *incoming_codec,
+                                                 const CrosMessageCodec *outgoing_codec)
+{
+  ProviderContext *context = (ProviderContext *)calloc(1, sizeof(ProviderContext));
+  if (context == NULL)
+    return NULL;
+
+  context->type = type;
+  context->md5sum = (char*) calloc(1, 33);// 32 chars + '\0';
+  if (context->md5sum == NULL)
+    goto clean;
+  strncpy(context->md5sum, md5sum, 32);
+
+  if (incoming_codec != NULL)
+  {
+    context->incoming_codec = incoming_codec;
+    context->typed_incoming = newTypedMessage(incoming_codec);
+    if (context->typed_incoming == NULL)
+      goto clean;
+  }
+
+  if (outgoing_codec != NULL)
+  {
+    context->outgoing_codec = outgoing_codec;
+    context->typed_outgoing = newTypedMessage(outgoing_codec);
+    if (context->typed_outgoing == NULL)
+      goto clean;
+  }
+
+  return context;
+
+clean:
+  PRINT_ERROR("newTypedProviderContext() : Can't allocate memory\n");
+  freeProviderContext(context);
+  return NULL;
+}
+
 static CallbackResponse cRosNodePublisherCallback(DynBuffer *buffer, void* context_)
 {
   ProviderContext *context = (ProviderContext *)context_;
@@ -163,13 +251,29 @@ static CallbackResponse cRosNodePublisherCallback(DynBuffer *buffer, void* conte
 static CallbackResponse cRosNodeSubscriberCallback(DynBuffer *buffer, void* context_)
 {
   ProviderContext *context = (ProviderContext *)context_;
-  cRosMessageDeserialize(context->incoming, buffer);
+  if (context->arena != NULL)
+  {
+    // The previous message is no more referenced: recycle its storage
+    cRosArenaReset(context->arena);
+    cRosMessageDeserializeArena(context->incoming, buffer, context->arena);
+  }
+  else
+  {
+    cRosMessageDeserialize(context->incoming, buffer);
+  }
 
   // Cast to the appropriate public api callback and invoke it on the user context
   SubscriberApiCallback subscriberApiCallback = (SubscriberApiCallback)context->api_callback;
   return subscriberApiCallback(context->incoming, context->context);
 }
 
+static CallbackResponse cRosNodeRawSubscriberCallback(DynBuffer *buffer, void* context_)
+{
+  ProviderContext *context = (ProviderContext *)context_;
+  RawSubscriberApiCallback rawSubscriberApiCallback = (RawSubscriberApiCallback)context->api_callback;
+  return rawSubscriberApiCallback(buffer, context->context);
+}
+
 static CallbackResponse cRosNodeServiceProviderCallback(DynBuffer *request, DynBuffer *response, void* contex_)
 {
   ProviderContext *context = (ProviderContext *)contex_;
@@ -178,7 +282,68 @@ static CallbackResponse cRosNodeServiceProviderCallback(DynBuffer *request, DynB
   ServiceProviderApiCallback serviceProviderApiCallback = (ServiceProviderApiCallback)context->api_callback;
   CallbackResponse rc = serviceProviderApiCallback(context->incoming, context->outgoing, context->context);
 
-  cRosMessageSerialize(context->outgoing, response);
+  // A deferred response is serialized by cRosApiSendServiceResponse()
+  if (rc != CN_SERVICE_RESPONSE_DEFERRED)
+    cRosMessageSerialize(context->outgoing, response);
+
+  return rc;
+}
+
+static void cRosNodeServiceCallerCallback(int callid, DynBuffer *response, void* context_)
+{
+  ProviderContext *context = (ProviderContext *)context_;
+
+  ServiceCallerApiCallback serviceCallerApiCallback = (ServiceCallerApiCallback)context->api_callback;
+  if (response == NULL)
+  {
+    serviceCallerApiCallback(callid, NULL, context->context);
+    return;
+  }
+
+  cRosMessageDeserialize(context->incoming, response);
+  serviceCallerApiCallback(callid, context->incoming, context->context);
+}
+
+static CallbackResponse cRosNodeTypedPublisherCallback(DynBuffer *buffer, void* context_)
+{
+  ProviderContext *context = (ProviderContext *)context_;
+
+  TypedPublisherApiCallback publisherApiCallback = (TypedPublisherApiCallback)context->api_callback;
+  CallbackResponse rc = publisherApiCallback(context->typed_outgoing, context->context);
+
+  context->outgoing_codec->serialize(context->typed_outgoing, buffer);
+
+  return rc;
+}
+
+static CallbackResponse cRosNodeTypedSubscriberCallback(DynBuffer *buffer, void* context_)
+{
+  ProviderContext *context = (ProviderContext *)context_;
+  if (context->incoming_codec->deserialize(context->typed_incoming, buffer) == -1)
+  {
+    PRINT_ERROR("cRosNodeTypedSubscriberCallback() : Malformed %s message\n", context->incoming_codec->type);
+    return 0;
+  }
+
+  TypedSubscriberApiCallback subscriberApiCallback = (TypedSubscriberApiCallback)context->api_callback;
+  return subscriberApiCallback(context->typed_incoming, context->context);
+}
+
+static CallbackResponse cRosNodeTypedServiceProviderCallback(DynBuffer *request, DynBuffer *response, void* context_)
+{
+  ProviderContext *context = (ProviderContext *)context_;
+  if (context->incoming_codec->deserialize(context->typed_incoming, request) == -1)
+  {
+    PRINT_ERROR("cRosNodeTypedServiceProviderCallback() : Malformed %s request\n", context->incoming_codec->type);
+    return 0;
+  }
+
+  TypedServiceProviderApiCallback serviceProviderApiCallback = (TypedServiceProviderApiCallback)context->api_callback;
+  CallbackResponse rc = serviceProviderApiCallback(context->typed_incoming, context->typed_outgoing, context->context);
+
+  // A deferred response is serialized by cRosApiSendTypedServiceResponse()
+  if (rc != CN_SERVICE_RESPONSE_DEFERRED)
+    context->outgoing_codec->serialize(context->typed_outgoing, response);
 
   return rc;
 }
@@ -222,6 +387,101 @@ int cRosApisUnegisterServiceProvider(CrosNode *node, int svcidx)
   return rc;
 }
 
+int cRosApiRegisterServiceCaller(CrosNode *node, const char *service_name, const char *service_type, int persistent,
+                                 ServiceCallerApiCallback callback, NodeStatusCallback status_callback, void *context)
+{
+  char path[256];
+  getSrvFilePath(node, path, 256, service_type);
+  ProviderContext *nodeContext = newProviderContext(path, CROS_SERVICE_CALLER);
+  if (nodeContext == NULL)
+    return -1;
+
+  nodeContext->api_callback = callback;
+  nodeContext->status_callback = status_callback;
+  nodeContext->context = context;
+
+  // NB: Pass the private ProviderContext to the private api, not the user context
+  int rc = cRosNodeRegisterServiceCaller(node, service_name, service_type, nodeContext->md5sum, persistent,
+                                         cRosNodeServiceCallerCallback,
+                                         status_callback == NULL ? NULL : cRosNodeStatusCallback, nodeContext);
+  if (rc == -1)
+    freeProviderContext(nodeContext);
+
+  return rc;
+}
+
+int cRosApiUnregisterServiceCaller(CrosNode *node, int svccalleridx)
+{
+  if (svccalleridx < 0 || svccalleridx >= CN_MAX_SERVICE_CALLERS)
+    return -1;
+
+  ServiceCallerNode *caller = &node->service_callers[svccalleridx];
+  ProviderContext *context = (ProviderContext *)caller->context;
+  int rc = cRosNodeUnregisterServiceCaller(node, svccalleridx);
+
+  // The unregistration is synchronous: the context is no more referenced
+  if (rc != -1)
+    freeProviderContext(context);
+
+  return rc;
+}
+
+cRosMessage * cRosApiGetServiceCallerRequest(CrosNode *node, int svccalleridx)
+{
+  if (svccalleridx < 0 || svccalleridx >= CN_MAX_SERVICE_CALLERS)
+    return NULL;
+
+  ServiceCallerNode *caller = &node->service_callers[svccalleridx];
+  if (caller->service_name == NULL)
+    return NULL;
+
+  ProviderContext *context = (ProviderContext *)caller->context;
+  return context->outgoing;
+}
+
+int cRosApiCallService(CrosNode *node, int svccalleridx)
+{
+  cRosMessage *request = cRosApiGetServiceCallerRequest(node, svccalleridx);
+  if (request == NULL)
+    return -1;
+
+  DynBuffer buffer;
+  dynBufferInit(&buffer);
+  cRosMessageSerialize(request, &buffer);
+
+  int rc = cRosNodeCallService(node, svccalleridx, &buffer);
+  dynBufferRelease(&buffer);
+
+  return rc;
+}
+
+int cRosApiGetServiceCallId(CrosNode *node)
+{
+  return node->service_call_id;
+}
+
+int cRosApiSendServiceResponse(CrosNode *node, int callid, cRosMessage *response)
+{
+  DynBuffer buffer;
+  dynBufferInit(&buffer);
+
+  int rc;
+  if (response != NULL)
+  {
+    cRosMessageSerialize(response, &buffer);
+    rc = cRosNodeSendServiceResponse(node, callid, &buffer, 1);
+  }
+  else
+  {
+    const char *error = "service failed";
+    dynBufferPushBackBuf(&buffer, (const unsigned char *)error, strlen(error));
+    rc = cRosNodeSendServiceResponse(node, callid, &buffer, 0);
+  }
+
+  dynBufferRelease(&buffer);
+  return rc;
+}
+
 int cRosApiRegisterSubscriber(CrosNode *node, const char *topic_name, const char *topic_type,
                               SubscriberApiCallback callback, NodeStatusCallback status_callback, void *context)
 {
@@ -253,6 +513,54 @@ int cRosApiUnregisterSubscriber(CrosNode *node, int subidx)
   return rc;
 }
 
+int cRosApiRegisterRawSubscriber(CrosNode *node, const char *topic_name, const char *topic_type,
+                                 RawSubscriberApiCallback callback, NodeStatusCallback status_callback, void *context)
+{
+  char path[256];
+  cRosGetMsgFilePath(node, path, 256, topic_type);
+  ProviderContext *nodeContext = newProviderContext(path, CROS_SUBSCRIBER);
+  if (nodeContext == NULL)
+    return -1;
+
+  nodeContext->api_callback = callback;
+  nodeContext->status_callback = status_callback;
+  nodeContext->context = context;
+
+  int rc = cRosNodeRegisterSubscriber(node, nodeContext->message_definition, topic_name, topic_type,
+                                      nodeContext->md5sum, cRosNodeRawSubscriberCallback,
+                                      status_callback == NULL ? NULL : cRosNodeStatusCallback, nodeContext);
+  if (rc == -1)
+    freeProviderContext(nodeContext);
+
+  return rc;
+}
+
+int cRosApiSetSubscriberArena(CrosNode *node, int subidx, int enable, size_t block_size)
+{
+  if (subidx < 0 || subidx >= CN_MAX_SUBSCRIBED_TOPICS || node->subs[subidx].context == NULL)
+    return -1;
+
+  ProviderContext *context = (ProviderContext *)node->subs[subidx].context;
+  if (context->arena != NULL)
+  {
+    // The incoming message may still point to the arena: the fields are moved to the heap
+    // by the next deserialization, which doesn't free the arena storage
+    cRosArenaRelease(context->arena);
+    free(context->arena);
+    context->arena = NULL;
+  }
+
+  if (!enable)
+    return 0;
+
+  context->arena = (CrosArena *)malloc(sizeof(CrosArena));
+  if (context->arena == NULL)
+    return -1;
+
+  cRosArenaInit(context->arena, block_size);
+  return 0;
+}
+
 int cRosApiRegisterPublisher(CrosNode *node, const char *topic_name, const char *topic_type, int loop_period,
                              PublisherApiCallback callback, NodeStatusCallback status_callback, void *context)
 {
@@ -284,12 +592,98 @@ int cRosApiUnregisterPublisher(CrosNode *node, int pubidx)
   return rc;
 }
 
-int cRosApicRosApiLookupNode(CrosNode *node, const char *node_name, LookupNodeCallback callback, void *context)
+int cRosApiRegisterTypedPublisher(CrosNode *node, const char *topic_name, const CrosMessageCodec *codec, int loop_period,
+                                  TypedPublisherApiCallback callback, NodeStatusCallback status_callback, void *context)
+{
+  ProviderContext *nodeContext = newTypedProviderContext(CROS_PUBLISHER, codec->md5sum, NULL, codec);
+  if (nodeContext == NULL)
+    return -1;
+
+  nodeContext->api_callback = callback;
+  nodeContext->status_callback = status_callback;
+  nodeContext->context = context;
+  nodeContext->message_definition = (char *)codec->definition;
+
+  int rc = cRosNodeRegisterPublisher(node, codec->definition, topic_name, codec->type, codec->md5sum,
+                                     loop_period, cRosNodeTypedPublisherCallback,
+                                     status_callback == NULL ? NULL : cRosNodeStatusCallback, nodeContext);
+  if (rc == -1)
+    freeProviderContext(nodeContext);
+
+  return rc;
+}
+
+int cRosApiRegisterTypedSubscriber(CrosNode *node, const char *topic_name, const CrosMessageCodec *codec,
+                                   TypedSubscriberApiCallback callback, NodeStatusCallback status_callback, void *context)
+{
+  ProviderContext *nodeContext = newTypedProviderContext(CROS_SUBSCRIBER, codec->md5sum, codec, NULL);
+  if (nodeContext == NULL)
+    return -1;
+
+  nodeContext->api_callback = callback;
+  nodeContext->status_callback = status_callback;
+  nodeContext->context = context;
+  nodeContext->message_definition = (char *)codec->definition;
+
+  int rc = cRosNodeRegisterSubscriber(node, codec->definition, topic_name, codec->type, codec->md5sum,
+                                      cRosNodeTypedSubscriberCallback,
+                                      status_callback == NULL ? NULL : cRosNodeStatusCallback, nodeContext);
+  if (rc == -1)
+    freeProviderContext(nodeContext);
+
+  return rc;
+}
+
+int cRosApiRegisterTypedServiceProvider(CrosNode *node, const char *service_name, const CrosServiceCodec *codec,
+                                        TypedServiceProviderApiCallback callback, NodeStatusCallback status_callback,
+                                        void *context)
+{
+  ProviderContext *nodeContext = newTypedProviderContext(CROS_SERVICE_PROVIDER, codec->md5sum,
+                                                         codec->request, codec->response);
+  if (nodeContext == NULL)
+    return -1;
+
+  nodeContext->api_callback = callback;
+  nodeContext->status_callback = status_callback;
+  nodeContext->context = context;
+
+  int rc = cRosNodeRegisterServiceProvider(node, service_name, codec->type, codec->md5sum,
+                                           cRosNodeTypedServiceProviderCallback,
+                                           status_callback == NULL ? NULL : cRosNodeStatusCallback, nodeContext);
+  if (rc == -1)
+    freeProviderContext(nodeContext);
+
+  return rc;
+}
+
+int cRosApiSendTypedServiceResponse(CrosNode *node, int callid, const CrosMessageCodec *codec, const void *response)
+{
+  DynBuffer buffer;
+  dynBufferInit(&buffer);
+
+  int rc;
+  if (response != NULL)
+  {
+    codec->serialize(response, &buffer);
+    rc = cRosNodeSendServiceResponse(node, callid, &buffer, 1);
+  }
+  else
+  {
+    const char *error = "service failed";
+    dynBufferPushBackBuf(&buffer, (const unsigned char *)error, strlen(error));
+    rc = cRosNodeSendServiceResponse(node, callid, &buffer, 0);
+  }
+
+  dynBufferRelease(&buffer);
+  return rc;
+}
+
+int cRosApiLookupNode(CrosNode *node, const char *node_name, LookupNodeCallback callback, void *context)
 {
   RosApiCall *call = newRosApiCall();
   if (call == NULL)
   {
-    PRINT_ERROR ( "cRosApicRosApiLookupNode() : Can't allocate memory\n");
+    PRINT_ERROR ( "cRosApiLookupNode() : Can't allocate memory\n");
     return -1;
   }
 
@@ -712,8 +1106,8 @@ LookupNodeResult * fetchLookupNodeResult(XmlrpcParamVector *response)
   strcpy(ret->status, status->data.as_string);
 
   XmlrpcParam* uri = xmlrpcParamArrayGetParamAt(array, 2);
-  ret->uri = (char *)malloc(strlen(status->data.as_string) + 1);
-  if (ret == NULL)
+  ret->uri = (char *)malloc(strlen(uri->data.as_string) + 1);
+  if (ret->uri == NULL)
     goto clean;
   strcpy(ret->uri, uri->data.as_string);
 
@@ -991,8 +1385,8 @@ LookupServiceResult * fetchLookupServiceResult(XmlrpcParamVector *response)
   strcpy(ret->status, status->data.as_string);
 
   XmlrpcParam* service = xmlrpcParamArrayGetParamAt(array, 2);
-  ret->service_result = (char *)malloc(strlen(status->data.as_string) + 1);
-  if (ret == NULL)
+  ret->service_result = (char *)malloc(strlen(service->data.as_string) + 1);
+  if (ret->service_result == NULL)
     goto clean;
   strcpy(ret->service_result, service->data.as_string);
 
@@ -1021,7 +1415,12 @@ GetBusStatsResult * fetchGetBusStatsResult(XmlrpcParamVector *response)
   if (array->array_n_elem < 3)
     return ret;
 
-  XmlrpcParam* pubs_stats = xmlrpcParamArrayGetParamAt(array, 2);
+  // stats: [publishStats, subscribeStats, serviceStats]
+  XmlrpcParam* stats = xmlrpcParamArrayGetParamAt(array, 2);
+  if (stats->array_n_elem < 1)
+    return ret;
+
+  XmlrpcParam* pubs_stats = xmlrpcParamArrayGetParamAt(stats, 0);
   ret->stats.pub_stats = (struct TopicPubStats *)calloc(pubs_stats->array_n_elem, sizeof(struct TopicPubStats));
   if (ret->stats.pub_stats == NULL)
     goto clean;
@@ -1062,14 +1461,14 @@ GetBusStatsResult * fetchGetBusStatsResult(XmlrpcParamVector *response)
       pub_data->connection_id = connection_id->data.as_int;
       pub_data->bytes_sent = (size_t)bytes_sent->data.as_int;
       pub_data->num_sent = (size_t)num_sent->data.as_int;
-      pub_data->connected = connected->data.as_int;
+      pub_data->connected = connected->data.as_bool;
     }
   }
 
-  if (array->array_n_elem < 4)
+  if (stats->array_n_elem < 2)
     return ret;
 
-  XmlrpcParam* subs_stats = xmlrpcParamArrayGetParamAt(array, 3);
+  XmlrpcParam* subs_stats = xmlrpcParamArrayGetParamAt(stats, 1);
   ret->stats.sub_stats = (struct TopicSubStats *)calloc(subs_stats->array_n_elem, sizeof(struct TopicSubStats));
   if (ret->stats.sub_stats == NULL)
     goto clean;
@@ -1079,7 +1478,7 @@ GetBusStatsResult * fetchGetBusStatsResult(XmlrpcParamVector *response)
   {
     struct TopicSubStats *sub_stats = &ret->stats.sub_stats[it1];
     XmlrpcParam *sub_stats_xml = xmlrpcParamArrayGetParamAt(subs_stats, it1);
-    if (sub_stats_xml->array_n_elem < 3)
+    if (sub_stats_xml->array_n_elem < 2)
       goto clean;
 
     XmlrpcParam *name_xml = xmlrpcParamArrayGetParamAt(sub_stats_xml, 0);
@@ -1110,10 +1509,10 @@ GetBusStatsResult * fetchGetBusStatsResult(XmlrpcParamVector *response)
     }
   }
 
-  if (array->array_n_elem < 5)
+  if (stats->array_n_elem < 3)
     return ret;
 
-  XmlrpcParam *services_stats = xmlrpcParamArrayGetParamAt(array, 4);
+  XmlrpcParam *services_stats = xmlrpcParamArrayGetParamAt(stats, 2);
   XmlrpcParam *numRequests = xmlrpcParamArrayGetParamAt(services_stats, 0);
   XmlrpcParam *bytesReceived = xmlrpcParamArrayGetParamAt(services_stats, 1);
   XmlrpcParam *bytesSent = xmlrpcParamArrayGetParamAt(services_stats, 2);
@@ -1170,9 +1569,12 @@ GetBusInfoResult * fetchGetBusInfoResult(XmlrpcParamVector *response)
     if (businfo->topic == NULL)
       goto clean;
     strcpy(businfo->topic, topic->data.as_string);
+    businfo->destinationId = (char *)malloc(strlen(destinationId->data.as_string) + 1);
+    if (businfo->destinationId == NULL)
+      goto clean;
+    strcpy(businfo->destinationId, destinationId->data.as_string);
     businfo->connectionId = connectionId->data.as_int;
-    businfo->destinationId = connectionId->data.as_int;
-    switch (connectionId->data.as_string[0])
+    switch (direction->data.as_string[0])
     {
       case 'i':
         businfo->direction = CROS_TRANSPORT_DIRECTION_IN;
@@ -1186,8 +1588,9 @@ GetBusInfoResult * fetchGetBusInfoResult(XmlrpcParamVector *response)
       default:
         goto clean;
     }
-    businfo->transport = (CrosTransportType)connectionId->data.as_int;
-    businfo->connected = connectionId->data.as_int;
+    businfo->transport = strcmp(transport->data.as_string, CROS_TRANSPORT_TCPROS_STRING) == 0 ?
+                         CROS_TRANSPORT_TCPROS : CROS_TRANSPORT_UPDROS;
+    businfo->connected = connected != NULL ? connected->data.as_bool : 1;
   }
 
   return ret;
@@ -1617,12 +2020,18 @@ void freeGetBusStatsResult(GetBusStatsResult *result)
 {
   free(result->status);
   int it1 = 0;
-  for (; it1 < result->stats.pub_stats_count; it1++)
+  for (it1 = 0; it1 < result->stats.pub_stats_count; it1++)
+  {
     free(result->stats.pub_stats[it1].topic_name);
+    free(result->stats.pub_stats[it1].datas);
+  }
   free(result->stats.pub_stats);
 
-  for (; it1 < result->stats.sub_stats_count; it1++)
-    free(result->stats.pub_stats[it1].topic_name);
+  for (it1 = 0; it1 < result->stats.sub_stats_count; it1++)
+  {
+    free(result->stats.sub_stats[it1].topic_name);
+    free(result->stats.sub_stats[it1].datas);
+  }
   free(result->stats.sub_stats);
 
   free(result);
@@ -1633,7 +2042,10 @@ void freeGetBusInfoResult(GetBusInfoResult *result)
   free(result->status);
   int it = 0;
   for (; it < result->bus_infos_count; it++)
+  {
     free(result->bus_infos[it].topic);
+    free(result->bus_infos[it].destinationId);
+  }
   free(result->bus_infos);
   free(result);
 }
@@ -0,0 +1,112 @@
+#include <stdlib.h>
+
+#include "cros_arena.h"
+#include "cros_defs.h"
+
+static size_t alignSize(size_t size)
+{
+  return (size + CROS_ARENA_ALIGNMENT - 1) & ~((size_t)CROS_ARENA_ALIGNMENT - 1);
+}
+
+static CrosArenaBlock * newBlock(size_t size)
+{
+  CrosArenaBlock *block = (CrosArenaBlock *)malloc(sizeof(CrosArenaBlock) + size);
+  if (block == NULL)
+    return NULL;
+
+  block->next = NULL;
+  block->size = size;
+  block->used = 0;
+  return block;
+}
+
+static void freeBlocks(CrosArenaBlock *block)
+{
+  while (block != NULL)
+  {
+    CrosArenaBlock *next = block->next;
+    free(block);
+    block = next;
+  }
+}
+
+void cRosArenaInit(CrosArena *arena, size_t block_size)
+{
+  arena->first = NULL;
+  arena->current = NULL;
+  arena->block_size = alignSize(block_size == 0 ? CROS_ARENA_BLOCK_SIZE : block_size);
+  arena->used = 0;
+}
+
+void cRosArenaRelease(CrosArena *arena)
+{
+  freeBlocks(arena->first);
+  arena->first = NULL;
+  arena->current = NULL;
+  arena->used = 0;
+}
+
+void * cRosArenaAlloc(CrosArena *arena, size_t size)
+{
+  size = alignSize(size);
+
+  CrosArenaBlock *block = arena->current;
+  while (block != NULL && block->size - block->used < size)
+  {
+    // The blocks after the current one are empty, they are left by the last reset
+    block = block->next;
+  }
+
+  if (block == NULL)
+  {
+    block = newBlock(size > arena->block_size ? size : arena->block_size);
+    if (block == NULL)
+    {
+      PRINT_ERROR("cRosArenaAlloc() : Can't allocate memory\n");
+      return NULL;
+    }
+
+    if (arena->current == NULL)
+    {
+      arena->first = block;
+    }
+    else
+    {
+      // Append to the chain
+      CrosArenaBlock *last = arena->current;
+      while (last->next != NULL)
+        last = last->next;
+      last->next = block;
+    }
+  }
+
+  arena->current = block;
+  void *ret = block->data + block->used;
+  block->used += size;
+  arena->used += size;
+  return ret;
+}
+
+void cRosArenaReset(CrosArena *arena)
+{
+  if (arena->first == NULL)
+    return;
+
+  if (arena->first->next != NULL && arena->used > arena->first->size)
+  {
+    // Merge the blocks so that the next cycle is served by a single block
+    CrosArenaBlock *block = newBlock(arena->used);
+    if (block != NULL)
+    {
+      freeBlocks(arena->first);
+      arena->first = block;
+    }
+  }
+
+  CrosArenaBlock *block;
+  for (block = arena->first; block != NULL; block = block->next)
+    block->used = 0;
+
+  arena->current = arena->first;
+  arena->used = 0;
+}
@@ -0,0 +1,797 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "cros_bag.h"
+#include "cros_api.h"
+#include "cros_api_internal.h"
+#include "cros_clock.h"
+#include "cros_defs.h"
+
+#define CROS_BAG_MAGIC "#ROSBAG V2.0\n"
+
+// Record opcodes
+#define CROS_BAG_OP_MSG_DATA 0x02
+#define CROS_BAG_OP_BAG_HEADER 0x03
+#define CROS_BAG_OP_INDEX_DATA 0x04
+#define CROS_BAG_OP_CHUNK 0x05
+#define CROS_BAG_OP_CHUNK_INFO 0x06
+#define CROS_BAG_OP_CONNECTION 0x07
+
+static void pushField(DynBuffer *buf, const char *name, const void *value, size_t size)
+{
+  size_t name_len = strlen(name);
+  dynBufferPushBackUInt32(buf, (uint32_t)(name_len + 1 + size));
+  dynBufferPushBackBuf(buf, (const unsigned char *)name, name_len);
+  dynBufferPushBackUInt8(buf, '=');
+  dynBufferPushBackBuf(buf, (const unsigned char *)value, size);
+}
+
+static void pushFieldUInt8(DynBuffer *buf, const char *name, uint8_t value)
+{
+  pushField(buf, name, &value, sizeof(value));
+}
+
+static void pushFieldUInt32(DynBuffer *buf, const char *name, uint32_t value)
+{
+  pushField(buf, name, &value, sizeof(value));
+}
+
+static void pushFieldUInt64(DynBuffer *buf, const char *name, uint64_t value)
+{
+  pushField(buf, name, &value, sizeof(value));
+}
+
+// A time is stored as sec then nsec, the times compared as (sec << 32 | nsec)
+static void pushFieldTime(DynBuffer *buf, const char *name, uint64_t time)
+{
+  uint32_t value[2] = { (uint32_t)(time >> 32), (uint32_t)time };
+  pushField(buf, name, value, sizeof(value));
+}
+
+static void pushFieldString(DynBuffer *buf, const char *name, const char *value)
+{
+  pushField(buf, name, value, strlen(value));
+}
+
+// Start a record: the header length is reserved, to be set by endRecordHeader()
+static size_t beginRecordHeader(DynBuffer *buf)
+{
+  size_t pos = dynBufferGetSize(buf);
+  dynBufferPushBackUInt32(buf, 0);
+  return pos;
+}
+
+// Set the header length of the record started at pos, followed by the length of its data
+static void endRecordHeader(DynBuffer *buf, size_t pos, uint32_t data_len)
+{
+  uint32_t header_len = (uint32_t)(dynBufferGetSize(buf) - pos - sizeof(uint32_t));
+  memcpy((unsigned char *)dynBufferGetData(buf) + pos, &header_len, sizeof(uint32_t));
+  dynBufferPushBackUInt32(buf, data_len);
+}
+
+static int writeAll(CrosBag *bag, struct iovec *iov, int iovcnt)
+{
+  while (iovcnt > 0)
+  {
+    ssize_t n = writev(bag->fd, iov, iovcnt);
+    if (n < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      PRINT_ERROR("cRosBag : Write failed, errno %d\n", errno);
+      return -1;
+    }
+
+    bag->file_pos += n;
+    while (iovcnt > 0 && (size_t)n >= iov->iov_len)
+    {
+      n -= iov->iov_len;
+      iov++;
+      iovcnt--;
+    }
+
+    if (iovcnt > 0)
+    {
+      iov->iov_base = (unsigned char *)iov->iov_base + n;
+      iov->iov_len -= n;
+    }
+  }
+
+  return 0;
+}
+
+static void pushConnectionRecord(DynBuffer *buf, CrosBagConnection *connection, int conn)
+{
+  size_t pos = beginRecordHeader(buf);
+  pushFieldUInt8(buf, "op", CROS_BAG_OP_CONNECTION);
+  pushFieldUInt32(buf, "conn", (uint32_t)conn);
+  pushFieldString(buf, "topic", connection->topic);
+  endRecordHeader(buf, pos, (uint32_t)dynBufferGetSize(&connection->header));
+  dynBufferPushBackBuf(buf, dynBufferGetData(&connection->header), dynBufferGetSize(&connection->header));
+}
+
+// Write the current chunk followed by its index records, and keep its chunk info
+static int flushChunk(CrosBag *bag)
+{
+  if (dynBufferGetSize(&bag->chunk) == 0)
+    return 0;
+
+  uint64_t chunk_pos = bag->file_pos;
+  uint32_t chunk_size = (uint32_t)dynBufferGetSize(&bag->chunk);
+
+  DynBuffer header, index;
+  dynBufferInit(&header);
+  dynBufferInit(&index);
+
+  size_t pos = beginRecordHeader(&header);
+  pushFieldUInt8(&header, "op", CROS_BAG_OP_CHUNK);
+  pushFieldString(&header, "compression", "none");
+  pushFieldUInt32(&header, "size", chunk_size);
+  endRecordHeader(&header, pos, chunk_size);
+
+  uint32_t n_chunk_connections = 0;
+  int i;
+  for (i = 0; i < bag->n_connections; i++)
+  {
+    CrosBagConnection *connection = &bag->connections[i];
+    if (connection->chunk_count == 0)
+      continue;
+
+    pos = beginRecordHeader(&index);
+    pushFieldUInt8(&index, "op", CROS_BAG_OP_INDEX_DATA);
+    pushFieldUInt32(&index, "ver", 1);
+    pushFieldUInt32(&index, "conn", (uint32_t)i);
+    pushFieldUInt32(&index, "count", connection->chunk_count);
+    endRecordHeader(&index, pos, (uint32_t)dynBufferGetSize(&connection->index));
+    dynBufferPushBackBuf(&index, dynBufferGetData(&connection->index), dynBufferGetSize(&connection->index));
+    n_chunk_connections++;
+  }
+
+  struct iovec iov[3];
+  iov[0].iov_base = (void *)dynBufferGetData(&header);
+  iov[0].iov_len = dynBufferGetSize(&header);
+  iov[1].iov_base = (void *)dynBufferGetData(&bag->chunk);
+  iov[1].iov_len = chunk_size;
+  iov[2].iov_base = (void *)dynBufferGetData(&index);
+  iov[2].iov_len = dynBufferGetSize(&index);
+  int rc = writeAll(bag, iov, 3);
+
+  dynBufferRelease(&header);
+  dynBufferRelease(&index);
+
+  // Chunk info: [conn, count] of every connection in the chunk
+  DynBuffer *infos = &bag->chunk_infos;
+  pos = beginRecordHeader(infos);
+  pushFieldUInt8(infos, "op", CROS_BAG_OP_CHUNK_INFO);
+  pushFieldUInt32(infos, "ver", 1);
+  pushFieldUInt64(infos, "chunk_pos", chunk_pos);
+  pushFieldTime(infos, "start_time", bag->chunk_start_time);
+  pushFieldTime(infos, "end_time", bag->chunk_end_time);
+  pushFieldUInt32(infos, "count", n_chunk_connections);
+  endRecordHeader(infos, pos, n_chunk_connections * 2 * sizeof(uint32_t));
+  for (i = 0; i < bag->n_connections; i++)
+  {
+    CrosBagConnection *connection = &bag->connections[i];
+    if (connection->chunk_count == 0)
+      continue;
+
+    dynBufferPushBackUInt32(infos, (uint32_t)i);
+    dynBufferPushBackUInt32(infos, connection->chunk_count);
+    connection->chunk_count = 0;
+    dynBufferClear(&connection->index);
+  }
+
+  bag->chunk_count++;
+  dynBufferClear(&bag->chunk);
+  return rc;
+}
+
+// The bag header record, padded to CROS_BAG_HEADER_SIZE
+static int writeBagHeader(CrosBag *bag, uint64_t index_pos)
+{
+  DynBuffer header;
+  dynBufferInit(&header);
+
+  size_t pos = beginRecordHeader(&header);
+  pushFieldUInt8(&header, "op", CROS_BAG_OP_BAG_HEADER);
+  pushFieldUInt64(&header, "index_pos", index_pos);
+  pushFieldUInt32(&header, "conn_count", (uint32_t)bag->n_connections);
+  pushFieldUInt32(&header, "chunk_count", bag->chunk_count);
+  uint32_t padding = CROS_BAG_HEADER_SIZE - (uint32_t)dynBufferGetSize(&header) - sizeof(uint32_t);
+  endRecordHeader(&header, pos, padding);
+  unsigned char *data = dynBufferReserve(&header, padding);
+  int rc = -1;
+  if (data != NULL)
+  {
+    memset(data, ' ', padding);
+    dynBufferCommit(&header, padding);
+    ssize_t n = pwrite(bag->fd, dynBufferGetData(&header), CROS_BAG_HEADER_SIZE, strlen(CROS_BAG_MAGIC));
+    rc = (n == CROS_BAG_HEADER_SIZE) ? 0 : -1;
+  }
+
+  dynBufferRelease(&header);
+  return rc;
+}
+
+int cRosBagOpen(CrosBag *bag, const char *path, size_t chunk_threshold)
+{
+  memset(bag, 0, sizeof(CrosBag));
+  bag->chunk_threshold = chunk_threshold > 0 ? chunk_threshold : CROS_BAG_CHUNK_THRESHOLD;
+  dynBufferInit(&bag->chunk);
+  dynBufferInit(&bag->chunk_infos);
+
+  bag->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (bag->fd == -1)
+  {
+    PRINT_ERROR("cRosBagOpen() : Can't create %s\n", path);
+    return -1;
+  }
+
+  // The header is rewritten by cRosBagClose(), when the index position is known
+  struct iovec iov;
+  iov.iov_base = (void *)CROS_BAG_MAGIC;
+  iov.iov_len = strlen(CROS_BAG_MAGIC);
+  if (writeAll(bag, &iov, 1) != 0 || writeBagHeader(bag, 0) != 0)
+  {
+    close(bag->fd);
+    bag->fd = -1;
+    return -1;
+  }
+
+  // pwrite() doesn't move the file offset
+  bag->file_pos += CROS_BAG_HEADER_SIZE;
+  if (lseek(bag->fd, (off_t)bag->file_pos, SEEK_SET) == (off_t)-1)
+  {
+    close(bag->fd);
+    bag->fd = -1;
+    return -1;
+  }
+
+  return 0;
+}
+
+int cRosBagAddConnection(CrosBag *bag, const char *topic, const char *type, const char *md5sum,
+                         const char *message_definition)
+{
+  if (bag->fd == -1 || bag->n_connections == CROS_BAG_MAX_CONNECTIONS)
+    return -1;
+
+  CrosBagConnection *connection = &bag->connections[bag->n_connections];
+  memset(connection, 0, sizeof(CrosBagConnection));
+  connection->topic = strdup(topic);
+  if (connection->topic == NULL)
+    return -1;
+
+  connection->bag = bag;
+  dynBufferInit(&connection->header);
+  dynBufferInit(&connection->index);
+  pushFieldString(&connection->header, "topic", topic);
+  pushFieldString(&connection->header, "type", type);
+  pushFieldString(&connection->header, "md5sum", md5sum);
+  pushFieldString(&connection->header, "message_definition", message_definition);
+
+  return bag->n_connections++;
+}
+
+int cRosBagWrite(CrosBag *bag, int conn, uint32_t sec, uint32_t nsec, const unsigned char *data, size_t size)
+{
+  if (bag->fd == -1 || conn < 0 || conn >= bag->n_connections)
+    return -1;
+
+  CrosBagConnection *connection = &bag->connections[conn];
+  DynBuffer *chunk = &bag->chunk;
+
+  uint64_t time = ((uint64_t)sec << 32) | nsec;
+  if (dynBufferGetSize(chunk) == 0)
+  {
+    bag->chunk_start_time = time;
+    bag->chunk_end_time = time;
+  }
+  else if (time < bag->chunk_start_time)
+    bag->chunk_start_time = time;
+  else if (time > bag->chunk_end_time)
+    bag->chunk_end_time = time;
+
+  // A reader meets the connection record before the first message of the connection
+  if (!connection->written)
+  {
+    pushConnectionRecord(chunk, connection, conn);
+    connection->written = 1;
+  }
+
+  dynBufferPushBackUInt32(&connection->index, sec);
+  dynBufferPushBackUInt32(&connection->index, nsec);
+  dynBufferPushBackUInt32(&connection->index, (uint32_t)dynBufferGetSize(chunk));
+  connection->chunk_count++;
+  connection->message_count++;
+
+  size_t pos = beginRecordHeader(chunk);
+  pushFieldUInt8(chunk, "op", CROS_BAG_OP_MSG_DATA);
+  pushFieldUInt32(chunk, "conn", (uint32_t)conn);
+  pushFieldTime(chunk, "time", time);
+  endRecordHeader(chunk, pos, (uint32_t)size);
+  if (dynBufferPushBackBuf(chunk, data, size) == -1)
+  {
+    PRINT_ERROR("cRosBagWrite() : Can't allocate memory\n");
+    return -1;
+  }
+
+  if (dynBufferGetSize(chunk) >= bag->chunk_threshold)
+    return flushChunk(bag);
+
+  return 0;
+}
+
+static CallbackResponse recordCallback(DynBuffer *message, void *context)
+{
+  CrosBagConnection *connection = (CrosBagConnection *)context;
+  CrosBag *bag = connection->bag;
+
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  cRosBagWrite(bag, (int)(connection - bag->connections), (uint32_t)now.tv_sec, (uint32_t)now.tv_nsec,
+               dynBufferGetData(message), dynBufferGetSize(message));
+  return 0;
+}
+
+int cRosBagRecordTopic(CrosNode *node, CrosBag *bag, const char *topic_name, const char *topic_type)
+{
+  if (bag->fd == -1 || bag->n_connections == CROS_BAG_MAX_CONNECTIONS)
+    return -1;
+
+  // The connection is added once the md5sum and the definition of the type are known
+  CrosBagConnection *connection = &bag->connections[bag->n_connections];
+  int subidx = cRosApiRegisterRawSubscriber(node, topic_name, topic_type, recordCallback, NULL, connection);
+  if (subidx == -1)
+    return -1;
+
+  SubscriberNode *sub = &node->subs[subidx];
+  if (cRosBagAddConnection(bag, sub->topic_name, sub->topic_type, sub->md5sum, sub->message_definition) == -1)
+  {
+    cRosApiUnregisterSubscriber(node, subidx);
+    return -1;
+  }
+
+  return subidx;
+}
+
+int cRosBagClose(CrosBag *bag)
+{
+  if (bag->fd == -1)
+    return -1;
+
+  int rc = flushChunk(bag);
+
+  // Index section: the connection records, then the chunk infos
+  uint64_t index_pos = bag->file_pos;
+  DynBuffer connections;
+  dynBufferInit(&connections);
+  int i;
+  for (i = 0; i < bag->n_connections; i++)
+    pushConnectionRecord(&connections, &bag->connections[i], i);
+
+  struct iovec iov[2];
+  iov[0].iov_base = (void *)dynBufferGetData(&connections);
+  iov[0].iov_len = dynBufferGetSize(&connections);
+  iov[1].iov_base = (void *)dynBufferGetData(&bag->chunk_infos);
+  iov[1].iov_len = dynBufferGetSize(&bag->chunk_infos);
+  if (writeAll(bag, iov, 2) != 0 || writeBagHeader(bag, index_pos) != 0)
+    rc = -1;
+
+  dynBufferRelease(&connections);
+  if (close(bag->fd) != 0)
+    rc = -1;
+  bag->fd = -1;
+
+  for (i = 0; i < bag->n_connections; i++)
+  {
+    free(bag->connections[i].topic);
+    dynBufferRelease(&bag->connections[i].header);
+    dynBufferRelease(&bag->connections[i].index);
+  }
+  bag->n_connections = 0;
+  dynBufferRelease(&bag->chunk);
+  dynBufferRelease(&bag->chunk_infos);
+
+  return rc;
+}
+
+// A record of a mapped bag
+typedef struct
+{
+  const unsigned char *header;
+  uint32_t header_len;
+  const unsigned char *data;
+  uint32_t data_len;
+  uint64_t next;                      //! Position of the next record
+} BagRecord;
+
+static int readRecord(const CrosBagPlayer *player, uint64_t pos, BagRecord *rec)
+{
+  uint32_t len;
+  if (pos + sizeof(uint32_t) > player->map_size)
+    return -1;
+  memcpy(&len, player->map + pos, sizeof(uint32_t));
+  pos += sizeof(uint32_t);
+  if (pos + len + sizeof(uint32_t) > player->map_size)
+    return -1;
+  rec->header = player->map + pos;
+  rec->header_len = len;
+  pos += len;
+
+  memcpy(&len, player->map + pos, sizeof(uint32_t));
+  pos += sizeof(uint32_t);
+  if (pos + len > player->map_size)
+    return -1;
+  rec->data = player->map + pos;
+  rec->data_len = len;
+  rec->next = pos + len;
+  return 0;
+}
+
+// Find the value of a field in a list of fields (a record header or a connection header)
+static const unsigned char *findField(const unsigned char *fields, uint32_t len, const char *name, uint32_t *size)
+{
+  size_t name_len = strlen(name);
+  uint32_t pos = 0;
+  while (pos + sizeof(uint32_t) <= len)
+  {
+    uint32_t field_len;
+    memcpy(&field_len, fields + pos, sizeof(uint32_t));
+    pos += sizeof(uint32_t);
+    if (field_len > len - pos)
+      break;
+
+    if (field_len > name_len && fields[pos + name_len] == '=' && memcmp(fields + pos, name, name_len) == 0)
+    {
+      *size = field_len - name_len - 1;
+      return fields + pos + name_len + 1;
+    }
+
+    pos += field_len;
+  }
+
+  return NULL;
+}
+
+static int getFieldUInt(const unsigned char *fields, uint32_t len, const char *name, void *value, uint32_t size)
+{
+  uint32_t field_size;
+  const unsigned char *field = findField(fields, len, name, &field_size);
+  if (field == NULL || field_size != size)
+    return -1;
+
+  memcpy(value, field, size);
+  return 0;
+}
+
+static char *getFieldString(const unsigned char *fields, uint32_t len, const char *name)
+{
+  uint32_t size;
+  const unsigned char *field = findField(fields, len, name, &size);
+  if (field == NULL)
+    return NULL;
+
+  char *str = (char *)malloc(size + 1);
+  if (str != NULL)
+  {
+    memcpy(str, field, size);
+    str[size] = '\0';
+  }
+
+  return str;
+}
+
+static int getRecordOp(const BagRecord *rec)
+{
+  uint8_t op;
+  if (getFieldUInt(rec->header, rec->header_len, "op", &op, sizeof(op)) != 0)
+    return -1;
+
+  return op;
+}
+
+static CrosBagPlayerConnection *findPlayerConnection(CrosBagPlayer *player, uint32_t conn)
+{
+  int i;
+  for (i = 0; i < player->n_connections; i++)
+  {
+    if (player->connections[i].conn == conn)
+      return &player->connections[i];
+  }
+
+  return NULL;
+}
+
+static int compareIndexEntries(const void *a, const void *b)
+{
+  const CrosBagIndexEntry *ea = (const CrosBagIndexEntry *)a, *eb = (const CrosBagIndexEntry *)b;
+  if (ea->time != eb->time)
+    return ea->time < eb->time ? -1 : 1;
+
+  return ea->pos < eb->pos ? -1 : (ea->pos > eb->pos);
+}
+
+// Read the index records that follow a chunk
+static int loadChunkIndex(CrosBagPlayer *player, uint64_t chunk_pos, uint64_t index_pos)
+{
+  BagRecord rec;
+  uint32_t compression_size;
+  const unsigned char *compression;
+  if (readRecord(player, chunk_pos, &rec) != 0 || getRecordOp(&rec) != CROS_BAG_OP_CHUNK)
+    return -1;
+
+  compression = findField(rec.header, rec.header_len, "compression", &compression_size);
+  if (compression == NULL || compression_size != 4 || memcmp(compression, "none", 4) != 0)
+  {
+    PRINT_ERROR("cRosBagPlayerOpen() : Compressed chunks are not supported\n");
+    return -1;
+  }
+
+  uint64_t chunk_data_pos = (uint64_t)(rec.data - player->map);
+  uint64_t pos = rec.next;
+  while (pos < index_pos && readRecord(player, pos, &rec) == 0 && getRecordOp(&rec) == CROS_BAG_OP_INDEX_DATA)
+  {
+    uint32_t conn, count;
+    if (getFieldUInt(rec.header, rec.header_len, "conn", &conn, sizeof(conn)) != 0 ||
+        getFieldUInt(rec.header, rec.header_len, "count", &count, sizeof(count)) != 0 ||
+        (uint64_t)count * 12 > rec.data_len)
+      return -1;
+
+    CrosBagPlayerConnection *connection = findPlayerConnection(player, conn);
+    if (connection == NULL)
+      return -1;
+
+    CrosBagIndexEntry *entries = (CrosBagIndexEntry *)realloc(connection->entries,
+                                        (connection->n_entries + count) * sizeof(CrosBagIndexEntry));
+    if (entries == NULL)
+      return -1;
+    connection->entries = entries;
+
+    uint32_t i;
+    for (i = 0; i < count; i++)
+    {
+      uint32_t entry[3];              // sec, nsec, offset in the chunk data
+      memcpy(entry, rec.data + i * sizeof(entry), sizeof(entry));
+      entries[connection->n_entries].time = ((uint64_t)entry[0] << 32) | entry[1];
+      entries[connection->n_entries].pos = chunk_data_pos + entry[2];
+      connection->n_entries++;
+    }
+
+    pos = rec.next;
+  }
+
+  return 0;
+}
+
+static int loadIndex(CrosBagPlayer *player)
+{
+  BagRecord rec;
+  uint64_t index_pos;
+  if (readRecord(player, strlen(CROS_BAG_MAGIC), &rec) != 0 || getRecordOp(&rec) != CROS_BAG_OP_BAG_HEADER ||
+      getFieldUInt(rec.header, rec.header_len, "index_pos", &index_pos, sizeof(index_pos)) != 0 ||
+      index_pos == 0 || index_pos > player->map_size)
+  {
+    PRINT_ERROR("cRosBagPlayerOpen() : Missing bag header or index (unclosed bag?)\n");
+    return -1;
+  }
+
+  // The connection records precede the chunk infos
+  uint64_t pos = index_pos;
+  while (pos < player->map_size)
+  {
+    if (readRecord(player, pos, &rec) != 0)
+      return -1;
+    pos = rec.next;
+
+    int op = getRecordOp(&rec);
+    if (op == CROS_BAG_OP_CONNECTION)
+    {
+      if (player->n_connections == CROS_BAG_MAX_CONNECTIONS)
+      {
+        PRINT_ERROR("cRosBagPlayerOpen() : Too many connections\n");
+        return -1;
+      }
+
+      CrosBagPlayerConnection *connection = &player->connections[player->n_connections];
+      memset(connection, 0, sizeof(CrosBagPlayerConnection));
+      connection->player = player;
+      connection->pub_idx = -1;
+      player->n_connections++;
+      if (getFieldUInt(rec.header, rec.header_len, "conn", &connection->conn, sizeof(uint32_t)) != 0)
+        return -1;
+
+      connection->topic = getFieldString(rec.header, rec.header_len, "topic");
+      connection->type = getFieldString(rec.data, rec.data_len, "type");
+      connection->md5sum = getFieldString(rec.data, rec.data_len, "md5sum");
+      connection->message_definition = getFieldString(rec.data, rec.data_len, "message_definition");
+      if (connection->topic == NULL || connection->type == NULL || connection->md5sum == NULL)
+        return -1;
+      if (connection->message_definition == NULL && (connection->message_definition = strdup("")) == NULL)
+        return -1;
+    }
+    else if (op == CROS_BAG_OP_CHUNK_INFO)
+    {
+      uint64_t chunk_pos;
+      if (getFieldUInt(rec.header, rec.header_len, "chunk_pos", &chunk_pos, sizeof(chunk_pos)) != 0 ||
+          loadChunkIndex(player, chunk_pos, index_pos) != 0)
+        return -1;
+    }
+  }
+
+  int i, first = 1;
+  for (i = 0; i < player->n_connections; i++)
+  {
+    CrosBagPlayerConnection *connection = &player->connections[i];
+    if (connection->n_entries == 0)
+      continue;
+
+    qsort(connection->entries, connection->n_entries, sizeof(CrosBagIndexEntry), compareIndexEntries);
+    if (first || connection->entries[0].time < player->bag_start_time)
+      player->bag_start_time = connection->entries[0].time;
+    first = 0;
+  }
+
+  return 0;
+}
+
+int cRosBagPlayerOpen(CrosBagPlayer *player, const char *path)
+{
+  memset(player, 0, sizeof(CrosBagPlayer));
+
+  int fd = open(path, O_RDONLY);
+  if (fd == -1)
+  {
+    PRINT_ERROR("cRosBagPlayerOpen() : Can't open %s\n", path);
+    return -1;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < strlen(CROS_BAG_MAGIC))
+  {
+    close(fd);
+    return -1;
+  }
+
+  void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+  {
+    PRINT_ERROR("cRosBagPlayerOpen() : Can't map %s\n", path);
+    return -1;
+  }
+
+  player->map = (const unsigned char *)map;
+  player->map_size = (size_t)st.st_size;
+
+  if (memcmp(player->map, CROS_BAG_MAGIC, strlen(CROS_BAG_MAGIC)) != 0 || loadIndex(player) != 0)
+  {
+    PRINT_ERROR("cRosBagPlayerOpen() : Unsupported bag %s\n", path);
+    cRosBagPlayerClose(player);
+    return -1;
+  }
+
+  // The messages are read in time order, mostly ahead
+  madvise(map, player->map_size, MADV_SEQUENTIAL);
+  return 0;
+}
+
+// Time (msec) of a message from the start of the playback
+static uint64_t getPlaybackOffset(CrosBagPlayer *player, uint64_t time)
+{
+  uint64_t ns = (time >> 32) * 1000000000ULL + (time & 0xFFFFFFFF);
+  uint64_t start_ns = (player->bag_start_time >> 32) * 1000000000ULL + (player->bag_start_time & 0xFFFFFFFF);
+  return (uint64_t)((double)(ns - start_ns) / player->rate / 1000000.0);
+}
+
+// Wall time (msec) at which a message is due, 0 to publish it as soon as possible
+static uint64_t getDueTime(CrosBagPlayer *player, uint64_t time)
+{
+  if (player->rate <= 0 || player->start_time_ms == 0)
+    return 0;
+
+  return player->start_time_ms + getPlaybackOffset(player, time);
+}
+
+static CallbackResponse playCallback(DynBuffer *buffer, void *context)
+{
+  CrosBagPlayerConnection *connection = (CrosBagPlayerConnection *)context;
+  CrosBagPlayer *player = connection->player;
+  PublisherNode *pub = &player->node->pubs[connection->pub_idx];
+
+  if (connection->next < connection->n_entries)
+  {
+    CrosBagIndexEntry *entry = &connection->entries[connection->next++];
+
+    // The clock starts with the first message sent: it's published on time
+    if (player->start_time_ms == 0 && player->rate > 0)
+    {
+      uint64_t now = cRosClockGetTimeMs(), offset = getPlaybackOffset(player, entry->time);
+      player->start_time_ms = now > offset ? now - offset : 1;
+    }
+
+    BagRecord rec;
+    if (readRecord(player, entry->pos, &rec) == 0 && getRecordOp(&rec) == CROS_BAG_OP_MSG_DATA)
+      dynBufferPushBackBuf(buffer, rec.data, rec.data_len);
+    else
+      PRINT_ERROR("cRosBagPlayer : Bad message record at %llu\n", (unsigned long long)entry->pos);
+
+    player->published++;
+  }
+
+  // Next cycle at the time of the next message
+  if (connection->next < connection->n_entries)
+    pub->wake_up_time_ms = getDueTime(player, connection->entries[connection->next].time);
+  else
+    pub->wake_up_time_ms = UINT64_MAX;
+
+  return 0;
+}
+
+int cRosBagPlayerStart(CrosNode *node, CrosBagPlayer *player, double rate)
+{
+  if (player->map == NULL)
+    return -1;
+
+  player->node = node;
+  player->rate = rate;
+  player->start_time_ms = 0;
+
+  int i;
+  for (i = 0; i < player->n_connections; i++)
+  {
+    CrosBagPlayerConnection *connection = &player->connections[i];
+    if (connection->n_entries == 0)
+      continue;
+
+    connection->next = 0;
+    connection->pub_idx = cRosNodeRegisterPublisher(node, connection->message_definition, connection->topic,
+                                                    connection->type, connection->md5sum, 0, playCallback,
+                                                    NULL, connection);
+    if (connection->pub_idx == -1)
+      return -1;
+
+    // Due as soon as a subscriber is ready
+    node->pubs[connection->pub_idx].wake_up_time_ms = 0;
+  }
+
+  return 0;
+}
+
+int cRosBagPlayerIsDone(CrosBagPlayer *player)
+{
+  int i;
+  for (i = 0; i < player->n_connections; i++)
+  {
+    if (player->connections[i].next < player->connections[i].n_entries)
+      return 0;
+  }
+
+  return 1;
+}
+
+void cRosBagPlayerClose(CrosBagPlayer *player)
+{
+  int i;
+  for (i = 0; i < player->n_connections; i++)
+  {
+    CrosBagPlayerConnection *connection = &player->connections[i];
+    free(connection->topic);
+    free(connection->type);
+    free(connection->md5sum);
+    free(connection->message_definition);
+    free(connection->entries);
+  }
+  player->n_connections = 0;
+
+  if (player->map != NULL)
+    munmap((void *)player->map, player->map_size);
+  player->map = NULL;
+}
@@ -10,6 +10,14 @@ uint64_t cRosClockGetTimeMs()
   return (uint64_t)tv.tv_sec*1000 + (uint64_t)tv.tv_usec/1000;
 }
 
+uint64_t cRosClockGetTimeUs()
+{
+  PRINT_VDEBUG ( "cRosClockGetTimeUs()\n" );
+  struct timeval tv;
+  gettimeofday( &tv, NULL );
+  return (uint64_t)tv.tv_sec*1000000 + (uint64_t)tv.tv_usec;
+}
+
 struct timeval cRosClockGetTimeVal( uint64_t msec )
 {
   PRINT_VDEBUG ( "cRosClockGetTimeVal()\n" );
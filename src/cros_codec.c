@@ -0,0 +1,165 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "cros_codec.h"
+#include "cros_defs.h"
+
+size_t cRosCodecStringSize(const char *str)
+{
+  return sizeof(uint32_t) + (str != NULL ? strlen(str) : 0);
+}
+
+unsigned char * cRosCodecWriteBuf(unsigned char *out, const void *src, size_t n)
+{
+  if (n > 0)
+    memcpy(out, src, n);
+
+  return out + n;
+}
+
+unsigned char * cRosCodecWriteUInt32(unsigned char *out, uint32_t val)
+{
+  memcpy(out, &val, sizeof(uint32_t));
+  return out + sizeof(uint32_t);
+}
+
+unsigned char * cRosCodecWriteString(unsigned char *out, const char *str)
+{
+  uint32_t len = str != NULL ? strlen(str) : 0;
+  out = cRosCodecWriteUInt32(out, len);
+  return cRosCodecWriteBuf(out, str, len);
+}
+
+int cRosCodecRead(DynBuffer *buffer, void *dst, size_t n)
+{
+  if ((size_t)dynBufferGetRemainingDataSize(buffer) < n)
+    return -1;
+
+  if (n > 0)
+    memcpy(dst, dynBufferGetCurrentData(buffer), n);
+  dynBufferMovePoseIndicator(buffer, n);
+  return 0;
+}
+
+int cRosCodecReadString(DynBuffer *buffer, char **str)
+{
+  uint32_t len;
+  if (cRosCodecReadArraySize(buffer, &len, 1) == -1)
+    return -1;
+
+  char *new_str = (char *)realloc(*str, len + 1);
+  if (new_str == NULL)
+  {
+    PRINT_ERROR("cRosCodecReadString() : Can't allocate memory\n");
+    return -1;
+  }
+
+  memcpy(new_str, dynBufferGetCurrentData(buffer), len);
+  new_str[len] = '\0';
+  dynBufferMovePoseIndicator(buffer, len);
+  *str = new_str;
+  return 0;
+}
+
+int cRosCodecReadArraySize(DynBuffer *buffer, uint32_t *size, size_t min_element_size)
+{
+  uint32_t new_size;
+  if (cRosCodecRead(buffer, &new_size, sizeof(uint32_t)) == -1)
+    return -1;
+
+  // Don't trust the size before allocating the array
+  if ((size_t)new_size * min_element_size > (size_t)dynBufferGetRemainingDataSize(buffer))
+    return -1;
+
+  *size = new_size;
+  return 0;
+}
+
+int cRosCodecResizeArray(void **array, uint32_t size, size_t element_size)
+{
+  void *new_array = realloc(*array, size > 0 ? size * element_size : 1);
+  if (new_array == NULL)
+  {
+    PRINT_ERROR("cRosCodecResizeArray() : Can't allocate memory\n");
+    return -1;
+  }
+
+  *array = new_array;
+  return 0;
+}
+
+int cRosCodecReadArray(DynBuffer *buffer, void **array, uint32_t *size, size_t element_size)
+{
+  uint32_t new_size;
+  if (cRosCodecReadArraySize(buffer, &new_size, element_size) == -1)
+    return -1;
+
+  if (cRosCodecResizeArray(array, new_size, element_size) == -1)
+    return -1;
+
+  *size = new_size;
+  return cRosCodecRead(buffer, *array, new_size * element_size);
+}
+
+int cRosCodecReadStringArray(DynBuffer *buffer, char ***array, uint32_t *size)
+{
+  uint32_t new_size;
+  if (cRosCodecReadArraySize(buffer, &new_size, sizeof(uint32_t)) == -1)
+    return -1;
+
+  uint32_t i;
+  for (i = new_size; i < *size; i++)
+    free((*array)[i]);
+  if (new_size < *size)
+    *size = new_size;
+
+  if (cRosCodecResizeArray((void **)array, new_size, sizeof(char *)) == -1)
+    return -1;
+
+  for (i = *size; i < new_size; i++)
+    (*array)[i] = NULL;
+  *size = new_size;
+
+  for (i = 0; i < new_size; i++)
+  {
+    if (cRosCodecReadString(buffer, &(*array)[i]) == -1)
+      return -1;
+  }
+
+  return 0;
+}
+
+void cRosCodecReleaseStringArray(char **array, uint32_t size)
+{
+  uint32_t i;
+  for (i = 0; i < size; i++)
+    free(array[i]);
+  free(array);
+}
+
+size_t cRosCodecHeaderSize(const CrosHeader *header)
+{
+  return sizeof(uint32_t) + sizeof(CrosTime) + cRosCodecStringSize(header->frame_id);
+}
+
+unsigned char * cRosCodecWriteHeader(unsigned char *out, const CrosHeader *header)
+{
+  out = cRosCodecWriteUInt32(out, header->seq);
+  out = cRosCodecWriteBuf(out, &header->stamp, sizeof(CrosTime));
+  return cRosCodecWriteString(out, header->frame_id);
+}
+
+int cRosCodecReadHeader(DynBuffer *buffer, CrosHeader *header)
+{
+  if (cRosCodecRead(buffer, &header->seq, sizeof(uint32_t)) == -1 ||
+      cRosCodecRead(buffer, &header->stamp, sizeof(CrosTime)) == -1)
+    return -1;
+
+  return cRosCodecReadString(buffer, &header->frame_id);
+}
+
+void cRosCodecReleaseHeader(CrosHeader *header)
+{
+  free(header->frame_id);
+  header->frame_id = NULL;
+}
@@ -1,7 +1,11 @@
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include "cros_gentools.h"
+#include "cros_defs.h"
+#include "dyn_string.h"
 #include "cros_message.h"
 #include "cros_message_internal.h"
 #include "cros_service.h"
@@ -83,3 +87,808 @@ int cRosGentoolsFulltext(char* filename)
 	//free(full_text);
   return 1;
 }
+
+typedef enum GenKind
+{
+  GEN_KIND_FIXED,                     // Plain old data, serialized as it is in memory
+  GEN_KIND_STRING,
+  GEN_KIND_HEADER,
+  GEN_KIND_CUSTOM
+} GenKind;
+
+typedef enum GenOp
+{
+  GEN_OP_SIZE,
+  GEN_OP_WRITE,
+  GEN_OP_READ,
+  GEN_OP_RELEASE
+} GenOp;
+
+typedef struct GenNames
+{
+  char **names;
+  int n_names;
+} GenNames;
+
+typedef struct GenContext
+{
+  const char *output_dir;
+  GenNames generated;                 // Types already generated by this run
+} GenContext;
+
+static int generateMsgHeader(GenContext *ctx, const char *filename);
+
+static GenKind genFieldKind(CrosMessageType type)
+{
+  switch (type)
+  {
+    case CROS_STD_MSGS_STRING:
+      return GEN_KIND_STRING;
+    case CROS_STD_MSGS_HEADER:
+      return GEN_KIND_HEADER;
+    case CROS_CUSTOM_TYPE:
+      return GEN_KIND_CUSTOM;
+    default:
+      return GEN_KIND_FIXED;
+  }
+}
+
+static const char * genFixedCType(CrosMessageType type)
+{
+  switch (type)
+  {
+    case CROS_STD_MSGS_INT8:
+    case CROS_STD_MSGS_BYTE:
+      return "int8_t";
+    case CROS_STD_MSGS_UINT8:
+    case CROS_STD_MSGS_BOOL:
+    case CROS_STD_MSGS_CHAR:
+      return "uint8_t";
+    case CROS_STD_MSGS_INT16:
+      return "int16_t";
+    case CROS_STD_MSGS_UINT16:
+      return "uint16_t";
+    case CROS_STD_MSGS_INT32:
+      return "int32_t";
+    case CROS_STD_MSGS_UINT32:
+      return "uint32_t";
+    case CROS_STD_MSGS_INT64:
+      return "int64_t";
+    case CROS_STD_MSGS_UINT64:
+      return "uint64_t";
+    case CROS_STD_MSGS_FLOAT32:
+      return "float";
+    case CROS_STD_MSGS_FLOAT64:
+      return "double";
+    case CROS_STD_MSGS_TIME:
+      return "CrosTime";
+    case CROS_STD_MSGS_DURATION:
+      return "CrosDuration";
+    default:
+      return NULL;
+  }
+}
+
+// e.g. "std_msgs/String" -> "std_msgs_String"
+static void genSymbol(const char *type_s, char *symbol, size_t size)
+{
+  snprintf(symbol, size, "%s", type_s);
+  char *it;
+  for (it = symbol; *it != '\0'; it++)
+  {
+    if (*it == '/')
+      *it = '_';
+  }
+}
+
+// C type of a single element of the field
+static void genElementCType(msgFieldDef *field, char *ctype, size_t size)
+{
+  switch (genFieldKind(field->type))
+  {
+    case GEN_KIND_STRING:
+      snprintf(ctype, size, "char *");
+      break;
+    case GEN_KIND_HEADER:
+      snprintf(ctype, size, "CrosHeader ");
+      break;
+    case GEN_KIND_CUSTOM:
+      genSymbol(field->type_s, ctype, size);
+      strncat(ctype, " ", size - strlen(ctype) - 1);
+      break;
+    default:
+      snprintf(ctype, size, "%s ", genFixedCType(field->type));
+      break;
+  }
+}
+
+// Splits "pkg/Name.ext" (or ".../pkg/msg/Name.ext") in package and name
+static int genTypeFromPath(const char *filename, char *package, char *name, size_t size)
+{
+  char *path = (char *)malloc(strlen(filename) + 1);
+  if (path == NULL)
+    return -1;
+  strcpy(path, filename);
+
+  char *ext = strrchr(path, '.');
+  if (ext != NULL)
+    *ext = '\0';
+
+  const char *tokens[3] = { NULL, NULL, NULL };
+  char *tok = strtok(path, "/\\");
+  while (tok != NULL)
+  {
+    if (strcmp(tok, "msg") != 0 && strcmp(tok, "srv") != 0)
+    {
+      tokens[0] = tokens[1];
+      tokens[1] = tok;
+    }
+    tok = strtok(NULL, "/\\");
+  }
+
+  int rc = -1;
+  if (tokens[0] != NULL && tokens[1] != NULL)
+  {
+    snprintf(package, size, "%s", tokens[0]);
+    snprintf(name, size, "%s", tokens[1]);
+    rc = 0;
+  }
+
+  free(path);
+  return rc;
+}
+
+// Returns 1 if the name was already in the list, 0 if it has been added, -1 on failure
+static int genNamesAdd(GenNames *list, const char *name)
+{
+  int i;
+  for (i = 0; i < list->n_names; i++)
+  {
+    if (strcmp(list->names[i], name) == 0)
+      return 1;
+  }
+
+  char **names = (char **)realloc(list->names, (list->n_names + 1) * sizeof(char *));
+  if (names == NULL)
+    return -1;
+  list->names = names;
+
+  list->names[list->n_names] = (char *)malloc(strlen(name) + 1);
+  if (list->names[list->n_names] == NULL)
+    return -1;
+  strcpy(list->names[list->n_names], name);
+  list->n_names++;
+
+  return 0;
+}
+
+static void genNamesRelease(GenNames *list)
+{
+  int i;
+  for (i = 0; i < list->n_names; i++)
+    free(list->names[i]);
+  free(list->names);
+  list->names = NULL;
+  list->n_names = 0;
+}
+
+// Appends the definitions of the message types used by def, in the format of gendeps --cat
+static int genAppendDependencies(DynString *text, cRosMessageDef *def, GenNames *visited)
+{
+  msgFieldDef *field;
+  for (field = def->first_field; field->next != NULL; field = field->next)
+  {
+    const char *type_s;
+    if (field->type == CROS_STD_MSGS_HEADER)
+      type_s = HEADER_DEFAULT_TYPE;
+    else if (field->type == CROS_CUSTOM_TYPE)
+      type_s = field->type_s;
+    else
+      continue;
+
+    int rc = genNamesAdd(visited, type_s);
+    if (rc == 1)
+      continue;
+    if (rc == -1)
+      return -1;
+
+    dynStringPushBackStr(text, "\n");
+    int i;
+    for (i = 0; i < 80; i++)
+      dynStringPushBackChar(text, '=');
+    dynStringPushBackStr(text, "\nMSG: ");
+    dynStringPushBackStr(text, type_s);
+    dynStringPushBackStr(text, "\n");
+
+    if (field->type == CROS_STD_MSGS_HEADER)
+    {
+      dynStringPushBackStr(text, HEADER_DEFAULT_TYPEDEF);
+      continue;
+    }
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s.%s", def->root_dir, type_s, FILEEXT_MSG);
+    cRosMessage dep;
+    cRosMessageInit(&dep);
+    if (cRosMessageBuild(&dep, path) != 0)
+    {
+      PRINT_ERROR("cRosGentoolsGenerateC() : Can't load the message %s\n", path);
+      cRosMessageRelease(&dep);
+      return -1;
+    }
+
+    dynStringPushBackStr(text, dep.msgDef->plain_text);
+    rc = genAppendDependencies(text, dep.msgDef, visited);
+    cRosMessageRelease(&dep);
+    if (rc == -1)
+      return -1;
+  }
+
+  return 0;
+}
+
+static FILE * genOpenHeader(GenContext *ctx, const char *package, const char *name)
+{
+  char path[1024];
+  snprintf(path, sizeof(path), "%s/%s", ctx->output_dir, package);
+  if (mkdir(path, 0755) != 0 && errno != EEXIST)
+  {
+    PRINT_ERROR("cRosGentoolsGenerateC() : Can't create the directory %s\n", path);
+    return NULL;
+  }
+
+  snprintf(path, sizeof(path), "%s/%s/%s.h", ctx->output_dir, package, name);
+  FILE *f = fopen(path, "w");
+  if (f == NULL)
+    PRINT_ERROR("cRosGentoolsGenerateC() : Can't write the file %s\n", path);
+
+  return f;
+}
+
+static void genStringLiteral(FILE *f, const char *text)
+{
+  if (text == NULL || *text == '\0')
+  {
+    fprintf(f, "\"\"");
+    return;
+  }
+
+  fprintf(f, "\\\n  \"");
+  const char *it;
+  for (it = text; *it != '\0'; it++)
+  {
+    switch (*it)
+    {
+      case '\\':
+        fprintf(f, "\\\\");
+        break;
+      case '"':
+        fprintf(f, "\\\"");
+        break;
+      case '\r':
+        break;
+      case '\t':
+        fprintf(f, "\\t");
+        break;
+      case '\n':
+        fprintf(f, "\\n\"");
+        if (*(it + 1) != '\0')
+          fprintf(f, " \\\n  \"");
+        break;
+      default:
+        fputc(*it, f);
+        break;
+    }
+  }
+
+  if (*(it - 1) != '\n')
+    fprintf(f, "\"");
+}
+
+// Emits the includes of the message types used by the fields, generating them first
+static int genDependencies(GenContext *ctx, FILE *f, cRosMessageDef *def)
+{
+  if (def == NULL)
+    return 0;
+
+  msgFieldDef *field;
+  for (field = def->first_field; field->next != NULL; field = field->next)
+  {
+    if (field->type != CROS_CUSTOM_TYPE)
+      continue;
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s.%s", def->root_dir, field->type_s, FILEEXT_MSG);
+    if (generateMsgHeader(ctx, path) == -1)
+      return -1;
+
+    fprintf(f, "#include \"%s.h\"\n", field->type_s);
+  }
+
+  return 0;
+}
+
+static void genConstants(FILE *f, cRosMessageDef *def, const char *symbol)
+{
+  if (def == NULL)
+    return;
+
+  msgConst *c;
+  for (c = def->first_const; c->next != NULL; c = c->next)
+  {
+    if (c->type == CROS_STD_MSGS_STRING)
+    {
+      fprintf(f, "#define %s_%s ", symbol, c->name);
+      genStringLiteral(f, c->value);
+      fprintf(f, "\n");
+    }
+    else if (genFixedCType(c->type) != NULL)
+    {
+      fprintf(f, "#define %s_%s ((%s)%s)\n", symbol, c->name, genFixedCType(c->type), c->value);
+    }
+  }
+}
+
+static void genStruct(FILE *f, cRosMessageDef *def, const char *symbol)
+{
+  fprintf(f, "typedef struct %s %s;\n\n", symbol, symbol);
+  fprintf(f, "struct %s\n{\n", symbol);
+
+  int n_fields = 0;
+  msgFieldDef *field;
+  for (field = def != NULL ? def->first_field : NULL; field != NULL && field->next != NULL; field = field->next)
+  {
+    char ctype[256];
+    genElementCType(field, ctype, sizeof(ctype));
+    if (!field->is_array)
+      fprintf(f, "  %s%s;\n", ctype, field->name);
+    else if (field->array_size != -1)
+      fprintf(f, "  %s%s[%d];\n", ctype, field->name, field->array_size);
+    else
+      fprintf(f, "  %s*%s;\n  uint32_t %s_size;\n", ctype, field->name, field->name);
+    n_fields++;
+  }
+
+  if (n_fields == 0)
+    fprintf(f, "  uint8_t unused_;                   //! The message has no fields\n");
+
+  fprintf(f, "};\n\n");
+}
+
+// Emits the operation on a single string, header or nested message
+static void genElementOp(FILE *f, GenOp op, msgFieldDef *field, const char *elem, const char *indent)
+{
+  char symbol[256];
+  if (field->type == CROS_CUSTOM_TYPE)
+    genSymbol(field->type_s, symbol, sizeof(symbol));
+
+  GenKind kind = genFieldKind(field->type);
+  switch (op)
+  {
+    case GEN_OP_SIZE:
+      if (kind == GEN_KIND_STRING)
+        fprintf(f, "%ssize += cRosCodecStringSize(%s);\n", indent, elem);
+      else if (kind == GEN_KIND_HEADER)
+        fprintf(f, "%ssize += cRosCodecHeaderSize(&%s);\n", indent, elem);
+      else
+        fprintf(f, "%ssize += %s_size(&%s);\n", indent, symbol, elem);
+      break;
+    case GEN_OP_WRITE:
+      if (kind == GEN_KIND_STRING)
+        fprintf(f, "%sout = cRosCodecWriteString(out, %s);\n", indent, elem);
+      else if (kind == GEN_KIND_HEADER)
+        fprintf(f, "%sout = cRosCodecWriteHeader(out, &%s);\n", indent, elem);
+      else
+        fprintf(f, "%sout = %s_write(out, &%s);\n", indent, symbol, elem);
+      break;
+    case GEN_OP_READ:
+      if (kind == GEN_KIND_STRING)
+        fprintf(f, "%sif (cRosCodecReadString(buffer, &%s) == -1)\n", indent, elem);
+      else if (kind == GEN_KIND_HEADER)
+        fprintf(f, "%sif (cRosCodecReadHeader(buffer, &%s) == -1)\n", indent, elem);
+      else
+        fprintf(f, "%sif (%s_deserialize(&%s, buffer) == -1)\n", indent, symbol, elem);
+      fprintf(f, "%s  return -1;\n", indent);
+      break;
+    case GEN_OP_RELEASE:
+      if (kind == GEN_KIND_STRING)
+        fprintf(f, "%sfree(%s);\n", indent, elem);
+      else if (kind == GEN_KIND_HEADER)
+        fprintf(f, "%scRosCodecReleaseHeader(&%s);\n", indent, elem);
+      else
+        fprintf(f, "%s%s_release(&%s);\n", indent, symbol, elem);
+      break;
+  }
+}
+
+static void genFieldOp(FILE *f, GenOp op, msgFieldDef *field)
+{
+  const char *name = field->name;
+  GenKind kind = genFieldKind(field->type);
+  char elem[300];
+
+  if (kind == GEN_KIND_FIXED)
+  {
+    const char *ctype = genFixedCType(field->type);
+    int is_var_array = field->is_array && field->array_size == -1;
+    switch (op)
+    {
+      case GEN_OP_SIZE:
+        // The scalars and the fixed arrays are in the constant part of the size
+        if (is_var_array)
+          fprintf(f, "  size += msg->%s_size * sizeof(%s);\n", name, ctype);
+        break;
+      case GEN_OP_WRITE:
+        if (is_var_array)
+        {
+          fprintf(f, "  out = cRosCodecWriteUInt32(out, msg->%s_size);\n", name);
+          fprintf(f, "  out = cRosCodecWriteBuf(out, msg->%s, msg->%s_size * sizeof(%s));\n", name, name, ctype);
+        }
+        else if (field->is_array)
+          fprintf(f, "  out = cRosCodecWriteBuf(out, msg->%s, sizeof(msg->%s));\n", name, name);
+        else
+          fprintf(f, "  out = cRosCodecWriteBuf(out, &msg->%s, sizeof(msg->%s));\n", name, name);
+        break;
+      case GEN_OP_READ:
+        if (is_var_array)
+          fprintf(f, "  if (cRosCodecReadArray(buffer, (void **)&msg->%s, &msg->%s_size, sizeof(%s)) == -1)\n",
+                  name, name, ctype);
+        else if (field->is_array)
+          fprintf(f, "  if (cRosCodecRead(buffer, msg->%s, sizeof(msg->%s)) == -1)\n", name, name);
+        else
+          fprintf(f, "  if (cRosCodecRead(buffer, &msg->%s, sizeof(msg->%s)) == -1)\n", name, name);
+        fprintf(f, "    return -1;\n");
+        break;
+      case GEN_OP_RELEASE:
+        if (is_var_array)
+          fprintf(f, "  free(msg->%s);\n", name);
+        break;
+    }
+    return;
+  }
+
+  if (!field->is_array)
+  {
+    snprintf(elem, sizeof(elem), "msg->%s", name);
+    genElementOp(f, op, field, elem, "  ");
+    return;
+  }
+
+  snprintf(elem, sizeof(elem), "msg->%s[i]", name);
+  if (field->array_size != -1)
+  {
+    fprintf(f, "  for (i = 0; i < %d; i++)\n  {\n", field->array_size);
+    genElementOp(f, op, field, elem, "    ");
+    fprintf(f, "  }\n");
+    return;
+  }
+
+  switch (op)
+  {
+    case GEN_OP_SIZE:
+    case GEN_OP_WRITE:
+      if (op == GEN_OP_WRITE)
+        fprintf(f, "  out = cRosCodecWriteUInt32(out, msg->%s_size);\n", name);
+      fprintf(f, "  for (i = 0; i < msg->%s_size; i++)\n", name);
+      genElementOp(f, op, field, elem, "    ");
+      break;
+    case GEN_OP_RELEASE:
+      if (kind == GEN_KIND_STRING)
+      {
+        fprintf(f, "  cRosCodecReleaseStringArray(msg->%s, msg->%s_size);\n", name, name);
+        break;
+      }
+      fprintf(f, "  for (i = 0; i < msg->%s_size; i++)\n", name);
+      genElementOp(f, op, field, elem, "    ");
+      fprintf(f, "  free(msg->%s);\n", name);
+      break;
+    case GEN_OP_READ:
+      if (kind == GEN_KIND_STRING)
+      {
+        fprintf(f, "  if (cRosCodecReadStringArray(buffer, &msg->%s, &msg->%s_size) == -1)\n", name, name);
+        fprintf(f, "    return -1;\n");
+        break;
+      }
+      // The elements of the previous message are reused
+      fprintf(f, "  if (cRosCodecReadArraySize(buffer, &size, 0) == -1)\n    return -1;\n");
+      fprintf(f, "  for (i = size; i < msg->%s_size; i++)\n", name);
+      genElementOp(f, GEN_OP_RELEASE, field, elem, "    ");
+      fprintf(f, "  if (size < msg->%s_size)\n    msg->%s_size = size;\n", name, name);
+      fprintf(f, "  if (cRosCodecResizeArray((void **)&msg->%s, size, sizeof(*msg->%s)) == -1)\n    return -1;\n",
+              name, name);
+      fprintf(f, "  for (i = msg->%s_size; i < size; i++)\n", name);
+      fprintf(f, "    memset(&msg->%s[i], 0, sizeof(msg->%s[i]));\n", name, name);
+      fprintf(f, "  msg->%s_size = size;\n", name);
+      fprintf(f, "  for (i = 0; i < size; i++)\n  {\n");
+      genElementOp(f, op, field, elem, "    ");
+      fprintf(f, "  }\n");
+      break;
+  }
+}
+
+// Does the operation need the loop index (and the array size, for the reads)?
+static int genNeedsIndex(cRosMessageDef *def, GenOp op, int for_size)
+{
+  msgFieldDef *field;
+  for (field = def != NULL ? def->first_field : NULL; field != NULL && field->next != NULL; field = field->next)
+  {
+    GenKind kind = genFieldKind(field->type);
+    if (!field->is_array || kind == GEN_KIND_FIXED)
+      continue;
+
+    int is_var_array = field->array_size == -1;
+    if (for_size)
+    {
+      if (op == GEN_OP_READ && is_var_array && kind != GEN_KIND_STRING)
+        return 1;
+      continue;
+    }
+
+    if (!is_var_array || kind != GEN_KIND_STRING || op == GEN_OP_SIZE || op == GEN_OP_WRITE)
+      return 1;
+  }
+
+  return 0;
+}
+
+static void genFieldsOp(FILE *f, cRosMessageDef *def, GenOp op)
+{
+  if (genNeedsIndex(def, op, 0))
+    fprintf(f, "  uint32_t i;\n");
+  if (genNeedsIndex(def, op, 1))
+    fprintf(f, "  uint32_t size;\n");
+
+  msgFieldDef *field;
+  for (field = def != NULL ? def->first_field : NULL; field != NULL && field->next != NULL; field = field->next)
+    genFieldOp(f, op, field);
+}
+
+static void genFunctions(FILE *f, cRosMessageDef *def, const char *symbol)
+{
+  fprintf(f, "static inline void %s_init(%s *msg)\n{\n", symbol, symbol);
+  fprintf(f, "  memset(msg, 0, sizeof(%s));\n}\n\n", symbol);
+
+  fprintf(f, "static inline void %s_release(%s *msg)\n{\n", symbol, symbol);
+  genFieldsOp(f, def, GEN_OP_RELEASE);
+  fprintf(f, "  %s_init(msg);\n}\n\n", symbol);
+
+  // The size of the scalars and fixed arrays is known at generation time
+  size_t constant_size = 0;
+  msgFieldDef *field;
+  for (field = def != NULL ? def->first_field : NULL; field != NULL && field->next != NULL; field = field->next)
+  {
+    if (field->is_array && field->array_size == -1)
+      constant_size += sizeof(uint32_t);
+    else if (genFieldKind(field->type) == GEN_KIND_FIXED)
+      constant_size += getMessageTypeSizeOf(field->type) * (field->is_array ? field->array_size : 1);
+  }
+
+  fprintf(f, "static inline size_t %s_size(const %s *msg)\n{\n", symbol, symbol);
+  fprintf(f, "  size_t size = %zu;\n", constant_size);
+  genFieldsOp(f, def, GEN_OP_SIZE);
+  fprintf(f, "  return size;\n}\n\n");
+
+  fprintf(f, "static inline unsigned char * %s_write(unsigned char *out, const %s *msg)\n{\n", symbol, symbol);
+  genFieldsOp(f, def, GEN_OP_WRITE);
+  fprintf(f, "  return out;\n}\n\n");
+
+  fprintf(f, "static inline int %s_serialize(const %s *msg, DynBuffer *buffer)\n{\n", symbol, symbol);
+  fprintf(f, "  size_t size = %s_size(msg);\n", symbol);
+  fprintf(f, "  unsigned char *out = dynBufferReserve(buffer, size);\n");
+  fprintf(f, "  if (out == NULL)\n    return -1;\n\n");
+  fprintf(f, "  %s_write(out, msg);\n", symbol);
+  fprintf(f, "  dynBufferCommit(buffer, size);\n");
+  fprintf(f, "  return 0;\n}\n\n");
+
+  fprintf(f, "static inline int %s_deserialize(%s *msg, DynBuffer *buffer)\n{\n", symbol, symbol);
+  genFieldsOp(f, def, GEN_OP_READ);
+  fprintf(f, "  return 0;\n}\n\n");
+}
+
+static void genCodec(FILE *f, const char *symbol)
+{
+  fprintf(f, "static inline void %s_codecInit(void *msg) { %s_init((%s *)msg); }\n", symbol, symbol, symbol);
+  fprintf(f, "static inline void %s_codecRelease(void *msg) { %s_release((%s *)msg); }\n", symbol, symbol, symbol);
+  fprintf(f, "static inline int %s_codecSerialize(const void *msg, DynBuffer *buffer) "
+             "{ return %s_serialize((const %s *)msg, buffer); }\n", symbol, symbol, symbol);
+  fprintf(f, "static inline int %s_codecDeserialize(void *msg, DynBuffer *buffer) "
+             "{ return %s_deserialize((%s *)msg, buffer); }\n\n", symbol, symbol, symbol);
+
+  fprintf(f, "static const CrosMessageCodec %s_codec =\n{\n", symbol);
+  fprintf(f, "  %s_TYPE, %s_MD5SUM, %s_DEFINITION, sizeof(%s),\n", symbol, symbol, symbol, symbol);
+  fprintf(f, "  %s_codecInit, %s_codecRelease, %s_codecSerialize, %s_codecDeserialize\n};\n\n",
+          symbol, symbol, symbol, symbol);
+}
+
+static void genHeaderBegin(FILE *f, const char *package, const char *name, const char *ext)
+{
+  fprintf(f, "/* Generated by cRosGentoolsGenerateC() from %s/%s.%s: do not edit */\n\n", package, name, ext);
+  fprintf(f, "#ifndef _CROS_GEN_%s_%s_H_\n#define _CROS_GEN_%s_%s_H_\n\n", package, name, package, name);
+  fprintf(f, "#include <stdint.h>\n#include <stdlib.h>\n#include <string.h>\n\n");
+  fprintf(f, "#include \"cros_api.h\"\n#include \"cros_codec.h\"\n");
+}
+
+static int generateMsgHeader(GenContext *ctx, const char *filename)
+{
+  char package[256], name[256], type_s[512], symbol[512];
+  if (genTypeFromPath(filename, package, name, sizeof(package)) == -1)
+  {
+    PRINT_ERROR("cRosGentoolsGenerateC() : Invalid message path %s\n", filename);
+    return -1;
+  }
+
+  snprintf(type_s, sizeof(type_s), "%s/%s", package, name);
+  int rc = genNamesAdd(&ctx->generated, type_s);
+  if (rc != 0)
+    return rc == 1 ? 0 : -1;
+
+  cRosMessage msg;
+  cRosMessageInit(&msg);
+  if (cRosMessageBuild(&msg, filename) != 0)
+  {
+    PRINT_ERROR("cRosGentoolsGenerateC() : Can't load the message %s\n", filename);
+    cRosMessageRelease(&msg);
+    return -1;
+  }
+
+  DynString full_text;
+  GenNames visited = { NULL, 0 };
+  dynStringInit(&full_text);
+  dynStringPushBackStr(&full_text, msg.msgDef->plain_text);
+  rc = genAppendDependencies(&full_text, msg.msgDef, &visited);
+  genNamesRelease(&visited);
+
+  FILE *f = rc == 0 ? genOpenHeader(ctx, package, name) : NULL;
+  if (f == NULL)
+  {
+    dynStringRelease(&full_text);
+    cRosMessageRelease(&msg);
+    return -1;
+  }
+
+  genSymbol(type_s, symbol, sizeof(symbol));
+  genHeaderBegin(f, package, name, FILEEXT_MSG);
+  rc = genDependencies(ctx, f, msg.msgDef);
+
+  fprintf(f, "\n#define %s_TYPE \"%s\"\n", symbol, type_s);
+  fprintf(f, "#define %s_MD5SUM \"%s\"\n", symbol, msg.md5sum);
+  fprintf(f, "#define %s_DEFINITION ", symbol);
+  genStringLiteral(f, dynStringGetData(&full_text));
+  fprintf(f, "\n\n");
+  genConstants(f, msg.msgDef, symbol);
+  fprintf(f, "\n");
+
+  genStruct(f, msg.msgDef, symbol);
+  genFunctions(f, msg.msgDef, symbol);
+  genCodec(f, symbol);
+
+  fprintf(f, "typedef CallbackResponse (*%s_PublisherCallback)(%s *msg, void *context);\n", symbol, symbol);
+  fprintf(f, "typedef CallbackResponse (*%s_SubscriberCallback)(%s *msg, void *context);\n\n", symbol, symbol);
+  int indent = strlen("static inline int ") + strlen(symbol) + strlen("_registerPublisher(");
+  fprintf(f, "static inline int %s_registerPublisher(CrosNode *node, const char *topic_name, int loop_period,\n"
+             "%*s%s_PublisherCallback callback,\n"
+             "%*sNodeStatusCallback status_callback, void *context)\n{\n",
+          symbol, indent, "", symbol, indent, "");
+  fprintf(f, "  return cRosApiRegisterTypedPublisher(node, topic_name, &%s_codec, loop_period,\n"
+             "                                       (TypedPublisherApiCallback)callback, status_callback, context);\n}\n\n",
+          symbol);
+  indent = strlen("static inline int ") + strlen(symbol) + strlen("_registerSubscriber(");
+  fprintf(f, "static inline int %s_registerSubscriber(CrosNode *node, const char *topic_name,\n"
+             "%*s%s_SubscriberCallback callback,\n"
+             "%*sNodeStatusCallback status_callback, void *context)\n{\n",
+          symbol, indent, "", symbol, indent, "");
+  fprintf(f, "  return cRosApiRegisterTypedSubscriber(node, topic_name, &%s_codec,\n"
+             "                                        (TypedSubscriberApiCallback)callback, status_callback, context);\n}\n\n",
+          symbol);
+
+  fprintf(f, "#endif\n");
+  fclose(f);
+
+  dynStringRelease(&full_text);
+  cRosMessageRelease(&msg);
+  return rc;
+}
+
+static int generateSrvHeader(GenContext *ctx, const char *filename)
+{
+  char package[256], name[256], type_s[512], symbol[512], part_symbol[600], part_type[600];
+  if (genTypeFromPath(filename, package, name, sizeof(package)) == -1)
+  {
+    PRINT_ERROR("cRosGentoolsGenerateC() : Invalid service path %s\n", filename);
+    return -1;
+  }
+
+  snprintf(type_s, sizeof(type_s), "%s/%s", package, name);
+  genSymbol(type_s, symbol, sizeof(symbol));
+
+  cRosMessage request, response;
+  char md5sum[33];
+  cRosMessageInit(&request);
+  cRosMessageInit(&response);
+  if (cRosServiceBuildInner(&request, &response, md5sum, filename) != 0)
+  {
+    PRINT_ERROR("cRosGentoolsGenerateC() : Can't load the service %s\n", filename);
+    return -1;
+  }
+
+  FILE *f = genOpenHeader(ctx, package, name);
+  if (f == NULL)
+  {
+    cRosMessageRelease(&request);
+    cRosMessageRelease(&response);
+    return -1;
+  }
+
+  genHeaderBegin(f, package, name, FILEEXT_SRV);
+  int rc = genDependencies(ctx, f, request.msgDef);
+  if (rc == 0)
+    rc = genDependencies(ctx, f, response.msgDef);
+
+  fprintf(f, "\n#define %s_TYPE \"%s\"\n", symbol, type_s);
+  fprintf(f, "#define %s_MD5SUM \"%s\"\n\n", symbol, md5sum);
+
+  // The request and the response are generated as two messages with the md5sum of the service
+  cRosMessage *parts[2] = { &request, &response };
+  const char *suffixes[2] = { "Request", "Response" };
+  int i;
+  for (i = 0; i < 2; i++)
+  {
+    cRosMessageDef *def = parts[i]->msgDef;
+    snprintf(part_symbol, sizeof(part_symbol), "%s_%s", symbol, suffixes[i]);
+    snprintf(part_type, sizeof(part_type), "%s%s", type_s, suffixes[i]);
+
+    fprintf(f, "#define %s_TYPE \"%s\"\n", part_symbol, part_type);
+    fprintf(f, "#define %s_MD5SUM %s_MD5SUM\n", part_symbol, symbol);
+    fprintf(f, "#define %s_DEFINITION ", part_symbol);
+    genStringLiteral(f, def != NULL ? def->plain_text : NULL);
+    fprintf(f, "\n\n");
+    genConstants(f, def, part_symbol);
+    fprintf(f, "\n");
+
+    genStruct(f, def, part_symbol);
+    genFunctions(f, def, part_symbol);
+    genCodec(f, part_symbol);
+  }
+
+  fprintf(f, "static const CrosServiceCodec %s_codec =\n{\n", symbol);
+  fprintf(f, "  %s_TYPE, %s_MD5SUM, &%s_Request_codec, &%s_Response_codec\n};\n\n", symbol, symbol, symbol, symbol);
+
+  fprintf(f, "typedef CallbackResponse (*%s_ProviderCallback)(%s_Request *request, %s_Response *response,\n"
+             "%*svoid *context);\n\n", symbol, symbol, symbol,
+          (int)(strlen("typedef CallbackResponse (*") + strlen(symbol) + strlen("_ProviderCallback)(")), "");
+  int indent = strlen("static inline int ") + strlen(symbol) + strlen("_registerServiceProvider(");
+  fprintf(f, "static inline int %s_registerServiceProvider(CrosNode *node, const char *service_name,\n"
+             "%*s%s_ProviderCallback callback,\n"
+             "%*sNodeStatusCallback status_callback, void *context)\n{\n",
+          symbol, indent, "", symbol, indent, "");
+  fprintf(f, "  return cRosApiRegisterTypedServiceProvider(node, service_name, &%s_codec,\n"
+             "                                             (TypedServiceProviderApiCallback)callback,\n"
+             "                                             status_callback, context);\n}\n\n", symbol);
+
+  fprintf(f, "#endif\n");
+  fclose(f);
+
+  cRosMessageRelease(&request);
+  cRosMessageRelease(&response);
+  return rc;
+}
+
+int cRosGentoolsGenerateC(char* filename, const char *output_dir)
+{
+  GenContext ctx;
+  ctx.output_dir = output_dir;
+  ctx.generated.names = NULL;
+  ctx.generated.n_names = 0;
+
+  const char *file_ext = strrchr(filename, '.');
+  int rc = -1;
+  if (file_ext != NULL && strcmp(file_ext + 1, FILEEXT_MSG) == 0)
+    rc = generateMsgHeader(&ctx, filename);
+  else if (file_ext != NULL && strcmp(file_ext + 1, FILEEXT_SRV) == 0)
+    rc = generateSrvHeader(&ctx, filename);
+  else
+    PRINT_ERROR("cRosGentoolsGenerateC() : Unknown file type %s\n", filename);
+
+  genNamesRelease(&ctx.generated);
+  return rc;
+}
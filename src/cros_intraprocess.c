@@ -0,0 +1,203 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "cros_intraprocess.h"
+#include "cros_subscriber_queue.h"
+#include "cros_defs.h"
+
+// The nodes of the process, see cRosIntraprocessRegisterNode()
+static CrosNode *process_nodes[CN_MAX_INTRAPROCESS_NODES];
+
+int cRosIntraprocessRegisterNode(CrosNode *n)
+{
+  int i;
+  for (i = 0; i < CN_MAX_INTRAPROCESS_NODES; i++)
+  {
+    if (process_nodes[i] == NULL)
+    {
+      process_nodes[i] = n;
+      return 0;
+    }
+  }
+
+  PRINT_ERROR("cRosIntraprocessRegisterNode() : Too many nodes in the process, %s will use TCPROS only\n", n->name);
+  return -1;
+}
+
+void cRosIntraprocessUnregisterNode(CrosNode *n)
+{
+  int i;
+  for (i = 0; i < CN_MAX_PUBLISHED_TOPICS; i++)
+    cRosIntraprocessUnlinkPublisher(n, i);
+
+  for (i = 0; i < CN_MAX_SUBSCRIBED_TOPICS; i++)
+    cRosIntraprocessUnlinkSubscriber(n, i);
+
+  for (i = 0; i < CN_MAX_INTRAPROCESS_NODES; i++)
+  {
+    if (process_nodes[i] == n)
+      process_nodes[i] = NULL;
+  }
+}
+
+CrosNode * cRosIntraprocessFindNode(const char *node_name)
+{
+  int i;
+  for (i = 0; i < CN_MAX_INTRAPROCESS_NODES; i++)
+  {
+    if (process_nodes[i] != NULL && strcmp(process_nodes[i]->name, node_name) == 0)
+      return process_nodes[i];
+  }
+
+  return NULL;
+}
+
+static void enqueuePacket(SubscriberNode *sub, DynBuffer *packet)
+{
+  // A subscriber that doesn't keep up loses the new packets, as with a TCPROS connection still writing
+  if (sub->n_intra_packets == CN_INTRAPROCESS_QUEUE_LENGTH)
+    return;
+
+  if (dynBufferPushBackBuf(&sub->intra_packets, dynBufferGetData(packet), dynBufferGetSize(packet)) == -1)
+  {
+    PRINT_ERROR("cRosIntraprocessPublish() : Can't allocate memory\n");
+    return;
+  }
+
+  sub->n_intra_packets++;
+}
+
+int cRosIntraprocessLink(CrosNode *pub_node, int pub_idx, CrosNode *sub_node, int sub_idx)
+{
+  PublisherNode *pub = &pub_node->pubs[pub_idx];
+  SubscriberNode *sub = &sub_node->subs[sub_idx];
+
+  if (strcmp(pub->topic_type, sub->topic_type) != 0 || strcmp(pub->md5sum, sub->md5sum) != 0)
+  {
+    PRINT_ERROR("cRosIntraprocessLink() : Wrong type or md5sum\n");
+    return -1;
+  }
+
+  // Already linked (e.g., the subscriber requested the topic again)
+  if (sub->intra_pub_node == pub_node && sub->intra_pub_idx == pub_idx)
+    return 0;
+
+  if (pub->n_intra_subs == CN_MAX_INTRAPROCESS_SUBSCRIBERS)
+    return -1;
+
+  cRosIntraprocessUnlinkSubscriber(sub_node, sub_idx);
+
+  pub->intra_subs[pub->n_intra_subs].node = sub_node;
+  pub->intra_subs[pub->n_intra_subs].sub_idx = sub_idx;
+  pub->n_intra_subs++;
+
+  sub->intra_pub_node = pub_node;
+  sub->intra_pub_idx = pub_idx;
+
+  // Latching
+  if (dynBufferGetSize(&pub->packet) > 0)
+    enqueuePacket(sub, &pub->packet);
+
+  return 0;
+}
+
+void cRosIntraprocessUnlinkPublisher(CrosNode *n, int pub_idx)
+{
+  PublisherNode *pub = &n->pubs[pub_idx];
+
+  int i;
+  for (i = 0; i < pub->n_intra_subs; i++)
+  {
+    SubscriberNode *sub = &pub->intra_subs[i].node->subs[pub->intra_subs[i].sub_idx];
+    sub->intra_pub_node = NULL;
+    sub->intra_pub_idx = -1;
+    // Wait for a new publisher, as when the TCPROS connection is dropped
+    sub->tcpros_port = -1;
+  }
+
+  pub->n_intra_subs = 0;
+}
+
+void cRosIntraprocessUnlinkSubscriber(CrosNode *n, int sub_idx)
+{
+  SubscriberNode *sub = &n->subs[sub_idx];
+
+  dynBufferClear(&sub->intra_packets);
+  sub->n_intra_packets = 0;
+
+  if (sub->intra_pub_node == NULL)
+    return;
+
+  PublisherNode *pub = &sub->intra_pub_node->pubs[sub->intra_pub_idx];
+  int i;
+  for (i = 0; i < pub->n_intra_subs; i++)
+  {
+    if (pub->intra_subs[i].node == n && pub->intra_subs[i].sub_idx == sub_idx)
+    {
+      pub->intra_subs[i] = pub->intra_subs[pub->n_intra_subs - 1];
+      pub->n_intra_subs--;
+      break;
+    }
+  }
+
+  sub->intra_pub_node = NULL;
+  sub->intra_pub_idx = -1;
+}
+
+void cRosIntraprocessPublish(CrosNode *n, int pub_idx)
+{
+  PublisherNode *pub = &n->pubs[pub_idx];
+
+  int i;
+  for (i = 0; i < pub->n_intra_subs; i++)
+    enqueuePacket(&pub->intra_subs[i].node->subs[pub->intra_subs[i].sub_idx], &pub->packet);
+}
+
+int cRosIntraprocessDispatch(CrosNode *n)
+{
+  int count = 0;
+
+  int i;
+  for (i = 0; i < CN_MAX_SUBSCRIBED_TOPICS; i++)
+  {
+    SubscriberNode *sub = &n->subs[i];
+    if (sub->n_intra_packets == 0)
+      continue;
+
+    DynBuffer *packets = &sub->intra_packets;
+    while (sub->n_intra_packets > 0 && dynBufferGetRemainingDataSize(packets) >= sizeof(uint32_t))
+    {
+      const unsigned char *data = dynBufferGetCurrentData(packets);
+      uint32_t msg_size = 0;
+      ROS_TO_HOST_UINT32( *((uint32_t *)data), msg_size );
+      dynBufferMovePoseIndicator(packets, sizeof(uint32_t) + msg_size);
+      sub->n_intra_packets--;
+
+      DynBuffer msg;
+      dynBufferInitView(&msg, data + sizeof(uint32_t), msg_size);
+      cRosSubscriberQueueDeliver(n, i, &msg);
+      count++;
+
+      // The callback may have unsubscribed
+      if (sub->n_intra_packets == 0)
+        break;
+    }
+
+    dynBufferClear(packets);
+    sub->n_intra_packets = 0;
+  }
+
+  return count;
+}
+
+int cRosIntraprocessHasPending(CrosNode *n)
+{
+  int i;
+  for (i = 0; i < CN_MAX_SUBSCRIBED_TOPICS; i++)
+  {
+    if (n->subs[i].n_intra_packets > 0)
+      return 1;
+  }
+
+  return 0;
+}
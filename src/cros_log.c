@@ -7,123 +7,110 @@
 #include "cros_log.h"
 #include "cros_defs.h"
 #include "cros_node.h"
+#include "cros_clock.h"
 
-CrosLog * cRosLogNew()
-{
-  CrosLog *ret = (CrosLog *)malloc(sizeof(CrosLog));
-  ret->file = NULL;
-  ret->level = CROS_LOGLEVEL_INFO;
-  ret->function = NULL;
-  ret->msg = NULL;
-  ret->name = NULL;
-  ret->pubs = NULL;
-  ret->n_pubs = 0;
-  return ret;
-}
+// Starts at 1, so that the zero-initialized sites are updated at their first call
+uint32_t cRosLogGeneration = 1;
 
-void cRosLogFree(CrosLog *log)
+int cRosLogRingInit(CrosLogRing *ring, size_t capacity)
 {
-  free(log->file);
-  free(log->function);
-  free(log->msg);
-  free(log->name);
-  int i;
-  for(i = 0; i < log->n_pubs; i++)
+  ring->head = 0;
+  ring->count = 0;
+  ring->dropped = 0;
+  ring->capacity = capacity;
+  ring->records = (CrosLog *)calloc(capacity, sizeof(CrosLog));
+  if (ring->records == NULL)
   {
-    free(log->pubs[i]);
+    PRINT_ERROR("cRosLogRingInit() : Can't allocate memory\n");
+    ring->capacity = 0;
+    return -1;
   }
-  free(log->pubs);
-  free(log);
-}
 
-CrosLogQueue* cRosLogQueueNew()
-{
-  CrosLogQueue* new_queue = calloc(1,sizeof(CrosLogQueue));
-  cRosLogQueueInit(new_queue);
-  return new_queue;
+  return 0;
 }
 
-void cRosLogQueueInit(CrosLogQueue *queue)
+void cRosLogRingRelease(CrosLogRing *ring)
 {
-  queue->tail = NULL;
-  queue->head = NULL;
-  queue->count = 0;
+  free(ring->records);
+  ring->records = NULL;
+  ring->capacity = 0;
+  ring->head = 0;
+  ring->count = 0;
 }
 
-CrosLog * cRosLogQueuePeek(CrosLogQueue *queue)
+CrosLog * cRosLogRingPush(CrosLogRing *ring)
 {
-  if (queue->head == NULL)
+  if (ring->capacity == 0)
     return NULL;
 
-  return queue->head->call;
-}
-
-int cRosLogQueueEnqueue(CrosLogQueue *queue, CrosLog* CrosLog)
-{
-  CrosLogNode* node = malloc(sizeof(CrosLogNode));
-
-  if(node == NULL)
+  if (ring->count == ring->capacity)
   {
-    PRINT_ERROR("enqueueCrosLog() : Can't enqueue call\n");
-    return -1;
+    // Drop the oldest record
+    ring->head = (ring->head + 1) % ring->capacity;
+    ring->count--;
+    ring->dropped++;
   }
 
-  node->call = CrosLog;
-  node->next = NULL;
-
-  if(queue->head == NULL)
-  {
-    queue->head = node;
-    queue->tail = node;
-  }
-  else
-  {
-    queue->tail->next = node;
-    queue->tail = node;
-  }
+  CrosLog *log = &ring->records[(ring->head + ring->count) % ring->capacity];
+  ring->count++;
+  return log;
+}
 
-  queue->count++;
+CrosLog * cRosLogRingPeek(CrosLogRing *ring)
+{
+  if (ring->count == 0)
+    return NULL;
 
-  return 0;
+  return &ring->records[ring->head];
 }
 
-CrosLog * cRosLogQueueDequeue(CrosLogQueue *queue)
+void cRosLogRingPop(CrosLogRing *ring)
 {
-  CrosLogNode* head = queue->head;
-  queue->head = head->next;
-  if(queue->head == NULL)
-    queue->tail = queue->head;
+  if (ring->count == 0)
+    return;
 
-  CrosLog *call = head->call;
-  free(head);
+  ring->head = (ring->head + 1) % ring->capacity;
+  ring->count--;
+}
 
-  queue->count--;
+size_t cRosLogRingCount(CrosLogRing *ring)
+{
+  return ring->count;
+}
 
-  return call;
+int cRosLogRingIsEmpty(CrosLogRing *ring)
+{
+  return ring->count == 0;
 }
 
-void cRosLogQueueRelease(CrosLogQueue *queue)
+int cRosLogSiteUpdate(CrosLogSite *site, const CrosNode *node, CrosLogLevel level)
 {
-  CrosLogNode *current = queue->head;
-  while(current != NULL)
-  {
-    cRosLogFree(current->call);
-    CrosLogNode *next = current->next;
-    free(current);
-    current = next;
-  }
+  site->owner = node;
+  site->generation = cRosLogGeneration;
+  // Without a node, everything is printed on the console
+  site->enabled = node == NULL || level >= node->log_level;
+  return site->enabled;
+}
 
-  cRosLogQueueInit(queue);
+int cRosLogSiteThrottle(CrosLogSite *site, double period)
+{
+  uint64_t now = cRosClockGetTimeMs();
+  if (site->last_time_ms != 0 && now < site->last_time_ms + (uint64_t)(period * 1000.0))
+    return 0;
+
+  site->last_time_ms = now;
+  return 1;
 }
 
-size_t cRosLogQueueCount(CrosLogQueue *queue)
+void cRosLogSetLevel(CrosNode *node, CrosLogLevel level)
 {
-  return queue->count;
+  node->log_level = level;
+  cRosLogGeneration++;
 }
 
-int cRosLogQueueIsEmpty(CrosLogQueue *queue)
+uint64_t cRosLogGetDropped(CrosNode *node)
 {
-  return queue->count == 0;
+  return node->log_ring.dropped;
 }
 
 void cRosLogPrint(CrosNode* node,
@@ -133,23 +120,19 @@ void cRosLogPrint(CrosNode* node,
                   uint32_t line,
                   const char* msg, ...)      // message
 {
-  char* log_msg = NULL;
   va_list args;
-  va_start(args,msg);
-
-  time_t wall_time;
-
-  time(&wall_time);
+  struct timespec now;
 
+  clock_gettime(CLOCK_REALTIME, &now);
 
   if(node == NULL)
   {
+    char log_msg[CN_LOG_MAX_MSG_SIZE];
+    va_start(args,msg);
+    vsnprintf(log_msg, sizeof(log_msg), msg, args);
+    va_end(args);
 
-    printf("\n[%d,%d] ", (int)wall_time, 0);
-    size_t msg_size = strlen(msg) + 512;
-
-    log_msg = calloc(msg_size + 1, sizeof(char));
-    vsprintf(log_msg,msg,args);
+    printf("\n[%d,%d] ", (int)now.tv_sec, 0);
 
     switch(level)
     {
@@ -172,48 +155,28 @@ void cRosLogPrint(CrosNode* node,
       }
     }
 
-    va_end(args);
-    free(log_msg);
     return;
   }
 
-  if(level != node->log_level &&
-      (level != CROS_LOGLEVEL_ERROR || level != CROS_LOGLEVEL_FATAL))
+  // The macros already filter the levels, not the direct callers
+  if(level < node->log_level)
     return;
 
-  CrosLog* log = cRosLogNew();
-
-  log->secs = wall_time;
-  log->nsecs = 0;
+  // The message is formatted once, in place: nothing is allocated
+  CrosLog* log = cRosLogRingPush(&node->log_ring);
+  if(log == NULL)
+    return;
 
+  log->secs = (uint32_t)now.tv_sec;
+  log->nsecs = (uint32_t)now.tv_nsec;
   log->level = level;
-
-  log->file =  calloc(strlen(file)+1, sizeof(char));
-  strncpy(log->file, file,strlen(file));
-
-  log->function =  calloc(strlen(function)+1, sizeof(char));
-  strncpy(log->function, function,strlen(function));
-
+  log->file = file;
+  log->function = function;
   log->line = line;
 
-  int i;
-  log->n_pubs = node->n_pubs;
-  log->pubs = (char**) calloc(log->n_pubs,sizeof(char*));
-
-  for(i = 0; i <node->n_pubs; i++)
-  {
-    log->pubs[i] = calloc(strlen(node->pubs[i].topic_name) + 1, sizeof(char));
-    strncpy(log->pubs[i], node->pubs[i].topic_name,strlen(node->pubs[i].topic_name));
-  }
-
-  printf("\n[%d,%d] ",log->secs, log->nsecs);
-
-  size_t msg_size = vprintf(msg,args) + 512;
-
-  log_msg = calloc(msg_size + 1, sizeof(char));
-  vsprintf(log_msg,msg,args);
-  log->msg = log_msg;
-
+  va_start(args,msg);
+  vsnprintf(log->msg, sizeof(log->msg), msg, args);
   va_end(args);
-  cRosLogQueueEnqueue(node->log_queue, log);
+
+  printf("\n[%d,%d] %s", log->secs, log->nsecs, log->msg);
 }
@@ -0,0 +1,273 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "cros_lookup_cache.h"
+#include "cros_clock.h"
+#include "cros_defs.h"
+
+static uint32_t hashKey(CrosLookupCacheKind kind, const char *key)
+{
+  // FNV-1a, seeded with the lookup kind
+  uint32_t hash = 2166136261u ^ (uint32_t)kind;
+  while (*key != '\0')
+  {
+    hash ^= (unsigned char)*key++;
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
+
+static void releaseEntry(CrosLookupCacheEntry *entry)
+{
+  if (entry->kind == CROS_LOOKUP_CACHE_NONE)
+    return;
+
+  free(entry->key);
+  entry->key = NULL;
+  xmlrpcParamRelease(&entry->response);
+  entry->kind = CROS_LOOKUP_CACHE_NONE;
+  entry->hash = 0;
+  entry->expire_time = 0;
+}
+
+static CrosLookupCacheEntry * findEntry(CrosLookupCache *cache, CrosLookupCacheKind kind,
+                                        const char *key, uint32_t hash)
+{
+  int it;
+  for (it = 0; it < CROS_LOOKUP_CACHE_PROBES; it++)
+  {
+    CrosLookupCacheEntry *entry = &cache->entries[(hash + it) & (CROS_LOOKUP_CACHE_SIZE - 1)];
+    if (entry->kind == kind && entry->hash == hash && strcmp(entry->key, key) == 0)
+      return entry;
+  }
+
+  return NULL;
+}
+
+// Returns the URI (third element of the response array) of a node or service entry
+static const char * getEntryUri(CrosLookupCacheEntry *entry)
+{
+  if (entry->kind != CROS_LOOKUP_CACHE_NODE && entry->kind != CROS_LOOKUP_CACHE_SERVICE)
+    return NULL;
+
+  XmlrpcParam *uri = xmlrpcParamArrayGetParamAt(&entry->response, 2);
+  if (uri == NULL || xmlrpcParamGetType(uri) != XMLRPC_PARAM_STRING)
+    return NULL;
+
+  return xmlrpcParamGetString(uri);
+}
+
+void cRosLookupCacheInit(CrosLookupCache *cache)
+{
+  int it;
+  for (it = 0; it < CROS_LOOKUP_CACHE_SIZE; it++)
+  {
+    CrosLookupCacheEntry *entry = &cache->entries[it];
+    entry->kind = CROS_LOOKUP_CACHE_NONE;
+    entry->key = NULL;
+    entry->hash = 0;
+    xmlrpcParamInit(&entry->response);
+    entry->expire_time = 0;
+  }
+
+  cache->ttl = CROS_LOOKUP_CACHE_TTL;
+  cache->hits = 0;
+  cache->misses = 0;
+}
+
+void cRosLookupCacheRelease(CrosLookupCache *cache)
+{
+  cRosLookupCacheClear(cache);
+}
+
+XmlrpcParam * cRosLookupCacheGet(CrosLookupCache *cache, CrosLookupCacheKind kind, const char *key)
+{
+  if (cache->ttl == 0)
+    return NULL;
+
+  CrosLookupCacheEntry *entry = findEntry(cache, kind, key, hashKey(kind, key));
+  if (entry == NULL)
+  {
+    cache->misses++;
+    return NULL;
+  }
+
+  if (entry->expire_time <= cRosClockGetTimeMs())
+  {
+    releaseEntry(entry);
+    cache->misses++;
+    return NULL;
+  }
+
+  cache->hits++;
+  return &entry->response;
+}
+
+int cRosLookupCacheStore(CrosLookupCache *cache, CrosLookupCacheKind kind, const char *key, XmlrpcParam *response)
+{
+  if (cache->ttl == 0)
+    return 0;
+
+  uint32_t hash = hashKey(kind, key);
+  uint64_t cur_time = cRosClockGetTimeMs();
+
+  CrosLookupCacheEntry *entry = findEntry(cache, kind, key, hash);
+  if (entry == NULL)
+  {
+    // Take the first free or expired slot, otherwise evict the oldest one
+    int it;
+    for (it = 0; it < CROS_LOOKUP_CACHE_PROBES; it++)
+    {
+      CrosLookupCacheEntry *candidate = &cache->entries[(hash + it) & (CROS_LOOKUP_CACHE_SIZE - 1)];
+      if (candidate->kind == CROS_LOOKUP_CACHE_NONE || candidate->expire_time <= cur_time)
+      {
+        entry = candidate;
+        break;
+      }
+
+      if (entry == NULL || candidate->expire_time < entry->expire_time)
+        entry = candidate;
+    }
+  }
+
+  XmlrpcParam copy;
+  char *key_copy = (char *)malloc(strlen(key) + 1);
+  if (key_copy == NULL)
+  {
+    PRINT_ERROR("cRosLookupCacheStore() : Can't allocate memory\n");
+    return -1;
+  }
+  strcpy(key_copy, key);
+
+  if (xmlrpcParamCopy(&copy, response) == -1)
+  {
+    PRINT_ERROR("cRosLookupCacheStore() : Can't copy the response\n");
+    free(key_copy);
+    return -1;
+  }
+
+  releaseEntry(entry);
+  entry->kind = kind;
+  entry->key = key_copy;
+  entry->hash = hash;
+  entry->response = copy;
+  entry->expire_time = cur_time + cache->ttl;
+
+  return 0;
+}
+
+void cRosLookupCacheInvalidate(CrosLookupCache *cache, CrosLookupCacheKind kind, const char *key)
+{
+  CrosLookupCacheEntry *entry = findEntry(cache, kind, key, hashKey(kind, key));
+  if (entry != NULL)
+    releaseEntry(entry);
+}
+
+void cRosLookupCacheInvalidateParam(CrosLookupCache *cache, const char *key)
+{
+  size_t key_len = strlen(key);
+
+  int it;
+  for (it = 0; it < CROS_LOOKUP_CACHE_SIZE; it++)
+  {
+    CrosLookupCacheEntry *entry = &cache->entries[it];
+    if (entry->kind != CROS_LOOKUP_CACHE_PARAM)
+      continue;
+
+    // An update of "/a" changes "/a/b", an update of "/a/b" changes the dictionary "/a"
+    size_t entry_len = strlen(entry->key);
+    size_t cmp_len = key_len < entry_len ? key_len : entry_len;
+    if (strncmp(entry->key, key, cmp_len) != 0)
+      continue;
+
+    // The shorter name must end at a name separator of the longer one ("/a" doesn't cover "/ab")
+    const char *longer = key_len < entry_len ? entry->key : key;
+    if (longer[cmp_len] == '\0' || longer[cmp_len] == '/' || (cmp_len > 0 && longer[cmp_len - 1] == '/'))
+      releaseEntry(entry);
+  }
+}
+
+void cRosLookupCacheInvalidateKind(CrosLookupCache *cache, CrosLookupCacheKind kind)
+{
+  int it;
+  for (it = 0; it < CROS_LOOKUP_CACHE_SIZE; it++)
+  {
+    if (cache->entries[it].kind == kind)
+      releaseEntry(&cache->entries[it]);
+  }
+}
+
+// Check if a URI (scheme://host:port, possibly followed by a path) points to host and port
+static int uriMatches(const char *uri, const char *host, int port)
+{
+  const char *host_begin = strstr(uri, "://");
+  if (host_begin == NULL)
+    return 0;
+
+  host_begin += 3;
+  const char *host_end = strchr(host_begin, '/');
+  if (host_end == NULL)
+    host_end = host_begin + strlen(host_begin);
+
+  const char *port_begin = host_end;
+  while (port_begin > host_begin && *port_begin != ':')
+    port_begin--;
+  if (port_begin == host_begin)
+    return 0;
+
+  size_t host_len = port_begin - host_begin;
+  return strlen(host) == host_len && strncmp(host_begin, host, host_len) == 0 &&
+         atoi(port_begin + 1) == port;
+}
+
+void cRosLookupCacheInvalidateUri(CrosLookupCache *cache, const char *host, int port)
+{
+  if (host == NULL)
+    return;
+
+  int it;
+  for (it = 0; it < CROS_LOOKUP_CACHE_SIZE; it++)
+  {
+    const char *uri = getEntryUri(&cache->entries[it]);
+    if (uri != NULL && uriMatches(uri, host, port))
+      releaseEntry(&cache->entries[it]);
+  }
+}
+
+void cRosLookupCacheClear(CrosLookupCache *cache)
+{
+  int it;
+  for (it = 0; it < CROS_LOOKUP_CACHE_SIZE; it++)
+    releaseEntry(&cache->entries[it]);
+}
+
+CrosLookupCacheKind cRosLookupCacheCallKey(RosApiCall *call, const char **key)
+{
+  CrosLookupCacheKind kind;
+  switch (call->method)
+  {
+    case CROS_API_LOOKUP_SERVICE:
+      kind = CROS_LOOKUP_CACHE_SERVICE;
+      break;
+    case CROS_API_LOOKUP_NODE:
+      kind = CROS_LOOKUP_CACHE_NODE;
+      break;
+    case CROS_API_GET_PARAM:
+      kind = CROS_LOOKUP_CACHE_PARAM;
+      break;
+    case CROS_API_GET_TOPIC_TYPES:
+      *key = "";
+      return CROS_LOOKUP_CACHE_TOPIC_TYPES;
+    default:
+      return CROS_LOOKUP_CACHE_NONE;
+  }
+
+  // params: [caller_id, key]
+  XmlrpcParam *key_param = xmlrpcParamVectorAt(&call->params, 1);
+  if (key_param == NULL || xmlrpcParamGetType(key_param) != XMLRPC_PARAM_STRING)
+    return CROS_LOOKUP_CACHE_NONE;
+
+  *key = xmlrpcParamGetString(key_param);
+  return kind;
+}
@@ -15,6 +15,10 @@
 static void * arrayFieldValueAt(cRosMessageField *field, int position, size_t element_size);
 static const char * getMessageTypeDeclarationConst(msgConst *msgConst);
 static const char * getMessageTypeDeclarationField(msgFieldDef *fieldDef);
+static cRosMessage * newFieldMessage(const char *root_dir, const char *type_s);
+static int detachArenaData(cRosMessageField *field);
+static int growArrayField(cRosMessageField *field, size_t element_size);
+static void deserializeMessage(cRosMessage *message, DynBuffer *buffer, CrosArena *arena);
 
 char* base_msg_type(const char* type)
 {
@@ -581,6 +585,7 @@ void cRosMessageFieldInit(cRosMessageField *field)
   field->is_fixed_array = 0;
   field->array_size = -1;
   field->array_capacity = -1;
+  field->is_arena_data = 0;
   memset(field->data.opaque, 0, sizeof(field->data.opaque));
 }
 
@@ -712,7 +717,13 @@ int loadFromStringMsg(char* text, cRosMessageDef* msg)
                   current->type_s = entry_type;
                   entry_type = NULL;
                 }
-                current->value = entry_const_val;
+                // The value points into entry_name: it needs its own storage
+                current->value = NULL;
+                if (entry_const_val != NULL)
+                {
+                  current->value = (char*) calloc(strlen(entry_const_val) + 1, sizeof(char));
+                  strcpy(current->value, entry_const_val);
+                }
                 current->next = (msgConst*)malloc(sizeof(msgConst));
                 msgConst* next = current->next;
                 initMsgConst(next);
@@ -998,20 +1009,7 @@ void cRosMessageBuildFromDef(cRosMessage* message, cRosMessageDef* msg_def )
       case CROS_CUSTOM_TYPE:
       {
         if(!field_def_itr->is_array)
-        {
-          field->data.as_msg = malloc(sizeof(cRosMessage));
-          cRosMessageInit((cRosMessage*)field->data.as_msg);
-          char* path = calloc(strlen(msg_def->root_dir) +
-                              strlen(DIR_SEPARATOR_STR) +
-                              strlen(field_def_itr->type_s) +
-                              strlen(".msg") + 1, // '\0'
-                              sizeof(char));
-          strcat(path, msg_def->root_dir);
-          strcat(path, DIR_SEPARATOR_STR);
-          strcat(path, field_def_itr->type_s);
-          strcat(path, ".msg");
-          cRosMessageBuild((cRosMessage*) field->data.as_msg, path);
-        }
+          field->data.as_msg = newFieldMessage(msg_def->root_dir, field_def_itr->type_s);
         break;
       }
     }
@@ -1159,35 +1157,31 @@ void cRosMessageFieldRelease(cRosMessageField *field)
 
   if(field->is_array)
   {
-    if(field->type != CROS_CUSTOM_TYPE ||
-    field->type != CROS_STD_MSGS_STRING ||
-    field->type != CROS_STD_MSGS_TIME ||
-    field->type != CROS_STD_MSGS_DURATION ||
-    field->type != CROS_STD_MSGS_HEADER)
+    int i;
+    if(field->type == CROS_STD_MSGS_STRING && !field->is_arena_data && field->data.as_string_array != NULL)
     {
-      free(field->data.as_array);
-      field->data.as_array = NULL;
+      for(i = 0; i < field->array_size; i++)
+        free(field->data.as_string_array[i]);
     }
-    else
+    else if(field->type == CROS_CUSTOM_TYPE && field->data.as_msg_array != NULL)
     {
-        int i;
-        uint8_t* it;
-        size_t data_size;
-        for(i = 0; i < field->array_size; i++)
-        {
-          if(field->data.as_string_array)
-          {
-            free(field->data.as_string_array[i]);
-          }
-          else
-          {
-            free(field->data.as_msg_array[i]);
-          }
-        }
-        free(field->data.as_array);
-        field->data.as_array = NULL;
+      // The slots past array_size keep the messages of the previous deserializations
+      for(i = 0; i < field->array_capacity; i++)
+        cRosMessageFree(field->data.as_msg_array[i]);
     }
-   }
+
+    // The storage of fixed size arrays is allocated with the field
+    if(!field->is_arena_data || field->is_fixed_array)
+      free(field->data.as_array);
+    field->data.as_array = NULL;
+  }
+  else if(field->type == CROS_STD_MSGS_STRING)
+  {
+    if(!field->is_arena_data)
+      free(field->data.as_string);
+    field->data.as_string = NULL;
+  }
+  field->is_arena_data = 0;
 }
 
 void cRosMessageFieldFree(cRosMessageField *field)
@@ -1217,39 +1211,261 @@ cRosMessageField* cRosMessageGetField(cRosMessage *message, char *field_name)
   return matching_field;
 }
 
+int cRosMessageGetFieldIndex(cRosMessage *message, const char *field_name)
+{
+  int i;
+  for(i = 0; i < message->n_fields; i++)
+  {
+    if(strcmp(message->fields[i]->name, field_name) == 0)
+      return i;
+  }
+
+  return -1;
+}
+
+cRosMessageField* cRosMessageGetFieldAt(cRosMessage *message, int index)
+{
+  if(index < 0 || index >= message->n_fields)
+    return NULL;
+
+  return message->fields[index];
+}
+
+int cRosMessageFieldPathCompile(cRosMessage *message, const char *path, CrosMessageFieldPath *compiled)
+{
+  compiled->depth = 0;
+
+  // Messages built only to look at the element type of empty arrays
+  cRosMessage *element_msgs[CROS_MESSAGE_FIELD_PATH_MAX_DEPTH];
+  int n_element_msgs = 0;
+  int ret = 0;
+
+  const char *step = path;
+  while (1)
+  {
+    const char *step_end = step + strcspn(step, ".");
+    size_t name_len = step_end - step;
+    int is_element = 0;
+    if (name_len > 2 && strncmp(step_end - 2, "[]", 2) == 0)
+    {
+      is_element = 1;
+      name_len -= 2;
+    }
+
+    if (name_len == 0 || name_len >= 256 || compiled->depth == CROS_MESSAGE_FIELD_PATH_MAX_DEPTH)
+    {
+      PRINT_ERROR("cRosMessageFieldPathCompile() : Invalid path %s\n", path);
+      ret = -1;
+      break;
+    }
+
+    char name[256];
+    memcpy(name, step, name_len);
+    name[name_len] = '\0';
+
+    int idx = (message != NULL) ? cRosMessageGetFieldIndex(message, name) : -1;
+    if (idx == -1)
+    {
+      PRINT_ERROR("cRosMessageFieldPathCompile() : Field %s of path %s not found\n", name, path);
+      ret = -1;
+      break;
+    }
+
+    cRosMessageField *field = message->fields[idx];
+    compiled->indexes[compiled->depth] = idx;
+    compiled->is_element[compiled->depth] = is_element;
+    compiled->depth++;
+
+    if (is_element && (!field->is_array || isBuiltinMessageType(field->type)))
+    {
+      PRINT_ERROR("cRosMessageFieldPathCompile() : Field %s of path %s is not a message array\n", name, path);
+      ret = -1;
+      break;
+    }
+
+    if (*step_end == '\0')
+    {
+      if (is_element)
+      {
+        // The path must end on a field
+        PRINT_ERROR("cRosMessageFieldPathCompile() : Invalid path %s\n", path);
+        ret = -1;
+      }
+      break;
+    }
+
+    // Move to the message holding the next step
+    if (is_element)
+    {
+      if (field->array_size > 0)
+      {
+        message = field->data.as_msg_array[0];
+      }
+      else if (message->msgDef != NULL && field->type_s != NULL)
+      {
+        message = newFieldMessage(message->msgDef->root_dir, field->type_s);
+        if (message != NULL)
+          element_msgs[n_element_msgs++] = message;
+      }
+      else
+      {
+        message = NULL;
+      }
+    }
+    else if (!field->is_array && (!isBuiltinMessageType(field->type) ||
+                                  field->type == CROS_STD_MSGS_TIME ||
+                                  field->type == CROS_STD_MSGS_DURATION))
+    {
+      message = field->data.as_msg;
+    }
+    else
+    {
+      message = NULL;
+    }
+
+    step = step_end + 1;
+  }
+
+  while (n_element_msgs > 0)
+    cRosMessageFree(element_msgs[--n_element_msgs]);
+
+  if (ret == -1)
+    compiled->depth = 0;
+
+  return ret;
+}
+
+cRosMessageField* cRosMessageFieldPathGet(cRosMessage *message, const CrosMessageFieldPath *path,
+                                          const int *elements)
+{
+  cRosMessageField *field = NULL;
+
+  int level;
+  for (level = 0; level < path->depth; level++)
+  {
+    field = message->fields[path->indexes[level]];
+    if (level + 1 == path->depth)
+      break;
+
+    // Move to the message holding the next step
+    if (path->is_element[level])
+    {
+      int element = *elements++;
+      if (element < 0 || element >= field->array_size)
+        return NULL;
+
+      message = field->data.as_msg_array[element];
+    }
+    else
+    {
+      message = field->data.as_msg;
+    }
+  }
+
+  return field;
+}
+
 int cRosMessageSetFieldValueString(cRosMessageField* field, const char* value)
 {
   if (field->type != CROS_STD_MSGS_STRING)
     return -1;
 
   size_t len = strlen(value);
-  free(field->data.as_string);
+  if (!field->is_arena_data)
+    free(field->data.as_string);
+  field->is_arena_data = 0;
   field->data.as_string = calloc(strlen(value) + 1, sizeof(char));
   strcpy(field->data.as_string,value);
   field->size = (int)len;
   return 0;
 }
 
-int arrayFieldValuePushBack(cRosMessageField *field, const void* data, int element_size)
+// Moves the arena storage of a field to the heap, so that it can be modified
+static int detachArenaData(cRosMessageField *field)
 {
-  if(!field->is_array || field->is_fixed_array)
-    return -1;
+  if(!field->is_arena_data)
+    return 0;
 
-  if(field->array_capacity == field->array_size)
+  if(!field->is_array)
   {
-    void* new_location;
-    new_location = realloc(field->data.as_array, 2 * field->array_capacity * element_size);
-    if(new_location != NULL)
-    {
-      field->data.as_array = new_location;
-      field->array_capacity *= 2;
-    }
-    else
-    {
+    char *str = (char *)malloc(field->size + 1);
+    if(str == NULL)
+      return -1;
+
+    memcpy(str, field->data.as_string, field->size + 1);
+    field->data.as_string = str;
+    field->is_arena_data = 0;
+    return 0;
+  }
+
+  size_t element_size = field->type == CROS_STD_MSGS_STRING ? sizeof(char *) : (size_t)field->size;
+  int capacity = field->array_size > 0 ? field->array_size : 1;
+  if(!field->is_fixed_array)
+  {
+    void *data = malloc(capacity * element_size);
+    if(data == NULL)
       return -1;
+
+    memcpy(data, field->data.as_array, field->array_size * element_size);
+    field->data.as_array = data;
+    field->array_capacity = capacity;
+  }
+
+  if(field->type == CROS_STD_MSGS_STRING)
+  {
+    int i;
+    for(i = 0; i < field->array_size; i++)
+    {
+      const char *val = field->data.as_string_array[i];
+      char *str = NULL;
+      if(val != NULL)
+      {
+        str = (char *)malloc(strlen(val) + 1);
+        if(str != NULL)
+          strcpy(str, val);
+      }
+      field->data.as_string_array[i] = str;
     }
   }
 
+  field->is_arena_data = 0;
+  return 0;
+}
+
+// Doubles the capacity of a variable size array
+static int growArrayField(cRosMessageField *field, size_t element_size)
+{
+  if(detachArenaData(field) == -1)
+    return -1;
+
+  int new_capacity = field->array_capacity > 0 ? 2 * field->array_capacity : 1;
+  void* new_location = realloc(field->data.as_array, new_capacity * element_size);
+  if(new_location == NULL)
+    return -1;
+
+  // Free message slots must be NULL (see cRosMessageFieldRelease)
+  if(field->type == CROS_CUSTOM_TYPE)
+  {
+    int old_capacity = field->array_capacity > 0 ? field->array_capacity : 0;
+    memset((uint8_t *)new_location + old_capacity * element_size, 0, (new_capacity - old_capacity) * element_size);
+  }
+
+  field->data.as_array = new_location;
+  field->array_capacity = new_capacity;
+  return 0;
+}
+
+int arrayFieldValuePushBack(cRosMessageField *field, const void* data, int element_size)
+{
+  if(!field->is_array || field->is_fixed_array)
+    return -1;
+
+  if(detachArenaData(field) == -1)
+    return -1;
+
+  if(field->array_capacity <= field->array_size && growArrayField(field, element_size) == -1)
+    return -1;
+
   memcpy(field->data.as_array + field->array_size * element_size, data, element_size);
   field->array_size ++;
   return 0;
@@ -1344,20 +1560,11 @@ int cRosMessageFieldArrayPushBackString(cRosMessageField *field, const char* val
   if(!field->is_array || field->is_fixed_array)
     return -1;
 
-  if(field->array_capacity == field->array_size)
-  {
-    void* new_location;
-    new_location = realloc(field->data.as_string_array, 2 * field->array_capacity * sizeof(char*));
-    if(new_location != NULL)
-    {
-      field->data.as_array = new_location;
-      field->array_capacity *= 2;
-    }
-    else
-    {
-      return -1;
-    }
-  }
+  if(detachArenaData(field) == -1)
+    return -1;
+
+  if(field->array_capacity <= field->array_size && growArrayField(field, sizeof(char*)) == -1)
+    return -1;
 
   char* element_val = (char*) calloc(strlen(val) + 1, sizeof(char));
   strcpy(element_val, val);
@@ -1374,23 +1581,12 @@ int cRosMessageFieldArrayPushBackMsg(cRosMessageField *field, cRosMessage* msg)
   if(!field->is_array || field->is_fixed_array)
     return -1;
 
-  size_t element_size = sizeof(cRosMessage*);
-
-  if(field->array_capacity == field->array_size)
-  {
-    void* new_location;
-    new_location = realloc(field->data.as_array, 2 * field->array_capacity * element_size);
-    if(new_location != NULL)
-    {
-      field->data.as_array = new_location;
-      field->array_capacity *= 2;
-    }
-    else
-    {
-      return -1;
-    }
-  }
+  if(field->array_capacity <= field->array_size && growArrayField(field, sizeof(cRosMessage*)) == -1)
+    return -1;
 
+  // Drop the message left in the slot by a previous deserialization
+  if(field->data.as_msg_array[field->array_size] != msg)
+    cRosMessageFree(field->data.as_msg_array[field->array_size]);
   field->data.as_msg_array[field->array_size] = msg;
   field->array_size ++;
   return 0;
@@ -1511,6 +1707,9 @@ int cRosMessageFieldArrayAtStringSet(cRosMessageField *field, int position, cons
   if(field->type != CROS_STD_MSGS_STRING || !field->is_array)
     return -1;
 
+  if(detachArenaData(field) == -1)
+    return -1;
+
   char *current = field->data.as_string_array[position];
   if (current != NULL)
     free(current);
@@ -1608,24 +1807,24 @@ void cRosMessageSerialize(cRosMessage *message, DynBuffer* buffer)
       case CROS_STD_MSGS_FLOAT64:
       case CROS_STD_MSGS_BOOL:
       case CROS_STD_MSGS_TIME:
+      case CROS_STD_MSGS_DURATION:
       case CROS_STD_MSGS_CHAR:
       case CROS_STD_MSGS_BYTE:
       {
         size_t size = getMessageTypeSizeOf(field->type);
         if (field->is_array)
           dynBufferPushBackBuf(buffer, field->data.as_array, size * field->array_size);
+        else if (field->type == CROS_STD_MSGS_TIME || field->type == CROS_STD_MSGS_DURATION)
+        {
+          // secs and nsecs are the fields 0 and 1 of the sub-message built by build_time_field()
+          cRosMessage* time = field->data.as_msg;
+          dynBufferPushBackBuf(buffer, time->fields[0]->data.opaque, sizeof(int32_t));
+          dynBufferPushBackBuf(buffer, time->fields[1]->data.opaque, sizeof(int32_t));
+        }
         else
           dynBufferPushBackBuf(buffer, field->data.opaque, size);
         break;
       }
-      case CROS_STD_MSGS_DURATION:
-      {
-        cRosMessageField* timefromstart_secs = cRosMessageGetField(field->data.as_msg, "secs");
-        cRosMessageField* timefromstart_nsecs= cRosMessageGetField(field->data.as_msg, "nsecs");
-        dynBufferPushBackBuf( buffer, timefromstart_secs->data.opaque, sizeof(int32_t));
-        dynBufferPushBackBuf( buffer, timefromstart_nsecs->data.opaque, sizeof(int32_t));
-        break;
-      }
       case CROS_STD_MSGS_STRING:
       {
         // CHECK-ME
@@ -1683,7 +1882,116 @@ void cRosMessageSerialize(cRosMessage *message, DynBuffer* buffer)
   }
 }
 
-void cRosMessageDeserialize(cRosMessage *message, DynBuffer* buffer)
+// Builds the message of a custom type field, loading its definition from root_dir
+static cRosMessage * newFieldMessage(const char *root_dir, const char *type_s)
+{
+  cRosMessage *msg = cRosMessageNew();
+  if (msg == NULL)
+    return NULL;
+
+  char* path = calloc(strlen(root_dir) +
+                      strlen(DIR_SEPARATOR_STR) +
+                      strlen(type_s) +
+                      strlen(".msg") + 1, // '\0'
+                      sizeof(char));
+  strcat(path, root_dir);
+  strcat(path, DIR_SEPARATOR_STR);
+  strcat(path, type_s);
+  strcat(path, ".msg");
+  cRosMessageBuild(msg, path);
+  free(path);
+
+  return msg;
+}
+
+// Allocates the storage of a string or array, from the arena if any
+static void * allocFieldData(CrosArena *arena, size_t size)
+{
+  if (arena != NULL)
+    return cRosArenaAlloc(arena, size);
+
+  return malloc(size > 0 ? size : 1);
+}
+
+static char * readString(DynBuffer *buffer, CrosArena *arena, size_t *len)
+{
+  *len = *((uint32_t*)dynBufferGetCurrentData(buffer));
+  dynBufferMovePoseIndicator(buffer, 4);
+
+  char *str = (char *)allocFieldData(arena, *len + 1);
+  if (str != NULL)
+  {
+    memcpy(str, dynBufferGetCurrentData(buffer), *len);
+    str[*len] = '\0';
+  }
+  dynBufferMovePoseIndicator(buffer, *len);
+
+  return str;
+}
+
+static void deserializeString(cRosMessageField *field, DynBuffer *buffer, CrosArena *arena)
+{
+  size_t len;
+  char *str = readString(buffer, arena, &len);
+
+  if (!field->is_arena_data)
+    free(field->data.as_string);
+  field->data.as_string = str;
+  field->size = str != NULL ? (int)len : 0;
+  field->is_arena_data = (arena != NULL);
+}
+
+// Replaces the storage of a variable size array with room for count elements
+static int resizeArrayField(cRosMessageField *field, int count, size_t element_size, CrosArena *arena)
+{
+  if (arena != NULL)
+  {
+    void *data = cRosArenaAlloc(arena, count * element_size);
+    if (data == NULL)
+      return -1;
+
+    if (!field->is_arena_data)
+      free(field->data.as_array);
+    field->data.as_array = data;
+    field->array_capacity = count;
+    field->is_arena_data = 1;
+    return 0;
+  }
+
+  if (field->is_arena_data)
+  {
+    field->data.as_array = NULL;
+    field->array_capacity = 0;
+    field->is_arena_data = 0;
+  }
+
+  if (field->data.as_array == NULL || field->array_capacity < count)
+  {
+    int capacity = count > 0 ? count : 1;
+    void *data = realloc(field->data.as_array, capacity * element_size);
+    if (data == NULL)
+      return -1;
+
+    field->data.as_array = data;
+    field->array_capacity = capacity;
+  }
+
+  return 0;
+}
+
+// Makes room for count messages, keeping the ones built by the previous deserializations
+static int reserveMessageArray(cRosMessageField *field, int count)
+{
+  while (field->array_capacity < count)
+  {
+    if (growArrayField(field, sizeof(cRosMessage*)) == -1)
+      return -1;
+  }
+
+  return 0;
+}
+
+static void deserializeMessage(cRosMessage *message, DynBuffer* buffer, CrosArena *arena)
 {
   size_t it;
   for (it = 0; it < message->n_fields; it++)
@@ -1711,28 +2019,30 @@ void cRosMessageDeserialize(cRosMessage *message, DynBuffer* buffer)
         size_t size = getMessageTypeSizeOf(field->type);
         if (field->is_array)
         {
-          cRosMessageFieldArrayClear(field);
-          size_t curr_data_size = field->array_size;
-          if (field->is_fixed_array)
-          {
-            memcpy(field->data.as_array, dynBufferGetCurrentData(buffer), size * field->array_size);
-            dynBufferMovePoseIndicator(buffer, size * field->array_size);
-          }
-          else
+          int array_size = field->array_size;
+          if (!field->is_fixed_array)
           {
-            size_t array_size = *((uint32_t*)dynBufferGetCurrentData(buffer));
+            array_size = *((uint32_t*)dynBufferGetCurrentData(buffer));
             dynBufferMovePoseIndicator(buffer, 4);
-            int i;
-            for(i = 0; i < array_size; i++)
+            if (resizeArrayField(field, array_size, size, arena) == -1)
             {
-              double d = *((double*) dynBufferGetCurrentData(buffer));
-              //printf("%.8f ", d);
-              arrayFieldValuePushBack(field, (const void*) &d, size); //dynBufferGetCurrentData(buffer), size);
-              //printf("%.8f - ", *cRosMessageFieldArrayAtFloat64(field, i));
-              dynBufferMovePoseIndicator(buffer, size);
+              PRINT_ERROR("cRosMessageDeserialize() : Can't allocate memory\n");
+              return;
             }
-            //printf("\n");
+            field->array_size = array_size;
           }
+
+          memcpy(field->data.as_array, dynBufferGetCurrentData(buffer), size * array_size);
+          dynBufferMovePoseIndicator(buffer, size * array_size);
+        }
+        else if (field->type == CROS_STD_MSGS_TIME || field->type == CROS_STD_MSGS_DURATION)
+        {
+          // Don't overwrite the sub-message pointer
+          cRosMessage* time = field->data.as_msg;
+          memcpy(time->fields[0]->data.opaque, dynBufferGetCurrentData(buffer), sizeof(int32_t));
+          dynBufferMovePoseIndicator(buffer, sizeof(int32_t));
+          memcpy(time->fields[1]->data.opaque, dynBufferGetCurrentData(buffer), sizeof(int32_t));
+          dynBufferMovePoseIndicator(buffer, sizeof(int32_t));
         }
         else
         {
@@ -1744,108 +2054,106 @@ void cRosMessageDeserialize(cRosMessage *message, DynBuffer* buffer)
       }
       case CROS_STD_MSGS_STRING:
       {
-        // CHECK-ME
         if (field->is_array)
         {
-          cRosMessageFieldArrayClear(field);
-          size_t curr_data_size = field->array_size;
-          if(!field->is_fixed_array)
+          // Free the strings of the previous message, unless they are in the arena
+          int i;
+          if (!field->is_arena_data)
           {
-            curr_data_size = *((uint32_t*)dynBufferGetCurrentData(buffer));
-            dynBufferMovePoseIndicator(buffer, 4);
+            for (i = 0; i < field->array_size; i++)
+            {
+              free(field->data.as_string_array[i]);
+              field->data.as_string_array[i] = NULL;
+            }
           }
 
-          int i;
-          for(i = 0; i < curr_data_size; i++)
+          int array_size = field->array_size;
+          if (!field->is_fixed_array)
           {
-            size_t element_size = *((uint32_t*)dynBufferGetCurrentData(buffer));
+            array_size = *((uint32_t*)dynBufferGetCurrentData(buffer));
             dynBufferMovePoseIndicator(buffer, 4);
-            char* tmp_string = (char*) calloc(element_size + 1, sizeof(char));
-            memcpy(tmp_string, dynBufferGetCurrentData(buffer), element_size);
-            cRosMessageFieldArrayPushBackString(field, tmp_string);
-            dynBufferMovePoseIndicator(buffer, element_size);
-            free(tmp_string);
+            if (resizeArrayField(field, array_size, sizeof(char*), arena) == -1)
+            {
+              PRINT_ERROR("cRosMessageDeserialize() : Can't allocate memory\n");
+              field->array_size = 0;
+              return;
+            }
+            field->array_size = array_size;
+          }
+          field->is_arena_data = (arena != NULL);
+
+          for (i = 0; i < array_size; i++)
+          {
+            size_t len;
+            field->data.as_string_array[i] = readString(buffer, arena, &len);
           }
         }
         else
         {
-          size_t curr_data_size = *((uint32_t*)dynBufferGetCurrentData(buffer));
-          dynBufferMovePoseIndicator(buffer, 4);
-          field->data.as_string = (char*) calloc(curr_data_size + 1, sizeof(char));
-          memcpy(field->data.as_string, dynBufferGetCurrentData(buffer), curr_data_size);
-          dynBufferMovePoseIndicator(buffer, curr_data_size);
+          deserializeString(field, buffer, arena);
         }
         break;
       }
       case CROS_STD_MSGS_HEADER:
       {
-        build_header_field(field);
+        if (field->data.as_msg == NULL)
+          build_header_field(field);
         cRosMessage* header = field->data.as_msg;
 
         //uint32 seq
-
-        uint32_t seq = *((uint32_t*)dynBufferGetCurrentData(buffer));
+        header->fields[0]->data.as_uint32 = *((uint32_t*)dynBufferGetCurrentData(buffer));
         dynBufferMovePoseIndicator(buffer, 4);
-        //printf("Read: seq=%u , ", seq);
-        header->fields[0]->data.as_uint32 = seq;
-        
+
         //time stamp
         cRosMessage* timestamp = header->fields[1]->data.as_msg;
-        uint32_t stamp_sec = *((uint32_t*)dynBufferGetCurrentData(buffer));
+        timestamp->fields[0]->data.as_uint32 = *((uint32_t*)dynBufferGetCurrentData(buffer));
         dynBufferMovePoseIndicator(buffer, 4);
-        //printf("stamp.sec=%u , ", stamp_sec);
-        timestamp->fields[0]->data.as_uint32 = stamp_sec;        
-
-        uint32_t stamp_nsec =  *((uint32_t*)dynBufferGetCurrentData(buffer));
+        timestamp->fields[1]->data.as_uint32 = *((uint32_t*)dynBufferGetCurrentData(buffer));
         dynBufferMovePoseIndicator(buffer, 4);
-        //printf("stamp.nsec=%u , ", stamp_nsec);
-        timestamp->fields[0]->data.as_uint32 = stamp_nsec;
 
-        uint32_t strlen = *((uint32_t*)dynBufferGetCurrentData(buffer));
-        dynBufferMovePoseIndicator(buffer, 4);
-        cRosMessageField* string_field = header->fields[1];
-        string_field->data.as_string = (char*) calloc(strlen + 1, sizeof(char));
-        memcpy(string_field->data.as_string, dynBufferGetCurrentData(buffer), strlen);
-        dynBufferMovePoseIndicator(buffer, strlen);
-        //printf("frame_id=%s\n", string_field->data.as_string);  
-        //fflush(stdout);
+        //string frame_id
+        deserializeString(header->fields[2], buffer, arena);
         break;
       }
       default:
       {
         if (field->is_array)
         {
-          cRosMessageFieldArrayClear(field);
-          size_t curr_data_size = field->array_size;
-          if(!field->is_fixed_array)
+          int array_size = field->array_size;
+          if (!field->is_fixed_array)
           {
-            curr_data_size = *((uint32_t*)dynBufferGetCurrentData(buffer));
+            array_size = *((uint32_t*)dynBufferGetCurrentData(buffer));
             dynBufferMovePoseIndicator(buffer, 4);
+            if (reserveMessageArray(field, array_size) == -1)
+            {
+              PRINT_ERROR("cRosMessageDeserialize() : Can't allocate memory\n");
+              field->array_size = 0;
+              return;
+            }
+            field->array_size = array_size;
           }
 
           int it2;
-          for(it2 = 0; it2 < curr_data_size; it2++)
+          for (it2 = 0; it2 < array_size; it2++)
           {
-            cRosMessage* msg = calloc(1,sizeof(cRosMessage));
-            cRosMessageInit(msg);
-            char* msgPath = calloc(
-                            strlen(message->msgDef->root_dir) +
-                            strlen(DIR_SEPARATOR_STR) +
-                            strlen(field->type_s) +
-                            strlen(".msg") + 1,
-                            sizeof(char));
-            strcat(msgPath, message->msgDef->root_dir);
-            strcat(msgPath, DIR_SEPARATOR_STR);
-            strcat(msgPath, field->type_s);
-            strcat(msgPath,".msg");
-            cRosMessageBuild(msg,msgPath);
-            cRosMessageDeserialize(msg, buffer);
-            free(msgPath);
+            // The element messages are built once and reused by the next messages
+            cRosMessage* msg = field->data.as_msg_array[it2];
+            if (msg == NULL)
+            {
+              msg = newFieldMessage(message->msgDef->root_dir, field->type_s);
+              if (msg == NULL)
+              {
+                PRINT_ERROR("cRosMessageDeserialize() : Can't allocate memory\n");
+                return;
+              }
+              field->data.as_msg_array[it2] = msg;
+            }
+            deserializeMessage(msg, buffer, arena);
           }
         }
         else
         {
-          cRosMessageDeserialize(field->data.as_msg, buffer);
+          deserializeMessage(field->data.as_msg, buffer, arena);
         }
         break;
       }
@@ -1853,6 +2161,16 @@ void cRosMessageDeserialize(cRosMessage *message, DynBuffer* buffer)
   }
 }
 
+void cRosMessageDeserialize(cRosMessage *message, DynBuffer* buffer)
+{
+  deserializeMessage(message, buffer, NULL);
+}
+
+void cRosMessageDeserializeArena(cRosMessage *message, DynBuffer* buffer, CrosArena *arena)
+{
+  deserializeMessage(message, buffer, arena);
+}
+
 const char * getMessageTypeDeclarationConst(msgConst *msgConst)
 {
   if (msgConst->type_s == NULL)
@@ -0,0 +1,139 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "cros_name_index.h"
+#include "cros_defs.h"
+
+#define CROS_NAME_INDEX_MASK (CROS_NAME_INDEX_SIZE - 1)
+
+static uint32_t hashName(CrosNameKind kind, const char *name, size_t len)
+{
+  // FNV-1a, seeded with the provider kind
+  uint32_t hash = 2166136261u ^ (uint32_t)kind;
+  size_t i;
+  for (i = 0; i < len; i++)
+  {
+    hash ^= (unsigned char)name[i];
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
+
+void cRosNameIndexInit(CrosNameIndex *index)
+{
+  memset(index, 0, sizeof(CrosNameIndex));
+}
+
+int cRosNameIndexAdd(CrosNameIndex *index, CrosNameKind kind, const char *name, int idx)
+{
+  // Keep a free slot, that ends every probe sequence
+  if (index->count >= CROS_NAME_INDEX_SIZE - 1)
+  {
+    PRINT_ERROR("cRosNameIndexAdd() : Index full\n");
+    return -1;
+  }
+
+  uint32_t hash = hashName(kind, name, strlen(name));
+  uint32_t slot = hash & CROS_NAME_INDEX_MASK;
+  while (index->entries[slot].kind != CROS_NAME_NONE)
+    slot = (slot + 1) & CROS_NAME_INDEX_MASK;
+
+  CrosNameIndexEntry *entry = &index->entries[slot];
+  entry->kind = kind;
+  entry->hash = hash;
+  entry->name = name;
+  entry->idx = idx;
+  index->count++;
+  return 0;
+}
+
+void cRosNameIndexRemove(CrosNameIndex *index, CrosNameKind kind, const char *name, int idx)
+{
+  if (name == NULL)
+    return;
+
+  uint32_t hash = hashName(kind, name, strlen(name));
+  uint32_t slot = hash & CROS_NAME_INDEX_MASK;
+  while (index->entries[slot].kind != CROS_NAME_NONE)
+  {
+    CrosNameIndexEntry *entry = &index->entries[slot];
+    if (entry->kind == kind && entry->idx == idx && entry->hash == hash && strcmp(entry->name, name) == 0)
+      break;
+
+    slot = (slot + 1) & CROS_NAME_INDEX_MASK;
+  }
+
+  if (index->entries[slot].kind == CROS_NAME_NONE)
+    return;
+
+  // Shift back the next entries of the probe sequence, so that no tombstone is needed
+  uint32_t hole = slot, next = slot;
+  while (1)
+  {
+    next = (next + 1) & CROS_NAME_INDEX_MASK;
+    CrosNameIndexEntry *entry = &index->entries[next];
+    if (entry->kind == CROS_NAME_NONE)
+      break;
+
+    // The entry can fill the hole if its home slot isn't cyclically in (hole, next]
+    uint32_t home = entry->hash & CROS_NAME_INDEX_MASK;
+    if (((next - home) & CROS_NAME_INDEX_MASK) >= ((next - hole) & CROS_NAME_INDEX_MASK))
+    {
+      index->entries[hole] = *entry;
+      hole = next;
+    }
+  }
+
+  memset(&index->entries[hole], 0, sizeof(CrosNameIndexEntry));
+  index->count--;
+}
+
+int cRosNameIndexFindN(const CrosNameIndex *index, CrosNameKind kind, const char *name, size_t len)
+{
+  uint32_t hash = hashName(kind, name, len);
+  uint32_t slot = hash & CROS_NAME_INDEX_MASK;
+  int found = -1;
+  while (index->entries[slot].kind != CROS_NAME_NONE)
+  {
+    const CrosNameIndexEntry *entry = &index->entries[slot];
+    if (entry->kind == kind && entry->hash == hash && (found == -1 || entry->idx < found) &&
+        strncmp(entry->name, name, len) == 0 && entry->name[len] == '\0')
+      found = entry->idx;
+
+    slot = (slot + 1) & CROS_NAME_INDEX_MASK;
+  }
+
+  return found;
+}
+
+int cRosNameIndexFind(const CrosNameIndex *index, CrosNameKind kind, const char *name)
+{
+  return cRosNameIndexFindN(index, kind, name, strlen(name));
+}
+
+int cRosNameIndexFindNamespace(const CrosNameIndex *index, CrosNameKind kind, const char *name)
+{
+  int found = cRosNameIndexFind(index, kind, name);
+
+  size_t len;
+  for (len = strlen(name); len > 0; len--)
+  {
+    if (name[len - 1] != '/')
+      continue;
+
+    // The namespace with and without the trailing slash
+    int idx = cRosNameIndexFindN(index, kind, name, len);
+    if (idx != -1 && (found == -1 || idx < found))
+      found = idx;
+
+    if (len > 1)
+    {
+      idx = cRosNameIndexFindN(index, kind, name, len - 1);
+      if (idx != -1 && (found == -1 || idx < found))
+        found = idx;
+    }
+  }
+
+  return found;
+}
@@ -1,3 +1,5 @@
+#define _GNU_SOURCE // getaddrinfo_a()
+
 #include <stdio.h>
 #include <malloc.h>
 #include <string.h>
@@ -6,15 +8,25 @@
 #include <assert.h>
 #include <errno.h>
 #include <ctype.h>
+#include <unistd.h>
+#include <ifaddrs.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
 
 #include "cros_node.h"
 #include "cros_api.h"
+#include "cros_api_internal.h"
 #include "cros_message.h"
 #include "cros_clock.h"
 #include "cros_defs.h"
 #include "cros_node_api.h"
 #include "cros_tcpros.h"
 #include "cros_log.h"
+#include "cros_intraprocess.h"
+#include "cros_subscriber_queue.h"
+#include "cros_shm.h"
+#include "cros_udpros.h"
 
 static void initPublisherNode(PublisherNode *node);
 static void initSubscriberNode(SubscriberNode *node);
@@ -23,15 +35,19 @@ static void initParameterSubscrition(ParameterSubscription *subscription);
 static void releasePublisherNode(PublisherNode *node);
 static void releaseSubscriberNode(SubscriberNode *node);
 static void releaseServiceProviderNode(ServiceProviderNode *node);
+static void initServiceCallerNode(ServiceCallerNode *node);
+static void releaseServiceCallerNode(ServiceCallerNode *node);
 static void releaseParameterSubscrition(ParameterSubscription *subscription);
 static int enqueueSubscriberAdvertise(CrosNode *node, int subidx);
 static int enqueuePublisherAdvertise(CrosNode *node, int pubidx);
 static int enqueueServiceAdvertise(CrosNode *node, int servivceidx);
 static int enqueueParameterSubscription(CrosNode *node, int parameteridx);
 static int enqueueParameterUnsubscription(CrosNode *node, int parameteridx);
+static int enqueueServiceLookup(CrosNode *node, int svccalleridx);
 static void getIdleXmplrpcClients(CrosNode *node, int array[], size_t *count);
 static int enqueueSlaveApiCallInternal(CrosNode *node, RosApiCall *call);
 static int enqueueMasterApiCallInternal(CrosNode *node, RosApiCall *call);
+static void dispatchCachedApiCalls(CrosNode *node);
 
 static void openXmlrpcClientSocket( CrosNode *n, int i )
 {
@@ -55,6 +71,17 @@ static void openTcprosClientSocket( CrosNode *n, int i )
   }
 }
 
+static void openRpcrosClientSocket( CrosNode *n, int i )
+{
+  if( !tcpIpSocketOpen( &(n->rpcros_client_proc[i].socket) ) ||
+      !tcpIpSocketSetReuse( &(n->rpcros_client_proc[i].socket) ) ||
+      !tcpIpSocketSetNonBlocking( &(n->rpcros_client_proc[i].socket) ) )
+  {
+    PRINT_ERROR("openRpcrosClientSocket() at index %d failed", i);
+    exit( EXIT_FAILURE );
+  }
+}
+
 static void openXmlrpcListnerSocket( CrosNode *n )
 {
   if( !tcpIpSocketOpen( &(n->xmlrpc_listner_proc.socket) ) ||
@@ -77,7 +104,7 @@ static void openRpcrosListnerSocket( CrosNode *n )
   if( !tcpIpSocketOpen( &(n->rpcros_listner_proc.socket) ) ||
       !tcpIpSocketSetReuse( &(n->rpcros_listner_proc.socket) ) ||
       !tcpIpSocketSetNonBlocking( &(n->rpcros_listner_proc.socket) ) ||
-      !tcpIpSocketBindListen( &(n->rpcros_listner_proc.socket), n->host, 0, CN_MAX_RPCROS_SERVER_CONNECTIONS ) )
+      !tcpIpSocketBindListen( &(n->rpcros_listner_proc.socket), n->host, 0, CN_RPCROS_LISTEN_BACKLOG ) )
   {
     PRINT_ERROR("openRpcrosListnerSocket() failed");
     exit( EXIT_FAILURE );
@@ -106,6 +133,61 @@ static void openTcprosListnerSocket( CrosNode *n )
   }
 }
 
+const char *openUnixrosListnerSocket( CrosNode *n )
+{
+  if( n->unixros_path != NULL )
+    return n->unixros_path;
+
+  char path[108];
+  snprintf( path, sizeof(path), "/tmp/cros_%d_%d.sock", n->pid, n->xmlrpc_port );
+  if( !tcpIpSocketOpenUnix( &(n->unixros_listner) ) ||
+      !tcpIpSocketSetNonBlocking( &(n->unixros_listner) ) ||
+      !tcpIpSocketBindListenUnix( &(n->unixros_listner), path, CN_MAX_TCPROS_SERVER_CONNECTIONS ) )
+  {
+    PRINT_ERROR("openUnixrosListnerSocket() failed, using TCPROS only\n");
+    tcpIpSocketClose( &(n->unixros_listner) );
+    return NULL;
+  }
+
+  n->unixros_path = strdup( path );
+  if( n->unixros_path == NULL )
+  {
+    tcpIpSocketClose( &(n->unixros_listner) );
+    unlink( path );
+    return NULL;
+  }
+
+  PRINT_DEBUG ( "openUnixrosListnerSocket () : Accepting UNIXROS connections at %s\n", n->unixros_path );
+  return n->unixros_path;
+}
+
+// Check if the host of a publisher (already resolved, see lookup_host()) is this machine,
+// i.e. a loopback address or the address of one of the interfaces
+static int isLocalHost( const char *host )
+{
+  struct in_addr addr;
+  if( host == NULL || inet_pton( AF_INET, host, &addr ) != 1 )
+    return 0;
+
+  if( ( ntohl( addr.s_addr ) >> 24 ) == 127 )
+    return 1;
+
+  struct ifaddrs *ifs, *ifa;
+  if( getifaddrs( &ifs ) != 0 )
+    return 0;
+
+  int local = 0;
+  for( ifa = ifs; ifa != NULL && !local; ifa = ifa->ifa_next )
+  {
+    if( ifa->ifa_addr != NULL && ifa->ifa_addr->sa_family == AF_INET &&
+        ((struct sockaddr_in *)ifa->ifa_addr)->sin_addr.s_addr == addr.s_addr )
+      local = 1;
+  }
+
+  freeifaddrs( ifs );
+  return local;
+}
+
 static void closeTcprosProcess(TcprosProcess *process)
 {
   tcpIpSocketClose(&process->socket);
@@ -142,6 +224,10 @@ static void handleApiCallAttempt(CrosNode *node, RosApiCall *call)
       }
 
       // Finally release publisher
+      cRosIntraprocessUnlinkPublisher(node, call->provider_idx);
+      cRosShmRelease(node, call->provider_idx);
+      cRosUdprosRelease(node, call->provider_idx);
+      cRosNameIndexRemove(&node->name_index, CROS_NAME_PUBLISHER, pub->topic_name, call->provider_idx);
       releasePublisherNode(pub);
       initPublisherNode(pub);
       call->provider_idx = -1;
@@ -162,6 +248,10 @@ static void handleApiCallAttempt(CrosNode *node, RosApiCall *call)
       }
 
       // Finally release subscriber
+      cRosIntraprocessUnlinkSubscriber(node, call->provider_idx);
+      cRosShmDetach(node, call->provider_idx);
+      cRosUdprosCloseReceiver(node, call->provider_idx);
+      cRosNameIndexRemove(&node->name_index, CROS_NAME_SUBSCRIBER, sub->topic_name, call->provider_idx);
       releaseSubscriberNode(sub);
       initSubscriberNode(sub);
       call->provider_idx = -1;
@@ -182,6 +272,7 @@ static void handleApiCallAttempt(CrosNode *node, RosApiCall *call)
       }
 
       // Finally release service provider
+      cRosNameIndexRemove(&node->name_index, CROS_NAME_SERVICE, service->service_name, call->provider_idx);
       releaseServiceProviderNode(service);
       initServiceProviderNode(service);
       call->provider_idx = -1;
@@ -204,7 +295,11 @@ static void handleApiCallAttempt(CrosNode *node, RosApiCall *call)
         callback(&status, subscription->context);
       }
 
+      // Its cached values won't be updated anymore
+      cRosLookupCacheInvalidateParam(&node->lookup_cache, subscription->parameter_key);
+
       // Finally release parameter subscription
+      cRosNameIndexRemove(&node->name_index, CROS_NAME_PARAMETER, subscription->parameter_key, call->provider_idx);
       releaseParameterSubscrition(subscription);
       initParameterSubscrition(subscription);
       call->provider_idx = -1;
@@ -251,6 +346,18 @@ static void handleXmlrpcClientError(CrosNode *node, int i)
       enqueueApiCall(&node->master_api_queue, call);
       break;
     }
+    case CROS_API_LOOKUP_SERVICE:
+    {
+      if (!call->user_call)
+      {
+        // Lookup done on behalf of a service caller
+        XmlrpcParam *service_name = xmlrpcParamVectorAt(&call->params, 1);
+        cRosNodeServiceCallerLookupDone(node, call->provider_idx,
+                                        xmlrpcParamGetString(service_name), NULL);
+        break;
+      }
+    }
+    // fall through
     default:
     {
       ResultCallback callback = call->result_callback;
@@ -263,6 +370,10 @@ static void handleXmlrpcClientError(CrosNode *node, int i)
     }
   }
 
+  // The contacted node may be gone: forget the lookups that point to it
+  if (call->user_call && call->host != NULL && call->host != node->roscore_host)
+    cRosLookupCacheInvalidateUri(&node->lookup_cache, call->host, call->port);
+
   handleApiCallAttempt(node, call);
   cleanApiCallState(node, call);
   closeXmlrpcProcess(proc);
@@ -295,6 +406,264 @@ static void handleRpcrosServerError(CrosNode *n, int i)
   closeTcprosProcess(process);
 }
 
+// Double the RPCROS server pool (starting from CN_INIT_RPCROS_SERVER_CONNECTIONS),
+// up to CN_MAX_RPCROS_SERVER_CONNECTIONS
+static int growRpcrosServerProcs(CrosNode *n)
+{
+  int new_size = n->n_rpcros_server_proc == 0 ? CN_INIT_RPCROS_SERVER_CONNECTIONS
+                                              : 2 * n->n_rpcros_server_proc;
+  if (new_size > CN_MAX_RPCROS_SERVER_CONNECTIONS)
+    new_size = CN_MAX_RPCROS_SERVER_CONNECTIONS;
+  if (new_size <= n->n_rpcros_server_proc)
+    return -1;
+
+  TcprosProcess *new_procs = (TcprosProcess *)realloc(n->rpcros_server_proc,
+                                                      new_size * sizeof(TcprosProcess));
+  if (new_procs == NULL)
+    return -1;
+
+  int i;
+  for (i = n->n_rpcros_server_proc; i < new_size; i++)
+    tcprosProcessInit(&new_procs[i]);
+
+  n->rpcros_server_proc = new_procs;
+  n->n_rpcros_server_proc = new_size;
+  return 0;
+}
+
+// Get an idle RPCROS server, growing the pool if all of them are busy
+static int getIdleRpcrosServer(CrosNode *n)
+{
+  int i;
+  for (i = 0; i < n->n_rpcros_server_proc; i++)
+  {
+    if (n->rpcros_server_proc[i].state == TCPROS_PROCESS_STATE_IDLE)
+      return i;
+  }
+
+  int first_new = n->n_rpcros_server_proc;
+  if (growRpcrosServerProcs(n) == -1)
+    return -1;
+
+  return first_new;
+}
+
+static void freeServiceCall(ServiceCallNode *call)
+{
+  dynBufferRelease(&call->request);
+  free(call);
+}
+
+static void appendServiceCall(ServiceCallNode **head, ServiceCallNode **tail, ServiceCallNode *call)
+{
+  call->next = NULL;
+  if (*tail == NULL)
+    *head = call;
+  else
+    (*tail)->next = call;
+  *tail = call;
+}
+
+static ServiceCallNode * popServiceCall(ServiceCallNode **head, ServiceCallNode **tail)
+{
+  ServiceCallNode *call = *head;
+  if (call == NULL)
+    return NULL;
+
+  *head = call->next;
+  if (*head == NULL)
+    *tail = NULL;
+  call->next = NULL;
+
+  return call;
+}
+
+// Notifies the failure of all the calls in the list with a NULL response. The list is detached
+// first: the callbacks may enqueue new calls or unregister the caller
+static void failServiceCalls(CrosNode *n, int i, ServiceCallNode **head, ServiceCallNode **tail)
+{
+  ServiceCallerNode *caller = &n->service_callers[i];
+  ServiceCallNode *failed_head = *head, *failed_tail = *tail;
+  *head = *tail = NULL;
+
+  ServiceCallNode *call;
+  while ((call = popServiceCall(&failed_head, &failed_tail)) != NULL)
+  {
+    ServiceCallerCallback callback = caller->callback;
+    if (callback != NULL)
+      callback(call->id, NULL, caller->context);
+
+    freeServiceCall(call);
+  }
+}
+
+/*! Asynchronous resolution of the host name of a service provider */
+struct ServiceHostResolver
+{
+  struct gaicb request;
+  struct addrinfo hints;
+  char hostname[256];
+  int port;
+};
+
+static void releaseServiceHostResolver(ServiceHostResolver *resolver)
+{
+  // A request already being processed can't be cancelled: wait for its end before releasing it
+  if (gai_cancel(&resolver->request) == EAI_NOTCANCELED)
+  {
+    const struct gaicb *list[1] = { &resolver->request };
+    while (gai_error(&resolver->request) == EAI_INPROGRESS)
+      gai_suspend(list, 1, NULL);
+  }
+
+  if (resolver->request.ar_result != NULL)
+    freeaddrinfo(resolver->request.ar_result);
+  free(resolver);
+}
+
+static void setServiceCallerAddress(ServiceCallerNode *caller, char *host, int port)
+{
+  free(caller->service_host);
+  caller->service_host = host;
+  caller->service_port = port;
+}
+
+// Set the provider address from its URI. A host name is resolved in the background by
+// getaddrinfo_a(), so that the events loop doesn't wait for the DNS (see checkServiceHostResolver()).
+// Returns 0 if the address is set, 1 if the host name is being resolved, -1 on failure
+static int setServiceCallerUri(ServiceCallerNode *caller, const char *uri)
+{
+  // uri is in the form rosrpc://host:port, possibly with a trailing '/'
+  const char *prefix = "rosrpc://";
+  size_t prefix_len = strlen(prefix);
+  if (uri == NULL || strncmp(uri, prefix, prefix_len) != 0)
+    return -1;
+
+  const char *host_begin = uri + prefix_len;
+  const char *port_begin = strrchr(host_begin, ':');
+  if (port_begin == NULL || port_begin == host_begin)
+    return -1;
+
+  char hostname[256];
+  size_t host_len = port_begin - host_begin;
+  if (host_len >= sizeof(hostname))
+    return -1;
+
+  memcpy(hostname, host_begin, host_len);
+  hostname[host_len] = '\0';
+
+  int port = atoi(port_begin + 1);
+  if (port <= 0)
+    return -1;
+
+  if (caller->resolver != NULL)
+  {
+    releaseServiceHostResolver(caller->resolver);
+    caller->resolver = NULL;
+  }
+
+  struct in_addr addr;
+  if (inet_pton(AF_INET, hostname, &addr) == 1)
+  {
+    char *host = strdup(hostname);
+    if (host == NULL)
+      return -1;
+
+    setServiceCallerAddress(caller, host, port);
+    return 0;
+  }
+
+  ServiceHostResolver *resolver = (ServiceHostResolver *)calloc(1, sizeof(ServiceHostResolver));
+  if (resolver == NULL)
+    return -1;
+
+  strcpy(resolver->hostname, hostname);
+  resolver->port = port;
+  resolver->hints.ai_family = AF_INET; // tcpIpSocketConnect() supports IPv4 only
+  resolver->hints.ai_socktype = SOCK_STREAM;
+  resolver->request.ar_name = resolver->hostname;
+  resolver->request.ar_request = &resolver->hints;
+
+  struct gaicb *list[1] = { &resolver->request };
+  if (getaddrinfo_a(GAI_NOWAIT, list, 1, NULL) != 0)
+  {
+    PRINT_ERROR("setServiceCallerUri() : Can't resolve %s\n", hostname);
+    free(resolver);
+    return -1;
+  }
+
+  caller->resolver = resolver;
+  return 1;
+}
+
+// Check the resolution started by setServiceCallerUri().
+// Returns 0 if the provider address is set, 1 if the resolution is in progress, -1 on failure
+static int checkServiceHostResolver(ServiceCallerNode *caller)
+{
+  ServiceHostResolver *resolver = caller->resolver;
+  int rc = gai_error(&resolver->request);
+  if (rc == EAI_INPROGRESS)
+    return 1;
+
+  char *host = NULL;
+  struct addrinfo *result = resolver->request.ar_result;
+  if (rc == 0 && result != NULL)
+  {
+    host = (char *)calloc(INET_ADDRSTRLEN, sizeof(char));
+    const struct sockaddr_in *addr = (const struct sockaddr_in *)result->ai_addr;
+    if (host != NULL && inet_ntop(AF_INET, &addr->sin_addr, host, INET_ADDRSTRLEN) == NULL)
+    {
+      free(host);
+      host = NULL;
+    }
+  }
+  else
+  {
+    PRINT_ERROR("checkServiceHostResolver() : Can't resolve %s: %s\n", resolver->hostname, gai_strerror(rc));
+  }
+
+  int port = resolver->port;
+  caller->resolver = NULL;
+  releaseServiceHostResolver(resolver);
+  if (host == NULL)
+    return -1;
+
+  setServiceCallerAddress(caller, host, port);
+  return 0;
+}
+
+// Forget the provider address (and the related cached lookup): it will be looked up again
+static void forgetServiceProvider(CrosNode *n, int i)
+{
+  ServiceCallerNode *caller = &n->service_callers[i];
+  cRosLookupCacheInvalidate(&n->lookup_cache, CROS_LOOKUP_CACHE_SERVICE, caller->service_name);
+  free(caller->service_host);
+  caller->service_host = NULL;
+  caller->service_port = -1;
+  caller->uri_from_cache = 0;
+  if (caller->resolver != NULL)
+  {
+    releaseServiceHostResolver(caller->resolver);
+    caller->resolver = NULL;
+  }
+}
+
+static void handleRpcrosClientError(CrosNode *n, int i)
+{
+  TcprosProcess *process = &n->rpcros_client_proc[i];
+  ServiceCallerNode *caller = &n->service_callers[i];
+  closeTcprosProcess(process);
+
+  // A cached address may be stale: if the provider has not been reached yet, the queued
+  // calls get a fresh lookup. Otherwise they fail as well
+  int retry = caller->uri_from_cache && caller->sent_head == NULL;
+  forgetServiceProvider(n, i);
+
+  failServiceCalls(n, i, &caller->sent_head, &caller->sent_tail);
+  if (!retry)
+    failServiceCalls(n, i, &caller->queue_head, &caller->queue_tail);
+}
+
 static void doWithXmlrpcClientSocket(CrosNode *n, int i)
 {
   PRINT_VDEBUG ( "doWithXmlrpcClientSocket()\n" );
@@ -553,6 +922,88 @@ static void doWithXmlrpcServerSocket( CrosNode *n, int i )
   }
 }
 
+// Traffic counters of the connections (see getBusStats and getBusInfo)
+static void countSentMessage( TcprosProcess *process, size_t size )
+{
+  process->bytes_sent += size;
+  process->msgs_sent++;
+  process->last_activity_time = cRosClockGetTimeMs();
+}
+
+static void countReceivedMessage( TcprosProcess *process, size_t size )
+{
+  process->bytes_received += size;
+  process->msgs_received++;
+  process->last_activity_time = cRosClockGetTimeMs();
+}
+
+static void countServiceRequest( CrosNode *n, TcprosProcess *process, size_t size )
+{
+  countReceivedMessage( process, size );
+  n->service_requests++;
+  n->service_bytes_received += size;
+}
+
+// Dispatch all the complete messages ([size][data]) buffered by a subscriber connection,
+// and move the trailing incomplete one at the beginning of the buffer
+static void dispatchPublicationPackets( CrosNode *n, int client_idx )
+{
+  TcprosProcess *client_proc = &(n->tcpros_client_proc[client_idx]);
+  DynBuffer *packet = &(client_proc->packet);
+
+  while( client_proc->state == TCPROS_PROCESS_STATE_READING_SIZE &&
+         dynBufferGetRemainingDataSize( packet ) >= sizeof(uint32_t) )
+  {
+    const unsigned char *data = dynBufferGetCurrentData( packet );
+    uint32_t msg_size = 0;
+    ROS_TO_HOST_UINT32( *((uint32_t *)data), msg_size );
+    if( dynBufferGetRemainingDataSize( packet ) - sizeof(uint32_t) < msg_size )
+      break;
+
+    dynBufferMovePoseIndicator( packet, sizeof(uint32_t) + msg_size );
+
+    DynBuffer msg;
+    dynBufferInitView( &msg, data + sizeof(uint32_t), msg_size );
+    countReceivedMessage( client_proc, msg_size + sizeof(uint32_t) );
+    cRosMessageParsePublicationPacket( n, client_idx, &msg );
+  }
+
+  dynBufferCompact( packet );
+}
+
+// Read a chunk of the messages of a subscriber connection: with io_uring, the data comes from a
+// receive completed by the event loop (the socket isn't read again)
+static TcpIpSocketState readPublicationData( CrosNode *n, TcprosProcess *client_proc, size_t *n_reads )
+{
+#ifdef CROS_USE_IO_URING
+  const unsigned char *data;
+  ssize_t ret = cRosUringRecv( &n->uring, tcpIpSocketGetFD( &(client_proc->socket) ), &data );
+  if( ret > 0 )
+  {
+    if( dynBufferPushBackBuf( &(client_proc->packet), data, (size_t)ret ) < 0 )
+      return TCPIPSOCKET_FAILED;
+    *n_reads = (size_t)ret;
+    return TCPIPSOCKET_DONE;
+  }
+
+  *n_reads = 0;
+  if( ret == 0 || errno == ECONNRESET || errno == ENOTCONN )
+  {
+    client_proc->socket.connected = 0;
+    return TCPIPSOCKET_DISCONNECTED;
+  }
+  if( errno == EAGAIN )
+    return TCPIPSOCKET_IN_PROGRESS;
+  if( errno != ENOTSUP )
+    return TCPIPSOCKET_FAILED;
+#else
+  (void)n;
+#endif
+
+  return tcpIpSocketReadBufferEx( &(client_proc->socket), &(client_proc->packet),
+                                  CN_TCPROS_RECV_CHUNK_SIZE, n_reads );
+}
+
 static void doWithTcprosClientSocket( CrosNode *n, int client_idx)
 {
   PRINT_VDEBUG ( "doWithTcprosSubscriberNode()\n" );
@@ -565,12 +1016,16 @@ static void doWithTcprosClientSocket( CrosNode *n, int client_idx)
     {
       SubscriberNode *sub = &(n->subs[client_proc->topic_idx]);
       tcprosProcessClear( client_proc, 0 );
-      TcpIpSocketState conn_state = tcpIpSocketConnect( &(client_proc->socket),
-                                           sub->topic_host, sub->tcpros_port );
+      TcpIpSocketState conn_state;
+      if( client_proc->socket.family == AF_UNIX )
+        conn_state = tcpIpSocketConnectUnix( &(client_proc->socket), sub->unixros_path );
+      else
+        conn_state = tcpIpSocketConnect( &(client_proc->socket), sub->topic_host, sub->tcpros_port );
       switch (conn_state)
       {
         case TCPIPSOCKET_DONE:
         {
+          tcprosProcessStartConnection( client_proc, n->next_connection_id++ );
           tcprosProcessChangeState( client_proc, TCPROS_PROCESS_STATE_WRITING_HEADER );
           break;
         }
@@ -583,7 +1038,15 @@ static void doWithTcprosClientSocket( CrosNode *n, int client_idx)
         case TCPIPSOCKET_FAILED:
         {
           PRINT_DEBUG ( "doWithXmlrpcClientSocket() : error\n" );
+          int unixros = ( client_proc->socket.family == AF_UNIX );
           handleTcprosClientError( n, client_idx);
+          if( unixros )
+          {
+            // Ask again for TCPROS
+            sub->unixros_refused = 1;
+            sub->tcpros_port = -1;
+            enqueueRequestTopic( n, client_proc->topic_idx );
+          }
           break;
         }
         default:
@@ -706,60 +1169,20 @@ static void doWithTcprosClientSocket( CrosNode *n, int client_idx)
           handleTcprosClientError( n, client_idx );
           break;
       }
-    }
-    case TCPROS_PROCESS_STATE_READING_SIZE:
-    {
-      size_t n_reads;
-      TcpIpSocketState sock_state = tcpIpSocketReadBufferEx( &(client_proc->socket),
-                                                          &(client_proc->packet),
-                                                          client_proc->left_to_recv,
-                                                          &n_reads);
-
-      switch ( sock_state )
-      {
-        case TCPIPSOCKET_DONE:
-          client_proc->left_to_recv -= n_reads;
-          if (client_proc->left_to_recv == 0)
-          {
-            const unsigned char *data = dynBufferGetCurrentData(&client_proc->packet);
-            uint32_t msg_size = 0;
-            ROS_TO_HOST_UINT32(*((uint32_t *)data), msg_size);
-            tcprosProcessClear( client_proc, 0);
-            client_proc->left_to_recv = msg_size;
-            tcprosProcessChangeState( client_proc, TCPROS_PROCESS_STATE_READING);
-            goto read_msg;
-          }
-          break;
-        case TCPIPSOCKET_IN_PROGRESS:
-          break;
-        case TCPIPSOCKET_DISCONNECTED:
-        case TCPIPSOCKET_FAILED:
-        default:
-          handleTcprosClientError( n, client_idx );
-          break;
-      }
       break;
     }
-    read_msg:
+    case TCPROS_PROCESS_STATE_READING_SIZE:
     case TCPROS_PROCESS_STATE_READING:
     {
+      /* Messages are read in large chunks: every complete message received is dispatched,
+         an incomplete one is left in the packet buffer and completed by the next reads */
       size_t n_reads;
-      TcpIpSocketState sock_state = tcpIpSocketReadBufferEx( &(client_proc->socket),
-                                                          &(client_proc->packet),
-                                                          client_proc->left_to_recv,
-                                                          &n_reads);
+      TcpIpSocketState sock_state = readPublicationData( n, client_proc, &n_reads );
 
       switch ( sock_state )
       {
         case TCPIPSOCKET_DONE:
-          client_proc->left_to_recv -= n_reads;
-          if (client_proc->left_to_recv == 0)
-          {
-              cRosMessageParsePublicationPacket(n, client_idx);
-              tcprosProcessClear( client_proc, 0);
-              client_proc->left_to_recv = sizeof(uint32_t);
-              tcprosProcessChangeState( client_proc, TCPROS_PROCESS_STATE_READING_SIZE );
-          }
+          dispatchPublicationPackets( n, client_idx );
           break;
         case TCPIPSOCKET_IN_PROGRESS:
           break;
@@ -780,28 +1203,257 @@ static void doWithTcprosClientSocket( CrosNode *n, int client_idx)
   }
 }
 
-static void doWithTcprosServerSocket( CrosNode *n, int i )
+// Move the oldest packet of the send queue of a connection to dest, or drop it if dest is NULL
+static void popSendQueue( TcprosProcess *server_proc, DynBuffer *dest )
 {
-  PRINT_VDEBUG ( "doWithTcprosServerSocket()\n" );
-  
-  TcprosProcess *server_proc = &(n->tcpros_server_proc[i]);
+  DynBuffer *queue = &(server_proc->send_queue);
+  const unsigned char *data = dynBufferGetCurrentData( queue );
+  uint32_t msg_size = 0;
+  ROS_TO_HOST_UINT32( *((uint32_t *)data), msg_size );
+  size_t packet_size = sizeof(uint32_t) + msg_size;
+  if( dest != NULL )
+    dynBufferPushBackBuf( dest, data, packet_size );
+  dynBufferMovePoseIndicator( queue, packet_size );
+  server_proc->n_send_queued--;
+
+  // The space of the sent packets is reclaimed once it exceeds the one of the queued packets
+  if( server_proc->n_send_queued == 0 )
+    dynBufferClear( queue );
+  else if( dynBufferGetPoseIndicatorOffset( queue ) > dynBufferGetRemainingDataSize( queue ) )
+    dynBufferCompact( queue );
+}
 
-  if( server_proc->state == TCPROS_PROCESS_STATE_READING_HEADER)
+// Queue the packet of a publisher for a connection still writing the previous ones
+static void queuePublicationPacket( PublisherNode *pub, TcprosProcess *server_proc )
+{
+  if( server_proc->n_send_queued >= pub->send_queue_size )
   {
-    PRINT_DEBUG ( "doWithTcprosServerSocket() : Reading header index %d \n", i );
-    tcprosProcessClear( server_proc, 0);
-    TcpIpSocketState sock_state = tcpIpSocketReadBuffer( &(server_proc->socket), 
-                                                         &(server_proc->packet) );
-    TcprosParserState parser_state = TCPROS_PARSER_ERROR;
-    
-    switch ( sock_state )
+    server_proc->drops++;
+    if( pub->send_queue_size == 0 || pub->drop_policy == CROS_DROP_NEWEST )
+      return;
+
+    while( server_proc->n_send_queued >= pub->send_queue_size )
+      popSendQueue( server_proc, NULL );
+  }
+
+  if( dynBufferPushBackBuf( &(server_proc->send_queue), dynBufferGetData( &(pub->packet) ),
+                            dynBufferGetSize( &(pub->packet) ) ) == -1 )
+  {
+    server_proc->drops++;
+    return;
+  }
+
+  server_proc->n_send_queued++;
+}
+
+static int canQueuePublicationPacket( PublisherNode *pub, TcprosProcess *server_proc )
+{
+  return pub->send_queue_size > 0 &&
+         ( pub->drop_policy == CROS_DROP_OLDEST || server_proc->n_send_queued < pub->send_queue_size );
+}
+
+// Write the packets of a publisher connection: with io_uring, they are copied and sent by the event
+// loop, that reports the connection ready for writing when the copy has been sent
+static TcpIpSocketState writePublicationData( CrosNode *n, TcprosProcess *server_proc,
+                                              const struct iovec *iov, int iovcnt, size_t *n_written )
+{
+#ifdef CROS_USE_IO_URING
+  ssize_t ret = cRosUringSend( &n->uring, tcpIpSocketGetFD( &(server_proc->socket) ), iov, iovcnt );
+  if( ret >= 0 )
+  {
+    *n_written = (size_t)ret;
+    return TCPIPSOCKET_DONE;
+  }
+
+  *n_written = 0;
+  if( errno == EAGAIN )
+    return TCPIPSOCKET_IN_PROGRESS;
+  if( errno == ENOTCONN || errno == ECONNRESET || errno == EPIPE )
+  {
+    server_proc->socket.connected = 0;
+    return TCPIPSOCKET_DISCONNECTED;
+  }
+  if( errno != ENOTSUP )
+    return TCPIPSOCKET_FAILED;
+#else
+  (void)n;
+#endif
+
+  return tcpIpSocketWriteIov( &(server_proc->socket), iov, iovcnt, n_written );
+}
+
+// Write the current packet of a connection followed by its queued packets: every writev() coalesces
+// the whole queued packets that fit the write batch size of the publisher (a larger packet is written
+// alone). A queued packet written in part becomes the current packet. Returns TCPIPSOCKET_DONE when
+// the current packet and the queue are empty
+static TcpIpSocketState writePublicationPackets( CrosNode *n, PublisherNode *pub, TcprosProcess *server_proc )
+{
+  DynBuffer *packet = &(server_proc->packet);
+  DynBuffer *queue = &(server_proc->send_queue);
+
+  while( dynBufferGetRemainingDataSize( packet ) > 0 || server_proc->n_send_queued > 0 )
+  {
+    size_t packet_size = dynBufferGetRemainingDataSize( packet );
+    const unsigned char *queue_data = dynBufferGetCurrentData( queue );
+    size_t queue_size = dynBufferGetRemainingDataSize( queue ), batch_size = 0;
+    while( pub->write_batch_size > 0 && batch_size < queue_size )
     {
-      case TCPIPSOCKET_DONE:
-        parser_state = cRosMessageParseSubcriptionHeader( n, i );
-        break;
-        
-      case TCPIPSOCKET_IN_PROGRESS:
-      	parser_state = TCPROS_PARSER_HEADER_INCOMPLETE;
+      uint32_t msg_size = 0;
+      ROS_TO_HOST_UINT32( *((uint32_t *)(queue_data + batch_size)), msg_size );
+
+      // A packet larger than the batch size is written alone
+      if( packet_size + batch_size + sizeof(uint32_t) + msg_size > pub->write_batch_size &&
+          packet_size + batch_size > 0 )
+        break;
+
+      batch_size += sizeof(uint32_t) + msg_size;
+    }
+
+    // Writing the packets one by one
+    if( packet_size == 0 && batch_size == 0 )
+    {
+      popSendQueue( server_proc, packet );
+      continue;
+    }
+
+    struct iovec iov[2];
+    iov[0].iov_base = (void *)dynBufferGetCurrentData( packet );
+    iov[0].iov_len = packet_size;
+    iov[1].iov_base = (void *)queue_data;
+    iov[1].iov_len = batch_size;
+
+    size_t n_written;
+    TcpIpSocketState sock_state = writePublicationData( n, server_proc, iov, 2, &n_written );
+    if( sock_state != TCPIPSOCKET_DONE )
+      return sock_state;
+    if( n_written == 0 )
+      return TCPIPSOCKET_IN_PROGRESS;
+
+    if( n_written < packet_size )
+    {
+      dynBufferMovePoseIndicator( packet, n_written );
+      continue;
+    }
+
+    if( dynBufferGetSize( packet ) > 0 )
+      countSentMessage( server_proc, dynBufferGetSize( packet ) );
+    dynBufferClear( packet );
+    n_written -= packet_size;
+
+    while( n_written > 0 )
+    {
+      uint32_t msg_size = 0;
+      ROS_TO_HOST_UINT32( *((uint32_t *)dynBufferGetCurrentData( queue )), msg_size );
+      if( n_written < sizeof(uint32_t) + msg_size )
+      {
+        popSendQueue( server_proc, packet );
+        dynBufferMovePoseIndicator( packet, n_written );
+        break;
+      }
+
+      popSendQueue( server_proc, NULL );
+      countSentMessage( server_proc, sizeof(uint32_t) + msg_size );
+      n_written -= sizeof(uint32_t) + msg_size;
+    }
+  }
+
+  return TCPIPSOCKET_DONE;
+}
+
+// Generate the packet of a publisher once, and start sending it to all its idle subscribers.
+// The ones still writing the previous packets queue it, if their send queue allows, or skip this cycle
+static void startPublicationCycle( CrosNode *n, int pub_idx, uint64_t cur_time )
+{
+  PublisherNode *pub = &n->pubs[pub_idx];
+
+  int i, n_ready = 0;
+  for( i = 0; i < CN_MAX_TCPROS_SERVER_CONNECTIONS; i++ )
+  {
+    TcprosProcess *server_proc = &(n->tcpros_server_proc[i]);
+    if( server_proc->topic_idx != pub_idx )
+      continue;
+
+    if( server_proc->state == TCPROS_PROCESS_STATE_WAIT_FOR_WRITING )
+      n_ready++;
+    else if( ( server_proc->state == TCPROS_PROCESS_STATE_START_WRITING ||
+               server_proc->state == TCPROS_PROCESS_STATE_WRITING ) &&
+             canQueuePublicationPacket( pub, server_proc ) )
+      n_ready++;
+  }
+
+  // The subscribers of the same process or host are always ready, their queue drops the packets in excess,
+  // as the UDPROS ones
+  n_ready += pub->n_intra_subs + cRosShmHasReaders( n, pub_idx ) + cRosUdprosHasSubscribers( n, pub_idx );
+
+  // No subscriber to publish to: the cycle starts as soon as one is ready
+  if( n_ready == 0 )
+    return;
+
+  // The connections that haven't started writing the previous packet take it before it's replaced
+  if( pub->send_queue_size > 0 )
+  {
+    for( i = 0; i < CN_MAX_TCPROS_SERVER_CONNECTIONS; i++ )
+    {
+      TcprosProcess *server_proc = &(n->tcpros_server_proc[i]);
+      if( server_proc->topic_idx == pub_idx && server_proc->state == TCPROS_PROCESS_STATE_START_WRITING )
+      {
+        tcprosProcessClear( server_proc, 0 );
+        dynBufferPushBackBuf( &(server_proc->packet), dynBufferGetData( &(pub->packet) ),
+                              dynBufferGetSize( &(pub->packet) ) );
+        tcprosProcessChangeState( server_proc, TCPROS_PROCESS_STATE_WRITING );
+      }
+    }
+  }
+
+  pub->wake_up_time_ms = cur_time + pub->loop_period;
+  cRosMessagePreparePublicationPacket( n, pub_idx );
+  cRosIntraprocessPublish( n, pub_idx );
+  cRosShmPublish( n, pub_idx );
+  cRosUdprosPublish( n, pub_idx );
+
+  for( i = 0; i < CN_MAX_TCPROS_SERVER_CONNECTIONS; i++ )
+  {
+    TcprosProcess *server_proc = &(n->tcpros_server_proc[i]);
+    if( server_proc->topic_idx != pub_idx )
+      continue;
+
+    if( server_proc->state == TCPROS_PROCESS_STATE_WAIT_FOR_WRITING )
+    {
+      tcprosProcessChangeState( server_proc, TCPROS_PROCESS_STATE_START_WRITING );
+      server_proc->busy_since = cur_time;
+      if( pub->write_window_us > 0 && pub->send_queue_size > 0 )
+        server_proc->write_after_us = cRosClockGetTimeUs() + pub->write_window_us;
+    }
+    else if( server_proc->state == TCPROS_PROCESS_STATE_START_WRITING ||
+             server_proc->state == TCPROS_PROCESS_STATE_WRITING )
+    {
+      queuePublicationPacket( pub, server_proc );
+    }
+  }
+}
+
+static void doWithTcprosServerSocket( CrosNode *n, int i )
+{
+  PRINT_VDEBUG ( "doWithTcprosServerSocket()\n" );
+  
+  TcprosProcess *server_proc = &(n->tcpros_server_proc[i]);
+
+  if( server_proc->state == TCPROS_PROCESS_STATE_READING_HEADER)
+  {
+    PRINT_DEBUG ( "doWithTcprosServerSocket() : Reading header index %d \n", i );
+    tcprosProcessClear( server_proc, 0);
+    TcpIpSocketState sock_state = tcpIpSocketReadBuffer( &(server_proc->socket), 
+                                                         &(server_proc->packet) );
+    TcprosParserState parser_state = TCPROS_PARSER_ERROR;
+    
+    switch ( sock_state )
+    {
+      case TCPIPSOCKET_DONE:
+        parser_state = cRosMessageParseSubcriptionHeader( n, i );
+        break;
+        
+      case TCPIPSOCKET_IN_PROGRESS:
+      	parser_state = TCPROS_PARSER_HEADER_INCOMPLETE;
         break;
         
       case TCPIPSOCKET_DISCONNECTED:
@@ -819,7 +1471,7 @@ static void doWithTcprosServerSocket( CrosNode *n, int i )
         PRINT_DEBUG ( "doWithTcprosServerSocket() : Done read() and parse() with no error\n" );
         tcprosProcessClear( server_proc, 0);
         cRosMessagePreparePublicationHeader( n, i );
-        tcprosProcessChangeState( server_proc, TCPROS_PROCESS_STATE_WRITING );
+        tcprosProcessChangeState( server_proc, TCPROS_PROCESS_STATE_WRITING_HEADER );
         break;
       case TCPROS_PARSER_HEADER_INCOMPLETE:
         break;
@@ -831,25 +1483,43 @@ static void doWithTcprosServerSocket( CrosNode *n, int i )
         break;
     }
   }
-  else if( server_proc->state == TCPROS_PROCESS_STATE_START_WRITING ||
+  else if( server_proc->state == TCPROS_PROCESS_STATE_WRITING_HEADER ||
+           server_proc->state == TCPROS_PROCESS_STATE_START_WRITING ||
            server_proc->state == TCPROS_PROCESS_STATE_WRITING )
   {
     PRINT_DEBUG ( "doWithTcprosServerSocket() : writing() index %d \n", i );
+    PublisherNode *pub = &n->pubs[server_proc->topic_idx];
     if( server_proc->state == TCPROS_PROCESS_STATE_START_WRITING )
     {
+      // The packet has been already generated for all the subscribers
       tcprosProcessClear( server_proc, 0 );
-      cRosMessagePreparePublicationPacket( n, i );
+      dynBufferPushBackBuf( &(server_proc->packet), dynBufferGetData( &(pub->packet) ),
+                            dynBufferGetSize( &(pub->packet) ) );
       tcprosProcessChangeState( server_proc, TCPROS_PROCESS_STATE_WRITING );      
     }
-    TcpIpSocketState sock_state =  tcpIpSocketWriteBuffer( &(server_proc->socket), 
-                                                           &(server_proc->packet) );
-    
+    TcpIpSocketState sock_state;
+    if( server_proc->state == TCPROS_PROCESS_STATE_WRITING_HEADER )
+      sock_state = tcpIpSocketWriteBuffer( &(server_proc->socket), &(server_proc->packet) );
+    else
+      sock_state = writePublicationPackets( n, pub, server_proc );
+
     switch ( sock_state )
     {
       case TCPIPSOCKET_DONE:
         PRINT_DEBUG ( "doWithTcprosServerSocket() : Done write() with no error\n" );
         tcprosProcessClear( server_proc, 0);
-        tcprosProcessChangeState( server_proc, TCPROS_PROCESS_STATE_WAIT_FOR_WRITING );
+        if( server_proc->state == TCPROS_PROCESS_STATE_WRITING_HEADER &&
+            dynBufferGetSize( &(pub->packet) ) > 0 )
+        {
+          // Latching: send immediately the last published packet to the new subscriber
+          tcprosProcessChangeState( server_proc, TCPROS_PROCESS_STATE_START_WRITING );
+        }
+        else
+        {
+          tcprosProcessChangeState( server_proc, TCPROS_PROCESS_STATE_WAIT_FOR_WRITING );
+          server_proc->busy_since = 0;
+          server_proc->lagging = 0;
+        }
         break;
 
       case TCPIPSOCKET_IN_PROGRESS:
@@ -1016,12 +1686,19 @@ static void doWithRpcrosServerSocket(CrosNode *n, int i)
           if (server_proc->left_to_recv == 0)
           {
             const unsigned char *data = dynBufferGetCurrentData(&server_proc->packet);
-            uint32_t msg_size = (uint32_t)*data;
+            uint32_t msg_size;
+            ROS_TO_HOST_UINT32(*((uint32_t *)data), msg_size);
             tcprosProcessClear( server_proc, 0);
             if (msg_size == 0)
             {
               PRINT_DEBUG ( "doWithRpcrosServerSocket() : Done read() with no error\n" );
-              cRosMessagePrepareServiceResponsePacket(n, i);
+              countServiceRequest( n, server_proc, sizeof(uint32_t) );
+              if (cRosMessagePrepareServiceResponsePacket(n, i) == CN_SERVICE_RESPONSE_DEFERRED)
+              {
+                // Wait for cRosNodeSendServiceResponse()
+                tcprosProcessChangeState( server_proc, TCPROS_PROCESS_STATE_WAIT_FOR_WRITING );
+                break;
+              }
               tcprosProcessChangeState( server_proc, TCPROS_PROCESS_STATE_WRITING);
               goto write_msg;
             }
@@ -1061,8 +1738,11 @@ static void doWithRpcrosServerSocket(CrosNode *n, int i)
           if (server_proc->left_to_recv == 0)
           {
               PRINT_DEBUG ( "doWithRpcrosServerSocket() : Done read() with no error\n" );
-              cRosMessagePrepareServiceResponsePacket(n, i);
-              tcprosProcessChangeState( server_proc, TCPROS_PROCESS_STATE_WRITING );
+              countServiceRequest( n, server_proc, dynBufferGetSize( &(server_proc->packet) ) + sizeof(uint32_t) );
+              if (cRosMessagePrepareServiceResponsePacket(n, i) == CN_SERVICE_RESPONSE_DEFERRED)
+                tcprosProcessChangeState( server_proc, TCPROS_PROCESS_STATE_WAIT_FOR_WRITING );
+              else
+                tcprosProcessChangeState( server_proc, TCPROS_PROCESS_STATE_WRITING );
           }
           break;
         case TCPIPSOCKET_IN_PROGRESS:
@@ -1100,8 +1780,19 @@ static void doWithRpcrosServerSocket(CrosNode *n, int i)
       {
         case TCPIPSOCKET_DONE:
           PRINT_DEBUG ( "doWithRpcrosServerSocket() : Done write() with no error\n" );
-          tcprosProcessClear( server_proc, 1 );
-          tcprosProcessChangeState( server_proc, TCPROS_PROCESS_STATE_IDLE);
+          countSentMessage( server_proc, dynBufferGetSize( &(server_proc->packet) ) );
+          n->service_bytes_sent += dynBufferGetSize( &(server_proc->packet) );
+          if (server_proc->persistent)
+          {
+            // Wait for the next request on the same connection
+            tcprosProcessClear( server_proc, 0 );
+            server_proc->left_to_recv = sizeof(uint32_t);
+            tcprosProcessChangeState( server_proc, TCPROS_PROCESS_STATE_READING_SIZE );
+          }
+          else
+          {
+            closeTcprosProcess( server_proc );
+          }
           break;
 
         case TCPIPSOCKET_IN_PROGRESS:
@@ -1129,184 +1820,565 @@ static void doWithRpcrosServerSocket(CrosNode *n, int i)
   }
 }
 
-/*
- * Services, publisher and support functions for the logging feature
- */
-static CrosLogLevel stringToLogLevel(const char* level_str)
+// Move the queued requests to the send queue of the connection, that is written while the responses
+// are read (see doWithRpcrosClientSocket()): a persistent connection pipelines up to
+// CN_SERVICE_PIPELINE_DEPTH requests waiting for their response, otherwise a single request is sent
+// for each connection
+static void prepareServiceCallPacket(CrosNode *n, int i)
 {
-  if(strncmp("Info",level_str, strlen(level_str)) == 0)
-  {
-    return CROS_LOGLEVEL_INFO;
-  }
-  else if(strncmp("Debug",level_str, strlen(level_str)) == 0)
-  {
-    return CROS_LOGLEVEL_DEBUG;
-  }
-  else if(strncmp("Warn",level_str, strlen(level_str)) == 0)
-  {
-    return CROS_LOGLEVEL_WARN;
-  }
-  else if(strncmp("Error",level_str, strlen(level_str)) == 0)
-  {
-    return CROS_LOGLEVEL_ERROR;
-  }
-  else // Fatal
-  {
-    return CROS_LOGLEVEL_FATAL;
-  }
-}
+  TcprosProcess *client_proc = &(n->rpcros_client_proc[i]);
+  ServiceCallerNode *caller = &(n->service_callers[i]);
+  DynBuffer *packet = &(client_proc->send_queue);
 
-static char* LogLevelToString(CrosLogLevel log_level)
-{
-  char* ret = NULL;
+  // Drop the requests already written
+  dynBufferCompact( packet );
 
-  switch(log_level)
+  int max_sent = caller->persistent ? CN_SERVICE_PIPELINE_DEPTH : 1;
+  int n_sent = 0;
+  ServiceCallNode *call;
+  for (call = caller->sent_head; call != NULL; call = call->next)
+    n_sent++;
+
+  while (n_sent < max_sent && (call = popServiceCall(&caller->queue_head, &caller->queue_tail)) != NULL)
   {
-    case CROS_LOGLEVEL_INFO:
-    {
-      ret = calloc(strlen("INFO") + 1, sizeof(char));
-      strncpy(ret, "INFO",strlen("INFO"));
-      return ret;
-    }
-    case CROS_LOGLEVEL_DEBUG:
-    {
-      ret = calloc(strlen("DEBUG") + 1, sizeof(char));
-      strncpy(ret, "DEBUG",strlen("DEBUG"));
-      return ret;
-    }
-    case CROS_LOGLEVEL_WARN:
-    {
-      ret = calloc(strlen("WARN") + 1, sizeof(char));
-      strncpy(ret, "WARN",strlen("WARN"));
-      return  ret;
-    }
-    case CROS_LOGLEVEL_ERROR:
-    {
-      ret = calloc(strlen("ERROR") + 1, sizeof(char));
-      strncpy(ret, "ERROR",strlen("ERROR"));
-      return ret;
-    }
-    case CROS_LOGLEVEL_FATAL:
-    {
-      ret = calloc(strlen("FATAL") + 1, sizeof(char));
-      strncpy(ret, "FATAL",strlen("FATAL"));
-      return ret;
-    }
-    default:
-    {
-      assert(0);
-    }
+    uint32_t size = (uint32_t)dynBufferGetSize(&call->request), out_size;
+    HOST_TO_ROS_UINT32( size, out_size );
+    dynBufferPushBackUInt32( packet, out_size );
+    if (size > 0)
+      dynBufferPushBackBuf( packet, dynBufferGetData(&call->request), size );
+
+    // The request data is no more needed
+    dynBufferRelease(&call->request);
+    dynBufferInit(&call->request);
+    appendServiceCall(&caller->sent_head, &caller->sent_tail, call);
+    n_sent++;
   }
 }
 
-static CallbackResponse callback_pub_log(cRosMessage *message, void* data_context)
+// Deliver all the complete responses in the packet, in the same order of the requests
+static void dispatchServiceResponses(CrosNode *n, int i)
 {
-  CrosNode* node = (CrosNode*) data_context;
-  CrosLogQueue* queue = node->log_queue;
+  TcprosProcess *client_proc = &(n->rpcros_client_proc[i]);
+  ServiceCallerNode *caller = &(n->service_callers[i]);
+  DynBuffer *packet = &(client_proc->packet);
 
-  if(!cRosLogQueueIsEmpty(queue))
+  while (caller->sent_head != NULL)
   {
-    CrosLog* log = cRosLogQueueDequeue(queue);
-
-    cRosMessageField* header_field = cRosMessageGetField(message, "header");
-    cRosMessage* header_msg = header_field->data.as_msg;
-    cRosMessageField* seq_id = cRosMessageGetField(header_msg, "seq");
-    seq_id->data.as_uint32 = node->log_last_id++;
-    cRosMessageField* time_field = cRosMessageGetField(header_msg, "stamp");
-    cRosMessage* time_msg = time_field->data.as_msg;
-    cRosMessageField* time_secs = cRosMessageGetField(time_msg, "secs");
-    time_secs->data.as_uint32 = log->secs;
-    cRosMessageField* time_nsecs = cRosMessageGetField(time_msg, "nsecs");
-    time_nsecs->data.as_uint32 = log->nsecs;
-    cRosMessageSetFieldValueString(cRosMessageGetField(header_msg, "frame_id"), "0");
-
-
-    cRosMessageField* level = cRosMessageGetField(message, "level");
-    level->data.as_uint8 = log->level;
-
-    cRosMessageField* name = cRosMessageGetField(message, "name"); //name of the node
-    cRosMessageSetFieldValueString(name, node->name);
-
-    cRosMessageField* msg = cRosMessageGetField(message, "msg"); //message
-    cRosMessageSetFieldValueString(msg, log->msg);
-
-    cRosMessageField* file = cRosMessageGetField(message, "file"); //file the message came from
-    cRosMessageSetFieldValueString(file, log->file);
+    // Response: ok byte, data size, data (an error string if ok is 0)
+    size_t available = (size_t)dynBufferGetRemainingDataSize(packet);
+    if (available < 1 + sizeof(uint32_t))
+      break;
 
-    cRosMessageField* function = cRosMessageGetField(message, "function"); //function the message came from
-    cRosMessageSetFieldValueString(function, log->function);
+    const unsigned char *data = dynBufferGetCurrentData(packet);
+    unsigned char ok = data[0];
+    uint32_t in_size, size;
+    memcpy(&in_size, data + 1, sizeof(uint32_t));
+    ROS_TO_HOST_UINT32( in_size, size );
+    if (available - (1 + sizeof(uint32_t)) < size)
+      break;
 
-    cRosMessageField* line = cRosMessageGetField(message, "line"); //line the message came from
-    line->data.as_uint32 = log->line;
+    DynBuffer response;
+    dynBufferInit(&response);
+    if (size > 0)
+      dynBufferPushBackBuf(&response, data + 1 + sizeof(uint32_t), size);
+    dynBufferMovePoseIndicator(packet, 1 + sizeof(uint32_t) + size);
 
-    cRosMessageField* topics = cRosMessageGetField(message, "topics"); //topic names that the node publishes
-    int i;
-    for(i = 0; i < log->n_pubs; i++)
+    ServiceCallNode *call = popServiceCall(&caller->sent_head, &caller->sent_tail);
+    ServiceCallerCallback callback = caller->callback;
+    if (!ok)
     {
-      cRosMessageFieldArrayPushBackString(topics, log->pubs[i]);
+      PRINT_ERROR("dispatchServiceResponses() : Service %s failed: %.*s\n", caller->service_name,
+                  (int)size, size > 0 ? (const char *)dynBufferGetData(&response) : "");
     }
 
-    cRosLogFree(log);
-  }
-  return 0;
-}
-
-static CallbackResponse callback_srv_set_logger_level(cRosMessage *request, cRosMessage *response, void* context)
-{
-  cRosMessageField* level = cRosMessageGetField(request, "level");
-  const char* level_str = level->data.as_string;
-  CrosNode* node = (CrosNode*) context;
-  node->log_level = stringToLogLevel(level_str);
-  return 0;
-}
-
-static CallbackResponse callback_srv_get_loggers(cRosMessage *request, cRosMessage *response, void* context)
-{
-  cRosMessageField* loggers = cRosMessageGetField(response, "loggers");
-
-  cRosMessage* logger_msg = cRosMessageNew();
+    if (callback != NULL)
+      callback(call->id, ok ? &response : NULL, caller->context);
 
-  CrosNode* node = (CrosNode*) context;
-  char path[256];
+    dynBufferRelease(&response);
+    freeServiceCall(call);
 
-  cRosGetMsgFilePath(node, path, 256, "roscpp/Logger");
-  cRosMessageBuild(logger_msg,path);
+    // The caller may have been unregistered by the callback
+    if (caller->service_name == NULL || client_proc->state != TCPROS_PROCESS_STATE_READING)
+      return;
+  }
 
-  cRosMessageField* logger = cRosMessageGetField(logger_msg, "name");
-  cRosMessageSetFieldValueString(logger, "ros.cros_node");
-  cRosMessageField* level = cRosMessageGetField(logger_msg, "level");
-  char* str_level = LogLevelToString(node->log_level);
-  cRosMessageSetFieldValueString(level, str_level);
-  free(str_level);
+  if (caller->sent_head != NULL)
+  {
+    // Drop the delivered responses: the pipeline of a busy caller may never get empty
+    dynBufferCompact( packet );
+    return;
+  }
 
-  cRosMessageFieldArrayPushBackMsg(loggers,logger_msg);
-  return 0;
+  if (dynBufferGetRemainingDataSize(packet) > 0)
+  {
+    PRINT_ERROR("dispatchServiceResponses() : Unexpected data from the provider\n");
+    handleRpcrosClientError( n, i );
+  }
+  else if (caller->persistent)
+  {
+    tcprosProcessClear( client_proc, 0 );
+    dynBufferClear( &(client_proc->send_queue) );
+    tcprosProcessChangeState( client_proc, TCPROS_PROCESS_STATE_WAIT_FOR_WRITING );
+  }
+  else
+  {
+    closeTcprosProcess( client_proc );
+  }
 }
 
-int checkNamespaceFormat(const char* namespace)
+static void doWithRpcrosClientSocket(CrosNode *n, int i)
 {
-  const char* it_ns = namespace;
+  PRINT_VDEBUG ( "doWithRpcrosClientSocket()\n" );
 
-  if(*it_ns == '~')
-    it_ns++;
+  TcprosProcess *client_proc = &(n->rpcros_client_proc[i]);
+  ServiceCallerNode *caller = &(n->service_callers[i]);
 
-  while(*it_ns != '\0')
+  switch (client_proc->state)
   {
-    if(*it_ns == '/')
-    {
-      if(*(it_ns + 1) == '\0' ||
-         !isalpha(*(it_ns + 1)))
-        return 0;
-      it_ns++;
-    }
-    else
+    case TCPROS_PROCESS_STATE_CONNECTING:
     {
-      if(!isalnum(*it_ns) && *it_ns != '_')
-        return 0;
-    }
-    it_ns++;
-  }
-
+      TcpIpSocketState conn_state = tcpIpSocketConnect( &(client_proc->socket),
+                                                        caller->service_host, caller->service_port );
+      switch (conn_state)
+      {
+        case TCPIPSOCKET_DONE:
+          tcprosProcessClear( client_proc, 0 );
+          cRosMessagePrepareServiceCallHeader( n, i );
+          tcprosProcessChangeState( client_proc, TCPROS_PROCESS_STATE_WRITING_HEADER );
+          goto write_header;
+        case TCPIPSOCKET_IN_PROGRESS:
+          // Wait: connection is established asynchronously
+          break;
+        case TCPIPSOCKET_FAILED:
+        default:
+          PRINT_ERROR ( "doWithRpcrosClientSocket() : Can't connect to service %s\n", caller->service_name );
+          handleRpcrosClientError( n, i );
+          break;
+      }
+      break;
+    }
+    write_header:
+    case TCPROS_PROCESS_STATE_WRITING_HEADER:
+    {
+      TcpIpSocketState sock_state =  tcpIpSocketWriteBuffer( &(client_proc->socket),
+                                                             &(client_proc->packet) );
+      switch ( sock_state )
+      {
+        case TCPIPSOCKET_DONE:
+          tcprosProcessClear( client_proc, 0 );
+          client_proc->left_to_recv = sizeof(uint32_t);
+          tcprosProcessChangeState( client_proc, TCPROS_PROCESS_STATE_READING_HEADER_SIZE );
+          break;
+        case TCPIPSOCKET_IN_PROGRESS:
+          break;
+        case TCPIPSOCKET_DISCONNECTED:
+        case TCPIPSOCKET_FAILED:
+        default:
+          handleRpcrosClientError( n, i );
+          break;
+      }
+      break;
+    }
+    case TCPROS_PROCESS_STATE_READING_HEADER_SIZE:
+    {
+      size_t n_reads;
+      TcpIpSocketState sock_state = tcpIpSocketReadBufferEx( &(client_proc->socket),
+                                                             &(client_proc->packet),
+                                                             client_proc->left_to_recv,
+                                                             &n_reads);
+      switch ( sock_state )
+      {
+        case TCPIPSOCKET_DONE:
+          client_proc->left_to_recv -= n_reads;
+          if (client_proc->left_to_recv == 0)
+          {
+            const unsigned char *data = dynBufferGetCurrentData(&client_proc->packet);
+            uint32_t header_size;
+            ROS_TO_HOST_UINT32(*((uint32_t *)data), header_size);
+            tcprosProcessClear( client_proc, 0 );
+            client_proc->left_to_recv = header_size;
+            tcprosProcessChangeState( client_proc, TCPROS_PROCESS_STATE_READING_HEADER );
+            goto read_header;
+          }
+          break;
+        case TCPIPSOCKET_IN_PROGRESS:
+          break;
+        case TCPIPSOCKET_DISCONNECTED:
+        case TCPIPSOCKET_FAILED:
+        default:
+          handleRpcrosClientError( n, i );
+          break;
+      }
+      break;
+    }
+    read_header:
+    case TCPROS_PROCESS_STATE_READING_HEADER:
+    {
+      size_t n_reads;
+      TcpIpSocketState sock_state = tcpIpSocketReadBufferEx( &(client_proc->socket),
+                                                             &(client_proc->packet),
+                                                             client_proc->left_to_recv,
+                                                             &n_reads);
+      TcprosParserState parser_state = TCPROS_PARSER_ERROR;
+
+      switch ( sock_state )
+      {
+        case TCPIPSOCKET_DONE:
+          client_proc->left_to_recv -= n_reads;
+          if (client_proc->left_to_recv == 0)
+            parser_state = cRosMessageParseServiceProviderHeader( n, i );
+          else
+            parser_state = TCPROS_PARSER_HEADER_INCOMPLETE;
+          break;
+        case TCPIPSOCKET_IN_PROGRESS:
+          parser_state = TCPROS_PARSER_HEADER_INCOMPLETE;
+          break;
+        case TCPIPSOCKET_DISCONNECTED:
+        case TCPIPSOCKET_FAILED:
+        default:
+          break;
+      }
+
+      switch ( parser_state )
+      {
+        case TCPROS_PARSER_DONE:
+          tcprosProcessClear( client_proc, 0 );
+          if (caller->queue_head != NULL)
+          {
+            prepareServiceCallPacket( n, i );
+            tcprosProcessChangeState( client_proc, TCPROS_PROCESS_STATE_READING );
+          }
+          else
+          {
+            tcprosProcessChangeState( client_proc, TCPROS_PROCESS_STATE_WAIT_FOR_WRITING );
+          }
+          break;
+        case TCPROS_PARSER_HEADER_INCOMPLETE:
+          break;
+        case TCPROS_PARSER_ERROR:
+        default:
+          handleRpcrosClientError( n, i );
+          break;
+      }
+      break;
+    }
+    case TCPROS_PROCESS_STATE_WAIT_FOR_WRITING:
+    {
+      // Nothing is expected from the provider of an idle persistent connection:
+      // it's just closing the connection
+      TcpIpSocketState sock_state = tcpIpSocketReadBuffer( &(client_proc->socket),
+                                                           &(client_proc->packet) );
+      switch ( sock_state )
+      {
+        case TCPIPSOCKET_IN_PROGRESS:
+          break;
+        case TCPIPSOCKET_DISCONNECTED:
+          PRINT_DEBUG ( "doWithRpcrosClientSocket() : Provider closed the connection\n" );
+          closeTcprosProcess( client_proc );
+          forgetServiceProvider( n, i );
+          break;
+        case TCPIPSOCKET_DONE:
+        case TCPIPSOCKET_FAILED:
+        default:
+          handleRpcrosClientError( n, i );
+          break;
+      }
+      break;
+    }
+    case TCPROS_PROCESS_STATE_READING:
+    {
+      // The requests are written while the responses of the previous ones are read
+      if (dynBufferGetRemainingDataSize(&client_proc->send_queue) > 0)
+      {
+        TcpIpSocketState sock_state = tcpIpSocketWriteBuffer( &(client_proc->socket),
+                                                              &(client_proc->send_queue) );
+        if (sock_state == TCPIPSOCKET_DISCONNECTED || sock_state == TCPIPSOCKET_FAILED)
+        {
+          handleRpcrosClientError( n, i );
+          break;
+        }
+      }
+
+      TcpIpSocketState sock_state = tcpIpSocketReadBuffer( &(client_proc->socket),
+                                                           &(client_proc->packet) );
+      switch ( sock_state )
+      {
+        case TCPIPSOCKET_DONE:
+          dispatchServiceResponses( n, i );
+          break;
+        case TCPIPSOCKET_IN_PROGRESS:
+          break;
+        case TCPIPSOCKET_DISCONNECTED:
+        case TCPIPSOCKET_FAILED:
+        default:
+          handleRpcrosClientError( n, i );
+          break;
+      }
+      break;
+    }
+    default:
+    {
+      // Invalid flow
+      assert(0);
+    }
+  }
+}
+
+// Start the connection (looking up and resolving the provider first, if needed) or the writing
+// of the queued requests of a service caller
+static void updateServiceCaller(CrosNode *n, int i)
+{
+  TcprosProcess *client_proc = &(n->rpcros_client_proc[i]);
+  ServiceCallerNode *caller = &(n->service_callers[i]);
+
+  if (caller->service_name == NULL || caller->queue_head == NULL)
+    return;
+
+  // A persistent connection sends the new requests while the previous ones are being answered
+  if (client_proc->state == TCPROS_PROCESS_STATE_WAIT_FOR_WRITING ||
+      ( client_proc->state == TCPROS_PROCESS_STATE_READING && caller->persistent ))
+  {
+    prepareServiceCallPacket( n, i );
+    if (client_proc->state == TCPROS_PROCESS_STATE_WAIT_FOR_WRITING)
+      tcprosProcessChangeState( client_proc, TCPROS_PROCESS_STATE_READING );
+    return;
+  }
+
+  if (client_proc->state != TCPROS_PROCESS_STATE_IDLE)
+    return;
+
+  if (caller->service_host == NULL)
+  {
+    if (caller->lookup_pending)
+      return;
+
+    if (caller->resolver == NULL)
+    {
+      XmlrpcParam *response = cRosLookupCacheGet(&n->lookup_cache, CROS_LOOKUP_CACHE_SERVICE,
+                                                 caller->service_name);
+      XmlrpcParam *uri = response != NULL ? xmlrpcParamArrayGetParamAt(response, 2) : NULL;
+      if (uri != NULL && xmlrpcParamGetType(uri) == XMLRPC_PARAM_STRING &&
+          setServiceCallerUri(caller, xmlrpcParamGetString(uri)) != -1)
+      {
+        caller->uri_from_cache = 1;
+      }
+      else
+      {
+        if (enqueueServiceLookup(n, i) == -1)
+          failServiceCalls(n, i, &caller->queue_head, &caller->queue_tail);
+        return;
+      }
+    }
+
+    if (caller->resolver != NULL)
+    {
+      int rc = checkServiceHostResolver(caller);
+      if (rc == 1)
+        return;
+
+      if (rc == -1)
+      {
+        // A cached address may be stale: the provider is looked up again
+        int retry = caller->uri_from_cache;
+        forgetServiceProvider(n, i);
+        if (!retry)
+          failServiceCalls(n, i, &caller->queue_head, &caller->queue_tail);
+        return;
+      }
+    }
+  }
+
+  if (!client_proc->socket.open)
+    openRpcrosClientSocket(n, i);
+
+  tcprosProcessClear( client_proc, 1 );
+  client_proc->service_idx = i;
+  tcprosProcessChangeState( client_proc, TCPROS_PROCESS_STATE_CONNECTING );
+  doWithRpcrosClientSocket( n, i );
+}
+
+/*
+ * Services, publisher and support functions for the logging feature
+ */
+static CrosLogLevel stringToLogLevel(const char* level_str)
+{
+  if(strncmp("Info",level_str, strlen(level_str)) == 0)
+  {
+    return CROS_LOGLEVEL_INFO;
+  }
+  else if(strncmp("Debug",level_str, strlen(level_str)) == 0)
+  {
+    return CROS_LOGLEVEL_DEBUG;
+  }
+  else if(strncmp("Warn",level_str, strlen(level_str)) == 0)
+  {
+    return CROS_LOGLEVEL_WARN;
+  }
+  else if(strncmp("Error",level_str, strlen(level_str)) == 0)
+  {
+    return CROS_LOGLEVEL_ERROR;
+  }
+  else // Fatal
+  {
+    return CROS_LOGLEVEL_FATAL;
+  }
+}
+
+static char* LogLevelToString(CrosLogLevel log_level)
+{
+  char* ret = NULL;
+
+  switch(log_level)
+  {
+    case CROS_LOGLEVEL_INFO:
+    {
+      ret = calloc(strlen("INFO") + 1, sizeof(char));
+      strncpy(ret, "INFO",strlen("INFO"));
+      return ret;
+    }
+    case CROS_LOGLEVEL_DEBUG:
+    {
+      ret = calloc(strlen("DEBUG") + 1, sizeof(char));
+      strncpy(ret, "DEBUG",strlen("DEBUG"));
+      return ret;
+    }
+    case CROS_LOGLEVEL_WARN:
+    {
+      ret = calloc(strlen("WARN") + 1, sizeof(char));
+      strncpy(ret, "WARN",strlen("WARN"));
+      return  ret;
+    }
+    case CROS_LOGLEVEL_ERROR:
+    {
+      ret = calloc(strlen("ERROR") + 1, sizeof(char));
+      strncpy(ret, "ERROR",strlen("ERROR"));
+      return ret;
+    }
+    case CROS_LOGLEVEL_FATAL:
+    {
+      ret = calloc(strlen("FATAL") + 1, sizeof(char));
+      strncpy(ret, "FATAL",strlen("FATAL"));
+      return ret;
+    }
+    default:
+    {
+      assert(0);
+    }
+  }
+}
+
+static CallbackResponse callback_pub_log(cRosMessage *message, void* data_context)
+{
+  CrosNode* node = (CrosNode*) data_context;
+  CrosLogRing* ring = &node->log_ring;
+
+  CrosLog* log = cRosLogRingPeek(ring);
+  if(log != NULL)
+  {
+    cRosMessageField* header_field = cRosMessageGetField(message, "header");
+    cRosMessage* header_msg = header_field->data.as_msg;
+    cRosMessageField* seq_id = cRosMessageGetField(header_msg, "seq");
+    seq_id->data.as_uint32 = node->log_last_id++;
+    cRosMessageField* time_field = cRosMessageGetField(header_msg, "stamp");
+    cRosMessage* time_msg = time_field->data.as_msg;
+    cRosMessageField* time_secs = cRosMessageGetField(time_msg, "secs");
+    time_secs->data.as_uint32 = log->secs;
+    cRosMessageField* time_nsecs = cRosMessageGetField(time_msg, "nsecs");
+    time_nsecs->data.as_uint32 = log->nsecs;
+    cRosMessageSetFieldValueString(cRosMessageGetField(header_msg, "frame_id"), "0");
+
+
+    cRosMessageField* level = cRosMessageGetField(message, "level");
+    level->data.as_uint8 = log->level;
+
+    cRosMessageField* name = cRosMessageGetField(message, "name"); //name of the node
+    cRosMessageSetFieldValueString(name, node->name);
+
+    cRosMessageField* msg = cRosMessageGetField(message, "msg"); //message
+    cRosMessageSetFieldValueString(msg, log->msg);
+
+    cRosMessageField* file = cRosMessageGetField(message, "file"); //file the message came from
+    cRosMessageSetFieldValueString(file, log->file);
+
+    cRosMessageField* function = cRosMessageGetField(message, "function"); //function the message came from
+    cRosMessageSetFieldValueString(function, log->function);
+
+    cRosMessageField* line = cRosMessageGetField(message, "line"); //line the message came from
+    line->data.as_uint32 = log->line;
+
+    cRosMessageField* topics = cRosMessageGetField(message, "topics"); //topic names that the node publishes
+    int i;
+    for(i = 0; i < CN_MAX_PUBLISHED_TOPICS; i++)
+    {
+      if(node->pubs[i].topic_name != NULL)
+        cRosMessageFieldArrayPushBackString(topics, node->pubs[i].topic_name);
+    }
+
+    cRosLogRingPop(ring);
+
+    // Drain the pending records in back-to-back publication cycles, instead of one per loop period
+    if(!cRosLogRingIsEmpty(ring) && node->log_pub_idx >= 0)
+      node->pubs[node->log_pub_idx].wake_up_time_ms = 0;
+  }
+  return 0;
+}
+
+static CallbackResponse callback_srv_set_logger_level(cRosMessage *request, cRosMessage *response, void* context)
+{
+  cRosMessageField* level = cRosMessageGetField(request, "level");
+  const char* level_str = level->data.as_string;
+  CrosNode* node = (CrosNode*) context;
+  cRosLogSetLevel(node, stringToLogLevel(level_str));
+  return 0;
+}
+
+static CallbackResponse callback_srv_get_loggers(cRosMessage *request, cRosMessage *response, void* context)
+{
+  cRosMessageField* loggers = cRosMessageGetField(response, "loggers");
+
+  cRosMessage* logger_msg = cRosMessageNew();
+
+  CrosNode* node = (CrosNode*) context;
+  char path[256];
+
+  cRosGetMsgFilePath(node, path, 256, "roscpp/Logger");
+  cRosMessageBuild(logger_msg,path);
+
+  cRosMessageField* logger = cRosMessageGetField(logger_msg, "name");
+  cRosMessageSetFieldValueString(logger, "ros.cros_node");
+  cRosMessageField* level = cRosMessageGetField(logger_msg, "level");
+  char* str_level = LogLevelToString(node->log_level);
+  cRosMessageSetFieldValueString(level, str_level);
+  free(str_level);
+
+  cRosMessageFieldArrayPushBackMsg(loggers,logger_msg);
+  return 0;
+}
+
+int checkNamespaceFormat(const char* namespace)
+{
+  const char* it_ns = namespace;
+
+  if(*it_ns == '~')
+    it_ns++;
+
+  while(*it_ns != '\0')
+  {
+    if(*it_ns == '/')
+    {
+      if(*(it_ns + 1) == '\0' ||
+         !isalpha(*(it_ns + 1)))
+        return 0;
+      it_ns++;
+    }
+    else
+    {
+      if(!isalnum(*it_ns) && *it_ns != '_')
+        return 0;
+    }
+    it_ns++;
+  }
+
   return 1;
 }
 
@@ -1405,6 +2477,8 @@ CrosNode *cRosNodeCreate (char* node_name, char *node_host, char *roscore_host,
   }
 
   new_n->name = new_n->host = new_n->roscore_host = NULL;
+  new_n->log_pub_idx = -1;
+  cRosLogRingInit( &new_n->log_ring, CN_LOG_RING_CAPACITY );
 
   new_n->name = cRosNamespaceBuild(NULL, node_name);
   new_n->host = ( char * ) malloc ( ( strlen ( node_host ) + 1 ) *sizeof ( char ) );
@@ -1423,7 +2497,7 @@ CrosNode *cRosNodeCreate (char* node_name, char *node_host, char *roscore_host,
   strcpy ( new_n->roscore_host, roscore_host );
   strcpy ( new_n->message_root_path, message_root_path );
 
-  new_n->log_level = CROS_LOGLEVEL_INFO;
+  cRosLogSetLevel( new_n, CROS_LOGLEVEL_INFO );
   new_n->xmlrpc_port = 0;
   new_n->tcpros_port = 0;
   new_n->roscore_port = roscore_port;
@@ -1434,6 +2508,8 @@ CrosNode *cRosNodeCreate (char* node_name, char *node_host, char *roscore_host,
   new_n->next_call_id = 0;
   initApiCallQueue(&new_n->master_api_queue);
   initApiCallQueue(&new_n->slave_api_queue);
+  initApiCallQueue(&new_n->cached_api_queue);
+  cRosLookupCacheInit(&new_n->lookup_cache);
 
   int i;
   for (i = 0 ; i < CN_MAX_XMLRPC_SERVER_CONNECTIONS; i++)
@@ -1443,6 +2519,8 @@ CrosNode *cRosNodeCreate (char* node_name, char *node_host, char *roscore_host,
     xmlrpcProcessInit( &(new_n->xmlrpc_client_proc[i]) );
 
   tcprosProcessInit( &(new_n->tcpros_listner_proc) );
+  tcpIpSocketInit( &(new_n->unixros_listner) );
+  new_n->unixros_path = NULL;
 
   for ( i = 0; i < CN_MAX_TCPROS_SERVER_CONNECTIONS; i++)
     tcprosProcessInit( &(new_n->tcpros_server_proc[i]) );
@@ -1452,8 +2530,22 @@ CrosNode *cRosNodeCreate (char* node_name, char *node_host, char *roscore_host,
 
   tcprosProcessInit( &(new_n->rpcros_listner_proc) );
 
-  for ( i = 0; i < CN_MAX_RPCROS_SERVER_CONNECTIONS; i++)
-    tcprosProcessInit( &(new_n->rpcros_server_proc[i]) );
+  new_n->rpcros_server_proc = NULL;
+  new_n->n_rpcros_server_proc = 0;
+  new_n->service_call_id = -1;
+  new_n->next_connection_id = 0;
+  new_n->service_requests = 0;
+  new_n->service_bytes_received = 0;
+  new_n->service_bytes_sent = 0;
+  if ( growRpcrosServerProcs( new_n ) == -1 )
+  {
+    PRINT_ERROR ( "cRosNodeCreate() : Can't allocate memory\n" );
+    cRosNodeDestroy ( new_n );
+    return NULL;
+  }
+
+  for ( i = 0; i < CN_MAX_RPCROS_CLIENT_CONNECTIONS; i++)
+    tcprosProcessInit( &(new_n->rpcros_client_proc[i]) );
 
   for ( i = 0; i < CN_MAX_PUBLISHED_TOPICS; i++)
     initPublisherNode(&new_n->pubs[i]);
@@ -1467,15 +2559,26 @@ CrosNode *cRosNodeCreate (char* node_name, char *node_host, char *roscore_host,
     initServiceProviderNode(&new_n->services[i]);
   new_n->n_services = 0;
 
+  for ( i = 0; i < CN_MAX_SERVICE_CALLERS; i++)
+    initServiceCallerNode(&new_n->service_callers[i]);
+  new_n->n_service_callers = 0;
+
   for ( i = 0; i < CN_MAX_PARAMETER_SUBSCRIPTIONS; i++)
     initParameterSubscrition(&new_n->paramsubs[i]);
   new_n->n_paramsubs = 0;
+  cRosNameIndexInit( &new_n->name_index );
 
   if (select_timeout_ms == NULL)
     new_n->select_timeout = UINT64_MAX;
   else
     new_n->select_timeout = *select_timeout_ms;
   new_n->pid = (int)getpid();
+  new_n->intraprocess_transport = 0;
+  new_n->shm_transport = 1;
+  new_n->unix_transport = 1;
+#ifdef CROS_USE_IO_URING
+  cRosUringInit( &new_n->uring );
+#endif
 
   for(i = 0; i < CN_MAX_XMLRPC_CLIENT_CONNECTIONS; i++)
   {
@@ -1492,8 +2595,7 @@ CrosNode *cRosNodeCreate (char* node_name, char *node_host, char *roscore_host,
   openRpcrosListnerSocket( new_n );
 
 
-  new_n->log_queue = cRosLogQueueNew();
-  new_n-> log_last_id = 0;
+  new_n->log_last_id = 0;
 
   /*
    * Registering logging callback
@@ -1507,6 +2609,7 @@ CrosNode *cRosNodeCreate (char* node_name, char *node_host, char *roscore_host,
   {
     PRINT_ERROR ( "cRosNodeCreate(): Error registering rosout\n" );
   }
+  new_n->log_pub_idx = rc;
 
   rc = cRosApiRegisterServiceProvider(new_n,"~get_loggers","roscpp/GetLoggers",
                                       callback_srv_get_loggers, NULL, (void*) new_n);
@@ -1534,12 +2637,31 @@ void cRosNodeDestroy ( CrosNode *n )
   if ( n == NULL )
     return;
 
+  cRosIntraprocessUnregisterNode( n );
+#ifdef CROS_USE_IO_URING
+  cRosUringRelease( &n->uring );
+#endif
+
+  int i;
+  for ( i = 0; i < CN_MAX_PUBLISHED_TOPICS; i++)
+  {
+    cRosShmRelease( n, i );
+    cRosUdprosRelease( n, i );
+  }
+
+  for ( i = 0; i < CN_MAX_SUBSCRIBED_TOPICS; i++)
+  {
+    cRosShmDetach( n, i );
+    cRosUdprosCloseReceiver( n, i );
+  }
+
   xmlrpcProcessRelease( &(n->xmlrpc_listner_proc) );
 
   releaseApiCallQueue(&n->master_api_queue);
   releaseApiCallQueue(&n->slave_api_queue);
+  releaseApiCallQueue(&n->cached_api_queue);
+  cRosLookupCacheRelease(&n->lookup_cache);
 
-  int i;
   for (i = 0; i < CN_MAX_XMLRPC_SERVER_CONNECTIONS; i++)
     xmlrpcProcessRelease( &(n->xmlrpc_server_proc[i]) ); 
 
@@ -1547,19 +2669,30 @@ void cRosNodeDestroy ( CrosNode *n )
     xmlrpcProcessRelease( &(n->xmlrpc_client_proc[i]) );
 
   tcprosProcessRelease( &(n->tcpros_listner_proc) );
+  tcpIpSocketClose( &(n->unixros_listner) );
+  if ( n->unixros_path != NULL )
+  {
+    unlink( n->unixros_path );
+    free( n->unixros_path );
+  }
 
   for ( i = 0; i < CN_MAX_TCPROS_SERVER_CONNECTIONS; i++)
     tcprosProcessRelease( &(n->tcpros_server_proc[i]) );
 
   for ( i = 0; i < CN_MAX_TCPROS_CLIENT_CONNECTIONS; i++)
-    tcprosProcessRelease( &(n->tcpros_server_proc[i]) ); 
+    tcprosProcessRelease( &(n->tcpros_client_proc[i]) );
 
-  for ( i = 0; i < CN_MAX_RPCROS_SERVER_CONNECTIONS; i++)
+  for ( i = 0; i < n->n_rpcros_server_proc; i++)
     tcprosProcessRelease( &(n->rpcros_server_proc[i]) );
+  free( n->rpcros_server_proc );
+
+  for ( i = 0; i < CN_MAX_RPCROS_CLIENT_CONNECTIONS; i++)
+    tcprosProcessRelease( &(n->rpcros_client_proc[i]) );
 
   if ( n->name != NULL ) free ( n->name );
   if ( n->host != NULL ) free ( n->host );
   if ( n->roscore_host != NULL ) free ( n->roscore_host );
+  cRosLogRingRelease( &n->log_ring );
 
   for ( i = 0; i < CN_MAX_PUBLISHED_TOPICS; i++)
     releasePublisherNode(&n->pubs[i]);
@@ -1570,6 +2703,9 @@ void cRosNodeDestroy ( CrosNode *n )
   for ( i = 0; i < CN_MAX_SERVICE_PROVIDERS; i++)
     releaseServiceProviderNode(&n->services[i]);
 
+  for ( i = 0; i < CN_MAX_SERVICE_CALLERS; i++)
+    releaseServiceCallerNode(&n->service_callers[i]);
+
   for ( i = 0; i < CN_MAX_PARAMETER_SUBSCRIPTIONS; i++)
     releaseParameterSubscrition(&n->paramsubs[i]);
 }
@@ -1628,6 +2764,7 @@ int cRosNodeRegisterPublisher (CrosNode *node, const char *message_definition,
   pub->context = data_context;
 
   node->n_pubs++;
+  cRosNameIndexAdd(&node->name_index, CROS_NAME_PUBLISHER, pub->topic_name, pubidx);
 
   int rc = enqueuePublisherAdvertise(node, pubidx);
   if (rc == -1)
@@ -1695,6 +2832,7 @@ int cRosNodeRegisterServiceProvider(CrosNode *node, const char *service_name,
   service->context = data_context;
 
   node->n_services++;
+  cRosNameIndexAdd(&node->name_index, CROS_NAME_SERVICE, service->service_name, serviceidx);
 
   int rc = enqueueServiceAdvertise(node, serviceidx);
   if (rc == -1)
@@ -1761,6 +2899,7 @@ int cRosNodeRegisterSubscriber(CrosNode *node, const char *message_definition,
   client_proc->topic_idx = subidx;
 
   node->n_subs++;
+  cRosNameIndexAdd(&node->name_index, CROS_NAME_SUBSCRIBER, sub->topic_name, subidx);
 
   int rc = enqueueSubscriberAdvertise(node, subidx);
   if (rc == -1)
@@ -1785,6 +2924,10 @@ int cRosNodeUnregisterSubscriber(CrosNode *node, int subidx)
     return -1;
   }
 
+  cRosIntraprocessUnlinkSubscriber(node, subidx);
+  cRosShmDetach(node, subidx);
+  cRosUdprosCloseReceiver(node, subidx);
+
   TcprosProcess *tcprosProc = &node->tcpros_client_proc[sub->client_tcpros_id];
   closeTcprosProcess(tcprosProc);
   if (sub->client_xmlrpc_id != -1)
@@ -1832,6 +2975,10 @@ int cRosNodeUnregisterPublisher(CrosNode *node, int pubidx)
     return -1;
   }
 
+  cRosIntraprocessUnlinkPublisher(node, pubidx);
+  cRosShmRelease(node, pubidx);
+  cRosUdprosRelease(node, pubidx);
+
   TcprosProcess *tcprosProc = &node->tcpros_server_proc[pub->client_tcpros_id];
   closeTcprosProcess(tcprosProc);
 
@@ -1844,58 +2991,228 @@ int cRosNodeUnregisterPublisher(CrosNode *node, int pubidx)
     closeXmlrpcProcess(coreproc);
   }
 
-  call->method = CROS_API_UNREGISTER_PUBLISHER;
-  call->provider_idx = pubidx;
+  call->method = CROS_API_UNREGISTER_PUBLISHER;
+  call->provider_idx = pubidx;
+
+  xmlrpcParamVectorPushBackString( &call->params, node->name);
+  xmlrpcParamVectorPushBackString( &call->params, pub->topic_name );
+  char node_uri[256];
+  snprintf( node_uri, 256, "http://%s:%d/", node->host, node->xmlrpc_port);
+  xmlrpcParamVectorPushBackString( &call->params, node_uri );
+
+  // NB: Node release is done in handleApiCallAttempt()
+
+  return enqueueMasterApiCallInternal(node, call);
+}
+
+int cRosNodeUnregisterService(CrosNode *node, int serviceidx)
+{
+  if (serviceidx < 0 || serviceidx >= CN_MAX_SERVICE_PROVIDERS)
+    return -1;
+
+  ServiceProviderNode *svc = &node->services[serviceidx];
+  if (svc->service_name == NULL)
+    return -1;
+
+  RosApiCall *call = newRosApiCall();
+  if (call == NULL)
+  {
+    PRINT_ERROR ( "cRosNodeRegisterPublisher() : Can't allocate memory\n");
+    return -1;
+  }
+
+  XmlrpcProcess *coreproc = &node->xmlrpc_client_proc[0];
+  if (coreproc->current_call != NULL
+      && coreproc->current_call->method == CROS_API_REGISTER_SERVICE
+      && coreproc->current_call->provider_idx == serviceidx)
+  {
+    // Delist current registration
+    closeXmlrpcProcess(coreproc);
+  }
+
+  call->method = CROS_API_UNREGISTER_SERVICE;
+
+  xmlrpcParamVectorPushBackString( &call->params, node->name);
+  xmlrpcParamVectorPushBackString( &call->params, svc->service_name);
+  char uri[256];
+  snprintf( uri, 256, "rosrpc://%s:%d/", node->host, node->rpcros_port);
+  xmlrpcParamVectorPushBackString( &call->params, uri );
+  snprintf( uri, 256, "http://%s:%d/", node->host, node->xmlrpc_port);
+  xmlrpcParamVectorPushBackString( &call->params, uri );
+
+  // NB: Node release is done in handleApiCallAttempt()
+
+  return enqueueMasterApiCallInternal(node, call);
+}
+
+int cRosNodeSendServiceResponse(CrosNode *node, int callid, DynBuffer *response, int ok)
+{
+  int i;
+  for (i = 0; i < node->n_rpcros_server_proc; i++)
+  {
+    TcprosProcess *server_proc = &node->rpcros_server_proc[i];
+    if (server_proc->state != TCPROS_PROCESS_STATE_WAIT_FOR_WRITING || server_proc->call_id != callid)
+      continue;
+
+    server_proc->call_id = -1;
+    tcprosProcessClear( server_proc, 0 );
+    cRosMessagePrepareServiceResponse( &server_proc->packet, ok, response );
+    tcprosProcessChangeState( server_proc, TCPROS_PROCESS_STATE_WRITING );
+    return 0;
+  }
+
+  // The caller has probably closed the connection
+  PRINT_ERROR ( "cRosNodeSendServiceResponse() : No service request with id %d\n", callid );
+  return -1;
+}
+
+int cRosNodeRegisterServiceCaller(CrosNode *node, const char *service_name,
+                                  const char *service_type, const char *md5sum, int persistent,
+                                  ServiceCallerCallback callback, NodeStatusCallback status_callback,
+                                  void *data_context)
+{
+  PRINT_VDEBUG ( "cRosNodeRegisterServiceCaller()\n" );
+
+  if (node->n_service_callers >= CN_MAX_SERVICE_CALLERS)
+  {
+    PRINT_ERROR ( "cRosNodeRegisterServiceCaller() : Can't register a new service caller: \
+                 reached the maximum number of service callers\n");
+    return -1;
+  }
+
+  char *caller_service_name = cRosNamespaceBuild(node, service_name);
+  char *caller_service_type = ( char * ) malloc ( ( strlen ( service_type ) + 1 ) * sizeof ( char ) );
+  char *caller_md5sum = ( char * ) malloc ( ( strlen ( md5sum ) + 1 ) * sizeof ( char ) );
+
+  if ( caller_service_name == NULL || caller_service_type == NULL || caller_md5sum == NULL )
+  {
+    PRINT_ERROR ( "cRosNodeRegisterServiceCaller() : Can't allocate memory\n" );
+    free(caller_service_name);
+    free(caller_service_type);
+    free(caller_md5sum);
+    return -1;
+  }
+
+  strcpy ( caller_service_type, service_type );
+  strcpy ( caller_md5sum, md5sum );
+
+  int svccalleridx = -1;
+  int it = 0;
+  for (; it < CN_MAX_SERVICE_CALLERS; it++)
+  {
+    if (node->service_callers[it].service_name == NULL)
+    {
+      svccalleridx = it;
+      break;
+    }
+  }
+
+  ServiceCallerNode *caller = &(node->service_callers[svccalleridx]);
+
+  caller->service_name = caller_service_name;
+  caller->service_type = caller_service_type;
+  caller->md5sum = caller_md5sum;
+  caller->persistent = persistent ? 1 : 0;
+  caller->callback = callback;
+  caller->status_callback = status_callback;
+  caller->context = data_context;
+
+  node->n_service_callers++;
+
+  return svccalleridx;
+}
+
+int cRosNodeUnregisterServiceCaller(CrosNode *node, int svccalleridx)
+{
+  if (svccalleridx < 0 || svccalleridx >= CN_MAX_SERVICE_CALLERS)
+    return -1;
+
+  ServiceCallerNode *caller = &node->service_callers[svccalleridx];
+  if (caller->service_name == NULL)
+    return -1;
+
+  TcprosProcess *client_proc = &node->rpcros_client_proc[svccalleridx];
+  if (client_proc->state != TCPROS_PROCESS_STATE_IDLE)
+    closeTcprosProcess(client_proc);
+
+  failServiceCalls(node, svccalleridx, &caller->sent_head, &caller->sent_tail);
+  failServiceCalls(node, svccalleridx, &caller->queue_head, &caller->queue_tail);
+
+  // Already unregistered by one of the failure callbacks
+  if (caller->service_name == NULL)
+    return 0;
+
+  NodeStatusCallback callback = caller->status_callback;
+  void *context = caller->context;
 
-  xmlrpcParamVectorPushBackString( &call->params, node->name);
-  xmlrpcParamVectorPushBackString( &call->params, pub->topic_name );
-  char node_uri[256];
-  snprintf( node_uri, 256, "http://%s:%d/", node->host, node->xmlrpc_port);
-  xmlrpcParamVectorPushBackString( &call->params, node_uri );
+  releaseServiceCallerNode(caller);
+  initServiceCallerNode(caller);
+  node->n_service_callers--;
 
-  // NB: Node release is done in handleApiCallAttempt()
+  if (callback != NULL)
+  {
+    CrosNodeStatusUsr status;
+    initCrosNodeStatus(&status);
+    status.state = CROS_STATUS_SERVICE_CALLER_UNREGISTERED;
+    status.provider_idx = svccalleridx;
+    callback(&status, context);
+  }
 
-  return enqueueMasterApiCallInternal(node, call);
+  return 0;
 }
 
-int cRosNodeUnregisterService(CrosNode *node, int serviceidx)
+int cRosNodeCallService(CrosNode *node, int svccalleridx, DynBuffer *request)
 {
-  if (serviceidx < 0 || serviceidx >= CN_MAX_SERVICE_PROVIDERS)
+  if (svccalleridx < 0 || svccalleridx >= CN_MAX_SERVICE_CALLERS)
     return -1;
 
-  ServiceProviderNode *svc = &node->services[serviceidx];
-  if (svc->service_name == NULL)
+  ServiceCallerNode *caller = &node->service_callers[svccalleridx];
+  if (caller->service_name == NULL)
     return -1;
 
-  RosApiCall *call = newRosApiCall();
+  ServiceCallNode *call = (ServiceCallNode *)malloc(sizeof(ServiceCallNode));
   if (call == NULL)
   {
-    PRINT_ERROR ( "cRosNodeRegisterPublisher() : Can't allocate memory\n");
+    PRINT_ERROR ( "cRosNodeCallService() : Can't allocate memory\n" );
     return -1;
   }
 
-  XmlrpcProcess *coreproc = &node->xmlrpc_client_proc[0];
-  if (coreproc->current_call != NULL
-      && coreproc->current_call->method == CROS_API_REGISTER_SERVICE
-      && coreproc->current_call->provider_idx == serviceidx)
+  dynBufferInit(&call->request);
+  size_t size = dynBufferGetSize(request);
+  if (size > 0 && dynBufferPushBackBuf(&call->request, dynBufferGetData(request), size) == -1)
   {
-    // Delist current registration
-    closeXmlrpcProcess(coreproc);
+    PRINT_ERROR ( "cRosNodeCallService() : Can't allocate memory\n" );
+    freeServiceCall(call);
+    return -1;
   }
 
-  call->method = CROS_API_UNREGISTER_SERVICE;
+  // Sent by the next cRosNodeDoEventsLoop() cycles
+  call->id = (int)node->next_call_id++;
+  appendServiceCall(&caller->queue_head, &caller->queue_tail, call);
 
-  xmlrpcParamVectorPushBackString( &call->params, node->name);
-  xmlrpcParamVectorPushBackString( &call->params, svc->service_name);
-  char uri[256];
-  snprintf( uri, 256, "rosrpc://%s:%d/", node->host, node->rpcros_port);
-  xmlrpcParamVectorPushBackString( &call->params, uri );
-  snprintf( uri, 256, "http://%s:%d/", node->host, node->xmlrpc_port);
-  xmlrpcParamVectorPushBackString( &call->params, uri );
+  return call->id;
+}
 
-  // NB: Node release is done in handleApiCallAttempt()
+void cRosNodeServiceCallerLookupDone(CrosNode *node, int svccalleridx, const char *service_name,
+                                     const char *uri)
+{
+  ServiceCallerNode *caller = &node->service_callers[svccalleridx];
 
-  return enqueueMasterApiCallInternal(node, call);
+  // The caller may have been unregistered in the meantime
+  if (!caller->lookup_pending || service_name == NULL || caller->service_name == NULL ||
+      strcmp(caller->service_name, service_name) != 0)
+    return;
+
+  caller->lookup_pending = 0;
+  if (uri == NULL || setServiceCallerUri(caller, uri) == -1)
+  {
+    PRINT_ERROR ( "cRosNodeServiceCallerLookupDone() : Can't find a provider for the service %s\n",
+                  caller->service_name );
+    failServiceCalls(node, svccalleridx, &caller->queue_head, &caller->queue_tail);
+    return;
+  }
+
+  caller->uri_from_cache = 0;
 }
 
 int cRosApiSubscribeParam(CrosNode *node, const char *key, NodeStatusCallback callback, void *context)
@@ -1923,7 +3240,7 @@ int cRosApiSubscribeParam(CrosNode *node, const char *key, NodeStatusCallback ca
   int it = 0;
   for (; it < CN_MAX_PARAMETER_SUBSCRIPTIONS; it++)
   {
-    if (node->subs[it].topic_name == NULL)
+    if (node->paramsubs[it].parameter_key == NULL)
     {
       paramsubidx = it;
       break;
@@ -1936,6 +3253,7 @@ int cRosApiSubscribeParam(CrosNode *node, const char *key, NodeStatusCallback ca
   sub->status_callback = callback;
 
   node->n_paramsubs++;
+  cRosNameIndexAdd(&node->name_index, CROS_NAME_PARAMETER, sub->parameter_key, paramsubidx);
 
   int rc = enqueueParameterSubscription(node, paramsubidx);
   if (rc == -1)
@@ -1969,20 +3287,26 @@ int cRosApiUnsubscribeParam(CrosNode *node, int paramsubidx)
   return 0;
 }
 
-void cRosNodeDoEventsLoop ( CrosNode *n )
+// Start a cycle of the events loop: dispatch the pending messages and API calls, and collect the
+// sockets to be waited for. Returns the max waiting time (in msec)
+static uint64_t prepareEvents( CrosNode *n, fd_set *r_fds, fd_set *w_fds, fd_set *err_fds, int *max_fd )
 {
-  PRINT_VDEBUG ( "cRosNodeDoEventsLoop ()\n" );
-
   int nfds = -1;
-  fd_set r_fds, w_fds, err_fds;
   int i = 0;
 
-  FD_ZERO( &r_fds );
-  FD_ZERO( &w_fds );
-  FD_ZERO( &err_fds );
+  FD_ZERO( r_fds );
+  FD_ZERO( w_fds );
+  FD_ZERO( err_fds );
+
+  dispatchCachedApiCalls(n);
+  cRosIntraprocessDispatch(n);
+  cRosShmDispatch(n);
+  cRosUdprosReceive(n);
+  cRosSubscriberQueueDispatch(n);
 
   int xmlrpc_listner_fd = tcpIpSocketGetFD( &(n->xmlrpc_listner_proc.socket) );
   int tcpros_listner_fd = tcpIpSocketGetFD( &(n->tcpros_listner_proc.socket) );
+  int unixros_listner_fd = tcpIpSocketGetFD( &(n->unixros_listner) );
   int rpcros_listner_fd = tcpIpSocketGetFD( &(n->rpcros_listner_proc.socket) );
 
   XmlrpcProcess *coreproc = &n->xmlrpc_client_proc[0];
@@ -2019,12 +3343,12 @@ void cRosNodeDoEventsLoop ( CrosNode *n )
     fd_set *fdset = NULL;
     if( n->xmlrpc_client_proc[i].state == XMLRPC_PROCESS_STATE_WRITING )
     {
-      fdset = &w_fds;
+      fdset = w_fds;
       if( xmlrpc_client_fd > nfds ) nfds = xmlrpc_client_fd;
     }
     else if( n->xmlrpc_client_proc[i].state == XMLRPC_PROCESS_STATE_READING )
     {
-      fdset = &r_fds;
+      fdset = r_fds;
       if( xmlrpc_client_fd > nfds ) nfds = xmlrpc_client_fd;
     }
 
@@ -2034,7 +3358,7 @@ void cRosNodeDoEventsLoop ( CrosNode *n )
         openXmlrpcClientSocket(n, i);
 
       FD_SET( xmlrpc_client_fd, fdset);
-      FD_SET( xmlrpc_client_fd, &err_fds);
+      FD_SET( xmlrpc_client_fd, err_fds);
     }
   }
 
@@ -2053,14 +3377,14 @@ void cRosNodeDoEventsLoop ( CrosNode *n )
     }
     else if( n->xmlrpc_server_proc[i].state == XMLRPC_PROCESS_STATE_READING )
     {
-      FD_SET( server_fd, &r_fds);
-      FD_SET( server_fd, &err_fds);
+      FD_SET( server_fd, r_fds);
+      FD_SET( server_fd, err_fds);
       if( server_fd > nfds ) nfds = server_fd;
     }
     else if( n->xmlrpc_server_proc[i].state == XMLRPC_PROCESS_STATE_WRITING )
     {
-      FD_SET( server_fd, &w_fds);
-      FD_SET( server_fd, &err_fds);
+      FD_SET( server_fd, w_fds);
+      FD_SET( server_fd, err_fds);
       if( server_fd > nfds ) nfds = server_fd;
     }
   }
@@ -2068,8 +3392,8 @@ void cRosNodeDoEventsLoop ( CrosNode *n )
   /* If one XMLRPC server is active at least, add to the select() the listener socket */
   if( next_xmlrpc_server_i >= 0)
   {
-    FD_SET( xmlrpc_listner_fd, &r_fds);
-    FD_SET( xmlrpc_listner_fd, &err_fds);
+    FD_SET( xmlrpc_listner_fd, r_fds);
+    FD_SET( xmlrpc_listner_fd, err_fds);
     if( xmlrpc_listner_fd > nfds ) nfds = xmlrpc_listner_fd;
   }
 
@@ -2093,8 +3417,8 @@ void cRosNodeDoEventsLoop ( CrosNode *n )
     }
     else if(n->tcpros_client_proc[i].state == TCPROS_PROCESS_STATE_WRITING_HEADER)
     {
-      FD_SET( tcpros_client_fd, &w_fds);
-      FD_SET( tcpros_client_fd, &err_fds);
+      FD_SET( tcpros_client_fd, w_fds);
+      FD_SET( tcpros_client_fd, err_fds);
       if( tcpros_client_fd > nfds ) nfds = tcpros_client_fd;
     }
     else if(n->tcpros_client_proc[i].state == TCPROS_PROCESS_STATE_READING_HEADER_SIZE ||
@@ -2102,14 +3426,38 @@ void cRosNodeDoEventsLoop ( CrosNode *n )
             n->tcpros_client_proc[i].state == TCPROS_PROCESS_STATE_READING_SIZE ||
             n->tcpros_client_proc[i].state == TCPROS_PROCESS_STATE_READING)
     {
-      FD_SET( tcpros_client_fd, &r_fds);
-      FD_SET( tcpros_client_fd, &err_fds);
+      FD_SET( tcpros_client_fd, r_fds);
+      FD_SET( tcpros_client_fd, err_fds);
       if( tcpros_client_fd > nfds ) nfds = tcpros_client_fd;
     }
   }
 
+  /* Add to the select() the notifications of the publishers writing in the shared memory */
+  for(i = 0; i < CN_MAX_SUBSCRIBED_TOPICS; i++)
+  {
+    int notify_fd = n->subs[i].shm_notify_fd;
+    if( n->subs[i].shm != NULL )
+    {
+      FD_SET( notify_fd, r_fds);
+      if( notify_fd > nfds ) nfds = notify_fd;
+    }
+  }
+
+  /* Add to the select() the sockets of the subscribers receiving UDPROS datagrams */
+  for(i = 0; i < CN_MAX_SUBSCRIBED_TOPICS; i++)
+  {
+    // Until the publisher is known its datagrams (e.g., the latched one) wait in the socket
+    int udpros_fd = n->subs[i].udpros.fd;
+    if( udpros_fd != -1 && n->subs[i].udpros.connected )
+    {
+      FD_SET( udpros_fd, r_fds);
+      if( udpros_fd > nfds ) nfds = udpros_fd;
+    }
+  }
+
   /* Add to the select() the active TCPROS servers */
   int next_tcpros_server_i = -1;  
+  uint64_t cur_time_us = cRosClockGetTimeUs();
   for( i = 0; i < CN_MAX_TCPROS_SERVER_CONNECTIONS; i++ )
   {
     int server_fd = tcpIpSocketGetFD( &(n->tcpros_server_proc[i].socket) );
@@ -2121,20 +3469,29 @@ void cRosNodeDoEventsLoop ( CrosNode *n )
     }
     else if( n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_READING_HEADER )
     {
-      FD_SET( server_fd, &r_fds);
-      FD_SET( server_fd, &err_fds);
+      FD_SET( server_fd, r_fds);
+      FD_SET( server_fd, err_fds);
+      if( server_fd > nfds ) nfds = server_fd;
+    }
+    else if( ( n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_START_WRITING ||
+               n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_WRITING ) &&
+             n->tcpros_server_proc[i].write_after_us > cur_time_us )
+    {
+      // Aggregation window: the connection waits for more packets to write
+      FD_SET( server_fd, err_fds);
       if( server_fd > nfds ) nfds = server_fd;
     }
-    else if( n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_START_WRITING ||
+    else if( n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_WRITING_HEADER ||
+             n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_START_WRITING ||
              n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_WRITING )
     {
-      FD_SET( server_fd, &w_fds);
-      FD_SET( server_fd, &err_fds);
+      FD_SET( server_fd, w_fds);
+      FD_SET( server_fd, err_fds);
       if( server_fd > nfds ) nfds = server_fd;
     }
     else if( n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_WAIT_FOR_WRITING )
     {
-      FD_SET( server_fd, &err_fds);
+      FD_SET( server_fd, err_fds);
       if( server_fd > nfds ) nfds = server_fd;
     }
   }
@@ -2142,9 +3499,15 @@ void cRosNodeDoEventsLoop ( CrosNode *n )
   /* If one TCPROS server is available at least, add to the select() the listner socket */
   if( next_tcpros_server_i >= 0)
   {
-    FD_SET( tcpros_listner_fd, &r_fds);
-    FD_SET( tcpros_listner_fd, &err_fds);
+    FD_SET( tcpros_listner_fd, r_fds);
+    FD_SET( tcpros_listner_fd, err_fds);
     if( tcpros_listner_fd > nfds ) nfds = tcpros_listner_fd;
+
+    if( unixros_listner_fd != -1 )
+    {
+      FD_SET( unixros_listner_fd, r_fds);
+      if( unixros_listner_fd > nfds ) nfds = unixros_listner_fd;
+    }
   }
 
   uint64_t timeout = n->select_timeout;
@@ -2158,12 +3521,51 @@ void cRosNodeDoEventsLoop ( CrosNode *n )
   if( tmp_timeout < timeout )
     timeout = tmp_timeout;
 
+  /* Lookups enqueued by the callbacks of the cached ones must be answered at the next cycle */
+  if( !isQueueEmpty(&n->cached_api_queue) )
+    timeout = 0;
+
+  /* Same for the packets delivered by the publishers of the same process */
+  if( cRosIntraprocessHasPending(n) || cRosSubscriberQueueHasPending(n) )
+    timeout = 0;
+
+  for( i = 0; i < CN_MAX_PUBLISHED_TOPICS; i++ )
+  {
+    PublisherNode *pub = &n->pubs[i];
+    if( pub->topic_name != NULL &&
+        ( pub->n_intra_subs > 0 || cRosShmHasReaders( n, i ) || cRosUdprosHasSubscribers( n, i ) ) )
+    {
+      if( pub->wake_up_time_ms > cur_time )
+        tmp_timeout = pub->wake_up_time_ms - cur_time;
+      else
+        tmp_timeout = 0;
+
+      if( tmp_timeout < timeout )
+        timeout = tmp_timeout;
+    }
+  }
+
   for( i = 0; i < CN_MAX_TCPROS_SERVER_CONNECTIONS; i++ )
   {
-    if( n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_WAIT_FOR_WRITING)
+    if( n->tcpros_server_proc[i].write_after_us > cur_time_us &&
+        ( n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_START_WRITING ||
+          n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_WRITING ) )
+    {
+      // Rounded up, not to wake up before the end of the window
+      tmp_timeout = ( n->tcpros_server_proc[i].write_after_us - cur_time_us + 999 ) / 1000;
+      if( tmp_timeout < timeout )
+        timeout = tmp_timeout;
+    }
+
+    // The connections that can queue the next packet are ready for the next publication cycle as well
+    if( n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_WAIT_FOR_WRITING ||
+        ( ( n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_START_WRITING ||
+            n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_WRITING ) &&
+          canQueuePublicationPacket( &n->pubs[n->tcpros_server_proc[i].topic_idx], &(n->tcpros_server_proc[i]) ) ) )
     {
-      if( n->tcpros_server_proc[i].wake_up_time_ms > cur_time )
-        tmp_timeout = n->tcpros_server_proc[i].wake_up_time_ms - cur_time;
+      PublisherNode *pub = &n->pubs[n->tcpros_server_proc[i].topic_idx];
+      if( pub->wake_up_time_ms > cur_time )
+        tmp_timeout = pub->wake_up_time_ms - cur_time;
       else
         tmp_timeout = 0;
 
@@ -2180,55 +3582,438 @@ void cRosNodeDoEventsLoop ( CrosNode *n )
 
   /* Add to the select() the active RPCROS servers */
 
-  int next_rpcros_server_i = -1;
+  /* An idle RPCROS server is available, or the pool can still grow */
+  int next_rpcros_server_i = n->n_rpcros_server_proc < CN_MAX_RPCROS_SERVER_CONNECTIONS ?
+                             n->n_rpcros_server_proc : -1;
 
-  for( i = 0; i < CN_MAX_RPCROS_SERVER_CONNECTIONS; i++ )
+  for( i = 0; i < n->n_rpcros_server_proc; i++ )
   {
     int server_fd = tcpIpSocketGetFD( &(n->rpcros_server_proc[i].socket) );
 
-    if( next_rpcros_server_i < 0 &&
-        n->rpcros_server_proc[i].state == TCPROS_PROCESS_STATE_IDLE )
+    if( n->rpcros_server_proc[i].state == TCPROS_PROCESS_STATE_IDLE )
     {
-    	next_rpcros_server_i = i;
+      if( next_rpcros_server_i < 0 || next_rpcros_server_i > i )
+        next_rpcros_server_i = i;
     }
     else if (n->rpcros_server_proc[i].state == TCPROS_PROCESS_STATE_READING_HEADER_SIZE ||
              n->rpcros_server_proc[i].state == TCPROS_PROCESS_STATE_READING_HEADER ||
              n->rpcros_server_proc[i].state == TCPROS_PROCESS_STATE_READING_SIZE ||
              n->rpcros_server_proc[i].state == TCPROS_PROCESS_STATE_READING)
     {
-      FD_SET( server_fd, &r_fds);
-      FD_SET( server_fd, &err_fds);
+      FD_SET( server_fd, r_fds);
+      FD_SET( server_fd, err_fds);
       if( server_fd > nfds ) nfds = server_fd;
     }
     else if( n->rpcros_server_proc[i].state == TCPROS_PROCESS_STATE_WRITING_HEADER ||
              n->rpcros_server_proc[i].state == TCPROS_PROCESS_STATE_WRITING )
     {
-      FD_SET( server_fd, &w_fds);
-      FD_SET( server_fd, &err_fds);
-      if( server_fd > nfds ) nfds = server_fd;
+      FD_SET( server_fd, w_fds);
+      FD_SET( server_fd, err_fds);
+      if( server_fd > nfds ) nfds = server_fd;
+    }
+    else if( n->rpcros_server_proc[i].state == TCPROS_PROCESS_STATE_WAIT_FOR_WRITING )
+    {
+      FD_SET( server_fd, err_fds);
+      if( server_fd > nfds ) nfds = server_fd;
+    }
+  }
+
+  /* Start the pending service calls and add to the select() the active RPCROS clients */
+  for( i = 0; i < CN_MAX_RPCROS_CLIENT_CONNECTIONS; i++ )
+  {
+    updateServiceCaller(n, i);
+
+    // Poll the resolution of the provider host name
+    if( n->service_callers[i].resolver != NULL && timeout > CN_SERVICE_RESOLVE_PERIOD )
+      timeout = CN_SERVICE_RESOLVE_PERIOD;
+
+    TcprosProcess *client_proc = &(n->rpcros_client_proc[i]);
+    int client_fd = tcpIpSocketGetFD( &(client_proc->socket) );
+    if( client_proc->state == TCPROS_PROCESS_STATE_CONNECTING ||
+        client_proc->state == TCPROS_PROCESS_STATE_WRITING_HEADER )
+    {
+      FD_SET( client_fd, w_fds);
+      FD_SET( client_fd, err_fds);
+      if( client_fd > nfds ) nfds = client_fd;
+    }
+    else if( client_proc->state == TCPROS_PROCESS_STATE_READING_HEADER_SIZE ||
+             client_proc->state == TCPROS_PROCESS_STATE_READING_HEADER ||
+             client_proc->state == TCPROS_PROCESS_STATE_WAIT_FOR_WRITING ||
+             client_proc->state == TCPROS_PROCESS_STATE_READING )
+    {
+      FD_SET( client_fd, r_fds);
+      FD_SET( client_fd, err_fds);
+      if( client_proc->state == TCPROS_PROCESS_STATE_READING &&
+          dynBufferGetRemainingDataSize( &(client_proc->send_queue) ) > 0 )
+        FD_SET( client_fd, w_fds);
+      if( client_fd > nfds ) nfds = client_fd;
+    }
+  }
+
+  /* If one RPCROS server is available at least, add to the select() the listner socket */
+  if( next_rpcros_server_i >= 0)
+  {
+    FD_SET( rpcros_listner_fd, r_fds);
+    FD_SET( rpcros_listner_fd, err_fds);
+    if( rpcros_listner_fd > nfds ) nfds = rpcros_listner_fd;
+  }
+
+#ifdef DEBUG
+  assert(timeout <= n->select_timeout);
+#endif
+
+  *max_fd = nfds;
+  return timeout;
+}
+
+// End a cycle of the events loop in which no socket got ready: the timers of the processes
+static void processTimeouts( CrosNode *n )
+{
+  int i;
+
+  uint64_t cur_time = cRosClockGetTimeMs();
+
+  XmlrpcProcess *rosproc = &n->xmlrpc_client_proc[0];
+  if(rosproc->state == XMLRPC_PROCESS_STATE_IDLE && rosproc->wake_up_time_ms <= cur_time )
+  {
+    rosproc->wake_up_time_ms = cur_time + CN_PING_LOOP_PERIOD;
+
+    /* Prepare to ping roscore ... */
+    PRINT_DEBUG("cRosApiPrepareRequest() : ping roscore\n");
+
+    RosApiCall *call = newRosApiCall();
+    if (call == NULL)
+    {
+      PRINT_ERROR ( "cRosApiPrepareRequest() : Can't allocate memory\n");
+      exit(1);
+    }
+
+    call->method = CROS_API_GET_PID;
+    int rc = xmlrpcParamVectorPushBackString(&call->params, "/rosout");
+
+    rosproc->message_type = XMLRPC_MESSAGE_REQUEST;
+    generateXmlrpcMessage( n->host, n->roscore_port, rosproc->message_type,
+                        getMethodName(call->method), &call->params, &rosproc->message );
+
+    rosproc->current_call = call;
+    xmlrpcProcessChangeState(rosproc, XMLRPC_PROCESS_STATE_WRITING );
+
+  }
+  else if( n->xmlrpc_client_proc[0].state != XMLRPC_PROCESS_STATE_IDLE &&
+           cur_time - n->xmlrpc_client_proc[0].last_change_time > CN_IO_TIMEOUT )
+  {
+    /* Timeout between I/O operations... close the socket and re-advertise */
+    PRINT_DEBUG ( "cRosNodeDoEventsLoop() : XMLRPC client I/O timeout\n");
+    handleXmlrpcClientError( n, 0 );
+  }
+
+  for( i = 0; i < CN_MAX_PUBLISHED_TOPICS; i++ )
+  {
+    PublisherNode *pub = &n->pubs[i];
+    if( pub->topic_name != NULL && pub->wake_up_time_ms <= cur_time )
+      startPublicationCycle( n, i, cur_time );
+  }
+
+  for( i = 0; i < CN_MAX_TCPROS_SERVER_CONNECTIONS; i++ )
+  {
+    if( (n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_READING_HEADER || 
+              n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_WRITING_HEADER ||
+              n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_WRITING ) &&
+             cur_time - n->tcpros_server_proc[i].last_change_time > CN_IO_TIMEOUT )
+    {
+      /* Timeout between I/O operations */
+      PRINT_DEBUG ( "cRosNodeDoEventsLoop() : TCPROS server I/O timeout\n");
+      handleTcprosServerError( n, i );
+    }
+    else if( n->tcpros_server_proc[i].busy_since != 0 &&
+             n->pubs[n->tcpros_server_proc[i].topic_idx].lag_limit_ms > 0 &&
+             cur_time - n->tcpros_server_proc[i].busy_since > n->pubs[n->tcpros_server_proc[i].topic_idx].lag_limit_ms )
+    {
+      /* The subscriber doesn't keep up with the publication rate */
+      TcprosProcess *server_proc = &(n->tcpros_server_proc[i]);
+      PublisherNode *pub = &n->pubs[server_proc->topic_idx];
+      if( !server_proc->lagging )
+      {
+        PRINT_INFO ( "cRosNodeDoEventsLoop() : Subscriber %s of %s is lagging\n",
+                     dynStringGetData( &(server_proc->caller_id) ), pub->topic_name );
+        server_proc->lagging = 1;
+      }
+
+      if( pub->disconnect_lagging )
+      {
+        pub->lagging_disconnects++;
+        handleTcprosServerError( n, i );
+      }
+    }
+  }
+
+  for( i = 0; i < CN_MAX_RPCROS_CLIENT_CONNECTIONS; i++ )
+  {
+    /* The service execution time is not bounded: only the connection setup is timed out */
+    TcprosProcess *client_proc = &(n->rpcros_client_proc[i]);
+    if( ( client_proc->state == TCPROS_PROCESS_STATE_CONNECTING ||
+          client_proc->state == TCPROS_PROCESS_STATE_WRITING_HEADER ||
+          client_proc->state == TCPROS_PROCESS_STATE_READING_HEADER_SIZE ||
+          client_proc->state == TCPROS_PROCESS_STATE_READING_HEADER ) &&
+        cur_time - client_proc->last_change_time > CN_IO_TIMEOUT )
+    {
+      PRINT_DEBUG ( "cRosNodeDoEventsLoop() : RPCROS client I/O timeout\n");
+      handleRpcrosClientError( n, i );
+    }
+  }
+}
+
+// End a cycle of the events loop in which some sockets got ready
+static void processFdEvents( CrosNode *n, fd_set *r_fds, fd_set *w_fds, fd_set *err_fds )
+{
+  int i;
+  int xmlrpc_listner_fd = tcpIpSocketGetFD( &(n->xmlrpc_listner_proc.socket) );
+  int tcpros_listner_fd = tcpIpSocketGetFD( &(n->tcpros_listner_proc.socket) );
+  int unixros_listner_fd = tcpIpSocketGetFD( &(n->unixros_listner) );
+  int rpcros_listner_fd = tcpIpSocketGetFD( &(n->rpcros_listner_proc.socket) );
+
+  /* The idle servers that accept the new connections, as selected by prepareEvents() */
+  int next_xmlrpc_server_i = -1;
+  for( i = 0; i < CN_MAX_XMLRPC_SERVER_CONNECTIONS && next_xmlrpc_server_i < 0; i++ )
+  {
+    if( n->xmlrpc_server_proc[i].state == XMLRPC_PROCESS_STATE_IDLE )
+      next_xmlrpc_server_i = i;
+  }
+
+  int next_tcpros_server_i = -1;
+  for( i = 0; i < CN_MAX_TCPROS_SERVER_CONNECTIONS && next_tcpros_server_i < 0; i++ )
+  {
+    if( n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_IDLE )
+      next_tcpros_server_i = i;
+  }
+
+  int next_rpcros_server_i = n->n_rpcros_server_proc < CN_MAX_RPCROS_SERVER_CONNECTIONS ?
+                             n->n_rpcros_server_proc : -1;
+  for( i = 0; i < n->n_rpcros_server_proc; i++ )
+  {
+    if( n->rpcros_server_proc[i].state == TCPROS_PROCESS_STATE_IDLE )
+    {
+      next_rpcros_server_i = i;
+      break;
+    }
+  }
+
+  for(i = 0; i < CN_MAX_XMLRPC_CLIENT_CONNECTIONS; i++ )
+  {
+    int xmlrpc_client_fd = tcpIpSocketGetFD( &(n->xmlrpc_client_proc[i].socket) );
+
+    if( FD_ISSET(xmlrpc_client_fd, err_fds) )
+    {
+      PRINT_ERROR ( "cRosNodeDoEventsLoop() : XMLRPC Client error\n" );
+      handleXmlrpcClientError( n, i );
+    }
+
+    /* Check what is the socket unblocked by the select, and start the requested operations */
+    else if( ( n->xmlrpc_client_proc[i].state == XMLRPC_PROCESS_STATE_WRITING && FD_ISSET(xmlrpc_client_fd, w_fds) ) ||
+        ( n->xmlrpc_client_proc[i].state == XMLRPC_PROCESS_STATE_READING && FD_ISSET(xmlrpc_client_fd, r_fds) ) )
+    {
+      doWithXmlrpcClientSocket( n, i );
+    }
+  }
+
+  if ( next_xmlrpc_server_i >= 0 )
+  {
+    if( FD_ISSET( xmlrpc_listner_fd, err_fds) )
+    {
+      PRINT_ERROR ( "cRosNodeDoEventsLoop() : XMLRPC  listner error\n" ); 
+    }
+    else if( FD_ISSET( xmlrpc_listner_fd, r_fds) )
+    {
+      PRINT_DEBUG ( "cRosNodeDoEventsLoop() : XMLRPC listner ready\n" );
+      if( tcpIpSocketAccept( &(n->xmlrpc_listner_proc.socket), 
+          &(n->xmlrpc_server_proc[next_xmlrpc_server_i].socket) ) == TCPIPSOCKET_DONE &&
+          tcpIpSocketSetReuse( &(n->xmlrpc_server_proc[next_xmlrpc_server_i].socket) ) && 
+          tcpIpSocketSetNonBlocking( &(n->xmlrpc_server_proc[next_xmlrpc_server_i].socket ) ) )
+
+        xmlrpcProcessChangeState( &(n->xmlrpc_server_proc[next_xmlrpc_server_i]), XMLRPC_PROCESS_STATE_READING );        
+    }
+  }
+
+  for( i = 0; i < CN_MAX_XMLRPC_SERVER_CONNECTIONS; i++ )
+  {
+    int server_fd = tcpIpSocketGetFD( &(n->xmlrpc_server_proc[i].socket) );
+    if( FD_ISSET(server_fd, err_fds) )
+    {
+      PRINT_ERROR ( "cRosNodeDoEventsLoop() : XMLRPC server error\n" );
+      tcpIpSocketClose( &(n->xmlrpc_server_proc[i].socket) );
+      xmlrpcProcessChangeState( &(n->xmlrpc_server_proc[next_xmlrpc_server_i]), XMLRPC_PROCESS_STATE_IDLE ); 
+    }
+    else if( ( n->xmlrpc_server_proc[i].state == XMLRPC_PROCESS_STATE_WRITING && FD_ISSET(server_fd, w_fds) ) || 
+             ( n->xmlrpc_server_proc[i].state == XMLRPC_PROCESS_STATE_READING && FD_ISSET(server_fd, r_fds) ) )
+    {
+      doWithXmlrpcServerSocket( n, i );
+    }
+  }
+
+  for(i = 0; i < CN_MAX_TCPROS_CLIENT_CONNECTIONS; i++ )
+  {
+    TcprosProcess *client_proc = &(n->tcpros_client_proc[i]);
+    int tcpros_client_fd = tcpIpSocketGetFD( &(client_proc->socket) );
+
+    if( client_proc->state != TCPROS_PROCESS_STATE_IDLE && FD_ISSET(tcpros_client_fd, err_fds) )
+    {
+      PRINT_ERROR ( "cRosNodeDoEventsLoop() : XMLRPC Client error\n" );
+      handleTcprosClientError( n, i );
+    }
+
+    if( client_proc->state == TCPROS_PROCESS_STATE_CONNECTING ||
+        ( client_proc->state == TCPROS_PROCESS_STATE_WRITING_HEADER && FD_ISSET(tcpros_client_fd, w_fds) ) ||
+        ( client_proc->state == TCPROS_PROCESS_STATE_READING_SIZE && FD_ISSET(tcpros_client_fd, r_fds) ) ||
+        ( client_proc->state == TCPROS_PROCESS_STATE_READING && FD_ISSET(tcpros_client_fd, r_fds) ) ||
+        ( client_proc->state == TCPROS_PROCESS_STATE_READING_HEADER_SIZE && FD_ISSET(tcpros_client_fd, r_fds) ) ||
+        ( client_proc->state == TCPROS_PROCESS_STATE_READING_HEADER && FD_ISSET(tcpros_client_fd, r_fds) ) )
+    {
+      doWithTcprosClientSocket( n, i );
+    }
+  }
+
+  if ( next_tcpros_server_i >= 0 )
+  {
+    if( FD_ISSET( tcpros_listner_fd, err_fds) )
+    {
+      PRINT_ERROR ( "cRosNodeDoEventsLoop() : TCPROS listner error\n" ); 
+    }
+    else if( FD_ISSET( tcpros_listner_fd, r_fds) )
+    {
+      PRINT_DEBUG ( "cRosNodeDoEventsLoop() : TCPROS listner ready\n" );
+      if( tcpIpSocketAccept( &(n->tcpros_listner_proc.socket), 
+          &(n->tcpros_server_proc[next_tcpros_server_i].socket) ) == TCPIPSOCKET_DONE &&
+          tcpIpSocketSetReuse( &(n->tcpros_server_proc[next_tcpros_server_i].socket) ) && 
+          tcpIpSocketSetNonBlocking( &(n->tcpros_server_proc[next_tcpros_server_i].socket ) ) &&
+          tcpIpSocketSetKeepAlive( &(n->tcpros_server_proc[next_tcpros_server_i].socket ), 60, 10, 9 ) )
+      {
+        tcprosProcessStartConnection( &(n->tcpros_server_proc[next_tcpros_server_i]), n->next_connection_id++ );
+        tcprosProcessChangeState( &(n->tcpros_server_proc[next_tcpros_server_i]), TCPROS_PROCESS_STATE_READING_HEADER );
+      }
+    }
+    else if( unixros_listner_fd != -1 && FD_ISSET( unixros_listner_fd, r_fds) )
+    {
+      // The same TCPROS protocol, through a Unix domain socket (no keepalive needed)
+      PRINT_DEBUG ( "cRosNodeDoEventsLoop() : UNIXROS listner ready\n" );
+      if( tcpIpSocketAccept( &(n->unixros_listner),
+          &(n->tcpros_server_proc[next_tcpros_server_i].socket) ) == TCPIPSOCKET_DONE &&
+          tcpIpSocketSetNonBlocking( &(n->tcpros_server_proc[next_tcpros_server_i].socket ) ) )
+      {
+        tcprosProcessStartConnection( &(n->tcpros_server_proc[next_tcpros_server_i]), n->next_connection_id++ );
+        tcprosProcessChangeState( &(n->tcpros_server_proc[next_tcpros_server_i]), TCPROS_PROCESS_STATE_READING_HEADER );
+      }
+    }
+  }
+
+  for( i = 0; i < CN_MAX_TCPROS_SERVER_CONNECTIONS; i++ )
+  {
+    int server_fd = tcpIpSocketGetFD( &(n->tcpros_server_proc[i].socket) );
+    if( FD_ISSET(server_fd, err_fds) )
+    {
+      PRINT_ERROR ( "cRosNodeDoEventsLoop() : TCPROS server error\n" );
+      tcpIpSocketClose( &(n->tcpros_server_proc[i].socket) );
+      tcprosProcessChangeState( &(n->tcpros_server_proc[next_tcpros_server_i]), TCPROS_PROCESS_STATE_IDLE ); 
+    }
+    else if( ( n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_READING_HEADER && FD_ISSET(server_fd, r_fds) ) ||
+      ( n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_WRITING_HEADER && FD_ISSET(server_fd, w_fds) ) ||
+      ( n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_START_WRITING && FD_ISSET(server_fd, w_fds) ) || 
+      ( n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_WRITING && FD_ISSET(server_fd, w_fds) ) )
+    {
+      doWithTcprosServerSocket( n, i );    
+    }
+  }
+
+  /* Only the servers that were in the select() (the pool can grow while accepting) */
+  int n_rpcros_server_proc = n->n_rpcros_server_proc;
+
+  if ( next_rpcros_server_i >= 0 )
+  {
+    if( FD_ISSET( rpcros_listner_fd, err_fds) )
+    {
+      PRINT_ERROR ( "cRosNodeDoEventsLoop() : RPCROS listner error\n" );
+    }
+    else if( FD_ISSET( rpcros_listner_fd, r_fds) )
+    {
+      PRINT_DEBUG ( "cRosNodeDoEventsLoop() : RPCROS listner ready\n" );
+      /* Empty the accept backlog, as long as there are idle servers */
+      int server_i;
+      while( ( server_i = getIdleRpcrosServer( n ) ) >= 0 )
+      {
+        TcprosProcess *server_proc = &(n->rpcros_server_proc[server_i]);
+        if( tcpIpSocketAccept( &(n->rpcros_listner_proc.socket), &(server_proc->socket) ) != TCPIPSOCKET_DONE )
+          break;
+
+        if( tcpIpSocketSetReuse( &(server_proc->socket) ) &&
+            tcpIpSocketSetNonBlocking( &(server_proc->socket) ) &&
+            tcpIpSocketSetKeepAlive( &(server_proc->socket), 60, 10, 9 ) )
+        {
+          tcprosProcessStartConnection( server_proc, n->next_connection_id++ );
+          tcprosProcessChangeState( server_proc, TCPROS_PROCESS_STATE_READING_HEADER_SIZE );
+        }
+        else
+        {
+          tcpIpSocketClose( &(server_proc->socket) );
+        }
+      }
+    }
+  }
+
+  for( i = 0; i < n_rpcros_server_proc; i++ )
+  {
+    if( n->rpcros_server_proc[i].state == TCPROS_PROCESS_STATE_IDLE )
+      continue;
+
+    int server_fd = tcpIpSocketGetFD( &(n->rpcros_server_proc[i].socket) );
+    if( FD_ISSET(server_fd, err_fds) )
+    {
+      PRINT_ERROR ( "cRosNodeDoEventsLoop() : RPCROS server error\n" );
+      handleRpcrosServerError( n, i );
     }
-    else if( n->rpcros_server_proc[i].state == TCPROS_PROCESS_STATE_WAIT_FOR_WRITING )
+    else if( ( n->rpcros_server_proc[i].state == TCPROS_PROCESS_STATE_READING_HEADER_SIZE && FD_ISSET(server_fd, r_fds) ) ||
+      ( n->rpcros_server_proc[i].state == TCPROS_PROCESS_STATE_READING_HEADER && FD_ISSET(server_fd, r_fds) ) ||
+      ( n->rpcros_server_proc[i].state == TCPROS_PROCESS_STATE_READING_SIZE && FD_ISSET(server_fd, r_fds) ) ||
+      ( n->rpcros_server_proc[i].state == TCPROS_PROCESS_STATE_READING && FD_ISSET(server_fd, r_fds) ) ||
+      ( n->rpcros_server_proc[i].state == TCPROS_PROCESS_STATE_WRITING_HEADER && FD_ISSET(server_fd, w_fds) ) ||
+      ( n->rpcros_server_proc[i].state == TCPROS_PROCESS_STATE_WRITING && FD_ISSET(server_fd, w_fds) ) )
     {
-      FD_SET( server_fd, &err_fds);
-      if( server_fd > nfds ) nfds = server_fd;
+      doWithRpcrosServerSocket( n, i );
     }
   }
 
-  /* If one RPCROS server is available at least, add to the select() the listner socket */
-  if( next_rpcros_server_i >= 0)
+  for( i = 0; i < CN_MAX_RPCROS_CLIENT_CONNECTIONS; i++ )
   {
-    FD_SET( rpcros_listner_fd, &r_fds);
-    FD_SET( rpcros_listner_fd, &err_fds);
-    if( rpcros_listner_fd > nfds ) nfds = rpcros_listner_fd;
+    TcprosProcess *client_proc = &(n->rpcros_client_proc[i]);
+    if( client_proc->state == TCPROS_PROCESS_STATE_IDLE )
+      continue;
+
+    int client_fd = tcpIpSocketGetFD( &(client_proc->socket) );
+    if( FD_ISSET(client_fd, err_fds) )
+    {
+      PRINT_ERROR ( "cRosNodeDoEventsLoop() : RPCROS client error\n" );
+      handleRpcrosClientError( n, i );
+    }
+    else if( FD_ISSET(client_fd, r_fds) || FD_ISSET(client_fd, w_fds) )
+    {
+      doWithRpcrosClientSocket( n, i );
+    }
   }
+}
 
-#ifdef DEBUG
-  assert(timeout <= n->select_timeout);
-#endif
+void cRosNodeDoEventsLoop ( CrosNode *n )
+{
+  PRINT_VDEBUG ( "cRosNodeDoEventsLoop ()\n" );
+
+  fd_set r_fds, w_fds, err_fds;
+  int nfds;
+  uint64_t timeout = prepareEvents( n, &r_fds, &w_fds, &err_fds, &nfds );
 
+#ifdef CROS_USE_IO_URING
+  int n_set = cRosUringSelect( &n->uring, nfds + 1, &r_fds, &w_fds, &err_fds, timeout );
+#else
   struct timeval tv = cRosClockGetTimeVal( timeout );
 
   int n_set = select(nfds + 1, &r_fds, &w_fds, &err_fds, &tv);
+#endif
 
   if (n_set == -1)
   {
@@ -2245,222 +4030,72 @@ void cRosNodeDoEventsLoop ( CrosNode *n )
   else if( n_set == 0 )
   {
     PRINT_DEBUG ("cRosNodeDoEventsLoop() : select() timeout\n");
-
-    uint64_t cur_time = cRosClockGetTimeMs();
-
-    XmlrpcProcess *rosproc = &n->xmlrpc_client_proc[0];
-    if(rosproc->state == XMLRPC_PROCESS_STATE_IDLE && rosproc->wake_up_time_ms <= cur_time )
-    {
-      rosproc->wake_up_time_ms = cur_time + CN_PING_LOOP_PERIOD;
-
-      /* Prepare to ping roscore ... */
-      PRINT_DEBUG("cRosApiPrepareRequest() : ping roscore\n");
-
-      RosApiCall *call = newRosApiCall();
-      if (call == NULL)
-      {
-        PRINT_ERROR ( "cRosApiPrepareRequest() : Can't allocate memory\n");
-        exit(1);
-      }
-
-      call->method = CROS_API_GET_PID;
-      int rc = xmlrpcParamVectorPushBackString(&call->params, "/rosout");
-
-      rosproc->message_type = XMLRPC_MESSAGE_REQUEST;
-      generateXmlrpcMessage( n->host, n->roscore_port, rosproc->message_type,
-                          getMethodName(call->method), &call->params, &rosproc->message );
-
-      rosproc->current_call = call;
-      xmlrpcProcessChangeState(rosproc, XMLRPC_PROCESS_STATE_WRITING );
-
-    }
-    else if( n->xmlrpc_client_proc[0].state != XMLRPC_PROCESS_STATE_IDLE &&
-             cur_time - n->xmlrpc_client_proc[0].last_change_time > CN_IO_TIMEOUT )
-    {
-      /* Timeout between I/O operations... close the socket and re-advertise */
-      PRINT_DEBUG ( "cRosNodeDoEventsLoop() : XMLRPC client I/O timeout\n");
-      handleXmlrpcClientError( n, 0 );
-    }
-
-    for( i = 0; i < CN_MAX_TCPROS_SERVER_CONNECTIONS; i++ )
-    {
-      int server_fd = tcpIpSocketGetFD( &(n->tcpros_server_proc[i].socket) );
-      if( n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_WAIT_FOR_WRITING &&
-            n->tcpros_server_proc[i].wake_up_time_ms <= cur_time )
-      {
-        n->tcpros_server_proc[i].wake_up_time_ms = cur_time + n->pubs[n->tcpros_server_proc[i].topic_idx].loop_period;
-        tcprosProcessChangeState( &(n->tcpros_server_proc[i]), TCPROS_PROCESS_STATE_START_WRITING );
-      }
-      else if( (n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_READING_HEADER || 
-                n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_WRITING ) &&
-               cur_time - n->tcpros_server_proc[i].last_change_time > CN_IO_TIMEOUT )
-      {
-        /* Timeout between I/O operations */
-        PRINT_DEBUG ( "cRosNodeDoEventsLoop() : TCPROS server I/O timeout\n");
-        handleTcprosServerError( n, i );
-      }
-    }
+    processTimeouts( n );
   }
   else
   {
-
     PRINT_DEBUG ( "cRosNodeDoEventsLoop() : select() unblocked\n" );
+    processFdEvents( n, &r_fds, &w_fds, &err_fds );
+  }
+}
 
-    for(i = 0; i < CN_MAX_XMLRPC_CLIENT_CONNECTIONS; i++ )
-    {
-      int xmlrpc_client_fd = tcpIpSocketGetFD( &(n->xmlrpc_client_proc[i].socket) );
-
-      if( FD_ISSET(xmlrpc_client_fd, &err_fds) )
-      {
-        PRINT_ERROR ( "cRosNodeDoEventsLoop() : XMLRPC Client error\n" );
-        handleXmlrpcClientError( n, i );
-      }
+int cRosNodeGetEvents( CrosNode *n, CrosNodeFd *fds, int max_fds, uint64_t *deadline_ms )
+{
+  PRINT_VDEBUG ( "cRosNodeGetEvents ()\n" );
 
-      /* Check what is the socket unblocked by the select, and start the requested operations */
-      else if( ( n->xmlrpc_client_proc[i].state == XMLRPC_PROCESS_STATE_WRITING && FD_ISSET(xmlrpc_client_fd, &w_fds) ) ||
-          ( n->xmlrpc_client_proc[i].state == XMLRPC_PROCESS_STATE_READING && FD_ISSET(xmlrpc_client_fd, &r_fds) ) )
-      {
-        doWithXmlrpcClientSocket( n, i );
-      }
-    }
+  fd_set r_fds, w_fds, err_fds;
+  int nfds;
+  uint64_t timeout = prepareEvents( n, &r_fds, &w_fds, &err_fds, &nfds );
 
-    if ( next_xmlrpc_server_i >= 0 )
-    {
-      if( FD_ISSET( xmlrpc_listner_fd, &err_fds) )
-      {
-        PRINT_ERROR ( "cRosNodeDoEventsLoop() : XMLRPC  listner error\n" ); 
-      }
-      else if( FD_ISSET( xmlrpc_listner_fd, &r_fds) )
-      {
-        PRINT_DEBUG ( "cRosNodeDoEventsLoop() : XMLRPC listner ready\n" );
-        if( tcpIpSocketAccept( &(n->xmlrpc_listner_proc.socket), 
-            &(n->xmlrpc_server_proc[next_xmlrpc_server_i].socket) ) == TCPIPSOCKET_DONE &&
-            tcpIpSocketSetReuse( &(n->xmlrpc_server_proc[next_xmlrpc_server_i].socket) ) && 
-            tcpIpSocketSetNonBlocking( &(n->xmlrpc_server_proc[next_xmlrpc_server_i].socket ) ) )
+  uint64_t cur_time = cRosClockGetTimeMs();
+  *deadline_ms = ( timeout < UINT64_MAX - cur_time ) ? cur_time + timeout : UINT64_MAX;
 
-          xmlrpcProcessChangeState( &(n->xmlrpc_server_proc[next_xmlrpc_server_i]), XMLRPC_PROCESS_STATE_READING );        
-      }
-    }
+  // Only the urgent data (never sent by ROS) would be reported in err_fds: they aren't waited for
+  int fd, n_fds = 0;
+  for( fd = 0; fd <= nfds; fd++ )
+  {
+    int events = ( FD_ISSET( fd, &r_fds ) ? CN_EVENT_READ : 0 ) |
+                 ( FD_ISSET( fd, &w_fds ) ? CN_EVENT_WRITE : 0 );
+    if( events == 0 )
+      continue;
 
-    for( i = 0; i < CN_MAX_XMLRPC_SERVER_CONNECTIONS; i++ )
+    if( n_fds == max_fds )
     {
-      int server_fd = tcpIpSocketGetFD( &(n->xmlrpc_server_proc[i].socket) );
-      if( FD_ISSET(server_fd, &err_fds) )
-      {
-        PRINT_ERROR ( "cRosNodeDoEventsLoop() : XMLRPC server error\n" );
-        tcpIpSocketClose( &(n->xmlrpc_server_proc[i].socket) );
-        xmlrpcProcessChangeState( &(n->xmlrpc_server_proc[next_xmlrpc_server_i]), XMLRPC_PROCESS_STATE_IDLE ); 
-      }
-      else if( ( n->xmlrpc_server_proc[i].state == XMLRPC_PROCESS_STATE_WRITING && FD_ISSET(server_fd, &w_fds) ) || 
-               ( n->xmlrpc_server_proc[i].state == XMLRPC_PROCESS_STATE_READING && FD_ISSET(server_fd, &r_fds) ) )
-      {
-        doWithXmlrpcServerSocket( n, i );
-      }
+      PRINT_ERROR ( "cRosNodeGetEvents() : More than %d file descriptors\n", max_fds );
+      return -1;
     }
 
-    for(i = 0; i < CN_MAX_TCPROS_CLIENT_CONNECTIONS; i++ )
-    {
-      TcprosProcess *client_proc = &(n->tcpros_client_proc[i]);
-      int tcpros_client_fd = tcpIpSocketGetFD( &(client_proc->socket) );
-
-      if( client_proc->state != TCPROS_PROCESS_STATE_IDLE && FD_ISSET(tcpros_client_fd, &err_fds) )
-      {
-        PRINT_ERROR ( "cRosNodeDoEventsLoop() : XMLRPC Client error\n" );
-        handleTcprosClientError( n, i );
-      }
-
-      if( client_proc->state == TCPROS_PROCESS_STATE_CONNECTING ||
-          ( client_proc->state == TCPROS_PROCESS_STATE_WRITING_HEADER && FD_ISSET(tcpros_client_fd, &w_fds) ) ||
-          ( client_proc->state == TCPROS_PROCESS_STATE_READING_SIZE && FD_ISSET(tcpros_client_fd, &r_fds) ) ||
-          ( client_proc->state == TCPROS_PROCESS_STATE_READING && FD_ISSET(tcpros_client_fd, &r_fds) ) ||
-          ( client_proc->state == TCPROS_PROCESS_STATE_READING_HEADER_SIZE && FD_ISSET(tcpros_client_fd, &r_fds) ) ||
-          ( client_proc->state == TCPROS_PROCESS_STATE_READING_HEADER && FD_ISSET(tcpros_client_fd, &r_fds) ) )
-      {
-        doWithTcprosClientSocket( n, i );
-      }
-    }
+    fds[n_fds].fd = fd;
+    fds[n_fds].events = events;
+    n_fds++;
+  }
 
-    if ( next_tcpros_server_i >= 0 )
-    {
-      if( FD_ISSET( tcpros_listner_fd, &err_fds) )
-      {
-        PRINT_ERROR ( "cRosNodeDoEventsLoop() : TCPROS listner error\n" ); 
-      }
-      else if( FD_ISSET( tcpros_listner_fd, &r_fds) )
-      {
-        PRINT_DEBUG ( "cRosNodeDoEventsLoop() : TCPROS listner ready\n" );
-        if( tcpIpSocketAccept( &(n->tcpros_listner_proc.socket), 
-            &(n->tcpros_server_proc[next_tcpros_server_i].socket) ) == TCPIPSOCKET_DONE &&
-            tcpIpSocketSetReuse( &(n->tcpros_server_proc[next_tcpros_server_i].socket) ) && 
-            tcpIpSocketSetNonBlocking( &(n->tcpros_server_proc[next_tcpros_server_i].socket ) ) &&
-            tcpIpSocketSetKeepAlive( &(n->tcpros_server_proc[next_tcpros_server_i].socket ), 60, 10, 9 ) )
-        {
+  return n_fds;
+}
 
-          tcprosProcessChangeState( &(n->tcpros_server_proc[next_tcpros_server_i]), TCPROS_PROCESS_STATE_READING_HEADER );
-          uint64_t cur_time = cRosClockGetTimeMs();
-          n->tcpros_server_proc[next_tcpros_server_i].wake_up_time_ms = cur_time;
-        }
-      }
-    }
+void cRosNodeProcessEvents( CrosNode *n, int fd, int events )
+{
+  PRINT_VDEBUG ( "cRosNodeProcessEvents ()\n" );
 
-    for( i = 0; i < CN_MAX_TCPROS_SERVER_CONNECTIONS; i++ )
-    {
-      int server_fd = tcpIpSocketGetFD( &(n->tcpros_server_proc[i].socket) );
-      if( FD_ISSET(server_fd, &err_fds) )
-      {
-        PRINT_ERROR ( "cRosNodeDoEventsLoop() : TCPROS server error\n" );
-        tcpIpSocketClose( &(n->tcpros_server_proc[i].socket) );
-        tcprosProcessChangeState( &(n->tcpros_server_proc[next_tcpros_server_i]), TCPROS_PROCESS_STATE_IDLE ); 
-      }
-      else if( ( n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_READING_HEADER && FD_ISSET(server_fd, &r_fds) ) ||
-        ( n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_START_WRITING && FD_ISSET(server_fd, &w_fds) ) || 
-        ( n->tcpros_server_proc[i].state == TCPROS_PROCESS_STATE_WRITING && FD_ISSET(server_fd, &w_fds) ) )
-      {
-        doWithTcprosServerSocket( n, i );    
-      }
-    }
+  if( fd < 0 )
+  {
+    processTimeouts( n );
+    return;
+  }
 
-    if ( next_rpcros_server_i >= 0 )
-    {
-      if( FD_ISSET( rpcros_listner_fd, &err_fds) )
-      {
-        PRINT_ERROR ( "cRosNodeDoEventsLoop() : TCPROS listner error\n" );
-      }
-      else if( next_rpcros_server_i >= 0 && FD_ISSET( rpcros_listner_fd, &r_fds) )
-      {
-        PRINT_DEBUG ( "cRosNodeDoEventsLoop() : TCPROS listner ready\n" );
-        if( tcpIpSocketAccept( &(n->rpcros_listner_proc.socket),
-            &(n->rpcros_server_proc[next_rpcros_server_i].socket) ) == TCPIPSOCKET_DONE &&
-            tcpIpSocketSetReuse( &(n->rpcros_server_proc[next_rpcros_server_i].socket) ) &&
-            tcpIpSocketSetNonBlocking( &(n->rpcros_server_proc[next_rpcros_server_i].socket ) ) &&
-            tcpIpSocketSetKeepAlive( &(n->rpcros_server_proc[next_rpcros_server_i].socket ), 60, 10, 9 ) )
-        {
-          tcprosProcessChangeState( &(n->rpcros_server_proc[next_rpcros_server_i]), TCPROS_PROCESS_STATE_READING_HEADER_SIZE );
-        }
-      }
-    }
+  if( fd >= FD_SETSIZE )
+    return;
 
-    for( i = 0; i < CN_MAX_RPCROS_SERVER_CONNECTIONS; i++ )
-    {
-      int server_fd = tcpIpSocketGetFD( &(n->rpcros_server_proc[i].socket) );
-      if( FD_ISSET(server_fd, &err_fds) )
-      {
-        PRINT_ERROR ( "cRosNodeDoEventsLoop() : TCPROS server error\n" );
-        tcpIpSocketClose( &(n->rpcros_server_proc[i].socket) );
-        tcprosProcessChangeState( &(n->rpcros_server_proc[next_rpcros_server_i]), TCPROS_PROCESS_STATE_IDLE );
-      }
-      else if( ( n->rpcros_server_proc[i].state == TCPROS_PROCESS_STATE_READING_HEADER_SIZE && FD_ISSET(server_fd, &r_fds) ) ||
-        ( n->rpcros_server_proc[i].state == TCPROS_PROCESS_STATE_READING_HEADER && FD_ISSET(server_fd, &r_fds) ) ||
-        ( n->rpcros_server_proc[i].state == TCPROS_PROCESS_STATE_READING_SIZE && FD_ISSET(server_fd, &r_fds) ) ||
-        ( n->rpcros_server_proc[i].state == TCPROS_PROCESS_STATE_READING && FD_ISSET(server_fd, &r_fds) ) ||
-        ( n->rpcros_server_proc[i].state == TCPROS_PROCESS_STATE_WRITING_HEADER && FD_ISSET(server_fd, &w_fds) ) ||
-        ( n->rpcros_server_proc[i].state == TCPROS_PROCESS_STATE_WRITING && FD_ISSET(server_fd, &w_fds) ) )
-      {
-        doWithRpcrosServerSocket( n, i );
-      }
-    }
+  fd_set r_fds, w_fds, err_fds;
+  FD_ZERO( &r_fds );
+  FD_ZERO( &w_fds );
+  FD_ZERO( &err_fds );
+  if( events & CN_EVENT_READ )
+    FD_SET( fd, &r_fds );
+  if( events & CN_EVENT_WRITE )
+    FD_SET( fd, &w_fds );
 
-  }
+  processFdEvents( n, &r_fds, &w_fds, &err_fds );
 }
 
 void cRosNodeStart( CrosNode *n, unsigned char *exit )
@@ -2611,15 +4246,90 @@ int enqueueRequestTopic(CrosNode *node, int subidx)
   xmlrpcParamVectorPushBackString(&call->params, sub->topic_name );
   xmlrpcParamVectorPushBackArray(&call->params);
   XmlrpcParam* array_param = xmlrpcParamVectorAt(&call->params,2);
-  xmlrpcParamArrayPushBackArray(array_param);
-  xmlrpcParamArrayPushBackString(xmlrpcParamArrayGetParamAt(array_param,0),CROS_TRANSPORT_TCPROS_STRING);
+  // Preferred when the publisher is a linked node of this process (the PID tells it), ignored otherwise
+  if (node->intraprocess_transport)
+  {
+    XmlrpcParam* intraprocess_param = xmlrpcParamArrayPushBackArray(array_param);
+    xmlrpcParamArrayPushBackString(intraprocess_param, CROS_TRANSPORT_INTRAPROCESS_STRING);
+    xmlrpcParamArrayPushBackInt(intraprocess_param, node->pid);
+  }
+  // Preferred then by the cROS publishers of this host (they can open the FIFO)
+  const char *fifo_path = NULL;
+  if (node->shm_transport && !sub->shm_refused)
+    fifo_path = cRosShmOpenNotifier(node, subidx);
+  if (fifo_path != NULL)
+  {
+    XmlrpcParam* shm_param = xmlrpcParamArrayPushBackArray(array_param);
+    xmlrpcParamArrayPushBackString(shm_param, CROS_TRANSPORT_SHMROS_STRING);
+    xmlrpcParamArrayPushBackInt(shm_param, node->pid);
+    xmlrpcParamArrayPushBackString(shm_param, fifo_path);
+  }
+  // Then UDPROS, if wanted: [UDPROS, connection header, host, port, max datagram size]
+  int udpros_port = -1;
+  if (sub->udpros.max_datagram_size > 0 && !sub->udpros.refused)
+    udpros_port = cRosUdprosOpenReceiver(node, subidx);
+  if (udpros_port != -1)
+  {
+    DynBuffer header;
+    dynBufferInit(&header);
+    cRosMessagePrepareUdprosSubscriptionHeader(node, subidx, &header);
+    XmlrpcParam* udpros_param = xmlrpcParamArrayPushBackArray(array_param);
+    xmlrpcParamArrayPushBackString(udpros_param, CROS_TRANSPORT_UDPROS_STRING);
+    xmlrpcParamArrayPushBackBinary(udpros_param, dynBufferGetData(&header), dynBufferGetSize(&header));
+    xmlrpcParamArrayPushBackString(udpros_param, node->host);
+    xmlrpcParamArrayPushBackInt(udpros_param, udpros_port);
+    xmlrpcParamArrayPushBackInt(udpros_param, sub->udpros.max_datagram_size);
+    dynBufferRelease(&header);
+  }
+  // TCPROS connection through a Unix domain socket, if the publisher is on this host,
+  // otherwise through TCP/IP
+  if (node->unix_transport && !sub->unixros_refused && isLocalHost(sub->topic_host))
+  {
+    XmlrpcParam* unixros_param = xmlrpcParamArrayPushBackArray(array_param);
+    xmlrpcParamArrayPushBackString(unixros_param, CROS_TRANSPORT_UNIXROS_STRING);
+  }
+  XmlrpcParam* tcpros_param = xmlrpcParamArrayPushBackArray(array_param);
+  xmlrpcParamArrayPushBackString(tcpros_param, CROS_TRANSPORT_TCPROS_STRING);
 
   return enqueueSlaveApiCallInternal(node, call);
 }
 
+int enqueueServiceLookup(CrosNode *node, int svccalleridx)
+{
+  RosApiCall *call = newRosApiCall();
+  if (call == NULL)
+  {
+    PRINT_ERROR ( "enqueueServiceLookup() : Can't allocate memory\n");
+    return -1;
+  }
+
+  ServiceCallerNode *caller = &node->service_callers[svccalleridx];
+
+  call->method = CROS_API_LOOKUP_SERVICE;
+  call->provider_idx = svccalleridx;
+  xmlrpcParamVectorPushBackString( &call->params, node->name );
+  xmlrpcParamVectorPushBackString( &call->params, caller->service_name );
+
+  int rc = enqueueMasterApiCallInternal(node, call);
+  if (rc == -1)
+  {
+    freeRosApiCall(call);
+    return -1;
+  }
+
+  caller->lookup_pending = 1;
+  return rc;
+}
+
 void restartAdversing(CrosNode* n)
 {
+  // roscore restarted: all the cached lookups are stale, and it doesn't know the parameter subscriptions
+  cRosLookupCacheClear(&n->lookup_cache);
+
   int it;
+  for(it = 0; it < CN_MAX_PARAMETER_SUBSCRIPTIONS; it++)
+    n->paramsubs[it].subscribed = 0;
+
   for(it = 0; it < n->n_pubs; it++)
   {
     if (n->pubs[it].topic_name == NULL)
@@ -2656,12 +4366,26 @@ void initPublisherNode(PublisherNode *node)
   node->context = NULL;
   node->client_tcpros_id = -1;
   node->loop_period = 1000;
+  node->wake_up_time_ms = 0;
+  dynBufferInit(&node->packet);
+  dynBufferInit(&node->header);
+  node->n_intra_subs = 0;
+  node->shm = NULL;
+  node->n_udpros_subs = 0;
+  node->send_queue_size = 0;
+  node->drop_policy = CROS_DROP_NEWEST;
+  node->lag_limit_ms = 0;
+  node->disconnect_lagging = 0;
+  node->lagging_disconnects = 0;
+  node->write_batch_size = CN_TCPROS_WRITE_BATCH_SIZE;
+  node->write_window_us = 0;
 }
 
 void initSubscriberNode(SubscriberNode *node)
 {
   node->message_definition = NULL;
   node->topic_host = NULL;
+  node->topic_uri = NULL;
   node->topic_port = -1;
   node->topic_name = NULL;
   node->topic_type = NULL;
@@ -2672,6 +4396,34 @@ void initSubscriberNode(SubscriberNode *node)
   node->client_xmlrpc_id = -1;
   node->client_tcpros_id = -1;
   node->tcpros_port = -1;
+  node->intra_pub_node = NULL;
+  node->intra_pub_idx = -1;
+  dynBufferInit(&node->header);
+  dynBufferInit(&node->intra_packets);
+  node->n_intra_packets = 0;
+  node->shm = NULL;
+  node->shm_reader = -1;
+  node->shm_notify_fd = -1;
+  node->shm_fifo_path = NULL;
+  node->shm_refused = 0;
+  node->unixros_path = NULL;
+  node->unixros_refused = 0;
+  node->udpros.max_datagram_size = 0;
+  node->udpros.fd = -1;
+  node->udpros.refused = 0;
+  node->udpros.connected = 0;
+  node->udpros.connection_id = 0;
+  dynBufferInit(&node->udpros.message);
+  node->udpros.message_id = -1;
+  node->udpros.n_blocks = 0;
+  node->udpros.next_block = 0;
+  node->udpros.last_message_id = -1;
+  node->udpros.received_messages = 0;
+  node->udpros.dropped_messages = 0;
+  node->queue_size = 0;
+  dynBufferInit(&node->queue);
+  node->n_queued = 0;
+  node->queue_drops = 0;
 }
 
 void initServiceProviderNode(ServiceProviderNode *node)
@@ -2684,6 +4436,26 @@ void initServiceProviderNode(ServiceProviderNode *node)
   node->context = NULL;
   node->servicerequest_type = NULL;
   node->serviceresponse_type = NULL;
+  dynBufferInit(&node->header);
+}
+
+void initServiceCallerNode(ServiceCallerNode *node)
+{
+  node->service_name = NULL;
+  node->service_type = NULL;
+  node->md5sum = NULL;
+  node->service_host = NULL;
+  node->service_port = -1;
+  node->uri_from_cache = 0;
+  node->lookup_pending = 0;
+  node->resolver = NULL;
+  node->persistent = 0;
+  dynBufferInit(&node->header);
+  node->queue_head = node->queue_tail = NULL;
+  node->sent_head = node->sent_tail = NULL;
+  node->callback = NULL;
+  node->status_callback = NULL;
+  node->context = NULL;
 }
 
 void initParameterSubscrition(ParameterSubscription *subscription)
@@ -2692,6 +4464,7 @@ void initParameterSubscrition(ParameterSubscription *subscription)
   xmlrpcParamInit(&subscription->parameter_value);
   subscription->status_callback = NULL;
   subscription->context = NULL;
+  subscription->subscribed = 0;
 }
 
 void releasePublisherNode(PublisherNode *node)
@@ -2700,6 +4473,8 @@ void releasePublisherNode(PublisherNode *node)
   free(node->topic_name);
   free(node->topic_type);
   free(node->md5sum);
+  dynBufferRelease(&node->packet);
+  dynBufferRelease(&node->header);
 }
 
 void releaseSubscriberNode(SubscriberNode *node)
@@ -2709,6 +4484,12 @@ void releaseSubscriberNode(SubscriberNode *node)
   free(node->topic_type);
   free(node->md5sum);
   free(node->topic_host);
+  free(node->topic_uri);
+  free(node->unixros_path);
+  dynBufferRelease(&node->header);
+  dynBufferRelease(&node->intra_packets);
+  dynBufferRelease(&node->udpros.message);
+  dynBufferRelease(&node->queue);
 }
 
 void releaseServiceProviderNode(ServiceProviderNode *node)
@@ -2718,6 +4499,24 @@ void releaseServiceProviderNode(ServiceProviderNode *node)
   free(node->servicerequest_type);
   free(node->serviceresponse_type);
   free(node->md5sum);
+  dynBufferRelease(&node->header);
+}
+
+void releaseServiceCallerNode(ServiceCallerNode *node)
+{
+  free(node->service_name);
+  free(node->service_type);
+  free(node->md5sum);
+  free(node->service_host);
+  if (node->resolver != NULL)
+    releaseServiceHostResolver(node->resolver);
+  dynBufferRelease(&node->header);
+
+  ServiceCallNode *call;
+  while ((call = popServiceCall(&node->queue_head, &node->queue_tail)) != NULL)
+    freeServiceCall(call);
+  while ((call = popServiceCall(&node->sent_head, &node->sent_tail)) != NULL)
+    freeServiceCall(call);
 }
 
 void initCrosNodeStatus(CrosNodeStatusUsr *status)
@@ -2752,9 +4551,39 @@ void getIdleXmplrpcClients(CrosNode *node, int idle_clients[], size_t *idle_clie
   }
 }
 
+CrosLookupCacheKind lookupCacheCallKey(CrosNode *node, RosApiCall *call, const char **key)
+{
+  CrosLookupCacheKind kind = cRosLookupCacheCallKey(call, key);
+  if (kind != CROS_LOOKUP_CACHE_PARAM)
+    return kind;
+
+  // Any node can change a parameter: its cached value is valid only if the master notifies the updates
+  int idx = cRosNameIndexFindNamespace(&node->name_index, CROS_NAME_PARAMETER, *key);
+  if (idx == -1 || !node->paramsubs[idx].subscribed)
+    return CROS_LOOKUP_CACHE_NONE;
+
+  return kind;
+}
+
 int enqueueMasterApiCall(CrosNode *node, RosApiCall *call)
 {
   call->user_call = 1;
+
+  const char *key;
+  CrosLookupCacheKind kind = lookupCacheCallKey(node, call, &key);
+  if (kind != CROS_LOOKUP_CACHE_NONE && cRosLookupCacheGet(&node->lookup_cache, kind, key) != NULL)
+  {
+    // Answered from the cache by the next cRosNodeDoEventsLoop() cycle
+    int callid = (int)node->next_call_id;
+    call->id = callid;
+    int rc = enqueueApiCall(&node->cached_api_queue, call);
+    if (rc == -1)
+      return -1;
+
+    node->next_call_id++;
+    return callid;
+  }
+
   return enqueueSlaveApiCallInternal(node, call);
 }
 
@@ -2806,6 +4635,45 @@ int enqueueSlaveApiCallInternal(CrosNode *node, RosApiCall *call)
   return callid;
 }
 
+void dispatchCachedApiCalls(CrosNode *node)
+{
+  // Only the calls already enqueued are served: the callbacks may enqueue new ones
+  size_t count = getQueueCount(&node->cached_api_queue);
+  for (; count > 0; count--)
+  {
+    RosApiCall *call = dequeueApiCall(&node->cached_api_queue);
+
+    const char *key;
+    CrosLookupCacheKind kind = lookupCacheCallKey(node, call, &key);
+    XmlrpcParam *cached = NULL;
+    if (kind != CROS_LOOKUP_CACHE_NONE)
+      cached = cRosLookupCacheGet(&node->lookup_cache, kind, key);
+    XmlrpcParam response_array;
+    if (cached == NULL || xmlrpcParamCopy(&response_array, cached) == -1)
+    {
+      // Invalidated in the meantime: ask roscore
+      enqueueApiCall(&node->slave_api_queue, call);
+      continue;
+    }
+
+    XmlrpcParamVector response;
+    xmlrpcParamVectorInit(&response);
+    xmlrpcParamVectorPushBack(&response, &response_array);
+
+    ResultCallback callback = call->result_callback;
+    if (callback != NULL)
+    {
+      void *result = call->fetch_result_callback(&response);
+      callback(call->id, result, call->context_data);
+      if (result != NULL)
+        call->free_result_callback(result);
+    }
+
+    xmlrpcParamVectorRelease(&response);
+    freeRosApiCall(call);
+  }
+}
+
 void cRosGetMsgFilePath(CrosNode *node, char *buffer, size_t bufsize, const char *topic_type)
 {
   snprintf(buffer, bufsize, "%s/%s.msg", node->message_root_path, topic_type);
@@ -2818,15 +4686,126 @@ void getSrvFilePath(CrosNode *node, char *buffer, size_t bufsize, const char *se
 
 XmlrpcParam * cRosNodeGetParameterValue( CrosNode *node, const char *key)
 {
-  int it = 0;
-  for (it = 0 ; it < node->n_paramsubs; it++)
+  int idx = cRosNameIndexFind(&node->name_index, CROS_NAME_PARAMETER, key);
+  if (idx == -1)
+    return NULL;
+
+  return &node->paramsubs[idx].parameter_value;
+}
+
+void cRosNodeSetLookupCacheTtl( CrosNode *n, uint64_t ttl_ms )
+{
+  n->lookup_cache.ttl = ttl_ms;
+  if (ttl_ms == 0)
+    cRosLookupCacheClear(&n->lookup_cache);
+}
+
+int cRosNodeSetIntraprocessTransport( CrosNode *n, int enable )
+{
+  if (enable == n->intraprocess_transport)
+    return 0;
+
+  if (enable)
   {
-    if (node->paramsubs[it].parameter_key == NULL)
+    if (cRosIntraprocessRegisterNode(n) == -1)
+      return -1;
+  }
+  else
+  {
+    // The subscribers fed by another node wait for the next publisherUpdate, as the ones of its publishers
+    int i;
+    for (i = 0; i < CN_MAX_SUBSCRIBED_TOPICS; i++)
+    {
+      if (n->subs[i].intra_pub_node != NULL)
+        n->subs[i].tcpros_port = -1;
+    }
+
+    cRosIntraprocessUnregisterNode(n);
+  }
+
+  n->intraprocess_transport = enable;
+  return 0;
+}
+
+void cRosNodeSetShmTransport( CrosNode *n, int enable )
+{
+  n->shm_transport = enable;
+}
+
+void cRosNodeSetUnixTransport( CrosNode *n, int enable )
+{
+  n->unix_transport = enable;
+}
+
+int cRosNodeSetSubscriberUdpros( CrosNode *n, int subidx, int max_datagram_size )
+{
+  if (subidx < 0 || subidx >= CN_MAX_SUBSCRIBED_TOPICS || n->subs[subidx].topic_name == NULL ||
+      max_datagram_size < 0 || max_datagram_size > 65507)
+    return -1;
+
+  n->subs[subidx].udpros.max_datagram_size = max_datagram_size;
+  n->subs[subidx].udpros.refused = 0;
+  return 0;
+}
+
+int cRosNodeSetSubscriberQueue( CrosNode *n, int subidx, int queue_size )
+{
+  if (subidx < 0 || subidx >= CN_MAX_SUBSCRIBED_TOPICS || n->subs[subidx].topic_name == NULL || queue_size < 0)
+    return -1;
+
+  cRosSubscriberQueueResize(&n->subs[subidx], queue_size);
+  return 0;
+}
+
+int cRosNodeSetPublisherQueue( CrosNode *n, int pubidx, int queue_size, CrosDropPolicy policy )
+{
+  if (pubidx < 0 || pubidx >= CN_MAX_PUBLISHED_TOPICS || n->pubs[pubidx].topic_name == NULL || queue_size < 0 ||
+      (policy != CROS_DROP_NEWEST && policy != CROS_DROP_OLDEST))
+    return -1;
+
+  n->pubs[pubidx].send_queue_size = queue_size;
+  n->pubs[pubidx].drop_policy = policy;
+  return 0;
+}
+
+int cRosNodeSetPublisherLagLimit( CrosNode *n, int pubidx, uint64_t lag_limit_ms, int disconnect )
+{
+  if (pubidx < 0 || pubidx >= CN_MAX_PUBLISHED_TOPICS || n->pubs[pubidx].topic_name == NULL)
+    return -1;
+
+  n->pubs[pubidx].lag_limit_ms = lag_limit_ms;
+  n->pubs[pubidx].disconnect_lagging = disconnect ? 1 : 0;
+  return 0;
+}
+
+int cRosNodeSetPublisherWriteBatching( CrosNode *n, int pubidx, size_t batch_size, uint64_t window_us )
+{
+  if (pubidx < 0 || pubidx >= CN_MAX_PUBLISHED_TOPICS || n->pubs[pubidx].topic_name == NULL)
+    return -1;
+
+  n->pubs[pubidx].write_batch_size = batch_size;
+  n->pubs[pubidx].write_window_us = window_us;
+  return 0;
+}
+
+int cRosNodeGetPublisherStats( CrosNode *n, int pubidx, size_t *drops, int *lagging, size_t *lagging_disconnects )
+{
+  if (pubidx < 0 || pubidx >= CN_MAX_PUBLISHED_TOPICS || n->pubs[pubidx].topic_name == NULL)
+    return -1;
+
+  *drops = 0;
+  *lagging = 0;
+  int i;
+  for (i = 0; i < CN_MAX_TCPROS_SERVER_CONNECTIONS; i++)
+  {
+    TcprosProcess *server_proc = &n->tcpros_server_proc[i];
+    if (server_proc->topic_idx != pubidx || server_proc->state == TCPROS_PROCESS_STATE_IDLE)
       continue;
 
-    if (strcmp(node->paramsubs[it].parameter_key, key) == 0)
-      return &node->paramsubs[it].parameter_value;
+    *drops += server_proc->drops;
+    *lagging += server_proc->lagging;
   }
 
-  return NULL;
+  *lagging_disconnects = n->pubs[pubidx].lagging_disconnects;
+  return 0;
 }
@@ -11,6 +11,10 @@
 #include "cros_api.h"
 #include "cros_api_internal.h"
 #include "cros_defs.h"
+#include "cros_intraprocess.h"
+#include "cros_shm.h"
+#include "cros_tcpros.h"
+#include "cros_udpros.h"
 #include "xmlrpc_params.h"
 
 int
@@ -97,6 +101,21 @@ static int checkResponseValue( XmlrpcParamVector *params )
   return res;
 }
 
+// Keep the XMLRPC URI of the publisher contacted by a subscriber, reported by getBusInfo
+static void setSubscriberTopicUri( SubscriberNode *sub, const char *uri )
+{
+  // A new publisher may accept the Unix domain socket refused by the previous one
+  if( sub->topic_uri == NULL || strcmp( sub->topic_uri, uri ) != 0 )
+    sub->unixros_refused = 0;
+
+  char *uri_copy = strdup( uri );
+  if( uri_copy == NULL )
+    return;
+
+  free( sub->topic_uri );
+  sub->topic_uri = uri_copy;
+}
+
 void cRosApiPrepareRequest( CrosNode *n, int client_idx )
 {
   PRINT_VDEBUG ( "cRosApiPrepareRequest()\n" );
@@ -223,6 +242,7 @@ int cRosApiParseResponse( CrosNode *n, int client_idx )
                 return ret;
 
               requesting_subscriber->topic_port = atoi(strtok_r(NULL,":",&progress));
+              setSubscriberTopicUri(requesting_subscriber, pub_host_string);
               enqueueRequestTopic(n, subidx);
 
               break;
@@ -263,6 +283,7 @@ int cRosApiParseResponse( CrosNode *n, int client_idx )
           ret = 0;
           xmlrpcParamRelease(&subscription->parameter_value);
           subscription->parameter_value = copy;
+          subscription->subscribed = 1;
         }
 
         break;
@@ -352,6 +373,29 @@ int cRosApiParseResponse( CrosNode *n, int client_idx )
         xmlrpcProcessChangeState(client_proc,XMLRPC_PROCESS_STATE_IDLE);
         break;
       }
+      case CROS_API_LOOKUP_SERVICE:
+      {
+        PRINT_DEBUG ( "cRosApiParseResponse() : lookupService response \n" );
+
+        // Lookup done on behalf of a service caller
+        XmlrpcParam *service_name = xmlrpcParamVectorAt(&call->params, 1);
+        const char *uri = NULL;
+        if( checkResponseValue( &client_proc->response ) == 1 )
+        {
+          XmlrpcParam *array = xmlrpcParamVectorAt(&client_proc->response, 0);
+          XmlrpcParam *uri_param = xmlrpcParamArrayGetParamAt(array, 2);
+          if (uri_param != NULL && xmlrpcParamGetType(uri_param) == XMLRPC_PARAM_STRING)
+          {
+            uri = xmlrpcParamGetString(uri_param);
+            cRosLookupCacheStore(&n->lookup_cache, CROS_LOOKUP_CACHE_SERVICE,
+                                 xmlrpcParamGetString(service_name), array);
+          }
+        }
+
+        cRosNodeServiceCallerLookupDone(n, call->provider_idx, xmlrpcParamGetString(service_name), uri);
+        ret = 0;
+        break;
+      }
       default:
       {
         assert(0);
@@ -385,6 +429,14 @@ int cRosApiParseResponse( CrosNode *n, int client_idx )
       {
         ret = 0;
 
+        const char *key;
+        CrosLookupCacheKind kind = lookupCacheCallKey(n, call, &key);
+        if (kind != CROS_LOOKUP_CACHE_NONE && checkResponseValue(&client_proc->response) == 1)
+        {
+          cRosLookupCacheStore(&n->lookup_cache, kind, key,
+                               xmlrpcParamVectorAt(&client_proc->response, 0));
+        }
+
         ResultCallback callback = call->result_callback;
         if (callback != NULL)
         {
@@ -404,10 +456,118 @@ int cRosApiParseResponse( CrosNode *n, int client_idx )
 
           XmlrpcParam* param_array = xmlrpcParamVectorAt(&client_proc->response,0);
           XmlrpcParam* nested_array = xmlrpcParamArrayGetParamAt(param_array,2);
+          XmlrpcParam* protocol = xmlrpcParamArrayGetParamAt(nested_array,0);
           XmlrpcParam* tcp_port = xmlrpcParamArrayGetParamAt(nested_array,2);
 
           RosApiCall *call = client_proc->current_call;
 
+          if (protocol != NULL && xmlrpcParamGetType(protocol) == XMLRPC_PARAM_STRING &&
+              strcmp(xmlrpcParamGetString(protocol), CROS_TRANSPORT_INTRAPROCESS_STRING) == 0)
+          {
+            // The publisher has already linked the subscriber: no TCPROS connection
+            PRINT_DEBUG( "cRosApiParseResponse() : requestTopic response [intra-process]\n");
+            n->subs[call->provider_idx].tcpros_port = 0;
+            xmlrpcProcessChangeState(client_proc,XMLRPC_PROCESS_STATE_IDLE);
+            break;
+          }
+
+          if (protocol != NULL && xmlrpcParamGetType(protocol) == XMLRPC_PARAM_STRING &&
+              strcmp(xmlrpcParamGetString(protocol), CROS_TRANSPORT_SHMROS_STRING) == 0)
+          {
+            XmlrpcParam* shm_name = xmlrpcParamArrayGetParamAt(nested_array,1);
+            XmlrpcParam* shm_reader = xmlrpcParamArrayGetParamAt(nested_array,2);
+            SubscriberNode* sub = &n->subs[call->provider_idx];
+            xmlrpcProcessChangeState(client_proc,XMLRPC_PROCESS_STATE_IDLE);
+            if (shm_name != NULL && xmlrpcParamGetType(shm_name) == XMLRPC_PARAM_STRING &&
+                shm_reader != NULL && xmlrpcParamGetType(shm_reader) == XMLRPC_PARAM_INT &&
+                cRosShmAttach(n, call->provider_idx, xmlrpcParamGetString(shm_name), shm_reader->data.as_int) == 0)
+            {
+              PRINT_DEBUG( "cRosApiParseResponse() : requestTopic response [shared memory]\n");
+              sub->tcpros_port = 0;
+            }
+            else
+            {
+              // Ask again for TCPROS
+              sub->shm_refused = 1;
+              enqueueRequestTopic(n, call->provider_idx);
+            }
+            break;
+          }
+
+          if (protocol != NULL && xmlrpcParamGetType(protocol) == XMLRPC_PARAM_STRING &&
+              strcmp(xmlrpcParamGetString(protocol), CROS_TRANSPORT_UDPROS_STRING) == 0)
+          {
+            // [UDPROS, host, port, connection id, max datagram size, connection header]
+            XmlrpcParam* host = xmlrpcParamArrayGetParamAt(nested_array,1);
+            XmlrpcParam* port = xmlrpcParamArrayGetParamAt(nested_array,2);
+            XmlrpcParam* connection_id = xmlrpcParamArrayGetParamAt(nested_array,3);
+            XmlrpcParam* max_datagram_size = xmlrpcParamArrayGetParamAt(nested_array,4);
+            XmlrpcParam* header = xmlrpcParamArrayGetParamAt(nested_array,5);
+            SubscriberNode* sub = &n->subs[call->provider_idx];
+            unsigned char *header_data = NULL;
+            int header_size = 0;
+            if (header != NULL && xmlrpcParamGetType(header) == XMLRPC_PARAM_BINARY)
+              header_data = xmlrpcParamGetBinary(header, &header_size);
+
+            xmlrpcProcessChangeState(client_proc,XMLRPC_PROCESS_STATE_IDLE);
+            if (host != NULL && xmlrpcParamGetType(host) == XMLRPC_PARAM_STRING &&
+                port != NULL && xmlrpcParamGetType(port) == XMLRPC_PARAM_INT &&
+                connection_id != NULL && xmlrpcParamGetType(connection_id) == XMLRPC_PARAM_INT &&
+                max_datagram_size != NULL && xmlrpcParamGetType(max_datagram_size) == XMLRPC_PARAM_INT &&
+                header_data != NULL &&
+                cRosMessageCheckUdprosHeader(header_data, header_size, sub->topic_type, sub->md5sum) == 0 &&
+                cRosUdprosConnect(n, call->provider_idx, xmlrpcParamGetString(host), port->data.as_int,
+                                  (uint32_t)connection_id->data.as_int, max_datagram_size->data.as_int) == 0)
+            {
+              PRINT_DEBUG( "cRosApiParseResponse() : requestTopic response [udpros]\n");
+              sub->tcpros_port = 0;
+            }
+            else
+            {
+              PRINT_ERROR( "cRosApiParseResponse() : Wrong UDPROS response, requesting TCPROS\n");
+              sub->udpros.refused = 1;
+              cRosUdprosCloseReceiver(n, call->provider_idx);
+              enqueueRequestTopic(n, call->provider_idx);
+            }
+            break;
+          }
+
+          if (protocol != NULL && xmlrpcParamGetType(protocol) == XMLRPC_PARAM_STRING &&
+              strcmp(xmlrpcParamGetString(protocol), CROS_TRANSPORT_UNIXROS_STRING) == 0)
+          {
+            // [UNIXROS, socket path]: TCPROS through the Unix domain socket of the publisher
+            XmlrpcParam* unix_path = xmlrpcParamArrayGetParamAt(nested_array,1);
+            SubscriberNode* sub = &n->subs[call->provider_idx];
+            TcprosProcess* tcpros_proc = &n->tcpros_client_proc[sub->client_tcpros_id];
+            xmlrpcProcessChangeState(client_proc,XMLRPC_PROCESS_STATE_IDLE);
+
+            if (tcpros_proc->socket.open)
+              tcpIpSocketClose(&(tcpros_proc->socket));
+
+            free(sub->unixros_path);
+            sub->unixros_path = NULL;
+            if (unix_path != NULL && xmlrpcParamGetType(unix_path) == XMLRPC_PARAM_STRING)
+              sub->unixros_path = strdup(xmlrpcParamGetString(unix_path));
+
+            if (sub->unixros_path != NULL &&
+                tcpIpSocketOpenUnix(&(tcpros_proc->socket)) &&
+                tcpIpSocketSetNonBlocking(&(tcpros_proc->socket)))
+            {
+              PRINT_DEBUG( "cRosApiParseResponse() : requestTopic response [unix socket: %s]\n", sub->unixros_path);
+              sub->tcpros_port = 0;
+              tcpros_proc->topic_idx = call->provider_idx;
+              tcprosProcessChangeState(tcpros_proc, TCPROS_PROCESS_STATE_CONNECTING);
+            }
+            else
+            {
+              // Ask again for TCPROS
+              tcpIpSocketClose(&(tcpros_proc->socket));
+              sub->unixros_refused = 1;
+              enqueueRequestTopic(n, call->provider_idx);
+            }
+            break;
+          }
+
           int tcp_port_print = tcp_port->data.as_int;
           SubscriberNode* sub = &n->subs[call->provider_idx];
           sub->tcpros_port = tcp_port_print;
@@ -415,6 +575,12 @@ int cRosApiParseResponse( CrosNode *n, int client_idx )
           TcprosProcess* tcpros_proc = &n->tcpros_client_proc[sub->client_tcpros_id];
           tcpros_proc->topic_idx = call->provider_idx;
 
+          // A previous connection through a Unix domain socket can't be reused for TCP/IP
+          if(tcpros_proc->socket.open && tcpros_proc->socket.family != AF_INET)
+          {
+            tcpIpSocketClose(&(tcpros_proc->socket));
+          }
+
           //need to be checked because maybe the connection went down suddenly.
           if(!tcpros_proc->socket.open)
           {
@@ -489,6 +655,10 @@ int cRosApiParseRequestPrepareResponse( CrosNode *n, int server_idx )
       }
       else
       {
+        // The publishers of the topic changed: node and topic lookups may be stale
+        cRosLookupCacheInvalidateKind(&n->lookup_cache, CROS_LOOKUP_CACHE_NODE);
+        cRosLookupCacheInvalidateKind(&n->lookup_cache, CROS_LOOKUP_CACHE_TOPIC_TYPES);
+
         int array_size = xmlrpcParamArrayGetSize( publishers_param );
         XmlrpcParam *uri;
         XmlrpcParam *proto_name;
@@ -497,18 +667,9 @@ int cRosApiParseRequestPrepareResponse( CrosNode *n, int server_idx )
         SubscriberNode* requesting_subscriber = NULL;
 
         int i = 0;
-        for(; i < n->n_subs; i++)
-        {
-          if (n->subs[i].topic_name == NULL)
-            continue;
-
-          if( strcmp( xmlrpcParamGetString( topic_param ), n->subs[i].topic_name ) == 0)
-          {
-            sub_idx = i;
-            requesting_subscriber = &(n->subs[i]);
-            break;
-          }
-        }
+        sub_idx = cRosNameIndexFind( &n->name_index, CROS_NAME_SUBSCRIBER, xmlrpcParamGetString( topic_param ) );
+        if( sub_idx != -1 )
+          requesting_subscriber = &(n->subs[sub_idx]);
 
         if(array_size > 0)
         {
@@ -555,6 +716,7 @@ int cRosApiParseRequestPrepareResponse( CrosNode *n, int server_idx )
             }
 
             requesting_subscriber->topic_port = atoi(strtok_r(NULL,":",&progress));
+            setSubscriberTopicUri(requesting_subscriber, pub_host_string);
             enqueueRequestTopic(n, sub_idx);
           }
 
@@ -597,27 +759,22 @@ int cRosApiParseRequestPrepareResponse( CrosNode *n, int server_idx )
       {
         int array_size = xmlrpcParamArrayGetSize( protocols_param );
         XmlrpcParam *proto, *proto_name;
-        int i = 0, topic_found = 0, protocol_found = 0;
+        int i = 0, topic_found = 0, protocol_found = 0, intraprocess = 0, shm_reader = -1, udpros_sub = -1;
+        const char *unixros_path = NULL;
+        int pub_idx = -1;
 
-        for( i = 0 ; i < n->n_pubs; i++)
+        pub_idx = cRosNameIndexFind( &n->name_index, CROS_NAME_PUBLISHER, xmlrpcParamGetString( topic_param ) );
+        if( pub_idx != -1 )
         {
-          PublisherNode *pub = &n->pubs[i];
-          if (pub->topic_name == NULL)
-            continue;
-
-          if( strcmp( xmlrpcParamGetString( topic_param ), pub->topic_name ) == 0)
+          PublisherNode *pub = &n->pubs[pub_idx];
+          topic_found = 1;
+          if (pub->status_callback != NULL && strlen(server_proc->host) != 0)
           {
-            topic_found = 1;
-            if (pub->status_callback != NULL && strlen(server_proc->host) != 0)
-            {
-              CrosNodeStatusUsr status;
-              initCrosNodeStatus(&status);
-              status.xmlrpc_host = server_proc->host;
-              status.xmlrpc_port = server_proc->port;
-              pub->status_callback(&status, pub->context);
-            }
-
-            break;
+            CrosNodeStatusUsr status;
+            initCrosNodeStatus(&status);
+            status.xmlrpc_host = server_proc->host;
+            status.xmlrpc_port = server_proc->port;
+            pub->status_callback(&status, pub->context);
           }
         }
 
@@ -625,17 +782,133 @@ int cRosApiParseRequestPrepareResponse( CrosNode *n, int server_idx )
         {
           proto = xmlrpcParamArrayGetParamAt ( protocols_param, i );
 
-          if( xmlrpcParamGetType( proto ) == XMLRPC_PARAM_ARRAY &&
-              ( proto_name = xmlrpcParamArrayGetParamAt ( proto, 0 ) ) != NULL &&
-              xmlrpcParamGetType( proto_name ) == XMLRPC_PARAM_STRING &&
-              strcmp( xmlrpcParamGetString( proto_name ), CROS_TRANSPORT_TCPROS_STRING) == 0 )
+          if( xmlrpcParamGetType( proto ) != XMLRPC_PARAM_ARRAY ||
+              ( proto_name = xmlrpcParamArrayGetParamAt ( proto, 0 ) ) == NULL ||
+              xmlrpcParamGetType( proto_name ) != XMLRPC_PARAM_STRING )
+            continue;
+
+          if( strcmp( xmlrpcParamGetString( proto_name ), CROS_TRANSPORT_TCPROS_STRING) == 0 )
           {
             protocol_found = 1;
-            break;
           }
+          else if( topic_found &&
+                   strcmp( xmlrpcParamGetString( proto_name ), CROS_TRANSPORT_INTRAPROCESS_STRING) == 0 )
+          {
+            // The subscriber is a linked node of this process if it has the same PID and is known here
+            XmlrpcParam *proto_pid = xmlrpcParamArrayGetParamAt ( proto, 1 );
+            CrosNode *sub_node = NULL;
+            if( n->intraprocess_transport )
+              sub_node = cRosIntraprocessFindNode( xmlrpcParamGetString( node_param ) );
+            if( proto_pid != NULL && xmlrpcParamGetType( proto_pid ) == XMLRPC_PARAM_INT &&
+                proto_pid->data.as_int == n->pid && sub_node != NULL )
+            {
+              int sub_idx = cRosNameIndexFind( &sub_node->name_index, CROS_NAME_SUBSCRIBER, n->pubs[pub_idx].topic_name );
+              if( sub_idx != -1 && cRosIntraprocessLink( n, pub_idx, sub_node, sub_idx ) == 0 )
+                intraprocess = 1;
+            }
+          }
+
+          else if( topic_found &&
+                   strcmp( xmlrpcParamGetString( proto_name ), CROS_TRANSPORT_SHMROS_STRING) == 0 )
+          {
+            XmlrpcParam *proto_pid = xmlrpcParamArrayGetParamAt ( proto, 1 );
+            XmlrpcParam *proto_fifo = xmlrpcParamArrayGetParamAt ( proto, 2 );
+            if( proto_pid != NULL && xmlrpcParamGetType( proto_pid ) == XMLRPC_PARAM_INT &&
+                proto_fifo != NULL && xmlrpcParamGetType( proto_fifo ) == XMLRPC_PARAM_STRING )
+            {
+              shm_reader = cRosShmAddReader( n, pub_idx, proto_pid->data.as_int,
+                                             xmlrpcParamGetString( proto_fifo ) );
+            }
+          }
+
+          else if( topic_found &&
+                   strcmp( xmlrpcParamGetString( proto_name ), CROS_TRANSPORT_UNIXROS_STRING) == 0 )
+          {
+            // Offered only by the cROS subscribers of this host
+            unixros_path = openUnixrosListnerSocket( n );
+          }
+
+          else if( topic_found &&
+                   strcmp( xmlrpcParamGetString( proto_name ), CROS_TRANSPORT_UDPROS_STRING) == 0 )
+          {
+            // [UDPROS, connection header, host, port, max datagram size]
+            XmlrpcParam *proto_header = xmlrpcParamArrayGetParamAt ( proto, 1 );
+            XmlrpcParam *proto_host = xmlrpcParamArrayGetParamAt ( proto, 2 );
+            XmlrpcParam *proto_port = xmlrpcParamArrayGetParamAt ( proto, 3 );
+            XmlrpcParam *proto_size = xmlrpcParamArrayGetParamAt ( proto, 4 );
+            PublisherNode *pub = &n->pubs[pub_idx];
+            unsigned char *header_data;
+            int header_size;
+            if( proto_header != NULL && xmlrpcParamGetType( proto_header ) == XMLRPC_PARAM_BINARY &&
+                proto_host != NULL && xmlrpcParamGetType( proto_host ) == XMLRPC_PARAM_STRING &&
+                proto_port != NULL && xmlrpcParamGetType( proto_port ) == XMLRPC_PARAM_INT &&
+                proto_size != NULL && xmlrpcParamGetType( proto_size ) == XMLRPC_PARAM_INT &&
+                ( header_data = xmlrpcParamGetBinary( proto_header, &header_size ) ) != NULL &&
+                cRosMessageCheckUdprosHeader( header_data, header_size, pub->topic_type, pub->md5sum ) == 0 )
+            {
+              udpros_sub = cRosUdprosAddSubscriber( n, pub_idx, xmlrpcParamGetString( node_param ),
+                                                    xmlrpcParamGetString( proto_host ), proto_port->data.as_int,
+                                                    proto_size->data.as_int );
+            }
+          }
+
+          if( protocol_found || intraprocess || shm_reader != -1 || unixros_path != NULL || udpros_sub != -1 )
+            break;
+        }
+
+        if( topic_found && intraprocess )
+        {
+          xmlrpcParamVectorPushBackArray(&params);
+          XmlrpcParam *array1 = xmlrpcParamVectorAt(&params, 0);
+          xmlrpcParamArrayPushBackInt(array1, 1);
+          xmlrpcParamArrayPushBackString(array1, "");
+          XmlrpcParam* array2 = xmlrpcParamArrayPushBackArray(array1);
+          xmlrpcParamArrayPushBackString( array2, CROS_TRANSPORT_INTRAPROCESS_STRING );
+          xmlrpcParamArrayPushBackString( array2, n->name );
+        }
+        else if( topic_found && shm_reader != -1 )
+        {
+          xmlrpcParamVectorPushBackArray(&params);
+          XmlrpcParam *array1 = xmlrpcParamVectorAt(&params, 0);
+          xmlrpcParamArrayPushBackInt(array1, 1);
+          xmlrpcParamArrayPushBackString(array1, "");
+          XmlrpcParam* array2 = xmlrpcParamArrayPushBackArray(array1);
+          xmlrpcParamArrayPushBackString( array2, CROS_TRANSPORT_SHMROS_STRING );
+          xmlrpcParamArrayPushBackString( array2, n->pubs[pub_idx].shm->name );
+          xmlrpcParamArrayPushBackInt( array2, shm_reader );
+        }
+        else if( topic_found && unixros_path != NULL )
+        {
+          xmlrpcParamVectorPushBackArray(&params);
+          XmlrpcParam *array1 = xmlrpcParamVectorAt(&params, 0);
+          xmlrpcParamArrayPushBackInt(array1, 1);
+          xmlrpcParamArrayPushBackString(array1, "");
+          XmlrpcParam* array2 = xmlrpcParamArrayPushBackArray(array1);
+          xmlrpcParamArrayPushBackString( array2, CROS_TRANSPORT_UNIXROS_STRING );
+          xmlrpcParamArrayPushBackString( array2, unixros_path );
         }
+        else if( topic_found && udpros_sub != -1 )
+        {
+          UdprosDestination *dest = &n->pubs[pub_idx].udpros_subs[udpros_sub];
+          DynBuffer header;
+          dynBufferInit(&header);
+          // Latching only if cRosUdprosAddSubscriber() could send the last message
+          cRosMessagePrepareUdprosPublicationHeader( n, pub_idx, dest->sent_messages > 0, &header );
 
-        if( topic_found && protocol_found)
+          xmlrpcParamVectorPushBackArray(&params);
+          XmlrpcParam *array1 = xmlrpcParamVectorAt(&params, 0);
+          xmlrpcParamArrayPushBackInt(array1, 1);
+          xmlrpcParamArrayPushBackString(array1, "");
+          XmlrpcParam* array2 = xmlrpcParamArrayPushBackArray(array1);
+          xmlrpcParamArrayPushBackString( array2, CROS_TRANSPORT_UDPROS_STRING );
+          xmlrpcParamArrayPushBackString( array2, n->host );
+          xmlrpcParamArrayPushBackInt( array2, dest->port );
+          xmlrpcParamArrayPushBackInt( array2, (int32_t)dest->connection_id );
+          xmlrpcParamArrayPushBackInt( array2, dest->max_datagram_size );
+          xmlrpcParamArrayPushBackBinary( array2, dynBufferGetData(&header), dynBufferGetSize(&header) );
+          dynBufferRelease(&header);
+        }
+        else if( topic_found && protocol_found)
         {
           xmlrpcParamVectorPushBackArray(&params);
           XmlrpcParam *array1 = xmlrpcParamVectorAt(&params, 0);
@@ -658,20 +931,119 @@ int cRosApiParseRequestPrepareResponse( CrosNode *n, int server_idx )
     }
     case CROS_API_GET_BUS_STATS:
     {
-      // CHECK-ME What to answer here?
       xmlrpcParamVectorPushBackArray(&params);
       XmlrpcParam *array = xmlrpcParamVectorAt(&params, 0);
-      xmlrpcParamArrayPushBackInt(array, 0);
+      xmlrpcParamArrayPushBackInt(array, 1);
       xmlrpcParamArrayPushBackString(array, "");
+      XmlrpcParam *stats = xmlrpcParamArrayPushBackArray(array);
+
+      // publishStats: [[topicName, messageDataSent, [[connectionId, bytesSent, numSent, connected]...]]...]
+      XmlrpcParam *pub_stats = xmlrpcParamArrayPushBackArray(stats);
+      int i, j;
+      for (i = 0; i < n->n_pubs; i++)
+      {
+        if (n->pubs[i].topic_name == NULL)
+          continue;
+
+        size_t message_data_sent = 0;
+        for (j = 0; j < CN_MAX_TCPROS_SERVER_CONNECTIONS; j++)
+        {
+          if (n->tcpros_server_proc[j].topic_idx == i)
+            message_data_sent += n->tcpros_server_proc[j].bytes_sent;
+        }
+
+        XmlrpcParam *topic_stats = xmlrpcParamArrayPushBackArray(pub_stats);
+        xmlrpcParamArrayPushBackString(topic_stats, n->pubs[i].topic_name);
+        xmlrpcParamArrayPushBackInt(topic_stats, (int32_t)message_data_sent);
+        XmlrpcParam *connections = xmlrpcParamArrayPushBackArray(topic_stats);
+        for (j = 0; j < CN_MAX_TCPROS_SERVER_CONNECTIONS; j++)
+        {
+          TcprosProcess *server_proc = &n->tcpros_server_proc[j];
+          if (server_proc->topic_idx != i)
+            continue;
+
+          XmlrpcParam *connection = xmlrpcParamArrayPushBackArray(connections);
+          xmlrpcParamArrayPushBackInt(connection, server_proc->connection_id);
+          xmlrpcParamArrayPushBackInt(connection, (int32_t)server_proc->bytes_sent);
+          xmlrpcParamArrayPushBackInt(connection, (int32_t)server_proc->msgs_sent);
+          xmlrpcParamArrayPushBackBool(connection, server_proc->state != TCPROS_PROCESS_STATE_IDLE);
+        }
+      }
+
+      // subscribeStats: [[topicName, [[connectionId, bytesReceived, dropEstimate, connected]...]]...]
+      XmlrpcParam *sub_stats = xmlrpcParamArrayPushBackArray(stats);
+      for (i = 0; i < n->n_subs; i++)
+      {
+        if (n->subs[i].topic_name == NULL)
+          continue;
+
+        XmlrpcParam *topic_stats = xmlrpcParamArrayPushBackArray(sub_stats);
+        xmlrpcParamArrayPushBackString(topic_stats, n->subs[i].topic_name);
+        XmlrpcParam *connections = xmlrpcParamArrayPushBackArray(topic_stats);
+        for (j = 0; j < CN_MAX_TCPROS_CLIENT_CONNECTIONS; j++)
+        {
+          TcprosProcess *client_proc = &n->tcpros_client_proc[j];
+          if (client_proc->topic_idx != i || client_proc->connection_id < 0)
+            continue;
+
+          XmlrpcParam *connection = xmlrpcParamArrayPushBackArray(connections);
+          xmlrpcParamArrayPushBackInt(connection, client_proc->connection_id);
+          xmlrpcParamArrayPushBackInt(connection, (int32_t)client_proc->bytes_received);
+          xmlrpcParamArrayPushBackInt(connection, (int32_t)client_proc->drops);
+          xmlrpcParamArrayPushBackBool(connection, client_proc->state != TCPROS_PROCESS_STATE_IDLE);
+        }
+      }
+
+      // serviceStats: [numRequests, bytesReceived, bytesSent]
+      XmlrpcParam *service_stats = xmlrpcParamArrayPushBackArray(stats);
+      xmlrpcParamArrayPushBackInt(service_stats, (int32_t)n->service_requests);
+      xmlrpcParamArrayPushBackInt(service_stats, (int32_t)n->service_bytes_received);
+      xmlrpcParamArrayPushBackInt(service_stats, (int32_t)n->service_bytes_sent);
       break;
     }
     case CROS_API_GET_BUS_INFO:
     {
-      // CHECK-ME What to answer here?
       xmlrpcParamVectorPushBackArray(&params);
       XmlrpcParam *array = xmlrpcParamVectorAt(&params, 0);
-      xmlrpcParamArrayPushBackInt(array, 0);
+      xmlrpcParamArrayPushBackInt(array, 1);
       xmlrpcParamArrayPushBackString(array, "");
+      XmlrpcParam *bus_info = xmlrpcParamArrayPushBackArray(array);
+
+      // [[connectionId, destinationId, direction, transport, topic, connected]...]
+      int i;
+      for (i = 0; i < CN_MAX_TCPROS_SERVER_CONNECTIONS; i++)
+      {
+        TcprosProcess *server_proc = &n->tcpros_server_proc[i];
+        if (server_proc->topic_idx < 0 || n->pubs[server_proc->topic_idx].topic_name == NULL)
+          continue;
+
+        XmlrpcParam *connection = xmlrpcParamArrayPushBackArray(bus_info);
+        xmlrpcParamArrayPushBackInt(connection, server_proc->connection_id);
+        xmlrpcParamArrayPushBackString(connection, dynStringGetData(&server_proc->caller_id));
+        xmlrpcParamArrayPushBackString(connection, "o");
+        xmlrpcParamArrayPushBackString(connection, server_proc->socket.family == AF_UNIX ?
+                                       CROS_TRANSPORT_UNIXROS_STRING : CROS_TRANSPORT_TCPROS_STRING);
+        xmlrpcParamArrayPushBackString(connection, n->pubs[server_proc->topic_idx].topic_name);
+        xmlrpcParamArrayPushBackBool(connection, server_proc->state != TCPROS_PROCESS_STATE_IDLE);
+      }
+
+      for (i = 0; i < CN_MAX_TCPROS_CLIENT_CONNECTIONS; i++)
+      {
+        TcprosProcess *client_proc = &n->tcpros_client_proc[i];
+        if (client_proc->topic_idx < 0 || client_proc->connection_id < 0 ||
+            n->subs[client_proc->topic_idx].topic_name == NULL)
+          continue;
+
+        SubscriberNode *sub = &n->subs[client_proc->topic_idx];
+        XmlrpcParam *connection = xmlrpcParamArrayPushBackArray(bus_info);
+        xmlrpcParamArrayPushBackInt(connection, client_proc->connection_id);
+        xmlrpcParamArrayPushBackString(connection, sub->topic_uri != NULL ? sub->topic_uri : "");
+        xmlrpcParamArrayPushBackString(connection, "i");
+        xmlrpcParamArrayPushBackString(connection, client_proc->socket.family == AF_UNIX ?
+                                       CROS_TRANSPORT_UNIXROS_STRING : CROS_TRANSPORT_TCPROS_STRING);
+        xmlrpcParamArrayPushBackString(connection, sub->topic_name);
+        xmlrpcParamArrayPushBackBool(connection, client_proc->state != TCPROS_PROCESS_STATE_IDLE);
+      }
       break;
     }
     case CROS_API_GET_MASTER_URI:
@@ -707,19 +1079,10 @@ int cRosApiParseRequestPrepareResponse( CrosNode *n, int server_idx )
 
       int paramsubidx = -1;
       char *parameter_key = xmlrpcParamGetString(key_param);
-      int it = 0;
-      for (it = 0 ; it < n->n_paramsubs; it++)
-      {
-        if (n->paramsubs[it].parameter_key == NULL)
-          continue;
+      cRosLookupCacheInvalidateParam(&n->lookup_cache, parameter_key);
 
-        if (strncmp(parameter_key, n->paramsubs[it].parameter_key, strlen(n->paramsubs[it].parameter_key)) == 0)
-        {
-          paramsubidx = it;
-
-          break;
-        }
-      }
+      // The subscriptions receive the updates of their subkeys too
+      int it = paramsubidx = cRosNameIndexFindNamespace(&n->name_index, CROS_NAME_PARAMETER, parameter_key);
 
       ParameterSubscription* subscription = NULL;
       if (paramsubidx != -1)
@@ -95,15 +95,20 @@ int loadFromFileSrv(char* filename, cRosSrvDef* srv)
 
         if(srv_req != NULL)
         {
-          srv->request->package = srv->package;
-          srv->request->root_dir = srv->root_dir;
+          // Every message definition owns its strings, they are freed with the message
+          srv->request->package = (char*) malloc (strlen(srv->package)+1);
+          strcpy(srv->request->package,srv->package);
+          srv->request->root_dir = (char*) malloc (strlen(srv->root_dir)+1);
+          strcpy(srv->request->root_dir,srv->root_dir);
           loadFromStringMsg(srv_req, srv->request);
         }
 
         if(strlen(srv_res) != 0)
         {
-          srv->response->package = srv->package;
-          srv->response->root_dir = srv->root_dir;
+          srv->response->package = (char*) malloc (strlen(srv->package)+1);
+          strcpy(srv->response->package,srv->package);
+          srv->response->root_dir = (char*) malloc (strlen(srv->root_dir)+1);
+          strcpy(srv->response->root_dir,srv->root_dir);
           loadFromStringMsg(srv_res, srv->response);
         }
 
@@ -0,0 +1,479 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "cros_shm.h"
+#include "cros_uring.h"
+#include "cros_subscriber_queue.h"
+#include "cros_defs.h"
+
+static uint64_t alignPos(uint64_t pos)
+{
+  return (pos + 7) & ~((uint64_t)7);
+}
+
+static CrosShmRing * newRing(void)
+{
+  CrosShmRing *ring = (CrosShmRing *)calloc(1, sizeof(CrosShmRing));
+  if (ring == NULL)
+    return NULL;
+
+  int i;
+  for (i = 0; i < CROS_SHM_MAX_READERS; i++)
+    ring->notify_fds[i] = -1;
+
+  return ring;
+}
+
+static int mapRing(CrosShmRing *ring, int fd)
+{
+  void *addr = mmap(NULL, ring->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED)
+    return -1;
+
+  ring->header = (CrosShmHeader *)addr;
+  ring->data = (unsigned char *)addr + alignPos(sizeof(CrosShmHeader));
+  return 0;
+}
+
+static void freeRing(CrosShmRing *ring)
+{
+  if (ring->header != NULL)
+    munmap(ring->header, ring->map_size);
+
+  int i;
+  for (i = 0; i < CROS_SHM_MAX_READERS; i++)
+  {
+    if (ring->notify_fds[i] != -1)
+      close(ring->notify_fds[i]);
+  }
+
+  free(ring);
+}
+
+static CrosShmRing * createRing(CrosNode *n, int pub_idx)
+{
+  CrosShmRing *ring = newRing();
+  if (ring == NULL)
+    return NULL;
+
+  snprintf(ring->name, sizeof(ring->name), "/cros_%d_%d_%d", n->pid, n->xmlrpc_port, pub_idx);
+  ring->map_size = alignPos(sizeof(CrosShmHeader)) + CROS_SHM_RING_SIZE;
+
+  shm_unlink(ring->name);
+  int fd = shm_open(ring->name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd == -1)
+  {
+    PRINT_ERROR("cRosShmAddReader() : Can't create the shared memory %s\n", ring->name);
+    free(ring);
+    return NULL;
+  }
+
+  int rc = ftruncate(fd, ring->map_size);
+  if (rc == 0)
+    rc = mapRing(ring, fd);
+  close(fd);
+
+  if (rc == -1)
+  {
+    PRINT_ERROR("cRosShmAddReader() : Can't map the shared memory %s\n", ring->name);
+    shm_unlink(ring->name);
+    free(ring);
+    return NULL;
+  }
+
+  // ftruncate() zero-filled the header
+  ring->header->capacity = CROS_SHM_RING_SIZE;
+  ring->header->magic = CROS_SHM_MAGIC;
+  return ring;
+}
+
+static void removeReader(CrosShmRing *ring, int reader_idx)
+{
+  __atomic_store_n(&ring->header->readers[reader_idx].active, 0, __ATOMIC_RELEASE);
+  if (ring->notify_fds[reader_idx] != -1)
+  {
+    close(ring->notify_fds[reader_idx]);
+    ring->notify_fds[reader_idx] = -1;
+  }
+}
+
+// The FIFOs are created by cRosShmOpenNotifier(): anything else sent by a peer is refused
+static int isNotifierPath(const char *path)
+{
+  static const char prefix[] = "/tmp/cros_";
+  static const char suffix[] = ".fifo";
+  size_t len = strlen(path);
+
+  if (len <= strlen(prefix) + strlen(suffix) || strncmp(path, prefix, strlen(prefix)) != 0 ||
+      strcmp(path + len - strlen(suffix), suffix) != 0)
+    return 0;
+
+  return strchr(path + strlen(prefix), '/') == NULL;
+}
+
+int cRosShmAddReader(CrosNode *n, int pub_idx, int pid, const char *fifo_path)
+{
+  if (!isNotifierPath(fifo_path))
+  {
+    PRINT_ERROR("cRosShmAddReader() : Invalid notification FIFO %s\n", fifo_path);
+    return -1;
+  }
+
+
+  PublisherNode *pub = &n->pubs[pub_idx];
+
+  if (pub->shm == NULL)
+  {
+    pub->shm = createRing(n, pub_idx);
+    if (pub->shm == NULL)
+      return -1;
+
+    // The packet latched before the ring existed is the first one of the ring
+    if (dynBufferGetSize(&pub->packet) > 0)
+      cRosShmPublish(n, pub_idx);
+  }
+
+  CrosShmRing *ring = pub->shm;
+  CrosShmHeader *header = ring->header;
+
+  int reader_idx;
+  for (reader_idx = 0; reader_idx < CROS_SHM_MAX_READERS; reader_idx++)
+  {
+    if (ring->notify_fds[reader_idx] == -1)
+      break;
+  }
+
+  if (reader_idx == CROS_SHM_MAX_READERS)
+    return -1;
+
+  // The FIFO is reachable only if the subscriber runs on this host (and has it open)
+  int fd = open(fifo_path, O_WRONLY | O_NONBLOCK | O_NOFOLLOW);
+  if (fd == -1)
+    return -1;
+
+  struct stat st;
+  if (fstat(fd, &st) == -1 || !S_ISFIFO(st.st_mode) || st.st_uid != geteuid())
+  {
+    PRINT_ERROR("cRosShmAddReader() : %s is not a FIFO of this user\n", fifo_path);
+    close(fd);
+    return -1;
+  }
+
+  ring->notify_fds[reader_idx] = fd;
+  CrosShmReader *reader = &header->readers[reader_idx];
+  reader->pid = pid;
+  if (dynBufferGetSize(&pub->packet) > 0)
+    reader->read_pos = header->last_pos;        // Latching
+  else
+    reader->read_pos = header->write_pos;
+  __atomic_store_n(&reader->active, 1, __ATOMIC_RELEASE);
+
+  return reader_idx;
+}
+
+int cRosShmHasReaders(CrosNode *n, int pub_idx)
+{
+  CrosShmRing *ring = n->pubs[pub_idx].shm;
+  if (ring == NULL)
+    return 0;
+
+  int i;
+  for (i = 0; i < CROS_SHM_MAX_READERS; i++)
+  {
+    if (ring->notify_fds[i] != -1)
+      return 1;
+  }
+
+  return 0;
+}
+
+// Position of the slowest subscriber, forgetting the ones whose process is gone
+static uint64_t getMinReadPos(CrosShmRing *ring, int check_alive)
+{
+  CrosShmHeader *header = ring->header;
+  uint64_t min_pos = header->write_pos;
+
+  int i;
+  for (i = 0; i < CROS_SHM_MAX_READERS; i++)
+  {
+    if (ring->notify_fds[i] == -1)
+      continue;
+
+    CrosShmReader *reader = &header->readers[i];
+    if (!__atomic_load_n(&reader->active, __ATOMIC_ACQUIRE) ||
+        (check_alive && kill(reader->pid, 0) == -1 && errno == ESRCH))
+    {
+      removeReader(ring, i);
+      continue;
+    }
+
+    uint64_t read_pos = __atomic_load_n(&reader->read_pos, __ATOMIC_ACQUIRE);
+    if (read_pos < min_pos)
+      min_pos = read_pos;
+  }
+
+  return min_pos;
+}
+
+void cRosShmPublish(CrosNode *n, int pub_idx)
+{
+  PublisherNode *pub = &n->pubs[pub_idx];
+  CrosShmRing *ring = pub->shm;
+  if (ring == NULL)
+    return;
+
+  CrosShmHeader *header = ring->header;
+  size_t packet_size = dynBufferGetSize(&pub->packet);
+  uint64_t record_size = alignPos(packet_size);
+  if (record_size > header->capacity / 2)
+  {
+    PRINT_ERROR("cRosShmPublish() : Packet too large for the shared memory ring of %s\n", pub->topic_name);
+    return;
+  }
+
+  uint64_t write_pos = header->write_pos;
+  uint64_t offset = write_pos % header->capacity;
+  uint64_t skip = (offset + record_size > header->capacity) ? header->capacity - offset : 0;
+
+  uint64_t needed = write_pos + skip + record_size;
+  if (needed - getMinReadPos(ring, 0) > header->capacity &&
+      needed - getMinReadPos(ring, 1) > header->capacity)
+  {
+    // A subscriber is late: drop the packet
+    return;
+  }
+
+  if (skip > 0)
+  {
+    *((uint32_t *)(ring->data + offset)) = CROS_SHM_WRAP_MARKER;
+    write_pos += skip;
+    offset = 0;
+  }
+
+  // The packet is [size][data], as on a TCPROS connection
+  memcpy(ring->data + offset, dynBufferGetData(&pub->packet), packet_size);
+  header->last_pos = write_pos;
+  __atomic_store_n(&header->write_pos, write_pos + record_size, __ATOMIC_RELEASE);
+
+  int i;
+  for (i = 0; i < CROS_SHM_MAX_READERS; i++)
+  {
+    if (ring->notify_fds[i] == -1)
+      continue;
+
+    // A full FIFO already has a wake up pending
+    char c = 0;
+    if (write(ring->notify_fds[i], &c, 1) == -1 && errno == EPIPE)
+      removeReader(ring, i);
+  }
+}
+
+void cRosShmRelease(CrosNode *n, int pub_idx)
+{
+  PublisherNode *pub = &n->pubs[pub_idx];
+  CrosShmRing *ring = pub->shm;
+  if (ring == NULL)
+    return;
+
+  __atomic_store_n(&ring->header->closed, 1, __ATOMIC_RELEASE);
+
+  // Wake up the subscribers to let them see that the ring is closed
+  int i;
+  for (i = 0; i < CROS_SHM_MAX_READERS; i++)
+  {
+    if (ring->notify_fds[i] != -1)
+    {
+      char c = 0;
+      if (write(ring->notify_fds[i], &c, 1) == -1) {}
+    }
+  }
+
+  shm_unlink(ring->name);
+  freeRing(ring);
+  pub->shm = NULL;
+}
+
+const char * cRosShmOpenNotifier(CrosNode *n, int sub_idx)
+{
+  SubscriberNode *sub = &n->subs[sub_idx];
+  if (sub->shm_notify_fd != -1)
+    return sub->shm_fifo_path;
+
+  char path[256];
+  snprintf(path, sizeof(path), "/tmp/cros_%d_%d_%d.fifo", n->pid, n->xmlrpc_port, sub_idx);
+  unlink(path);
+  if (mkfifo(path, 0600) == -1)
+    return NULL;
+
+  // Opened also for writing, so that it doesn't report EOF when the publisher closes it
+  int fd = open(path, O_RDWR | O_NONBLOCK);
+  if (fd == -1)
+  {
+    unlink(path);
+    return NULL;
+  }
+
+  sub->shm_fifo_path = strdup(path);
+  if (sub->shm_fifo_path == NULL)
+  {
+    close(fd);
+    unlink(path);
+    return NULL;
+  }
+
+  sub->shm_notify_fd = fd;
+  return sub->shm_fifo_path;
+}
+
+int cRosShmAttach(CrosNode *n, int sub_idx, const char *name, int reader_idx)
+{
+  SubscriberNode *sub = &n->subs[sub_idx];
+
+  if (sub->shm != NULL)
+  {
+    // Free the slot of the previous publisher, which otherwise waits for this reader
+    __atomic_store_n(&sub->shm->header->readers[sub->shm_reader].active, 0, __ATOMIC_RELEASE);
+    freeRing(sub->shm);
+    sub->shm = NULL;
+    sub->shm_reader = -1;
+  }
+
+  CrosShmRing *ring = newRing();
+  if (ring == NULL || reader_idx < 0 || reader_idx >= CROS_SHM_MAX_READERS)
+  {
+    free(ring);
+    cRosShmDetach(n, sub_idx);
+    return -1;
+  }
+
+  strncpy(ring->name, name, sizeof(ring->name) - 1);
+  ring->map_size = alignPos(sizeof(CrosShmHeader)) + CROS_SHM_RING_SIZE;
+
+  int fd = shm_open(ring->name, O_RDWR, 0);
+  int rc = (fd == -1) ? -1 : mapRing(ring, fd);
+  if (fd != -1)
+    close(fd);
+
+  if (rc == -1 || ring->header->magic != CROS_SHM_MAGIC || ring->header->capacity != CROS_SHM_RING_SIZE)
+  {
+    PRINT_ERROR("cRosShmAttach() : Can't map the shared memory %s\n", name);
+    freeRing(ring);
+    cRosShmDetach(n, sub_idx);
+    return -1;
+  }
+
+  sub->shm = ring;
+  sub->shm_reader = reader_idx;
+  return 0;
+}
+
+void cRosShmDetach(CrosNode *n, int sub_idx)
+{
+  SubscriberNode *sub = &n->subs[sub_idx];
+
+  if (sub->shm != NULL)
+  {
+    __atomic_store_n(&sub->shm->header->readers[sub->shm_reader].active, 0, __ATOMIC_RELEASE);
+    freeRing(sub->shm);
+    sub->shm = NULL;
+    sub->shm_reader = -1;
+  }
+
+  if (sub->shm_notify_fd != -1)
+  {
+    // The publisher gets EPIPE at the next notification
+    cRosUringNotifyClose(sub->shm_notify_fd);
+    close(sub->shm_notify_fd);
+    sub->shm_notify_fd = -1;
+  }
+
+  if (sub->shm_fifo_path != NULL)
+  {
+    unlink(sub->shm_fifo_path);
+    free(sub->shm_fifo_path);
+    sub->shm_fifo_path = NULL;
+  }
+}
+
+int cRosShmDispatch(CrosNode *n)
+{
+  int count = 0;
+
+  int i;
+  for (i = 0; i < CN_MAX_SUBSCRIBED_TOPICS; i++)
+  {
+    SubscriberNode *sub = &n->subs[i];
+    CrosShmRing *ring = sub->shm;
+    if (ring == NULL)
+      continue;
+
+    char drain[64];
+    while (read(sub->shm_notify_fd, drain, sizeof(drain)) > 0);
+
+    CrosShmHeader *header = ring->header;
+    CrosShmReader *reader = &header->readers[sub->shm_reader];
+    uint64_t read_pos = reader->read_pos;
+    uint64_t write_pos = __atomic_load_n(&header->write_pos, __ATOMIC_ACQUIRE);
+
+    // The shared header can't be trusted: the positions are checked against the mapped size
+    if (read_pos > write_pos || write_pos - read_pos > CROS_SHM_RING_SIZE || read_pos % 8 != 0)
+    {
+      PRINT_ERROR("cRosShmDispatch() : Invalid positions in the shared memory of %s\n", sub->topic_name);
+      read_pos = write_pos - (write_pos % 8);
+      __atomic_store_n(&reader->read_pos, read_pos, __ATOMIC_RELEASE);
+    }
+
+    while (read_pos < write_pos)
+    {
+      uint64_t offset = read_pos % CROS_SHM_RING_SIZE;
+      uint64_t available = write_pos - read_pos;
+      uint32_t msg_size = 0;
+      ROS_TO_HOST_UINT32( *((uint32_t *)(ring->data + offset)), msg_size );
+      if (msg_size == CROS_SHM_WRAP_MARKER && CROS_SHM_RING_SIZE - offset <= available)
+      {
+        read_pos += CROS_SHM_RING_SIZE - offset;
+        continue;
+      }
+
+      if (msg_size == CROS_SHM_WRAP_MARKER || sizeof(uint32_t) + (uint64_t)msg_size > CROS_SHM_RING_SIZE - offset ||
+          alignPos(sizeof(uint32_t) + msg_size) > available)
+      {
+        // Resync to the end of the ring: the packets in between are lost
+        PRINT_ERROR("cRosShmDispatch() : Invalid packet size %u in the shared memory of %s\n",
+                    msg_size, sub->topic_name);
+        read_pos = write_pos;
+        __atomic_store_n(&reader->read_pos, read_pos, __ATOMIC_RELEASE);
+        break;
+      }
+
+      // The packet is read in place: the publisher doesn't overwrite it until read_pos moves
+      DynBuffer msg;
+      dynBufferInitView(&msg, ring->data + offset + sizeof(uint32_t), msg_size);
+      cRosSubscriberQueueDeliver(n, i, &msg);
+      count++;
+
+      // The callback may have unsubscribed
+      if (sub->shm != ring)
+        break;
+
+      read_pos += alignPos(sizeof(uint32_t) + msg_size);
+      __atomic_store_n(&reader->read_pos, read_pos, __ATOMIC_RELEASE);
+    }
+
+    if (sub->shm == ring && __atomic_load_n(&header->closed, __ATOMIC_ACQUIRE))
+    {
+      // Wait for a new publisher, as when the TCPROS connection is dropped
+      cRosShmDetach(n, i);
+      sub->tcpros_port = -1;
+    }
+  }
+
+  return count;
+}
@@ -0,0 +1,117 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "cros_subscriber_queue.h"
+#include "cros_defs.h"
+
+// Returns the next queued message ([size][data]) and moves past it
+static const unsigned char *popMessage(SubscriberNode *sub, uint32_t *msg_size)
+{
+  DynBuffer *queue = &sub->queue;
+  const unsigned char *data = dynBufferGetCurrentData(queue);
+  ROS_TO_HOST_UINT32( *((uint32_t *)data), *msg_size );
+  dynBufferMovePoseIndicator(queue, sizeof(uint32_t) + *msg_size);
+  sub->n_queued--;
+
+  return data + sizeof(uint32_t);
+}
+
+// Reclaim the space of the messages already read once it exceeds the one of the queued messages,
+// so that every byte is moved at most once
+static void reclaimSpace(SubscriberNode *sub)
+{
+  DynBuffer *queue = &sub->queue;
+  if (sub->n_queued == 0)
+    dynBufferClear(queue);
+  else if (dynBufferGetPoseIndicatorOffset(queue) > dynBufferGetRemainingDataSize(queue))
+    dynBufferCompact(queue);
+}
+
+static void dropOldest(SubscriberNode *sub)
+{
+  uint32_t msg_size;
+  popMessage(sub, &msg_size);
+  sub->queue_drops++;
+  reclaimSpace(sub);
+}
+
+void cRosSubscriberQueueDeliver(CrosNode *n, int sub_idx, DynBuffer *msg)
+{
+  SubscriberNode *sub = &n->subs[sub_idx];
+  if (sub->queue_size == 0)
+  {
+    sub->callback(msg, sub->context);
+    return;
+  }
+
+  // The drops are reported by getBusStats as the ones of the subscriber connection
+  TcprosProcess *client_proc = &n->tcpros_client_proc[sub->client_tcpros_id];
+  while (sub->n_queued >= sub->queue_size)
+  {
+    dropOldest(sub);
+    client_proc->drops++;
+  }
+
+  uint32_t msg_size = (uint32_t)dynBufferGetSize(msg);
+  unsigned char *dest = dynBufferReserve(&sub->queue, sizeof(uint32_t) + msg_size);
+  if (dest == NULL)
+  {
+    PRINT_ERROR("cRosSubscriberQueueDeliver() : Can't queue a message of %u bytes\n", msg_size);
+    sub->queue_drops++;
+    client_proc->drops++;
+    return;
+  }
+
+  uint32_t out_size;
+  HOST_TO_ROS_UINT32( msg_size, out_size );
+  memcpy(dest, &out_size, sizeof(uint32_t));
+  memcpy(dest + sizeof(uint32_t), dynBufferGetData(msg), msg_size);
+  dynBufferCommit(&sub->queue, sizeof(uint32_t) + msg_size);
+  sub->n_queued++;
+}
+
+int cRosSubscriberQueueDispatch(CrosNode *n)
+{
+  int count = 0;
+
+  // A single message per subscriber: the connections are read again before the next one,
+  // so that the messages received meanwhile can replace the stale ones
+  int i;
+  for (i = 0; i < CN_MAX_SUBSCRIBED_TOPICS; i++)
+  {
+    SubscriberNode *sub = &n->subs[i];
+    if (sub->n_queued == 0)
+      continue;
+
+    uint32_t msg_size;
+    const unsigned char *data = popMessage(sub, &msg_size);
+
+    DynBuffer msg;
+    dynBufferInitView(&msg, data, msg_size);
+    sub->callback(&msg, sub->context);
+    count++;
+
+    reclaimSpace(sub);
+  }
+
+  return count;
+}
+
+int cRosSubscriberQueueHasPending(CrosNode *n)
+{
+  int i;
+  for (i = 0; i < CN_MAX_SUBSCRIBED_TOPICS; i++)
+  {
+    if (n->subs[i].n_queued > 0)
+      return 1;
+  }
+
+  return 0;
+}
+
+void cRosSubscriberQueueResize(SubscriberNode *sub, int queue_size)
+{
+  sub->queue_size = queue_size;
+  while (queue_size > 0 && sub->n_queued > queue_size)
+    dropOldest(sub);
+}
@@ -7,6 +7,7 @@
 #include "cros_defs.h"
 #include "tcpros_tags.h"
 #include "tcpros_process.h"
+#include "cros_subscriber_queue.h"
 #include "dyn_buffer.h"
 
 static uint32_t getLen( DynBuffer *pkt )
@@ -32,6 +33,20 @@ static uint32_t pushBackField( DynBuffer *pkt, TcprosTagStrDim *tag, const char
   return field_len + sizeof( uint32_t );
 }
 
+// Complete a header started with a size placeholder
+static void setHeaderLen( DynBuffer *header, uint32_t header_len )
+{
+  uint32_t header_out_len;
+  HOST_TO_ROS_UINT32( header_len, header_out_len );
+  memcpy( (unsigned char *)dynBufferGetData( header ), &header_out_len, sizeof(uint32_t) );
+}
+
+// Append a connection header of a provider, serialized only the first time
+static void pushBackCachedHeader( DynBuffer *packet, DynBuffer *header )
+{
+  dynBufferPushBackBuf( packet, dynBufferGetData( header ), dynBufferGetSize( header ) );
+}
+
 static void printPacket( DynBuffer *pkt, int print_data )
 {
   /* Save position indicator: it will be restored */
@@ -77,209 +92,221 @@ static void printPacket( DynBuffer *pkt, int print_data )
   dynBufferSetPoseIndicator ( pkt, initial_pos_idx );         
 }
 
-static TcprosParserState readSubcriptionHeader( TcprosProcess *p, uint32_t *flags )
+enum
 {
-  PRINT_VDEBUG("readSubcriptioHeader()\n");
-  DynBuffer *packet = &(p->packet);
-  uint32_t bytes_to_read = getLen( packet );
-  size_t packet_len = dynBufferGetSize( packet );
-
-  if( bytes_to_read > packet_len - sizeof( uint32_t ) )
-    return TCPROS_PARSER_HEADER_INCOMPLETE;
+  TCPROS_FIELD_CALLERID = 0,
+  TCPROS_FIELD_TOPIC,
+  TCPROS_FIELD_TYPE,
+  TCPROS_FIELD_MD5SUM,
+  TCPROS_FIELD_MESSAGE_DEFINITION,
+  TCPROS_FIELD_SERVICE,
+  TCPROS_FIELD_REQUESTTYPE,
+  TCPROS_FIELD_RESPONSETYPE,
+  TCPROS_FIELD_TCP_NODELAY,
+  TCPROS_FIELD_LATCHING,
+  TCPROS_FIELD_PERSISTENT,
+  TCPROS_FIELD_PROBE,
+  TCPROS_FIELD_ERROR,
+  TCPROS_FIELD_COUNT
+};
+
+typedef struct
+{
+  TcprosTagStrDim *tag;
+  uint32_t flag;
+} TcprosFieldDesc;
 
-  *flags = 0x0;
+static const TcprosFieldDesc TCPROS_FIELDS[TCPROS_FIELD_COUNT] =
+{
+  { &TCPROS_CALLERID_TAG, TCPROS_CALLER_ID_FLAG },
+  { &TCPROS_TOPIC_TAG, TCPROS_TOPIC_FLAG },
+  { &TCPROS_TYPE_TAG, TCPROS_TYPE_FLAG },
+  { &TCPROS_MD5SUM_TAG, TCPROS_MD5SUM_FLAG },
+  { &TCPROS_MESSAGE_DEFINITION_TAG, TCPROS_MESSAGE_DEFINITION_FLAG },
+  { &TCPROS_SERVICE_TAG, TCPROS_SERVICE_FLAG },
+  { &TCPROS_SERVICE_REQUESTTYPE_TAG, 0 },
+  { &TCPROS_SERVICE_RESPONSETYPE_TAG, 0 },
+  { &TCPROS_TCP_NODELAY_TAG, TCPROS_TCP_NODELAY_FLAG },
+  { &TCPROS_LATCHING_TAG, TCPROS_LATCHING_FLAG },
+  { &TCPROS_PERSISTENT_TAG, TCPROS_PERSISTENT_FLAG },
+  { &TCPROS_PROBE_TAG, TCPROS_PROBE_FLAG },
+  { &TCPROS_ERROR_TAG, TCPROS_ERROR_FLAG }
+};
+
+/*! A field value: it points into the packet and it's not null terminated */
+typedef struct
+{
+  const char *value;
+  uint32_t len;
+} TcprosHeaderField;
 
-  PRINT_DEBUG("readSubcriptioHeader() : Header len=%d\n",bytes_to_read);
+typedef struct
+{
+  TcprosHeaderField fields[TCPROS_FIELD_COUNT];
+  uint32_t flags;                       // The TCPROS_*_FLAG of the fields found
+} TcprosHeader;
 
-  while ( bytes_to_read > 0)
+// The known keys have different (length, first char) pairs: a single comparison confirms the candidate
+static int lookupField( const char *key, uint32_t key_len )
+{
+  int id;
+  switch( key_len )
   {
-    uint32_t field_len = getLen( packet );
+    case 4:
+      id = TCPROS_FIELD_TYPE;
+      break;
+    case 5:
+      id = ( key[0] == 't' ) ? TCPROS_FIELD_TOPIC :
+           ( key[0] == 'p' ) ? TCPROS_FIELD_PROBE : TCPROS_FIELD_ERROR;
+      break;
+    case 6:
+      id = TCPROS_FIELD_MD5SUM;
+      break;
+    case 7:
+      id = TCPROS_FIELD_SERVICE;
+      break;
+    case 8:
+      id = ( key[0] == 'c' ) ? TCPROS_FIELD_CALLERID : TCPROS_FIELD_LATCHING;
+      break;
+    case 10:
+      id = TCPROS_FIELD_PERSISTENT;
+      break;
+    case 11:
+      id = TCPROS_FIELD_TCP_NODELAY;
+      break;
+    case 12:
+      id = TCPROS_FIELD_REQUESTTYPE;
+      break;
+    case 13:
+      id = TCPROS_FIELD_RESPONSETYPE;
+      break;
+    case 18:
+      id = TCPROS_FIELD_MESSAGE_DEFINITION;
+      break;
+    default:
+      return -1;
+  }
 
-    PRINT_DEBUG("readSubcriptioHeader() : Field len=%d\n",field_len);
+  if( memcmp( key, TCPROS_FIELDS[id].tag->str, key_len ) != 0 )
+    return -1;
 
-    const char *field = (const char *)dynBufferGetCurrentData( packet );
-    if( field_len )
+  return id;
+}
+
+static TcprosParserState parseHeader( const unsigned char *data, size_t size, TcprosHeader *header )
+{
+  memset( header, 0, sizeof(TcprosHeader) );
+
+  while ( size > 0 )
+  {
+    uint32_t in_len, field_len;
+    if( size < sizeof(uint32_t) )
     {
-      if ( field_len > (uint32_t)TCPROS_CALLERID_TAG.dim &&
-          strncmp ( field, TCPROS_CALLERID_TAG.str, TCPROS_CALLERID_TAG.dim ) == 0 )
-      {
-        field += TCPROS_CALLERID_TAG.dim;
+      PRINT_ERROR("parseHeader() : Truncated field length\n");
+      return TCPROS_PARSER_ERROR;
+    }
 
-        dynStringPushBackStrN( &(p->caller_id), field, 
-                               field_len - TCPROS_CALLERID_TAG.dim );
-        *flags |= TCPROS_CALLER_ID_FLAG;
-        dynBufferMovePoseIndicator( packet, field_len );
-      }
-      else if ( field_len > (uint32_t)TCPROS_TOPIC_TAG.dim &&
-          strncmp ( field, TCPROS_TOPIC_TAG.str, TCPROS_TOPIC_TAG.dim ) == 0 )
-      {
-        field += TCPROS_TOPIC_TAG.dim;
+    memcpy( &in_len, data, sizeof(uint32_t) );
+    ROS_TO_HOST_UINT32( in_len, field_len );
+    data += sizeof(uint32_t);
+    size -= sizeof(uint32_t);
 
-        dynStringPushBackStrN( &(p->topic), field, 
-                               field_len - TCPROS_TOPIC_TAG.dim );
-        *flags |= TCPROS_TOPIC_FLAG;
-        dynBufferMovePoseIndicator( packet, field_len );
-      }
-      else if ( field_len > (uint32_t)TCPROS_TYPE_TAG.dim &&
-          strncmp ( field, TCPROS_TYPE_TAG.str, TCPROS_TYPE_TAG.dim ) == 0 )
-      {
-        field += TCPROS_TYPE_TAG.dim;
+    if( field_len > size )
+    {
+      PRINT_ERROR("parseHeader() : Field exceeds the header\n");
+      return TCPROS_PARSER_ERROR;
+    }
 
-        dynStringPushBackStrN( &(p->type), field, 
-                               field_len - TCPROS_TYPE_TAG.dim );
-        *flags |= TCPROS_TYPE_FLAG;
-        dynBufferMovePoseIndicator( packet, field_len );
-      }
-      else if ( field_len > (uint32_t)TCPROS_MD5SUM_TAG.dim &&
-          strncmp ( field, TCPROS_MD5SUM_TAG.str, TCPROS_MD5SUM_TAG.dim ) == 0 )
-      {
-        field += TCPROS_MD5SUM_TAG.dim;
-
-        dynStringPushBackStrN( &(p->md5sum), field, 
-                               field_len - TCPROS_MD5SUM_TAG.dim );
-        *flags |= TCPROS_MD5SUM_FLAG;
-        dynBufferMovePoseIndicator( packet, field_len );
-      }  
-      else if ( field_len > (uint32_t)TCPROS_MESSAGE_DEFINITION_TAG.dim &&
-          strncmp ( field, TCPROS_MESSAGE_DEFINITION_TAG.str, TCPROS_MESSAGE_DEFINITION_TAG.dim ) == 0 )
-      {        
-        *flags |= TCPROS_MESSAGE_DEFINITION_FLAG;
-        dynBufferMovePoseIndicator( packet, field_len );
-      }
-      else if ( field_len > (uint32_t)TCPROS_TCP_NODELAY_TAG.dim &&
-          strncmp ( field, TCPROS_TCP_NODELAY_TAG.str, TCPROS_TCP_NODELAY_TAG.dim ) == 0 )
-      {
-        PRINT_INFO("readSubcriptioHeader() WARNING : TCPROS_TCP_NODELAY_TAG not implemented\n");
-        field += TCPROS_TCP_NODELAY_TAG.dim;
-        p->tcp_nodelay = (*field == '1')?1:0;
-        *flags |= TCPROS_TCP_NODELAY_FLAG;
-        dynBufferMovePoseIndicator( packet, field_len );
-      }
-      else if ( field_len > (uint32_t)TCPROS_LATCHING_TAG.dim &&
-          strncmp ( field, TCPROS_LATCHING_TAG.str, TCPROS_LATCHING_TAG.dim ) == 0 )
-      {
-        PRINT_INFO("readSubcriptioHeader() WARNING : TCPROS_LATCHING_TAG not implemented\n");
-        field += TCPROS_LATCHING_TAG.dim;
-        p->latching = (*field == '1')?1:0; 
-        *flags |= TCPROS_LATCHING_FLAG;
-        dynBufferMovePoseIndicator( packet, field_len );
-      }
-      else if ( field_len > (uint32_t)TCPROS_ERROR_TAG.dim &&
-          strncmp ( field, TCPROS_ERROR_TAG.str, TCPROS_ERROR_TAG.dim ) == 0 )
+    const char *field = (const char *)data;
+    const char *sep = (const char *)memchr( field, '=', field_len );
+    if( sep != NULL )
+    {
+      uint32_t key_len = (uint32_t)( sep - field );
+      uint32_t value_len = field_len - key_len - 1;
+      int id = lookupField( field, key_len );
+      if( id != -1 && value_len > 0 )
       {
-        PRINT_INFO("readSubcriptioHeader() WARNING : TCPROS_ERROR_TAG not implemented\n");
-        *flags |= TCPROS_ERROR_FLAG;
-        dynBufferMovePoseIndicator( packet, field_len );
+        header->fields[id].value = sep + 1;
+        header->fields[id].len = value_len;
+        header->flags |= TCPROS_FIELDS[id].flag;
       }
       else
       {
-        PRINT_ERROR("readSubcriptioHeader() : unknown field\n");
-        *flags = 0x0;
-        break;
+        // Newer ROS versions send fields we don't need
+        PRINT_DEBUG("parseHeader() : Skipping field %.*s\n", (int)key_len, field);
       }
     }
+    else if( field_len )
+    {
+      PRINT_DEBUG("parseHeader() : Skipping malformed field of len=%d\n", field_len);
+    }
 
-    bytes_to_read -= ( sizeof(uint32_t) + field_len );
+    data += field_len;
+    size -= field_len;
   }
 
   return TCPROS_PARSER_DONE;
+}
 
+static int fieldEquals( const TcprosHeaderField *field, const char *str )
+{
+  return strlen( str ) == field->len && memcmp( str, field->value, field->len ) == 0;
 }
 
-static TcprosParserState readPublicationHeader( TcprosProcess *p, uint32_t *flags )
+static unsigned char fieldIsSet( const TcprosHeaderField *field )
 {
-  PRINT_VDEBUG("readPublicationHeader()\n");
-  DynBuffer *packet = &(p->packet);
-  size_t bytes_to_read = dynBufferGetSize( packet );
+  return ( field->len > 0 && field->value[0] == '1' ) ? 1 : 0;
+}
 
-  *flags = 0x0;
+// Parse a header and store in the process the fields that outlive the packet
+static TcprosParserState readHeader( TcprosProcess *p, const unsigned char *data, size_t size,
+                                     TcprosHeader *header )
+{
+  PRINT_DEBUG("readHeader() : Header len=%d\n", (int)size);
 
-  PRINT_DEBUG("readPublicationHeader() : Header len=%d\n",bytes_to_read);
+  TcprosParserState ret = parseHeader( data, size, header );
+  if( ret != TCPROS_PARSER_DONE )
+    return ret;
 
-  while ( bytes_to_read > 0)
+  const TcprosHeaderField *fields = header->fields;
+  if( header->flags & TCPROS_CALLER_ID_FLAG )
   {
-    uint32_t field_len = getLen( packet );
-
-    PRINT_DEBUG("readPublicationHeader() : Field len=%d\n",field_len);
-
-    const char *field = (const char *)dynBufferGetCurrentData( packet );
-    if( field_len )
-    {
-      // http://wiki.ros.org/ROS/TCPROS doesn't mention it but it's sent anyway in ros groovy
-      if ( field_len > (uint32_t)TCPROS_MESSAGE_DEFINITION_TAG.dim &&
-          strncmp ( field, TCPROS_MESSAGE_DEFINITION_TAG.str, TCPROS_MESSAGE_DEFINITION_TAG.dim ) == 0 )
-      {
-        *flags |= TCPROS_MESSAGE_DEFINITION_FLAG;
-        dynBufferMovePoseIndicator( packet, field_len );
-      } else if ( field_len > (uint32_t)TCPROS_CALLERID_TAG.dim &&
-          strncmp ( field, TCPROS_CALLERID_TAG.str, TCPROS_CALLERID_TAG.dim ) == 0 )
-      {
-        field += TCPROS_CALLERID_TAG.dim;
-
-        dynStringPushBackStrN( &(p->caller_id), field,
-                               field_len - TCPROS_CALLERID_TAG.dim );
-        *flags |= TCPROS_CALLER_ID_FLAG;
-        dynBufferMovePoseIndicator( packet, field_len );
-      }
-      else if ( field_len > (uint32_t)TCPROS_TYPE_TAG.dim &&
-          strncmp ( field, TCPROS_TYPE_TAG.str, TCPROS_TYPE_TAG.dim ) == 0 )
-      {
-        field += TCPROS_TYPE_TAG.dim;
+    dynStringClear( &(p->caller_id) );
+    dynStringPushBackStrN( &(p->caller_id), fields[TCPROS_FIELD_CALLERID].value,
+                           fields[TCPROS_FIELD_CALLERID].len );
+  }
+  if( header->flags & TCPROS_TCP_NODELAY_FLAG )
+    p->tcp_nodelay = fieldIsSet( &fields[TCPROS_FIELD_TCP_NODELAY] );
+  if( header->flags & TCPROS_LATCHING_FLAG )
+    p->latching = fieldIsSet( &fields[TCPROS_FIELD_LATCHING] );
+  if( header->flags & TCPROS_PERSISTENT_FLAG )
+    p->persistent = fieldIsSet( &fields[TCPROS_FIELD_PERSISTENT] );
+  if( header->flags & TCPROS_PROBE_FLAG )
+    p->probe = fieldIsSet( &fields[TCPROS_FIELD_PROBE] );
+  if( header->flags & TCPROS_ERROR_FLAG )
+    PRINT_ERROR("readHeader() : Remote error: %.*s\n", (int)fields[TCPROS_FIELD_ERROR].len,
+                fields[TCPROS_FIELD_ERROR].value);
 
-        dynStringPushBackStrN( &(p->type), field,
-                               field_len - TCPROS_TYPE_TAG.dim );
-        *flags |= TCPROS_TYPE_FLAG;
-        dynBufferMovePoseIndicator( packet, field_len );
-      }
-      else if ( field_len > (uint32_t)TCPROS_MD5SUM_TAG.dim &&
-          strncmp ( field, TCPROS_MD5SUM_TAG.str, TCPROS_MD5SUM_TAG.dim ) == 0 )
-      {
-        field += TCPROS_MD5SUM_TAG.dim;
+  return TCPROS_PARSER_DONE;
+}
 
-        dynStringPushBackStrN( &(p->md5sum), field,
-                               field_len - TCPROS_MD5SUM_TAG.dim );
-        *flags |= TCPROS_MD5SUM_FLAG;
-        dynBufferMovePoseIndicator( packet, field_len );
-      }
-      else if ( field_len > (uint32_t)TCPROS_LATCHING_TAG.dim &&
-          strncmp ( field, TCPROS_LATCHING_TAG.str, TCPROS_LATCHING_TAG.dim ) == 0 )
-      {
-        PRINT_INFO("readPublicationHeader() WARNING : TCPROS_LATCHING_TAG not implemented\n");
-        field += TCPROS_LATCHING_TAG.dim;
-        p->latching = (*field == '1')?1:0;
-        *flags |= TCPROS_LATCHING_FLAG;
-        dynBufferMovePoseIndicator( packet, field_len );
-      }
-      else if ( field_len > (uint32_t)TCPROS_TOPIC_TAG.dim &&
-          strncmp ( field, TCPROS_TOPIC_TAG.str, TCPROS_TOPIC_TAG.dim ) == 0 )
-      {
-        // http://wiki.ros.org/ROS/TCPROS doesn't mention it but it's sent anyway in ros groovy
-        field += TCPROS_TOPIC_TAG.dim;
+// The subscription header is preceded by its length, the packet can hold a part of it only
+static TcprosParserState readSubcriptionHeader( TcprosProcess *p, TcprosHeader *header )
+{
+  PRINT_VDEBUG("readSubcriptioHeader()\n");
+  DynBuffer *packet = &(p->packet);
+  size_t packet_len = dynBufferGetSize( packet );
+  uint32_t in_len, header_len;
 
-        dynStringPushBackStrN( &(p->topic), field,
-                               field_len - TCPROS_TOPIC_TAG.dim );
-        *flags |= TCPROS_TOPIC_FLAG;
-        dynBufferMovePoseIndicator( packet, field_len );
-      }
-      else if ( field_len > (uint32_t)TCPROS_ERROR_TAG.dim &&
-          strncmp ( field, TCPROS_ERROR_TAG.str, TCPROS_ERROR_TAG.dim ) == 0 )
-      {
-        PRINT_INFO("readPublicationHeader() WARNING : TCPROS_ERROR_TAG not implemented\n");
-        *flags |= TCPROS_ERROR_FLAG;
-        dynBufferMovePoseIndicator( packet, field_len );
-      }
-      else
-      {
-        PRINT_ERROR("readPublicationHeader() : unknown field\n");
-        *flags = 0x0;
-        break;
-      }
-    }
+  if( packet_len < sizeof( uint32_t ) )
+    return TCPROS_PARSER_HEADER_INCOMPLETE;
 
-    bytes_to_read -= ( sizeof(uint32_t) + field_len );
-  }
+  memcpy( &in_len, dynBufferGetData( packet ), sizeof(uint32_t) );
+  ROS_TO_HOST_UINT32( in_len, header_len );
+  if( header_len > packet_len - sizeof( uint32_t ) )
+    return TCPROS_PARSER_HEADER_INCOMPLETE;
 
-  return TCPROS_PARSER_DONE;
+  return readHeader( p, dynBufferGetData( packet ) + sizeof(uint32_t), header_len, header );
 }
 
 TcprosParserState cRosMessageParseSubcriptionHeader( CrosNode *n, int server_idx )
@@ -287,18 +314,14 @@ TcprosParserState cRosMessageParseSubcriptionHeader( CrosNode *n, int server_idx
   PRINT_VDEBUG("cRosMessageParseSubcriptionHeader()\n");
   
   TcprosProcess *server_proc = &(n->tcpros_server_proc[server_idx]);
-  DynBuffer *packet = &(server_proc->packet);
-  
-  /* Save position indicator: it will be restored */
-  int initial_pos_idx = dynBufferGetPoseIndicatorOffset ( packet );
-  dynBufferRewindPoseIndicator ( packet );
 
-  uint32_t header_flags; 
-  TcprosParserState ret = readSubcriptionHeader( server_proc, &header_flags );
+  TcprosHeader header;
+  TcprosParserState ret = readSubcriptionHeader( server_proc, &header );
   if( ret != TCPROS_PARSER_DONE )
     return ret;
-  
-  if( TCPROS_SUBCRIPTION_HEADER_FLAGS != ( header_flags&TCPROS_SUBCRIPTION_HEADER_FLAGS) )
+
+  const TcprosHeaderField *topic = &header.fields[TCPROS_FIELD_TOPIC];
+  if( TCPROS_SUBCRIPTION_HEADER_FLAGS != ( header.flags&TCPROS_SUBCRIPTION_HEADER_FLAGS) )
   {
     PRINT_ERROR("cRosMessageParseSubcriptionHeader() : Missing fields\n");
     ret = TCPROS_PARSER_ERROR;
@@ -306,21 +329,16 @@ TcprosParserState cRosMessageParseSubcriptionHeader( CrosNode *n, int server_idx
   else
   {
     int topic_found = 0;
-    int i = 0;
-    for( i = 0 ; i < n->n_pubs; i++)
+    int i = cRosNameIndexFindN( &n->name_index, CROS_NAME_PUBLISHER, topic->value, topic->len );
+    if( i != -1 )
     {
       PublisherNode *pub = &n->pubs[i];
-      if (pub->topic_name == NULL)
-        continue;
-
-      if( strcmp(pub->topic_name, dynStringGetData(&(server_proc->topic))) == 0 &&
-          strcmp(pub->topic_type, dynStringGetData(&(server_proc->type))) == 0 &&
-          strcmp(pub->md5sum, dynStringGetData(&(server_proc->md5sum))) == 0)
+      if( fieldEquals( &header.fields[TCPROS_FIELD_TYPE], pub->topic_type ) &&
+          fieldEquals( &header.fields[TCPROS_FIELD_MD5SUM], pub->md5sum ) )
       {
         topic_found = 1;
         server_proc->topic_idx = i;
         pub->client_tcpros_id = server_idx;
-        break;
       }
     }
 
@@ -332,9 +350,6 @@ TcprosParserState cRosMessageParseSubcriptionHeader( CrosNode *n, int server_idx
     }
   }
 
-  /* Restore position indicator */
-  dynBufferSetPoseIndicator ( packet, initial_pos_idx );
-
   return ret;
 }
 
@@ -345,16 +360,13 @@ TcprosParserState cRosMessageParsePublicationHeader( CrosNode *n, int client_idx
   TcprosProcess *client_proc = &(n->tcpros_client_proc[client_idx]);
   DynBuffer *packet = &(client_proc->packet);
 
-  /* Save position indicator: it will be restored */
-  int initial_pos_idx = dynBufferGetPoseIndicatorOffset ( packet );
-  dynBufferRewindPoseIndicator ( packet );
-
-  uint32_t header_flags;
-  TcprosParserState ret = readPublicationHeader( client_proc, &header_flags );
+  TcprosHeader header;
+  TcprosParserState ret = readHeader( client_proc, dynBufferGetData( packet ),
+                                      dynBufferGetSize( packet ), &header );
   if( ret != TCPROS_PARSER_DONE )
     return ret;
 
-  if( TCPROS_PUBLICATION_HEADER_FLAGS != ( header_flags&TCPROS_PUBLICATION_HEADER_FLAGS) )
+  if( TCPROS_PUBLICATION_HEADER_FLAGS != ( header.flags&TCPROS_PUBLICATION_HEADER_FLAGS) )
   {
     PRINT_ERROR("cRosMessageParsePublicationHeader() : Missing fields\n");
     ret = TCPROS_PARSER_ERROR;
@@ -369,8 +381,8 @@ TcprosParserState cRosMessageParsePublicationHeader( CrosNode *n, int client_idx
       if (sub->topic_name == NULL)
         continue;
 
-      if( strcmp(sub->topic_type, dynStringGetData(&(client_proc->type))) == 0 &&
-          strcmp(sub->md5sum, dynStringGetData(&(client_proc->md5sum))) == 0)
+      if( fieldEquals( &header.fields[TCPROS_FIELD_TYPE], sub->topic_type ) &&
+          fieldEquals( &header.fields[TCPROS_FIELD_MD5SUM], sub->md5sum ) )
       {
         subscriber_found = 1;
         break;
@@ -384,9 +396,6 @@ TcprosParserState cRosMessageParsePublicationHeader( CrosNode *n, int client_idx
     }
   }
 
-  /* Restore position indicator */
-  dynBufferSetPoseIndicator ( packet, initial_pos_idx );
-
   return ret;
 }
 
@@ -395,168 +404,130 @@ void cRosMessagePrepareSubcriptionHeader( CrosNode *n, int client_idx )
   PRINT_VDEBUG("cRosMessagePrepareSubcriptionHeader()\n");
 
   TcprosProcess *client_proc = &(n->tcpros_client_proc[client_idx]);
-  int sub_idx = client_proc->topic_idx;
-  DynBuffer *packet = &(client_proc->packet);
-  uint32_t header_len = 0, header_out_len = 0;
-  dynBufferPushBackUInt32( packet, header_out_len );
+  SubscriberNode *sub = &(n->subs[client_proc->topic_idx]);
+  DynBuffer *header = &(sub->header);
 
-  header_len += pushBackField( packet, &TCPROS_MESSAGE_DEFINITION_TAG, n->subs[sub_idx].message_definition );
-  header_len += pushBackField( packet, &TCPROS_CALLERID_TAG, n->name );
-  header_len += pushBackField( packet, &TCPROS_TOPIC_TAG, n->subs[sub_idx].topic_name );
-  header_len += pushBackField( packet, &TCPROS_MD5SUM_TAG, n->subs[sub_idx].md5sum );
-  header_len += pushBackField( packet, &TCPROS_TYPE_TAG, n->subs[sub_idx].topic_type );
+  if( dynBufferGetSize( header ) == 0 )
+  {
+    uint32_t header_len = 0;
+    dynBufferPushBackUInt32( header, header_len );
+
+    header_len += pushBackField( header, &TCPROS_MESSAGE_DEFINITION_TAG, sub->message_definition );
+    header_len += pushBackField( header, &TCPROS_CALLERID_TAG, n->name );
+    header_len += pushBackField( header, &TCPROS_TOPIC_TAG, sub->topic_name );
+    header_len += pushBackField( header, &TCPROS_MD5SUM_TAG, sub->md5sum );
+    header_len += pushBackField( header, &TCPROS_TYPE_TAG, sub->topic_type );
+    setHeaderLen( header, header_len );
+  }
 
-  HOST_TO_ROS_UINT32( header_len, header_out_len );
-  uint32_t *header_len_p = (uint32_t *)dynBufferGetData( packet );
-  *header_len_p = header_out_len;
+  pushBackCachedHeader( &(client_proc->packet), header );
 }
 
-void cRosMessageParsePublicationPacket( CrosNode *n, int client_idx )
+void cRosMessagePrepareUdprosSubscriptionHeader( CrosNode *n, int sub_idx, DynBuffer *header )
 {
-  TcprosProcess *client_proc = &(n->tcpros_client_proc[client_idx]);
-  DynBuffer *packet = &(client_proc->packet);
-  int sub_idx = client_proc->topic_idx;
-  void* data_context = n->subs[sub_idx].context;
-  n->subs[sub_idx].callback(packet,data_context);
-}
+  PRINT_VDEBUG("cRosMessagePrepareUdprosSubscriptionHeader()\n");
 
-void cRosMessagePreparePublicationHeader( CrosNode *n, int server_idx )
-{
-  PRINT_VDEBUG("cRosMessagePreparePublicationHeader()\n");
-    
-  TcprosProcess *server_proc = &(n->tcpros_server_proc[server_idx]);
-  int pub_idx = server_proc->topic_idx;
-  DynBuffer *packet = &(server_proc->packet);
-  uint32_t header_len = 0, header_out_len = 0; 
-  dynBufferPushBackUInt32( packet, header_out_len );
-
-  // http://wiki.ros.org/ROS/TCPROS doesn't mention to send message_definition and topic_name
-  // but they are sent anyway in ros groovy
-  header_len += pushBackField( packet, &TCPROS_MESSAGE_DEFINITION_TAG, n->pubs[pub_idx].message_definition );
-  header_len += pushBackField( packet, &TCPROS_CALLERID_TAG, n->name );
-  header_len += pushBackField( packet, &TCPROS_LATCHING_TAG, "1" );
-  header_len += pushBackField( packet, &TCPROS_MD5SUM_TAG, n->pubs[pub_idx].md5sum );
-  header_len += pushBackField( packet, &TCPROS_TOPIC_TAG, n->pubs[pub_idx].topic_name );
-  header_len += pushBackField( packet, &TCPROS_TYPE_TAG, n->pubs[pub_idx].topic_type );
-  
-  HOST_TO_ROS_UINT32( header_len, header_out_len );
-  uint32_t *header_len_p = (uint32_t *)dynBufferGetData( packet );
-  *header_len_p = header_out_len;
+  pushBackField( header, &TCPROS_CALLERID_TAG, n->name );
+  pushBackField( header, &TCPROS_TOPIC_TAG, n->subs[sub_idx].topic_name );
+  pushBackField( header, &TCPROS_MD5SUM_TAG, n->subs[sub_idx].md5sum );
+  pushBackField( header, &TCPROS_TYPE_TAG, n->subs[sub_idx].topic_type );
 }
 
-void cRosMessagePreparePublicationPacket( CrosNode *n, int server_idx )
+void cRosMessagePrepareUdprosPublicationHeader( CrosNode *n, int pub_idx, int latching, DynBuffer *header )
 {
-  PRINT_VDEBUG("cRosMessagePreparePublicationPacket()\n");
-  TcprosProcess *server_proc = &(n->tcpros_server_proc[server_idx]);
-  int pub_idx = server_proc->topic_idx;
-  DynBuffer *packet = &(server_proc->packet);
-  dynBufferPushBackUInt32( packet, 0 ); // Placehoder for packet size
+  PRINT_VDEBUG("cRosMessagePrepareUdprosPublicationHeader()\n");
 
-  void* data_context = n->pubs[pub_idx].context;
-  n->pubs[pub_idx].callback( packet, data_context);
-
-  uint32_t size = (uint32_t)dynBufferGetSize(packet) - sizeof(uint32_t);
-  memcpy(packet->data, &size, sizeof(uint32_t));
+  pushBackField( header, &TCPROS_CALLERID_TAG, n->name );
+  pushBackField( header, &TCPROS_LATCHING_TAG, latching ? "1" : "0" );
+  pushBackField( header, &TCPROS_MD5SUM_TAG, n->pubs[pub_idx].md5sum );
+  pushBackField( header, &TCPROS_TOPIC_TAG, n->pubs[pub_idx].topic_name );
+  pushBackField( header, &TCPROS_TYPE_TAG, n->pubs[pub_idx].topic_type );
 }
 
-static TcprosParserState readServiceCallHeader( TcprosProcess *p, uint32_t *flags )
+static int fieldMatches( const unsigned char *field, uint32_t field_len, TcprosTagStrDim *tag, const char *val )
 {
-  PRINT_VDEBUG("readServiceCallHeader()\n");
-  DynBuffer *packet = &(p->packet);
-  size_t bytes_to_read = dynBufferGetSize( packet );
-
-  *flags = 0x0;
-
-  PRINT_DEBUG("readServiceCallHeader() : Header len=%d\n",bytes_to_read);
+  size_t val_len = strlen( val );
+  return field_len == tag->dim + val_len &&
+         memcmp( field + tag->dim, val, val_len ) == 0;
+}
 
-  while ( bytes_to_read > 0)
+int cRosMessageCheckUdprosHeader( const unsigned char *header, size_t size, const char *type, const char *md5sum )
+{
+  int type_ok = 0, md5sum_ok = 0;
+  size_t pos = 0;
+  while ( pos + sizeof(uint32_t) <= size )
   {
-    uint32_t field_len = getLen( packet );
+    uint32_t field_len;
+    memcpy( &field_len, header + pos, sizeof(uint32_t) );
+    ROS_TO_HOST_UINT32( field_len, field_len );
+    pos += sizeof(uint32_t);
+    if ( field_len > size - pos )
+      return -1;
+
+    const unsigned char *field = header + pos;
+    if ( field_len >= (uint32_t)TCPROS_TYPE_TAG.dim &&
+         memcmp( field, TCPROS_TYPE_TAG.str, TCPROS_TYPE_TAG.dim ) == 0 )
+      type_ok = fieldMatches( field, field_len, &TCPROS_TYPE_TAG, type );
+    else if ( field_len >= (uint32_t)TCPROS_MD5SUM_TAG.dim &&
+              memcmp( field, TCPROS_MD5SUM_TAG.str, TCPROS_MD5SUM_TAG.dim ) == 0 )
+      md5sum_ok = fieldMatches( field, field_len, &TCPROS_MD5SUM_TAG, md5sum ) ||
+                  fieldMatches( field, field_len, &TCPROS_MD5SUM_TAG, "*" );
+
+    pos += field_len;
+  }
 
-    PRINT_DEBUG("readServiceCallHeader() : Field len=%d\n",field_len);
+  return ( type_ok && md5sum_ok ) ? 0 : -1;
+}
 
-    const char *field = (const char *)dynBufferGetCurrentData( packet );
+void cRosMessageParsePublicationPacket( CrosNode *n, int client_idx, DynBuffer *packet )
+{
+  TcprosProcess *client_proc = &(n->tcpros_client_proc[client_idx]);
+  cRosSubscriberQueueDeliver( n, client_proc->topic_idx, packet );
+}
 
-    if( field_len )
-    {
-      if ( field_len > (uint32_t)TCPROS_CALLERID_TAG.dim &&
-          strncmp ( field, TCPROS_CALLERID_TAG.str, TCPROS_CALLERID_TAG.dim ) == 0 )
-      {
-        field += TCPROS_CALLERID_TAG.dim;
+void cRosMessagePreparePublicationHeader( CrosNode *n, int server_idx )
+{
+  PRINT_VDEBUG("cRosMessagePreparePublicationHeader()\n");
+    
+  TcprosProcess *server_proc = &(n->tcpros_server_proc[server_idx]);
+  PublisherNode *pub = &(n->pubs[server_proc->topic_idx]);
+  DynBuffer *header = &(pub->header);
 
-        dynStringPushBackStrN( &(p->caller_id), field,
-                               field_len - TCPROS_CALLERID_TAG.dim );
-        *flags |= TCPROS_CALLER_ID_FLAG;
-        dynBufferMovePoseIndicator( packet, field_len );
-      }
-      else if ( field_len > (uint32_t)TCPROS_TYPE_TAG.dim &&
-          strncmp ( field, TCPROS_TYPE_TAG.str, TCPROS_TYPE_TAG.dim ) == 0 )
-      {
-        field += TCPROS_TYPE_TAG.dim;
+  if( dynBufferGetSize( header ) == 0 )
+  {
+    uint32_t header_len = 0;
+    dynBufferPushBackUInt32( header, header_len );
+
+    // http://wiki.ros.org/ROS/TCPROS doesn't mention to send message_definition and topic_name
+    // but they are sent anyway in ros groovy
+    header_len += pushBackField( header, &TCPROS_MESSAGE_DEFINITION_TAG, pub->message_definition );
+    header_len += pushBackField( header, &TCPROS_CALLERID_TAG, n->name );
+    header_len += pushBackField( header, &TCPROS_LATCHING_TAG, "1" );
+    header_len += pushBackField( header, &TCPROS_MD5SUM_TAG, pub->md5sum );
+    header_len += pushBackField( header, &TCPROS_TOPIC_TAG, pub->topic_name );
+    header_len += pushBackField( header, &TCPROS_TYPE_TAG, pub->topic_type );
+    setHeaderLen( header, header_len );
+  }
 
-        dynStringPushBackStrN( &(p->type), field,
-                               field_len - TCPROS_TYPE_TAG.dim );
-        *flags |= TCPROS_TYPE_FLAG;
-        dynBufferMovePoseIndicator( packet, field_len );
-      }
-      else if ( field_len > (uint32_t)TCPROS_MD5SUM_TAG.dim &&
-          strncmp ( field, TCPROS_MD5SUM_TAG.str, TCPROS_MD5SUM_TAG.dim ) == 0 )
-      {
-        field += TCPROS_MD5SUM_TAG.dim;
+  pushBackCachedHeader( &(server_proc->packet), header );
+}
 
-        dynStringPushBackStrN( &(p->md5sum), field,
-                               field_len - TCPROS_MD5SUM_TAG.dim );
-        *flags |= TCPROS_MD5SUM_FLAG;
-        dynBufferMovePoseIndicator( packet, field_len );
-      }
-      else if ( field_len > (uint32_t)TCPROS_SERVICE_TAG.dim &&
-          strncmp ( field, TCPROS_SERVICE_TAG.str, TCPROS_SERVICE_TAG.dim ) == 0 )
-      {
-        field += TCPROS_SERVICE_TAG.dim;
+void cRosMessagePreparePublicationPacket( CrosNode *n, int pub_idx )
+{
+  PRINT_VDEBUG("cRosMessagePreparePublicationPacket()\n");
+  DynBuffer *packet = &(n->pubs[pub_idx].packet);
+  dynBufferClear( packet );
+  dynBufferPushBackUInt32( packet, 0 ); // Placehoder for packet size
 
-        dynStringPushBackStrN( &(p->service), field,
-                               field_len - TCPROS_SERVICE_TAG.dim );
-        *flags |= TCPROS_SERVICE_FLAG;
-        dynBufferMovePoseIndicator( packet, field_len );
-      }
-      else if ( field_len > (uint32_t)TCPROS_PERSISTENT_TAG.dim &&
-          strncmp ( field, TCPROS_PERSISTENT_TAG.str, TCPROS_PERSISTENT_TAG.dim ) == 0 )
-      {
-        PRINT_INFO("readPublicationHeader() WARNING : TCPROS_LATCHING_TAG not implemented\n");
-        field += TCPROS_PERSISTENT_TAG.dim;
-        p->persistent = (*field == '1')?1:0;
-        *flags |= TCPROS_PERSISTENT_FLAG;
-        dynBufferMovePoseIndicator( packet, field_len );
-      }
-      else if ( field_len > (uint32_t)TCPROS_PROBE_TAG.dim &&
-          strncmp ( field, TCPROS_PROBE_TAG.str, TCPROS_PROBE_TAG.dim ) == 0 )
-      {
-        //PRINT_INFO("readServiceCallHeader() WARNING : TCPROS_PROBE_TAG implemented only\n");
-        field += TCPROS_PROBE_TAG.dim;
-        p->probe = (*field == '1')?1:0;
-        *flags |= TCPROS_PROBE_FLAG;
-        dynBufferMovePoseIndicator( packet, field_len );
-      }
-      else if ( field_len > (uint32_t)TCPROS_ERROR_TAG.dim &&
-          strncmp ( field, TCPROS_ERROR_TAG.str, TCPROS_ERROR_TAG.dim ) == 0 )
-      {
-        PRINT_INFO("readServiceCallHeader() WARNING : TCPROS_ERROR_TAG not implemented\n");
-        *flags |= TCPROS_ERROR_FLAG;
-        dynBufferMovePoseIndicator( packet, field_len );
-      }
-      else
-      {
-        PRINT_ERROR("readServiceCallHeader() : unknown field\n");
-        *flags = 0x0;
-        break;
-      }
-    }
-    bytes_to_read -= ( sizeof(uint32_t) + field_len );
-  }
+  void* data_context = n->pubs[pub_idx].context;
+  n->pubs[pub_idx].callback( packet, data_context);
 
-  return TCPROS_PARSER_DONE;
+  uint32_t size = (uint32_t)dynBufferGetSize(packet) - sizeof(uint32_t), out_size;
+  HOST_TO_ROS_UINT32( size, out_size );
+  memcpy(packet->data, &out_size, sizeof(uint32_t));
 }
 
+
 TcprosParserState cRosMessageParseServiceCallerHeader( CrosNode *n, int server_idx)
 {
   PRINT_VDEBUG("cRosMessageParseServiceCallerHeader()\n");
@@ -564,43 +535,33 @@ TcprosParserState cRosMessageParseServiceCallerHeader( CrosNode *n, int server_i
   TcprosProcess *server_proc = &(n->rpcros_server_proc[server_idx]);
   DynBuffer *packet = &(server_proc->packet);
 
-  /* Save position indicator: it will be restored */
-  int initial_pos_idx = dynBufferGetPoseIndicatorOffset ( packet );
-  dynBufferRewindPoseIndicator ( packet );
-
-  uint32_t header_flags;
-  TcprosParserState ret = readServiceCallHeader( server_proc, &header_flags );
+  TcprosHeader header;
+  TcprosParserState ret = readHeader( server_proc, dynBufferGetData( packet ),
+                                      dynBufferGetSize( packet ), &header );
   if( ret != TCPROS_PARSER_DONE )
     return ret;
 
   int service_found = 0;
+  const TcprosHeaderField *service = &header.fields[TCPROS_FIELD_SERVICE];
+  // The other fields (e.g., type or tcp_nodelay, sent by some clients) don't select the session kind
+  uint32_t header_flags = header.flags & ( TCPROS_SERVICECALL_HEADER_FLAGS | TCPROS_SERVICEPROBE_HEADER_FLAGS );
 
   if( header_flags == ( header_flags & TCPROS_SERVICECALL_HEADER_FLAGS) )
   {
-    int i = 0;
-    for( i = 0 ; i < n->n_services; i++)
+    int i = cRosNameIndexFindN( &n->name_index, CROS_NAME_SERVICE, service->value, service->len );
+    if( i != -1 && fieldEquals( &header.fields[TCPROS_FIELD_MD5SUM], n->services[i].md5sum ) )
     {
-      if( strcmp( n->services[i].service_name, dynStringGetData(&(server_proc->service))) == 0 &&
-          strcmp( n->services[i].md5sum, dynStringGetData(&(server_proc->md5sum))) == 0
-          )
-      {
-        service_found = 1;
-        server_proc->service_idx = i;
-        break;
-      }
+      service_found = 1;
+      server_proc->service_idx = i;
     }
   }
   else if( header_flags == ( header_flags & TCPROS_SERVICEPROBE_HEADER_FLAGS) )
   {
-    int i = 0;
-    for( i = 0 ; i < n->n_services; i++)
+    int i = cRosNameIndexFindN( &n->name_index, CROS_NAME_SERVICE, service->value, service->len );
+    if( i != -1 )
     {
-      if( strcmp( n->services[i].service_name, dynStringGetData(&(server_proc->service))) == 0)
-      {
-        service_found = 1;
-        server_proc->service_idx = i;
-        break;
-      }
+      service_found = 1;
+      server_proc->service_idx = i;
     }
   }
   else
@@ -616,9 +577,6 @@ TcprosParserState cRosMessageParseServiceCallerHeader( CrosNode *n, int server_i
     ret = TCPROS_PARSER_ERROR;
   }
 
-  /* Restore position indicator */
-  dynBufferSetPoseIndicator ( packet, initial_pos_idx );
-
   return ret;
 }
 
@@ -627,29 +585,32 @@ void cRosMessagePrepareServiceProviderHeader( CrosNode *n, int server_idx)
   PRINT_VDEBUG("cRosMessagePreparePublicationHeader()\n");
 
   TcprosProcess *server_proc = &(n->rpcros_server_proc[server_idx]);
-  int srv_idx = server_proc->service_idx;
-  DynBuffer *packet = &(server_proc->packet);
-  uint32_t header_len = 0, header_out_len = 0;
-  dynBufferPushBackUInt32( packet, header_out_len );
+  ServiceProviderNode *service = &(n->services[server_proc->service_idx]);
+  DynBuffer *header = &(service->header);
 
-  // http://wiki.ros.org/ROS/TCPROS doesn't mention to send message_definition and topic_name
-  // but they are sent anyway in ros groovy
-  header_len += pushBackField( packet, &TCPROS_CALLERID_TAG, n->name );
-  header_len += pushBackField( packet, &TCPROS_MD5SUM_TAG, n->services[srv_idx].md5sum );
-
-  //if(server_proc->probe)
-  //{
-    header_len += pushBackField( packet, &TCPROS_SERVICE_REQUESTTYPE_TAG, n->services[srv_idx].servicerequest_type );
-    header_len += pushBackField( packet, &TCPROS_SERVICE_RESPONSETYPE_TAG, n->services[srv_idx].serviceresponse_type );
-    header_len += pushBackField( packet, &TCPROS_TYPE_TAG, n->services[srv_idx].service_type );
-  //}
+  if( dynBufferGetSize( header ) == 0 )
+  {
+    uint32_t header_len = 0;
+    dynBufferPushBackUInt32( header, header_len );
+
+    // http://wiki.ros.org/ROS/TCPROS doesn't mention to send message_definition and topic_name
+    // but they are sent anyway in ros groovy
+    header_len += pushBackField( header, &TCPROS_CALLERID_TAG, n->name );
+    header_len += pushBackField( header, &TCPROS_MD5SUM_TAG, service->md5sum );
+
+    //if(server_proc->probe)
+    //{
+      header_len += pushBackField( header, &TCPROS_SERVICE_REQUESTTYPE_TAG, service->servicerequest_type );
+      header_len += pushBackField( header, &TCPROS_SERVICE_RESPONSETYPE_TAG, service->serviceresponse_type );
+      header_len += pushBackField( header, &TCPROS_TYPE_TAG, service->service_type );
+    //}
+    setHeaderLen( header, header_len );
+  }
 
-  HOST_TO_ROS_UINT32( header_len, header_out_len );
-  uint32_t *header_len_p = (uint32_t *)dynBufferGetData( packet );
-  *header_len_p = header_out_len;
+  pushBackCachedHeader( &(server_proc->packet), header );
 }
 
-void cRosMessagePrepareServiceResponsePacket( CrosNode *n, int server_idx)
+CallbackResponse cRosMessagePrepareServiceResponsePacket( CrosNode *n, int server_idx)
 {
   PRINT_VDEBUG("cRosMessageParseServiceArgumentsPacket()\n");
   TcprosProcess *server_proc = &(n->rpcros_server_proc[server_idx]);
@@ -659,23 +620,100 @@ void cRosMessagePrepareServiceResponsePacket( CrosNode *n, int server_idx)
   DynBuffer service_response;
   dynBufferInit(&service_response);
 
+  server_proc->call_id = n->next_call_id++;
+  n->service_call_id = server_proc->call_id;
   CallbackResponse callback_response = n->services[srv_idx].callback(packet, &service_response, service_context);
+  n->service_call_id = -1;
 
   //clear packet buffer
   dynBufferClear(packet);
 
+  if (callback_response == CN_SERVICE_RESPONSE_DEFERRED)
+  {
+    // The response will be given by cRosNodeSendServiceResponse()
+    dynBufferRelease(&service_response);
+    return callback_response;
+  }
+  server_proc->call_id = -1;
+
+  cRosMessagePrepareServiceResponse( packet, 1, &service_response );
+
+  dynBufferRelease(&service_response);
+  return callback_response;
+}
+
+void cRosMessagePrepareServiceResponse( DynBuffer *packet, int ok, DynBuffer *response )
+{
   //OK field (byte size)
-  unsigned char ok = 1;
-  dynBufferPushBackBuf( packet, &ok, 1 );
+  unsigned char ok_byte = ok ? 1 : 0;
+  dynBufferPushBackBuf( packet, &ok_byte, 1 );
 
   //Size data field
-  dynBufferPushBackUInt32( packet, service_response.size);
+  size_t size = response != NULL ? dynBufferGetSize(response) : 0;
+  uint32_t out_size;
+  HOST_TO_ROS_UINT32( (uint32_t)size, out_size );
+  dynBufferPushBackUInt32( packet, out_size );
 
-  if(service_response.size)
+  if(size)
   {
     //Response data
-    dynBufferPushBackBuf( packet, service_response.data, service_response.size);
+    dynBufferPushBackBuf( packet, dynBufferGetData(response), size );
   }
+}
 
-  dynBufferRelease(&service_response);
+
+void cRosMessagePrepareServiceCallHeader( CrosNode *n, int client_idx)
+{
+  PRINT_VDEBUG("cRosMessagePrepareServiceCallHeader()\n");
+
+  TcprosProcess *client_proc = &(n->rpcros_client_proc[client_idx]);
+  ServiceCallerNode *caller = &(n->service_callers[client_idx]);
+  DynBuffer *header = &(caller->header);
+
+  if( dynBufferGetSize( header ) == 0 )
+  {
+    uint32_t header_len = 0;
+    dynBufferPushBackUInt32( header, header_len );
+
+    header_len += pushBackField( header, &TCPROS_CALLERID_TAG, n->name );
+    header_len += pushBackField( header, &TCPROS_SERVICE_TAG, caller->service_name );
+    header_len += pushBackField( header, &TCPROS_MD5SUM_TAG, caller->md5sum );
+    header_len += pushBackField( header, &TCPROS_PERSISTENT_TAG, caller->persistent ? "1" : "0" );
+    setHeaderLen( header, header_len );
+  }
+
+  pushBackCachedHeader( &(client_proc->packet), header );
+}
+
+TcprosParserState cRosMessageParseServiceProviderHeader( CrosNode *n, int client_idx)
+{
+  PRINT_VDEBUG("cRosMessageParseServiceProviderHeader()\n");
+
+  TcprosProcess *client_proc = &(n->rpcros_client_proc[client_idx]);
+  ServiceCallerNode *caller = &(n->service_callers[client_idx]);
+  DynBuffer *packet = &(client_proc->packet);
+
+  TcprosHeader header;
+  TcprosParserState ret = readHeader( client_proc, dynBufferGetData( packet ),
+                                      dynBufferGetSize( packet ), &header );
+  if( ret == TCPROS_PARSER_DONE )
+  {
+    if( header.flags & TCPROS_ERROR_FLAG )
+    {
+      ret = TCPROS_PARSER_ERROR;
+    }
+    else if( !( header.flags & TCPROS_MD5SUM_FLAG ) )
+    {
+      PRINT_ERROR("cRosMessageParseServiceProviderHeader() : Missing fields\n");
+      ret = TCPROS_PARSER_ERROR;
+    }
+    else if( strcmp( caller->md5sum, "*" ) != 0 &&
+             !fieldEquals( &header.fields[TCPROS_FIELD_MD5SUM], caller->md5sum ) )
+    {
+      PRINT_ERROR("cRosMessageParseServiceProviderHeader() : Wrong md5sum\n");
+      ret = TCPROS_PARSER_ERROR;
+    }
+  }
+
+  return ret;
 }
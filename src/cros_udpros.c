@@ -0,0 +1,454 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "cros_udpros.h"
+#include "cros_uring.h"
+#include "cros_subscriber_queue.h"
+#include "cros_defs.h"
+
+/*! Max num datagrams read for a subscriber in a cycle, so that a flooding publisher can't stall the node
+ *  (the socket stays readable, the next cycle starts at once) */
+enum { UDPROS_MAX_DATAGRAMS_PER_CYCLE = 256 };
+
+/*! Socket receive buffer of a subscriber, to absorb the bursts of the large messages */
+enum { UDPROS_RECV_BUFFER_SIZE = 1024 * 1024 };
+
+// The header is little endian, as the rest of the ROS wire format
+static void writeHeader(unsigned char *header, uint32_t connection_id, uint8_t opcode, uint8_t message_id, uint16_t block)
+{
+  header[0] = connection_id & 0xFF;
+  header[1] = (connection_id >> 8) & 0xFF;
+  header[2] = (connection_id >> 16) & 0xFF;
+  header[3] = (connection_id >> 24) & 0xFF;
+  header[4] = opcode;
+  header[5] = message_id;
+  header[6] = block & 0xFF;
+  header[7] = (block >> 8) & 0xFF;
+}
+
+static void readHeader(const unsigned char *header, uint32_t *connection_id, uint8_t *opcode, uint8_t *message_id, uint16_t *block)
+{
+  *connection_id = header[0] | (header[1] << 8) | (header[2] << 16) | ((uint32_t)header[3] << 24);
+  *opcode = header[4];
+  *message_id = header[5];
+  *block = header[6] | (header[7] << 8);
+}
+
+static int resolveHost(const char *host, int port, struct sockaddr_in *adr)
+{
+  memset(adr, 0, sizeof(struct sockaddr_in));
+  adr->sin_family = AF_INET;
+  adr->sin_port = htons(port);
+
+  if (inet_pton(AF_INET, host, &adr->sin_addr) == 1)
+    return 0;
+
+  struct addrinfo hints, *res;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  if (getaddrinfo(host, NULL, &hints, &res) != 0)
+    return -1;
+
+  adr->sin_addr = ((struct sockaddr_in *)res->ai_addr)->sin_addr;
+  freeaddrinfo(res);
+  return 0;
+}
+
+static void releaseDestination(UdprosDestination *dest)
+{
+  if (dest->fd != -1)
+    close(dest->fd);
+  dest->fd = -1;
+  free(dest->caller_id);
+  dest->caller_id = NULL;
+}
+
+static void removeSubscriber(PublisherNode *pub, int idx)
+{
+  releaseDestination(&pub->udpros_subs[idx]);
+  pub->udpros_subs[idx] = pub->udpros_subs[pub->n_udpros_subs - 1];
+  pub->n_udpros_subs--;
+}
+
+/* Send a packet split in blocks. Returns 0 on success, -1 if the packet was dropped, -2 if the
+ * subscriber is gone (its host refused the datagrams) */
+static int sendPacket(UdprosDestination *dest, const unsigned char *data, size_t size)
+{
+  size_t block_size = dest->max_datagram_size - CROS_UDPROS_HEADER_SIZE;
+  size_t n_blocks = (size + block_size - 1) / block_size;
+  uint8_t message_id = dest->message_id++;
+
+  if (n_blocks > 0xFFFF)
+  {
+    PRINT_ERROR("cRosUdprosPublish() : Message too large for datagrams of %d bytes\n", dest->max_datagram_size);
+    return -1;
+  }
+
+  size_t block;
+  for (block = 0; block < n_blocks; block++)
+  {
+    unsigned char header[CROS_UDPROS_HEADER_SIZE];
+    if (block == 0)
+      writeHeader(header, dest->connection_id, CROS_UDPROS_DATA0, message_id, (uint16_t)n_blocks);
+    else
+      writeHeader(header, dest->connection_id, CROS_UDPROS_DATAN, message_id, (uint16_t)block);
+
+    size_t offset = block * block_size;
+    struct iovec iov[2];
+    iov[0].iov_base = header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = (void *)(data + offset);
+    iov[1].iov_len = size - offset < block_size ? size - offset : block_size;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+
+    if (sendmsg(dest->fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL) == -1)
+    {
+      // The rest of the message is useless to the subscriber
+      if (errno == ECONNREFUSED)
+        return -2;
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+static int publishTo(PublisherNode *pub, int idx)
+{
+  UdprosDestination *dest = &pub->udpros_subs[idx];
+  int rc = sendPacket(dest, dynBufferGetData(&pub->packet), dynBufferGetSize(&pub->packet));
+  if (rc == 0)
+    dest->sent_messages++;
+  else
+    dest->dropped_messages++;
+
+  return rc;
+}
+
+int cRosUdprosAddSubscriber(CrosNode *n, int pub_idx, const char *caller_id, const char *host,
+                            int port, int max_datagram_size)
+{
+  PublisherNode *pub = &n->pubs[pub_idx];
+
+  if (max_datagram_size <= CROS_UDPROS_HEADER_SIZE)
+    max_datagram_size = CN_UDPROS_DEFAULT_DATAGRAM_SIZE;
+
+  struct sockaddr_in adr;
+  if (resolveHost(host, port, &adr) == -1)
+  {
+    PRINT_ERROR("cRosUdprosAddSubscriber() : Unable to resolve %s\n", host);
+    return -1;
+  }
+
+  // A subscriber requesting the topic again (e.g., after a publisherUpdate) replaces its connection
+  int i;
+  for (i = 0; i < pub->n_udpros_subs; i++)
+  {
+    if (strcmp(pub->udpros_subs[i].caller_id, caller_id) == 0)
+    {
+      removeSubscriber(pub, i);
+      break;
+    }
+  }
+
+  if (pub->n_udpros_subs == CN_MAX_UDPROS_SUBSCRIBERS)
+    return -1;
+
+  UdprosDestination *dest = &pub->udpros_subs[pub->n_udpros_subs];
+  dest->fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (dest->fd == -1)
+    return -1;
+
+  // Connected, to be told by the next send when the subscriber is gone
+  if (connect(dest->fd, (struct sockaddr *)&adr, sizeof(adr)) == -1)
+  {
+    PRINT_ERROR("cRosUdprosAddSubscriber() : Can't connect to %s:%d\n", host, port);
+    close(dest->fd);
+    return -1;
+  }
+
+  struct sockaddr_in local_adr;
+  socklen_t local_adr_len = sizeof(local_adr);
+  dest->port = 0;
+  if (getsockname(dest->fd, (struct sockaddr *)&local_adr, &local_adr_len) == 0)
+    dest->port = ntohs(local_adr.sin_port);
+
+  dest->caller_id = strdup(caller_id);
+  if (dest->caller_id == NULL)
+  {
+    close(dest->fd);
+    return -1;
+  }
+
+  dest->connection_id = (uint32_t)n->next_connection_id++;
+  dest->max_datagram_size = max_datagram_size;
+  dest->message_id = 0;
+  dest->sent_messages = 0;
+  dest->dropped_messages = 0;
+  pub->n_udpros_subs++;
+
+  // Latching
+  if (dynBufferGetSize(&pub->packet) > 0)
+    publishTo(pub, pub->n_udpros_subs - 1);
+
+  return pub->n_udpros_subs - 1;
+}
+
+int cRosUdprosHasSubscribers(CrosNode *n, int pub_idx)
+{
+  return n->pubs[pub_idx].n_udpros_subs > 0;
+}
+
+void cRosUdprosPublish(CrosNode *n, int pub_idx)
+{
+  PublisherNode *pub = &n->pubs[pub_idx];
+
+  int i = 0;
+  while (i < pub->n_udpros_subs)
+  {
+    if (publishTo(pub, i) == -2)
+    {
+      PRINT_DEBUG("cRosUdprosPublish() : Subscriber %s gone\n", pub->udpros_subs[i].caller_id);
+      removeSubscriber(pub, i);
+      continue;
+    }
+
+    i++;
+  }
+}
+
+void cRosUdprosRelease(CrosNode *n, int pub_idx)
+{
+  PublisherNode *pub = &n->pubs[pub_idx];
+  while (pub->n_udpros_subs > 0)
+    removeSubscriber(pub, pub->n_udpros_subs - 1);
+}
+
+int cRosUdprosOpenReceiver(CrosNode *n, int sub_idx)
+{
+  UdprosReceiver *udp = &n->subs[sub_idx].udpros;
+
+  if (udp->fd == -1)
+  {
+    struct sockaddr_in adr;
+    if (resolveHost(n->host, 0, &adr) == -1)
+      return -1;
+
+    udp->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (udp->fd == -1)
+      return -1;
+
+    int buffer_size = UDPROS_RECV_BUFFER_SIZE;
+    setsockopt(udp->fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+
+    if (fcntl(udp->fd, F_SETFL, O_NONBLOCK) == -1 ||
+        bind(udp->fd, (struct sockaddr *)&adr, sizeof(adr)) == -1)
+    {
+      PRINT_ERROR("cRosUdprosOpenReceiver() : Can't bind the socket\n");
+      cRosUdprosCloseReceiver(n, sub_idx);
+      return -1;
+    }
+  }
+
+  else if (udp->connected)
+  {
+    // Requesting the topic again (e.g., to a new publisher): accept any sender until its answer
+    struct sockaddr unspec;
+    memset(&unspec, 0, sizeof(unspec));
+    unspec.sa_family = AF_UNSPEC;
+    connect(udp->fd, &unspec, sizeof(unspec));
+    udp->connected = 0;
+  }
+
+  struct sockaddr_in adr;
+  socklen_t adr_len = sizeof(adr);
+  if (getsockname(udp->fd, (struct sockaddr *)&adr, &adr_len) == -1)
+    return -1;
+
+  return ntohs(adr.sin_port);
+}
+
+int cRosUdprosConnect(CrosNode *n, int sub_idx, const char *host, int port, uint32_t connection_id,
+                      int max_datagram_size)
+{
+  UdprosReceiver *udp = &n->subs[sub_idx].udpros;
+
+  // Connected, so that the kernel discards the datagrams of any other sender
+  struct sockaddr_in adr;
+  if (udp->fd == -1 || resolveHost(host, port, &adr) == -1 ||
+      connect(udp->fd, (struct sockaddr *)&adr, sizeof(adr)) == -1)
+  {
+    PRINT_ERROR("cRosUdprosConnect() : Can't connect to %s:%d\n", host, port);
+    return -1;
+  }
+
+  udp->connected = 1;
+  udp->connection_id = connection_id;
+  if (max_datagram_size > CROS_UDPROS_HEADER_SIZE && max_datagram_size < udp->max_datagram_size)
+    udp->max_datagram_size = max_datagram_size;
+
+  dynBufferClear(&udp->message);
+  udp->message_id = -1;
+  udp->last_message_id = -1;
+  return 0;
+}
+
+void cRosUdprosCloseReceiver(CrosNode *n, int sub_idx)
+{
+  UdprosReceiver *udp = &n->subs[sub_idx].udpros;
+  if (udp->fd != -1)
+  {
+    cRosUringNotifyClose(udp->fd);
+    close(udp->fd);
+  }
+
+  udp->fd = -1;
+  udp->connected = 0;
+  dynBufferClear(&udp->message);
+  udp->message_id = -1;
+  udp->last_message_id = -1;
+}
+
+static void dropMessage(UdprosReceiver *udp)
+{
+  if (udp->message_id != -1)
+    udp->dropped_messages++;
+
+  dynBufferClear(&udp->message);
+  udp->message_id = -1;
+}
+
+// Returns 1 if a message has been completed
+static int receiveDatagram(UdprosReceiver *udp, unsigned char *payload, size_t payload_size)
+{
+  unsigned char header[CROS_UDPROS_HEADER_SIZE];
+  struct iovec iov[2];
+  iov[0].iov_base = header;
+  iov[0].iov_len = sizeof(header);
+  iov[1].iov_base = payload;
+  iov[1].iov_len = payload_size;
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 2;
+
+  ssize_t size = recvmsg(udp->fd, &msg, 0);
+  if (size == -1)
+    return -1;
+
+  uint32_t connection_id;
+  uint8_t opcode, message_id;
+  uint16_t block;
+  if (size < CROS_UDPROS_HEADER_SIZE || (msg.msg_flags & MSG_TRUNC))
+    return 0;
+
+  readHeader(header, &connection_id, &opcode, &message_id, &block);
+  // A previous publisher, or anything else
+  if (connection_id != udp->connection_id)
+    return 0;
+
+  size -= CROS_UDPROS_HEADER_SIZE;
+  if (opcode == CROS_UDPROS_DATA0)
+  {
+    dropMessage(udp);
+    if (udp->last_message_id != -1)
+      udp->dropped_messages += (uint8_t)(message_id - udp->last_message_id - 1);
+    udp->last_message_id = message_id;
+
+    // The payload has been received after the discarded blocks
+    unsigned char *begin = dynBufferReserve(&udp->message, size);
+    memmove(begin, payload, size);
+    dynBufferCommit(&udp->message, size);
+    udp->message_id = message_id;
+    udp->n_blocks = block;
+    udp->next_block = 1;
+  }
+  else if (opcode == CROS_UDPROS_DATAN)
+  {
+    if (udp->message_id != message_id || udp->next_block != block)
+    {
+      dropMessage(udp);
+      return 0;
+    }
+
+    dynBufferCommit(&udp->message, size);
+    udp->next_block++;
+  }
+  else
+    return 0;
+
+  return udp->next_block >= udp->n_blocks;
+}
+
+int cRosUdprosReceive(CrosNode *n)
+{
+  int count = 0;
+
+  int i;
+  for (i = 0; i < CN_MAX_SUBSCRIBED_TOPICS; i++)
+  {
+    SubscriberNode *sub = &n->subs[i];
+    UdprosReceiver *udp = &sub->udpros;
+
+    int j;
+    for (j = 0; j < UDPROS_MAX_DATAGRAMS_PER_CYCLE && udp->fd != -1 && udp->connected; j++)
+    {
+      size_t payload_size = udp->max_datagram_size - CROS_UDPROS_HEADER_SIZE;
+      unsigned char *payload = dynBufferReserve(&udp->message, payload_size);
+      if (payload == NULL)
+        break;
+
+      int rc = receiveDatagram(udp, payload, payload_size);
+      if (rc == -1)
+        break;
+      if (rc == 0)
+        continue;
+
+      // Complete message: [size][data]
+      const unsigned char *data = dynBufferGetData(&udp->message);
+      size_t size = dynBufferGetSize(&udp->message);
+      uint32_t msg_size = 0;
+      if (size >= sizeof(uint32_t))
+        ROS_TO_HOST_UINT32( *((uint32_t *)data), msg_size );
+
+      if (size < sizeof(uint32_t) || msg_size != size - sizeof(uint32_t))
+      {
+        dropMessage(udp);
+        continue;
+      }
+
+      udp->message_id = -1;
+      udp->received_messages++;
+
+      DynBuffer msg;
+      dynBufferInitView(&msg, data + sizeof(uint32_t), msg_size);
+      cRosSubscriberQueueDeliver(n, i, &msg);
+      count++;
+
+      // The callback may have unsubscribed
+      dynBufferClear(&udp->message);
+    }
+  }
+
+  return count;
+}
+
+void cRosUdprosGetStats(CrosNode *n, int sub_idx, size_t *received, size_t *dropped)
+{
+  *received = n->subs[sub_idx].udpros.received_messages;
+  *dropped = n->subs[sub_idx].udpros.dropped_messages;
+}
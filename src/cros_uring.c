@@ -0,0 +1,629 @@
+#ifdef CROS_USE_IO_URING
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#include "cros_uring.h"
+#include "cros_clock.h"
+#include "cros_defs.h"
+
+/* Tag of the requests that cancel or remove the polls */
+#define CROS_URING_CANCEL_DATA UINT64_MAX
+
+/* A tag holds the sequence (bits 32-63), the entry of io (bits 24-31) of a receive or send and the
+   descriptor (bits 0-15, 0xFFFF for the cancellations) */
+#define CROS_URING_IO_TAG 0x800000
+#define CROS_URING_FD_MASK 0xFFFF
+
+/* Group of the buffers provided to the receives */
+#define CROS_URING_RECV_GROUP 0
+
+/* Closings of each descriptor by the process, see cRosUringNotifyClose() */
+static uint32_t fd_close_count[FD_SETSIZE];
+
+static int uringSetup( unsigned entries, struct io_uring_params *params )
+{
+  return (int)syscall( __NR_io_uring_setup, entries, params );
+}
+
+static int uringEnter( CrosUring *ring, unsigned to_submit, unsigned min_complete, unsigned flags,
+                       void *arg, size_t arg_size )
+{
+  return (int)syscall( __NR_io_uring_enter, ring->fd, to_submit, min_complete, flags, arg, arg_size );
+}
+
+// Queue a request: the caller submits it, with io_uring_enter(), before the queue is full
+static struct io_uring_sqe *getSqe( CrosUring *ring )
+{
+  unsigned tail = *ring->sq_tail;
+  unsigned idx = tail & *ring->sq_mask;
+  struct io_uring_sqe *sqe = &ring->sqes[idx];
+  memset( sqe, 0, sizeof(struct io_uring_sqe) );
+  ring->sq_array[idx] = idx;
+  __atomic_store_n( ring->sq_tail, tail + 1, __ATOMIC_RELEASE );
+  return sqe;
+}
+
+int cRosUringInit( CrosUring *ring )
+{
+  PRINT_VDEBUG ( "cRosUringInit()\n" );
+
+  memset( ring, 0, sizeof(CrosUring) );
+  ring->fd = -1;
+  ring->max_fd = -1;
+  memset( ring->io_idx, -1, sizeof(ring->io_idx) );
+  int i;
+  for( i = 0; i < CROS_URING_MAX_IO; i++ )
+    ring->io[i].fd = -1;
+
+  struct io_uring_params params;
+  memset( &params, 0, sizeof(params) );
+  int fd = uringSetup( CROS_URING_ENTRIES, &params );
+  if( fd < 0 )
+  {
+    PRINT_INFO( "cRosUringInit() : io_uring not available, using select()\n" );
+    return -1;
+  }
+
+  // The single mapping of the rings and the wait timeout of io_uring_enter() are required
+  if( !(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG) )
+  {
+    PRINT_INFO( "cRosUringInit() : io_uring too old, using select()\n" );
+    close( fd );
+    return -1;
+  }
+
+  size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  ring->ring_map_size = ( sq_size > cq_size ) ? sq_size : cq_size;
+  ring->ring_map = mmap( NULL, ring->ring_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         fd, IORING_OFF_SQ_RING );
+  ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  void *sqes = mmap( NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     fd, IORING_OFF_SQES );
+  if( ring->ring_map == MAP_FAILED || sqes == MAP_FAILED )
+  {
+    PRINT_ERROR( "cRosUringInit() : Can't map the io_uring\n" );
+    if( ring->ring_map != MAP_FAILED )
+      munmap( ring->ring_map, ring->ring_map_size );
+    if( sqes != MAP_FAILED )
+      munmap( sqes, ring->sqes_size );
+    ring->ring_map = NULL;
+    close( fd );
+    return -1;
+  }
+
+  unsigned char *map = (unsigned char *)ring->ring_map;
+  ring->fd = fd;
+  ring->sqes = (struct io_uring_sqe *)sqes;
+  ring->sq_tail = (unsigned *)( map + params.sq_off.tail );
+  ring->sq_mask = (unsigned *)( map + params.sq_off.ring_mask );
+  ring->sq_array = (unsigned *)( map + params.sq_off.array );
+  ring->sq_entries = params.sq_entries;
+  ring->cq_head = (unsigned *)( map + params.cq_off.head );
+  ring->cq_tail = (unsigned *)( map + params.cq_off.tail );
+  ring->cq_mask = (unsigned *)( map + params.cq_off.ring_mask );
+  ring->cqes = (struct io_uring_cqe *)( map + params.cq_off.cqes );
+
+  return 0;
+}
+
+void cRosUringRelease( CrosUring *ring )
+{
+  PRINT_VDEBUG ( "cRosUringRelease()\n" );
+
+  if( ring->fd == -1 )
+    return;
+
+  // The buffers of the pending requests are released with the io_uring
+  munmap( ring->sqes, ring->sqes_size );
+  munmap( ring->ring_map, ring->ring_map_size );
+  close( ring->fd );
+  ring->fd = -1;
+
+  int i;
+  for( i = 0; i < CROS_URING_MAX_IO; i++ )
+  {
+    free( ring->io[i].send_buf );
+    ring->io[i].send_buf = NULL;
+  }
+  if( ring->recv_ring != NULL )
+  {
+    munmap( ring->recv_ring, CROS_URING_RECV_BUFFERS * sizeof(struct io_uring_buf) );
+    free( ring->recv_buffers );
+    ring->recv_ring = NULL;
+    ring->recv_buffers = NULL;
+  }
+}
+
+void cRosUringNotifyClose( int fd )
+{
+  if( fd >= 0 && fd < FD_SETSIZE )
+    __atomic_add_fetch( &fd_close_count[fd], 1, __ATOMIC_RELEASE );
+}
+
+static uint32_t getCloseCount( int fd )
+{
+  return __atomic_load_n( &fd_close_count[fd], __ATOMIC_ACQUIRE );
+}
+
+// Give a receive buffer (back) to the kernel
+static void provideRecvBuffer( CrosUring *ring, int buffer_id )
+{
+  struct io_uring_buf *buf = &ring->recv_ring->bufs[ring->recv_tail & ( CROS_URING_RECV_BUFFERS - 1 )];
+  buf->addr = (uint64_t)(uintptr_t)( ring->recv_buffers + (size_t)buffer_id * CROS_URING_RECV_BUFFER_SIZE );
+  buf->len = CROS_URING_RECV_BUFFER_SIZE;
+  buf->bid = (unsigned short)buffer_id;
+  ring->recv_tail++;
+  __atomic_store_n( &ring->recv_ring->tail, ring->recv_tail, __ATOMIC_RELEASE );
+}
+
+static int setupRecvBuffers( CrosUring *ring )
+{
+  size_t ring_size = CROS_URING_RECV_BUFFERS * sizeof(struct io_uring_buf);
+  void *buf_ring = mmap( NULL, ring_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0 );
+  unsigned char *buffers = (unsigned char *)malloc( (size_t)CROS_URING_RECV_BUFFERS * CROS_URING_RECV_BUFFER_SIZE );
+  if( buf_ring == MAP_FAILED || buffers == NULL )
+  {
+    PRINT_ERROR( "setupRecvBuffers() : Can't allocate the receive buffers\n" );
+    if( buf_ring != MAP_FAILED )
+      munmap( buf_ring, ring_size );
+    free( buffers );
+    return -1;
+  }
+
+  struct io_uring_buf_reg reg;
+  memset( &reg, 0, sizeof(reg) );
+  reg.ring_addr = (uint64_t)(uintptr_t)buf_ring;
+  reg.ring_entries = CROS_URING_RECV_BUFFERS;
+  reg.bgid = CROS_URING_RECV_GROUP;
+  if( syscall( __NR_io_uring_register, ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1 ) < 0 )
+  {
+    PRINT_INFO( "setupRecvBuffers() : io_uring can't provide the receive buffers, reading the sockets when ready\n" );
+    munmap( buf_ring, ring_size );
+    free( buffers );
+    return -1;
+  }
+
+  ring->recv_ring = (struct io_uring_buf_ring *)buf_ring;
+  ring->recv_buffers = buffers;
+  ring->recv_tail = 0;
+  int i;
+  for( i = 0; i < CROS_URING_RECV_BUFFERS; i++ )
+    provideRecvBuffer( ring, i );
+
+  return 0;
+}
+
+// Detach an entry from its closed socket: a submitted request is cancelled at the next cycle
+static void releaseIo( CrosUring *ring, CrosUringIo *io )
+{
+  if( ring->io_idx[io->fd] == (signed char)( io - ring->io ) )
+    ring->io_idx[io->fd] = -1;
+  io->fd = -1;
+
+  if( io->state == CROS_URING_IO_PENDING )
+  {
+    io->state = CROS_URING_IO_CANCEL;
+    return;
+  }
+
+  if( io->buffer_id >= 0 )
+    provideRecvBuffer( ring, io->buffer_id );
+  io->buffer_id = -1;
+  io->state = CROS_URING_IO_FREE;
+}
+
+// The entry of a socket, bound at its first receive or send. NULL if the socket can't use one
+static CrosUringIo *getIo( CrosUring *ring, int fd, int is_send )
+{
+  if( ring->fd == -1 || !ring->active || fd < 0 || fd >= FD_SETSIZE )
+    return NULL;
+
+  CrosUringIo *io;
+  if( ring->io_idx[fd] >= 0 )
+  {
+    io = &ring->io[(int)ring->io_idx[fd]];
+    if( io->close_count == getCloseCount( fd ) )
+      return ( io->is_send == is_send ) ? io : NULL;
+
+    // A new socket reuses the descriptor
+    releaseIo( ring, io );
+  }
+
+  if( !is_send && ring->recv_ring == NULL )
+  {
+    if( ring->recv_unavailable || setupRecvBuffers( ring ) < 0 )
+    {
+      ring->recv_unavailable = 1;
+      return NULL;
+    }
+  }
+
+  int i;
+  for( i = 0; i < CROS_URING_MAX_IO && ring->io[i].state != CROS_URING_IO_FREE; i++ );
+  if( i == CROS_URING_MAX_IO )
+    return NULL;
+
+  io = &ring->io[i];
+  if( is_send && io->send_buf == NULL &&
+      ( io->send_buf = (unsigned char *)malloc( CROS_URING_SEND_SIZE ) ) == NULL )
+    return NULL;
+
+  io->fd = fd;
+  io->is_send = is_send;
+  io->state = is_send ? CROS_URING_IO_IDLE : CROS_URING_IO_WANTED;
+  io->close_count = getCloseCount( fd );
+  io->result = 0;
+  io->buffer_id = -1;
+  io->send_size = io->send_offset = 0;
+  ring->io_idx[fd] = (signed char)i;
+  return io;
+}
+
+ssize_t cRosUringRecv( CrosUring *ring, int fd, const unsigned char **data )
+{
+  CrosUringIo *io = getIo( ring, fd, 0 );
+  if( io == NULL )
+  {
+    errno = ENOTSUP;
+    return -1;
+  }
+
+  if( io->state != CROS_URING_IO_DONE )
+  {
+    errno = EAGAIN;
+    return -1;
+  }
+
+  // The buffer is given back to the kernel, and the next receive queued, at the next cycle
+  io->state = CROS_URING_IO_WANTED;
+  if( io->result < 0 )
+  {
+    errno = -io->result;
+    return -1;
+  }
+
+  *data = ( io->buffer_id >= 0 ) ?
+          ring->recv_buffers + (size_t)io->buffer_id * CROS_URING_RECV_BUFFER_SIZE : NULL;
+  return io->result;
+}
+
+ssize_t cRosUringSend( CrosUring *ring, int fd, const struct iovec *iov, int iovcnt )
+{
+  CrosUringIo *io = getIo( ring, fd, 1 );
+  if( io == NULL )
+  {
+    errno = ENOTSUP;
+    return -1;
+  }
+
+  if( io->result < 0 )
+  {
+    errno = -io->result;
+    io->result = 0;
+    return -1;
+  }
+
+  if( io->state != CROS_URING_IO_IDLE )
+  {
+    errno = EAGAIN;
+    return -1;
+  }
+
+  size_t size = 0;
+  int i;
+  for( i = 0; i < iovcnt && size < CROS_URING_SEND_SIZE; i++ )
+  {
+    size_t len = iov[i].iov_len;
+    if( len > CROS_URING_SEND_SIZE - size )
+      len = CROS_URING_SEND_SIZE - size;
+    memcpy( io->send_buf + size, iov[i].iov_base, len );
+    size += len;
+  }
+
+  if( size > 0 )
+  {
+    io->send_size = size;
+    io->send_offset = 0;
+    io->state = CROS_URING_IO_WANTED;
+  }
+  return (ssize_t)size;
+}
+
+// Queue a request, submitting the queued ones first if the queue is full
+static struct io_uring_sqe *nextSqe( CrosUring *ring, unsigned *to_submit )
+{
+  if( *to_submit == ring->sq_entries )
+  {
+    if( uringEnter( ring, *to_submit, 0, 0, NULL, 0 ) < 0 )
+      return NULL;
+    *to_submit = 0;
+  }
+
+  (*to_submit)++;
+  return getSqe( ring );
+}
+
+static int queueIo( CrosUring *ring, CrosUringIo *io, unsigned *to_submit )
+{
+  struct io_uring_sqe *sqe = nextSqe( ring, to_submit );
+  if( sqe == NULL )
+    return -1;
+
+  ring->sequence++;
+  io->data = ( (uint64_t)ring->sequence << 32 ) | ( (uint64_t)( io - ring->io ) << 24 ) |
+             CROS_URING_IO_TAG | (uint32_t)io->fd;
+  sqe->fd = io->fd;
+  sqe->user_data = io->data;
+  if( io->is_send )
+  {
+    sqe->opcode = IORING_OP_SEND;
+    sqe->addr = (uint64_t)(uintptr_t)( io->send_buf + io->send_offset );
+    sqe->len = (uint32_t)( io->send_size - io->send_offset );
+    sqe->msg_flags = MSG_NOSIGNAL;
+  }
+  else
+  {
+    // The kernel picks a provided buffer when the data arrives
+    sqe->opcode = IORING_OP_RECV;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = CROS_URING_RECV_GROUP;
+    sqe->len = CROS_URING_RECV_BUFFER_SIZE;
+  }
+  io->state = CROS_URING_IO_PENDING;
+  return 0;
+}
+
+// Handle the completion of a receive or send: returns 1 if its socket is now ready
+static int completeIo( CrosUring *ring, const struct io_uring_cqe *cqe, unsigned *to_submit )
+{
+  CrosUringIo *io = &ring->io[( cqe->user_data >> 24 ) & 0xFF];
+  int buffer_id = ( cqe->flags & IORING_CQE_F_BUFFER ) ? (int)( cqe->flags >> IORING_CQE_BUFFER_SHIFT ) : -1;
+  if( io->data != cqe->user_data || ( io->state != CROS_URING_IO_PENDING &&
+      io->state != CROS_URING_IO_CANCEL && io->state != CROS_URING_IO_CANCELLING ) )
+    return 0;
+
+  if( io->state != CROS_URING_IO_PENDING )
+  {
+    // Completed or cancelled after the socket was closed
+    if( buffer_id >= 0 )
+      provideRecvBuffer( ring, buffer_id );
+    io->state = CROS_URING_IO_FREE;
+    return 0;
+  }
+
+  if( !io->is_send )
+  {
+    // No free buffer: the receive is queued again at the next cycle, after the buffers are given back
+    if( cqe->res == -ENOBUFS || cqe->res == -EAGAIN )
+    {
+      io->state = CROS_URING_IO_WANTED;
+      return 0;
+    }
+    io->result = cqe->res;
+    io->buffer_id = buffer_id;
+    io->state = CROS_URING_IO_DONE;
+    return 1;
+  }
+
+  if( cqe->res >= 0 || cqe->res == -EAGAIN )
+  {
+    io->send_offset += ( cqe->res > 0 ) ? (size_t)cqe->res : 0;
+    if( io->send_offset < io->send_size )
+    {
+      // Short send: the rest is submitted with the next io_uring_enter()
+      return ( queueIo( ring, io, to_submit ) < 0 ) ? -1 : 0;
+    }
+  }
+  else
+  {
+    io->result = cqe->res;
+  }
+  io->state = CROS_URING_IO_IDLE;
+  return 1;
+}
+
+int cRosUringSelect( CrosUring *ring, int nfds, fd_set *r_fds, fd_set *w_fds, fd_set *err_fds,
+                     uint64_t timeout_ms )
+{
+  PRINT_VDEBUG ( "cRosUringSelect()\n" );
+
+  if( ring->fd == -1 )
+  {
+    struct timeval tv = cRosClockGetTimeVal( timeout_ms );
+    return select( nfds, r_fds, w_fds, err_fds, &tv );
+  }
+  ring->active = 1;
+
+  // The sockets wake up their pollers with POLLPRI on every received data: io_uring reports it,
+  // while select() reports only the urgent data, never sent by ROS. So the exceptional conditions
+  // aren't checked, the errors and the hang-ups are reported as readiness for reading or writing
+  fd_set in_r_fds = *r_fds, in_w_fds = *w_fds;
+  FD_ZERO( r_fds );
+  FD_ZERO( w_fds );
+  FD_ZERO( err_fds );
+
+  unsigned to_submit = 0;
+  struct io_uring_sqe *sqe;
+  int i;
+
+  // The receives and sends of the closed sockets are cancelled, the buffers of the received data
+  // (copied by the owners of the sockets since the last cycle) are given back to the kernel
+  for( i = 0; i < CROS_URING_MAX_IO; i++ )
+  {
+    CrosUringIo *io = &ring->io[i];
+    if( io->fd != -1 && io->close_count != getCloseCount( io->fd ) )
+      releaseIo( ring, io );
+
+    if( io->state == CROS_URING_IO_CANCEL )
+    {
+      if( ( sqe = nextSqe( ring, &to_submit ) ) == NULL )
+        return -1;
+      sqe->opcode = IORING_OP_ASYNC_CANCEL;
+      sqe->addr = io->data;
+      sqe->user_data = CROS_URING_CANCEL_DATA;
+      io->state = CROS_URING_IO_CANCELLING;
+    }
+    else if( io->state == CROS_URING_IO_WANTED && io->buffer_id >= 0 )
+    {
+      provideRecvBuffer( ring, io->buffer_id );
+      io->buffer_id = -1;
+    }
+  }
+
+  int last_fd = ( nfds - 1 > ring->max_fd ) ? nfds - 1 : ring->max_fd;
+  int max_fd = -1;
+  int fd;
+  for( fd = 0; fd <= last_fd && fd < FD_SETSIZE; fd++ )
+  {
+    // The sockets that receive or send with completions aren't polled for it
+    int io_idx = ring->io_idx[fd];
+    unsigned events = 0;
+    if( fd < nfds )
+      events = ( ( FD_ISSET( fd, &in_r_fds ) && ( io_idx < 0 || ring->io[io_idx].is_send ) ) ? POLLIN : 0 ) |
+               ( ( FD_ISSET( fd, &in_w_fds ) && ( io_idx < 0 || !ring->io[io_idx].is_send ) ) ? POLLOUT : 0 );
+
+    // Only the poll of a closed socket is removed, and queued again for the new one
+    int closed = ( ring->poll_events[fd] != 0 && ring->poll_close_count[fd] != getCloseCount( fd ) );
+    if( events != ring->poll_events[fd] || closed )
+    {
+      if( ring->poll_events[fd] != 0 )
+      {
+        if( ( sqe = nextSqe( ring, &to_submit ) ) == NULL )
+          return -1;
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->addr = ring->poll_data[fd];
+        sqe->user_data = CROS_URING_CANCEL_DATA;
+        ring->poll_events[fd] = 0;
+      }
+
+      if( events != 0 )
+      {
+        if( ( sqe = nextSqe( ring, &to_submit ) ) == NULL )
+          return -1;
+        ring->sequence++;
+        ring->poll_data[fd] = ( (uint64_t)ring->sequence << 32 ) | (uint32_t)fd;
+        ring->poll_events[fd] = (unsigned char)events;
+        ring->poll_close_count[fd] = getCloseCount( fd );
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+        sqe->poll32_events = events;
+        sqe->user_data = ring->poll_data[fd];
+      }
+    }
+
+    if( ring->poll_events[fd] != 0 )
+      max_fd = fd;
+  }
+  ring->max_fd = max_fd;
+
+  // Queue the wanted receives and the data to send, report the completed ones
+  int n_set = 0;
+  for( i = 0; i < CROS_URING_MAX_IO; i++ )
+  {
+    CrosUringIo *io = &ring->io[i];
+    if( io->fd == -1 )
+      continue;
+
+    int wanted = ( io->fd < nfds ) && FD_ISSET( io->fd, io->is_send ? &in_w_fds : &in_r_fds );
+    if( io->state == CROS_URING_IO_WANTED && ( wanted || io->is_send ) &&
+        queueIo( ring, io, &to_submit ) < 0 )
+      return -1;
+
+    if( wanted && io->state == ( io->is_send ? CROS_URING_IO_IDLE : CROS_URING_IO_DONE ) )
+    {
+      FD_SET( io->fd, io->is_send ? w_fds : r_fds );
+      n_set++;
+    }
+  }
+
+  uint64_t deadline_us = UINT64_MAX;
+  uint64_t cur_time_us = cRosClockGetTimeUs();
+  if( n_set > 0 )
+    deadline_us = cur_time_us;
+  else if( timeout_ms < ( UINT64_MAX - cur_time_us ) / 1000 )
+    deadline_us = cur_time_us + timeout_ms * 1000;
+
+  while( 1 )
+  {
+    uint64_t wait_us = ( deadline_us > cur_time_us ) ? deadline_us - cur_time_us : 0;
+    struct __kernel_timespec ts;
+    ts.tv_sec = (int64_t)( wait_us / 1000000 );
+    ts.tv_nsec = (long long)( wait_us % 1000000 ) * 1000;
+    struct io_uring_getevents_arg arg;
+    memset( &arg, 0, sizeof(arg) );
+    arg.ts = (uint64_t)(uintptr_t)&ts;
+
+    // Submit the new requests and wait for a completion in the same call (if no socket is ready yet)
+    int ret = uringEnter( ring, to_submit, ( n_set > 0 ) ? 0 : 1,
+                          IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg) );
+    if( ret < 0 && errno != ETIME )
+      return -1;
+    to_submit = 0;
+
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n( ring->cq_tail, __ATOMIC_ACQUIRE );
+    for( ; head != tail; head++ )
+    {
+      const struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+      if( cqe->user_data == CROS_URING_CANCEL_DATA )
+        continue;
+
+      fd = (int)( cqe->user_data & CROS_URING_FD_MASK );
+      if( cqe->user_data & CROS_URING_IO_TAG )
+      {
+        int is_send = ring->io[( cqe->user_data >> 24 ) & 0xFF].is_send;
+        int ready = completeIo( ring, cqe, &to_submit );
+        if( ready < 0 )
+          return -1;
+        if( ready && fd < nfds && FD_ISSET( fd, is_send ? &in_w_fds : &in_r_fds ) )
+        {
+          FD_SET( fd, is_send ? w_fds : r_fds );
+          n_set++;
+        }
+        continue;
+      }
+
+      // The removed polls and the ones completed before their removal
+      if( fd >= FD_SETSIZE || ring->poll_events[fd] == 0 || ring->poll_data[fd] != cqe->user_data )
+        continue;
+
+      // A poll completes once: it is queued again at the next cycle, if the socket is still wanted
+      ring->poll_events[fd] = 0;
+
+      // A failed poll (e.g., EBADF) is reported as ready: the owner of the socket gets the error
+      unsigned revents = ( cqe->res < 0 ) ? ( POLLIN | POLLOUT | POLLERR ) : (unsigned)cqe->res;
+      if( FD_ISSET( fd, &in_r_fds ) && ( revents & ( POLLIN | POLLHUP | POLLERR ) ) )
+      {
+        FD_SET( fd, r_fds );
+        n_set++;
+      }
+      if( FD_ISSET( fd, &in_w_fds ) && ( revents & ( POLLOUT | POLLHUP | POLLERR ) ) )
+      {
+        FD_SET( fd, w_fds );
+        n_set++;
+      }
+    }
+    __atomic_store_n( ring->cq_head, head, __ATOMIC_RELEASE );
+
+    // Only the cancellations (or short sends) completed: wait until the deadline
+    cur_time_us = cRosClockGetTimeUs();
+    if( n_set > 0 || ( ret < 0 && errno == ETIME ) || cur_time_us >= deadline_us )
+      break;
+  }
+
+  // Short sends queued by the last completions
+  if( to_submit > 0 && uringEnter( ring, to_submit, 0, 0, NULL, 0 ) < 0 )
+    return -1;
+
+  return n_set;
+}
+
+#endif // CROS_USE_IO_URING
@@ -7,6 +7,44 @@
 
 enum { DYNBUFFER_INIT_SIZE = 256, DYNBUFFER_GROW_RATE = 2 };
 
+// Make room for at least n more bytes at the end of the buffer
+static int reserveSpace ( DynBuffer *d_buf, size_t n )
+{
+  if ( d_buf->data == NULL )
+  {
+    PRINT_DEBUG ( "reserveSpace() : allocate memory for the first time\n" );
+    d_buf->data = ( unsigned char * ) malloc ( DYNBUFFER_INIT_SIZE * sizeof ( unsigned char ) );
+
+    if ( d_buf->data == NULL )
+    {
+      PRINT_ERROR ( "reserveSpace() : Can't allocate memory\n" );
+      return -1;
+    }
+
+    d_buf->size = 0;
+    d_buf->max = DYNBUFFER_INIT_SIZE;
+  }
+
+  size_t new_max = d_buf->max;
+  while ( d_buf->size + n > new_max )
+    new_max *= DYNBUFFER_GROW_RATE;
+
+  if ( new_max != d_buf->max )
+  {
+    PRINT_DEBUG ( "reserveSpace() : reallocate memory\n" );
+    unsigned char *new_d_buf = ( unsigned char * ) realloc ( d_buf->data, new_max * sizeof ( unsigned char ) );
+    if ( new_d_buf == NULL )
+    {
+      PRINT_ERROR ( "reserveSpace() : Can't allocate more memory\n" );
+      return -1;
+    }
+    d_buf->max = new_max;
+    d_buf->data = new_d_buf;
+  }
+
+  return 0;
+}
+
 void dynBufferInit ( DynBuffer *d_buf )
 {
   PRINT_VDEBUG ( "dynBufferInit()\n" );
@@ -39,34 +77,8 @@ int dynBufferPushBackBuf ( DynBuffer *d_buf, const unsigned char *new_buf, size_
     return -1;
   }
 
-  if ( d_buf->data == NULL )
-  {
-    PRINT_DEBUG ( "dynBufferPushBackBuf() : allocate memory for the first time\n" );
-    d_buf->data = ( unsigned char * ) malloc ( DYNBUFFER_INIT_SIZE * sizeof ( unsigned char ) );
-
-    if ( d_buf->data == NULL )
-    {
-      PRINT_ERROR ( "dynBufferPushBackBuf() : Can't allocate memory\n" );
-      return -1;
-    }
-
-    d_buf->size = 0;
-    d_buf->max = DYNBUFFER_INIT_SIZE;
-  }
-
-  while ( d_buf->size + n > d_buf->max )
-  {
-    PRINT_DEBUG ( "dynBufferPushBackBuf() : reallocate memory\n" );
-    unsigned char *new_d_buf = ( unsigned char * ) realloc ( d_buf->data, ( DYNBUFFER_GROW_RATE * d_buf->max ) * 
-                                                                             sizeof ( unsigned char ) );
-    if ( new_d_buf == NULL )
-    {
-      PRINT_ERROR ( "dynBufferPushBackBuf() : Can't allocate more memory\n" );
-      return -1;
-    }
-    d_buf->max *= DYNBUFFER_GROW_RATE;
-    d_buf->data = new_d_buf;
-  }
+  if ( reserveSpace ( d_buf, n ) == -1 )
+    return -1;
 
   memcpy ( ( void * ) ( d_buf->data + d_buf->size ), ( void * ) new_buf, n );
   d_buf->size += n;
@@ -155,6 +167,51 @@ void dynBufferClear ( DynBuffer *d_buf )
   d_buf->pos_offset = 0;
 }
 
+unsigned char *dynBufferReserve ( DynBuffer *d_buf, size_t n )
+{
+  PRINT_VDEBUG ( "dynBufferReserve()\n" );
+
+  if ( reserveSpace ( d_buf, n ) == -1 )
+    return NULL;
+
+  return d_buf->data + d_buf->size;
+}
+
+void dynBufferCommit ( DynBuffer *d_buf, size_t n )
+{
+  PRINT_VDEBUG ( "dynBufferCommit()\n" );
+
+  if ( d_buf->size + n > d_buf->max )
+    n = d_buf->max - d_buf->size;
+
+  d_buf->size += n;
+}
+
+void dynBufferCompact ( DynBuffer *d_buf )
+{
+  PRINT_VDEBUG ( "dynBufferCompact()\n" );
+
+  if ( d_buf->pos_offset == 0 )
+    return;
+
+  size_t remaining = d_buf->size - d_buf->pos_offset;
+  if ( remaining > 0 )
+    memmove ( d_buf->data, d_buf->data + d_buf->pos_offset, remaining );
+
+  d_buf->size = remaining;
+  d_buf->pos_offset = 0;
+}
+
+void dynBufferInitView ( DynBuffer *d_buf, const unsigned char *data, size_t size )
+{
+  PRINT_VDEBUG ( "dynBufferInitView()\n" );
+
+  d_buf->data = ( unsigned char * ) data;
+  d_buf->size = size;
+  d_buf->pos_offset = 0;
+  d_buf->max = size;
+}
+
 size_t dynBufferGetSize ( DynBuffer *d_buf )
 {
   PRINT_VDEBUG ( "dynBufferGetSize()\n" );
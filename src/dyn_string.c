@@ -103,7 +103,8 @@ int dynStringPushBackChar ( DynString *d_str, const char c )
     d_str->max = DYNSTRING_INIT_SIZE;
   }
 
-  if ( d_str->len + 1 > d_str->max )
+  // One more byte for the terminator
+  if ( d_str->len + 2 > d_str->max )
   {
     PRINT_DEBUG ( "dynStringPushBackChar() : reallocate memory\n" );
     char *n_d_str = ( char * ) realloc ( d_str->data, ( DYNSTRING_GROW_RATE * d_str->max ) * 
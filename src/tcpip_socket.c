@@ -1,6 +1,7 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <netinet/tcp.h>
 #include <string.h>
 #include <fcntl.h>
@@ -8,6 +9,7 @@
 #include <stdlib.h>
 
 #include "tcpip_socket.h"
+#include "cros_uring.h"
 #include "cros_defs.h"
 #include "cros_log.h"
 
@@ -17,6 +19,7 @@ void tcpIpSocketInit ( TcpIpSocket *s )
 {
   PRINT_VDEBUG ( "tcpIpSocketInit()\n" );
   s->fd = -1;
+  s->family = AF_INET;
   s->port = 0;
   memset ( & ( s->adr ), 0, sizeof ( struct sockaddr_in ) );
   s->open = 0;
@@ -37,15 +40,44 @@ int tcpIpSocketOpen ( TcpIpSocket *s )
   else
     s->open = 1;
 
+  s->family = AF_INET;
   return ( s->fd != -1 );
 }
 
+int tcpIpSocketOpenUnix ( TcpIpSocket *s )
+{
+  PRINT_VDEBUG ( "tcpIpSocketOpenUnix()\n" );
+  if ( s->open )
+    return 1;
+
+  s->fd = socket ( AF_UNIX, SOCK_STREAM, 0 );
+  if ( s->fd == -1 )
+    PRINT_ERROR ( "tcpIpSocketOpenUnix() : Can't open a socket\n" );
+  else
+    s->open = 1;
+
+  s->family = AF_UNIX;
+  return ( s->fd != -1 );
+}
+
+static int fillUnixAddress ( struct sockaddr_un *adr, const char *path )
+{
+  memset ( adr, 0, sizeof ( struct sockaddr_un ) );
+  adr->sun_family = AF_UNIX;
+  if ( strlen ( path ) >= sizeof ( adr->sun_path ) )
+    return 0;
+
+  strcpy ( adr->sun_path, path );
+  return 1;
+}
+
 void tcpIpSocketClose ( TcpIpSocket *s )
 {
   PRINT_VDEBUG ( "tcpIpSocketClose()\n" );
   if ( !s->open )
     return;
 
+  cRosUringNotifyClose ( s->fd );
   close ( s->fd );
   tcpIpSocketInit ( s );
 }
@@ -167,6 +199,11 @@ TcpIpSocketState tcpIpSocketConnect ( TcpIpSocket *s, const char *host, unsigned
       PRINT_DEBUG ( "tcpIpSocketConnect() : connection in progress\n");
       return TCPIPSOCKET_IN_PROGRESS;
     }
+    else if ( s->is_nonblocking && errno == EISCONN )
+    {
+      // The asynchronous connection has been completed after a previous call
+      PRINT_DEBUG ( "tcpIpSocketConnect() : connection completed\n");
+    }
     else
     {
       PRINT_ERROR ( "tcpIpSocketConnect() : Connect failed, errno %d\n", errno );
@@ -184,6 +221,51 @@ TcpIpSocketState tcpIpSocketConnect ( TcpIpSocket *s, const char *host, unsigned
   return TCPIPSOCKET_DONE;
 }
 
+TcpIpSocketState tcpIpSocketConnectUnix ( TcpIpSocket *s, const char *path )
+{
+  PRINT_VDEBUG ( "tcpIpSocketConnectUnix()\n" );
+
+  if ( !s->open || s->family != AF_UNIX )
+  {
+    PRINT_ERROR ( "tcpIpSocketConnectUnix() : Unix domain socket not opened\n" );
+    return TCPIPSOCKET_FAILED;
+  }
+
+  if( s->connected )
+    return TCPIPSOCKET_DONE;
+
+  struct sockaddr_un adr;
+  if ( !fillUnixAddress ( &adr, path ) )
+  {
+    PRINT_ERROR ( "tcpIpSocketConnectUnix() : Path too long %s\n", path );
+    return TCPIPSOCKET_FAILED;
+  }
+
+  if ( connect ( s->fd, ( struct sockaddr * ) &adr, sizeof ( struct sockaddr_un ) ) == -1 )
+  {
+    if ( s->is_nonblocking && errno == EINPROGRESS )
+    {
+      PRINT_DEBUG ( "tcpIpSocketConnectUnix() : connection in progress\n");
+      return TCPIPSOCKET_IN_PROGRESS;
+    }
+    else if ( s->is_nonblocking && errno == EISCONN )
+    {
+      PRINT_DEBUG ( "tcpIpSocketConnectUnix() : connection completed\n");
+    }
+    else
+    {
+      PRINT_ERROR ( "tcpIpSocketConnectUnix() : Connect failed, errno %d\n", errno );
+      s->connected = 0;
+      return TCPIPSOCKET_FAILED;
+    }
+  }
+
+  s->port = 0;
+  s->connected = 1;
+
+  return TCPIPSOCKET_DONE;
+}
+
 int tcpIpSocketDisconnect ( TcpIpSocket *s )
 {
   PRINT_VDEBUG ( "tcpIpSocketDisconnect()\n" );
@@ -257,6 +339,47 @@ int tcpIpSocketBindListen( TcpIpSocket *s, const char *host, unsigned short port
   return 1;
 }
 
+int tcpIpSocketBindListenUnix( TcpIpSocket *s, const char *path, int backlog )
+{
+  PRINT_VDEBUG ( "tcpIpSocketBindListenUnix()\n" );
+
+  if ( !s->open || s->family != AF_UNIX )
+  {
+    PRINT_ERROR ( "tcpIpSocketBindListenUnix() : Unix domain socket not opened\n" );
+    return 0;
+  }
+
+  if ( !s->listening )
+  {
+    struct sockaddr_un adr;
+    if ( !fillUnixAddress ( &adr, path ) )
+    {
+      PRINT_ERROR ( "tcpIpSocketBindListenUnix() : Path too long %s\n", path );
+      return 0;
+    }
+
+    // Left by a process that didn't exit cleanly
+    unlink ( path );
+
+    if ( bind ( s->fd, ( struct sockaddr * ) &adr, sizeof ( struct sockaddr_un ) ) == -1 )
+    {
+      PRINT_ERROR ( "tcpIpSocketBindListenUnix() : Bind failed\n" );
+      return 0;
+    }
+
+    if ( listen ( s->fd, backlog ) == -1 )
+    {
+      PRINT_ERROR ( "tcpIpSocketBindListenUnix() : Listen failed\n" );
+      return 0;
+    }
+
+    s->port = 0;
+    s->listening = 1;
+  }
+
+  return 1;
+}
+
 TcpIpSocketState tcpIpSocketAccept ( TcpIpSocket *s, TcpIpSocket *new_s )
 {
   PRINT_VDEBUG ( "tcpIpSocketAccept()\n" );
@@ -272,7 +395,9 @@ TcpIpSocketState tcpIpSocketAccept ( TcpIpSocket *s, TcpIpSocket *new_s )
   struct sockaddr_in new_adr;
   socklen_t new_adr_len = sizeof(struct sockaddr);
 
-  int new_fd = accept ( s->fd, ( struct sockaddr * ) &new_adr, &new_adr_len );
+  memset ( &new_adr, 0, sizeof ( struct sockaddr_in ) );
+  int new_fd = accept ( s->fd, ( s->family == AF_INET ) ? ( struct sockaddr * ) &new_adr : NULL,
+                        ( s->family == AF_INET ) ? &new_adr_len : NULL );
 
   if ( new_fd == -1 )
   {
@@ -280,7 +405,8 @@ TcpIpSocketState tcpIpSocketAccept ( TcpIpSocket *s, TcpIpSocket *new_s )
        ( errno == EWOULDBLOCK || errno == EINPROGRESS || errno == EAGAIN ) )
     {
       PRINT_DEBUG ( "tcpIpSocketAccept() : Accept in progress\n");
-      state = TCPIPSOCKET_IN_PROGRESS;
+      // No pending connection: leave new_s untouched
+      return TCPIPSOCKET_IN_PROGRESS;
     }
     else
     {
@@ -293,6 +419,7 @@ TcpIpSocketState tcpIpSocketAccept ( TcpIpSocket *s, TcpIpSocket *new_s )
     tcpIpSocketClose ( new_s );
   
   new_s->fd = new_fd;
+  new_s->family = s->family;
   new_s->adr = new_adr;
   new_s->port = s->port;
   new_s->open = 1;
@@ -346,6 +473,44 @@ TcpIpSocketState tcpIpSocketWriteBuffer ( TcpIpSocket *s, DynBuffer *d_buf )
   return TCPIPSOCKET_DONE;
 }
 
+TcpIpSocketState tcpIpSocketWriteIov ( TcpIpSocket *s, const struct iovec *iov, int iovcnt, size_t *n_written )
+{
+  PRINT_VDEBUG ( "tcpIpSocketWriteIov()\n" );
+
+  *n_written = 0;
+
+  if ( !s->connected )
+  {
+    PRINT_ERROR ( "tcpIpSocketWriteIov() : Socket not connected\n" );
+    return TCPIPSOCKET_FAILED;
+  }
+
+  ssize_t ret = writev ( s->fd, iov, iovcnt );
+
+  if ( ret >= 0 )
+  {
+    *n_written = ( size_t ) ret;
+    return TCPIPSOCKET_DONE;
+  }
+  else if ( s->is_nonblocking &&
+            ( errno == EWOULDBLOCK || errno == EINPROGRESS || errno == EAGAIN ) )
+  {
+    PRINT_DEBUG ( "tcpIpSocketWriteIov() : write in progress\n" );
+    return TCPIPSOCKET_IN_PROGRESS;
+  }
+  else if ( errno == ENOTCONN || errno == ECONNRESET || errno == EPIPE )
+  {
+    PRINT_DEBUG ( "tcpIpSocketWriteIov() : socket disconnectd\n" );
+    s->connected = 0;
+    return  TCPIPSOCKET_DISCONNECTED;
+  }
+  else
+  {
+    PRINT_ERROR ( "tcpIpSocketWriteIov() : Write failed\n" );
+    return TCPIPSOCKET_FAILED;
+  }
+}
+
 TcpIpSocketState tcpIpSocketWriteString ( TcpIpSocket *s, DynString *d_str )
 {
   PRINT_VDEBUG ( "tcpIpSocketWriteString()\n" );
@@ -408,7 +573,8 @@ TcpIpSocketState tcpIpSocketReadBufferEx( TcpIpSocket *s, DynBuffer *d_buf, size
     return TCPIPSOCKET_FAILED;
   }
 
-  unsigned char *read_buf = (unsigned char *)malloc(max_size);
+  // Receive directly into the free space of the buffer
+  unsigned char *read_buf = dynBufferReserve ( d_buf, max_size );
   if (!read_buf)
   {
     PRINT_ERROR("Out of memory while reading from socket");
@@ -426,7 +592,7 @@ TcpIpSocketState tcpIpSocketReadBufferEx( TcpIpSocket *s, DynBuffer *d_buf, size
   else if ( reads > 0 )
   {
     PRINT_DEBUG ( "tcpIpSocketReadBufferEx() : read %d bytes \n", reads );
-    dynBufferPushBackBuf ( d_buf, read_buf, reads );
+    dynBufferCommit ( d_buf, reads );
     state = TCPIPSOCKET_DONE;
     *n_reads = reads;
   }
@@ -448,8 +614,6 @@ TcpIpSocketState tcpIpSocketReadBufferEx( TcpIpSocket *s, DynBuffer *d_buf, size
     state = TCPIPSOCKET_FAILED;
   }
 
-  free(read_buf);
-
   return state;
 }
 
@@ -5,17 +5,26 @@ void tcprosProcessInit( TcprosProcess *p )
 {
   p->state = TCPROS_PROCESS_STATE_IDLE;
   tcpIpSocketInit( &(p->socket) );
-  dynStringInit( &(p->topic) );
   dynStringInit( &(p->caller_id) );
-  dynStringInit( &(p->service) );
-  dynStringInit( &(p->type) );
-  dynStringInit( &(p->md5sum) );
   dynBufferInit( &(p->packet) );
+  dynBufferInit( &(p->send_queue) );
+  p->n_send_queued = 0;
+  p->busy_since = 0;
+  p->lagging = 0;
+  p->write_after_us = 0;
   p->latching = p->tcp_nodelay = p->persistent = 0;
   p->last_change_time = 0;
   p->wake_up_time_ms = 0;
   p->topic_idx = -1;
+  p->service_idx = -1;
   p->left_to_recv = 0;
+  p->probe = 0;
+  p->call_id = -1;
+  p->connection_id = -1;
+  p->connect_time = p->last_activity_time = 0;
+  p->bytes_sent = p->bytes_received = 0;
+  p->msgs_sent = p->msgs_received = 0;
+  p->drops = 0;
 }
 
 void tcprosProcessRelease( TcprosProcess *p )
@@ -23,11 +32,9 @@ void tcprosProcessRelease( TcprosProcess *p )
   if( p->socket.connected )
     tcpIpSocketDisconnect( &(p->socket) );
   
-  dynStringRelease( &(p->topic) );
   dynStringRelease( &(p->caller_id) );
-  dynStringRelease( &(p->type) );
-  dynStringRelease( &(p->md5sum) );
   dynBufferRelease( &(p->packet) );
+  dynBufferRelease( &(p->send_queue) );
 }
 
 void tcprosProcessClear( TcprosProcess *p , int fullreset)
@@ -37,11 +44,7 @@ void tcprosProcessClear( TcprosProcess *p , int fullreset)
 
   if (fullreset)
   {
-    dynStringClear( &(p->topic) );
     dynStringClear( &(p->caller_id) );
-    dynStringClear( &(p->service) );
-    dynStringClear( &(p->type) );
-    dynStringClear( &(p->md5sum) );
     p->latching = 0;
     p->tcp_nodelay = 0;
     p->persistent = 0;
@@ -49,9 +52,25 @@ void tcprosProcessClear( TcprosProcess *p , int fullreset)
     p->last_change_time = 0;
     p->wake_up_time_ms = 0;
     p->topic_idx = -1;
+    p->call_id = -1;
+    p->connection_id = -1;
+    dynBufferClear( &(p->send_queue) );
+    p->n_send_queued = 0;
+    p->busy_since = 0;
+    p->lagging = 0;
+    p->write_after_us = 0;
   }
 }
 
+void tcprosProcessStartConnection( TcprosProcess *p, int connection_id )
+{
+  p->connection_id = connection_id;
+  p->connect_time = p->last_activity_time = cRosClockGetTimeMs();
+  p->bytes_sent = p->bytes_received = 0;
+  p->msgs_sent = p->msgs_received = 0;
+  p->drops = 0;
+}
+
 void tcprosProcessChangeState( TcprosProcess *p, TcprosProcessState state )
 {
   p->state = state;
@@ -120,10 +120,82 @@ static void timeToXml ( void *val, DynString *message )
   exit ( EXIT_FAILURE );
 }
 
-static void binaryToXml ( void *val, DynString *message )
+static const char base64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static void binaryToXml ( XmlrpcParam *val, DynString *message )
 {
-  PRINT_ERROR ( "binaryToXml() : Not yet implemented! (FATAL ERROR) \n" );
-  exit ( EXIT_FAILURE );
+  dynStringPushBackStr ( message, XMLRPC_VALUE_TAG.str );
+  dynStringPushBackStr ( message, XMLRPC_BASE64_TAG.str );
+
+  const unsigned char *data = val->data.as_binary;
+  int i;
+  for ( i = 0; i < val->binary_size; i += 3 )
+  {
+    uint32_t block = data[i] << 16;
+    if ( i + 1 < val->binary_size )
+      block |= data[i + 1] << 8;
+    if ( i + 2 < val->binary_size )
+      block |= data[i + 2];
+
+    char out[5];
+    out[0] = base64_chars[( block >> 18 ) & 0x3F];
+    out[1] = base64_chars[( block >> 12 ) & 0x3F];
+    out[2] = ( i + 1 < val->binary_size ) ? base64_chars[( block >> 6 ) & 0x3F] : '=';
+    out[3] = ( i + 2 < val->binary_size ) ? base64_chars[block & 0x3F] : '=';
+    out[4] = '\0';
+    dynStringPushBackStr ( message, out );
+  }
+
+  dynStringPushBackStr ( message, XMLRPC_BASE64_ETAG.str );
+  dynStringPushBackStr ( message, XMLRPC_VALUE_ETAG.str );
+}
+
+static int base64Value ( char c )
+{
+  if ( c >= 'A' && c <= 'Z' ) return c - 'A';
+  if ( c >= 'a' && c <= 'z' ) return c - 'a' + 26;
+  if ( c >= '0' && c <= '9' ) return c - '0' + 52;
+  if ( c == '+' ) return 62;
+  if ( c == '/' ) return 63;
+  return -1;
+}
+
+/* Decode n base64 characters, skipping white spaces and padding. Returns the decoded size, -1 on failure */
+static int binaryFromBase64 ( const char *str, int n, unsigned char **data )
+{
+  *data = ( unsigned char * ) malloc ( n * 3 / 4 + 1 );
+  if ( *data == NULL )
+  {
+    PRINT_ERROR ( "binaryFromBase64() : Can't allocate memory\n" );
+    return -1;
+  }
+
+  uint32_t block = 0;
+  int n_bits = 0, size = 0, i;
+  for ( i = 0; i < n; i++ )
+  {
+    int v = base64Value ( str[i] );
+    if ( v < 0 )
+    {
+      if ( str[i] == '=' || str[i] == ' ' || str[i] == '\n' || str[i] == '\r' || str[i] == '\t' )
+        continue;
+
+      PRINT_ERROR ( "binaryFromBase64() : not valid value\n" );
+      free ( *data );
+      *data = NULL;
+      return -1;
+    }
+
+    block = ( block << 6 ) | v;
+    n_bits += 6;
+    if ( n_bits >= 8 )
+    {
+      n_bits -= 8;
+      ( *data )[size++] = ( block >> n_bits ) & 0xFF;
+    }
+  }
+
+  return size;
 }
 
 int paramFromXml (DynString *message, XmlrpcParam *param,  ParamContainerType container)
@@ -403,9 +475,6 @@ int paramValueFromXml (DynString *message, XmlrpcParam *param,  ParamContainerTy
     else if ( len - i >= XMLRPC_BASE64_TAG.dim &&
               strncmp ( c, XMLRPC_BASE64_TAG.str, XMLRPC_BASE64_TAG.dim ) == 0 )
     {
-      PRINT_ERROR ( "paramFromXml() : Tag %s not yet implemented! (FATAL ERROR) \n", XMLRPC_BASE64_TAG.str );
-      exit ( EXIT_FAILURE );
-
       c += XMLRPC_BASE64_TAG.dim;
       i += XMLRPC_BASE64_TAG.dim;
       type_init = c;
@@ -523,7 +592,7 @@ int paramValueFromXml (DynString *message, XmlrpcParam *param,  ParamContainerTy
     }
     case XMLRPC_PARAM_BINARY:
     {
-      // TODO Implement me!
+      str_init = type_init;
       break;
     }
     case XMLRPC_PARAM_STRUCT:
@@ -664,6 +733,26 @@ int paramValueFromXml (DynString *message, XmlrpcParam *param,  ParamContainerTy
     else
       xmlrpcParamSetStringN ( param, str_init, str_len );
   }
+  else if( p_type == XMLRPC_PARAM_BINARY )
+  {
+    unsigned char *data;
+    int size = binaryFromBase64 ( str_init, str_len, &data );
+    if ( size < 0 )
+      return -1;
+
+    if (container == PARAM_CONTAINER_ARRAY)
+      param = arrayAddElem ( param );
+
+    if ( param == NULL )
+    {
+      free ( data );
+      return -1;
+    }
+
+    param->type = XMLRPC_PARAM_BINARY;
+    param->data.as_binary = data;
+    param->binary_size = size;
+  }
 
   return 0;
 }
@@ -817,6 +906,12 @@ char *xmlrpcParamGetString( XmlrpcParam *param )
   return param->data.as_string;
 }
 
+unsigned char *xmlrpcParamGetBinary( XmlrpcParam *param, int *size )
+{
+  *size = param->binary_size;
+  return param->data.as_binary;
+}
+
 void xmlrpcParamSetUnknown ( XmlrpcParam *param )
 {
   PRINT_VDEBUG ( "xmlrpcParamSetUnknown()\n" );
@@ -892,6 +987,24 @@ void xmlrpcParamSetStringN ( XmlrpcParam *param, const char *val, int n )
   PRINT_DEBUG ( "xmlrpcSetStringN() : Set: %s\n", param->data.as_string );
 }
 
+void xmlrpcParamSetBinary ( XmlrpcParam *param, const void *val, int n )
+{
+  PRINT_VDEBUG ( "xmlrpcParamSetBinary()\n" );
+
+  param->type = XMLRPC_PARAM_BINARY;
+  param->binary_size = 0;
+  param->data.as_binary = ( unsigned char * ) malloc ( n > 0 ? n : 1 );
+  if ( param->data.as_binary == NULL )
+  {
+    PRINT_ERROR ( "xmlrpcParamSetBinary() : Can't allocate memory\n" );
+    return;
+  }
+
+  if ( n > 0 )
+    memcpy ( param->data.as_binary, val, n );
+  param->binary_size = n;
+}
+
 int xmlrpcParamArrayGetSize( XmlrpcParam *param )
 {
   if( param->type == XMLRPC_PARAM_ARRAY)
@@ -1001,6 +1114,17 @@ XmlrpcParam * xmlrpcParamArrayPushBackStringN ( XmlrpcParam *param, const char *
   return new_param;
 }
 
+XmlrpcParam * xmlrpcParamArrayPushBackBinary ( XmlrpcParam *param, const void *val, int n )
+{
+  PRINT_VDEBUG ( "xmlrpcParamArrayPushBackBinary()\n" );
+  XmlrpcParam *new_param = arrayAddElem ( param );
+  if ( new_param == NULL )
+    return NULL;
+
+  xmlrpcParamSetBinary ( new_param, val, n );
+  return new_param;
+}
+
 XmlrpcParam *xmlrpcParamArrayPushBackArray ( XmlrpcParam *param )
 {
   PRINT_VDEBUG ( "xmlrpcParamArrayPushBackArray()\n" );
@@ -1141,6 +1265,7 @@ void xmlrpcParamInit( XmlrpcParam *param )
   param->type = XMLRPC_PARAM_UNKNOWN;
   param->member_name =  NULL;
   memset(param->data.opaque, 0, sizeof(param->data.opaque));
+  param->binary_size = 0;
   param->array_n_elem = -1;
   param->array_max_elem = -1;
 }
@@ -1177,8 +1302,16 @@ void xmlrpcParamRelease ( XmlrpcParam *param )
     param->array_max_elem = 0;
     break;
 
+  case XMLRPC_PARAM_BINARY:
+    if ( param->data.as_binary != NULL )
+    {
+      free ( param->data.as_binary );
+      param->data.as_binary = NULL;
+    }
+    param->binary_size = 0;
+    break;
+
   case XMLRPC_PARAM_DATETIME: /* WARNING: Currently unsupported */
-  case XMLRPC_PARAM_BINARY: /* WARNING: Currently unsupported */
     PRINT_ERROR ( "xmlrpcParamReleaseData() : Parameter type not yet supported (FATAL ERROR) \n" );
     exit ( EXIT_FAILURE );
     break;
@@ -1228,7 +1361,7 @@ void xmlrpcParamToXml ( XmlrpcParam *param, DynString *message )
     timeToXml ( param->data.as_time, message );
     break;
   case XMLRPC_PARAM_BINARY:
-    binaryToXml ( param->data.as_binary, message );
+    binaryToXml ( param, message );
     break;
   case XMLRPC_PARAM_UNKNOWN:
     break;
@@ -1293,8 +1426,11 @@ static void paramPrint( XmlrpcParam *param, char *head )
     printf("=========End array=========\n\n");
     break;
 
+  case XMLRPC_PARAM_BINARY:
+    printf("%s type : base64 Size : [%d]\n", head, param->binary_size );
+    break;
+
   case XMLRPC_PARAM_DATETIME: /* WARNING: Currently unsupported */
-  case XMLRPC_PARAM_BINARY: /* WARNING: Currently unsupported */
   case XMLRPC_PARAM_STRUCT: /* WARNING: Currently unsupported */
     PRINT_ERROR ( "xmlrpcParamPrint() : Parameter type not yet supported\n" );
     break;
@@ -1381,8 +1517,13 @@ int xmlrpcParamCopy(XmlrpcParam *dest, XmlrpcParam *source)
           goto clean;
       }
       break;
-    case XMLRPC_PARAM_DATETIME:
     case XMLRPC_PARAM_BINARY:
+      dest->data.as_binary = (unsigned char *)malloc(source->binary_size > 0 ? source->binary_size : 1);
+      if (dest->data.as_binary == NULL)
+        goto clean;
+      memcpy(dest->data.as_binary, source->data.as_binary, source->binary_size);
+      break;
+    case XMLRPC_PARAM_DATETIME:
       PRINT_ERROR ( "xmlrpcParamToXml() : Unsupported type\n" );
       assert(0);
       break;